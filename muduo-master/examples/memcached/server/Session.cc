@@ -259,12 +259,6 @@ bool Session::processRequest(StringPiece request)
     }
     outputBuf_.append("END\r\n");
 
-    if (conn_->outputBuffer()->writableBytes() > 65536 + outputBuf_.readableBytes())
-    {
-      LOG_DEBUG << "shrink output buffer from " << conn_->outputBuffer()->internalCapacity();
-      conn_->outputBuffer()->shrink(65536 + outputBuf_.readableBytes());
-    }
-
     conn_->send(&outputBuf_);
   }
   else if (command_ == "delete")
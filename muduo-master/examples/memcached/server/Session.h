@@ -40,7 +40,7 @@ class Session : boost::noncopyable,
   {
     LOG_INFO << "requests processed: " << requestsProcessed_
              << " input buffer size: " << conn_->inputBuffer()->internalCapacity()
-             << " output buffer size: " << conn_->outputBuffer()->internalCapacity();
+             << " output bytes: " << conn_->outputBytes();
   }
 
  private:
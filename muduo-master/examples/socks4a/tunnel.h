@@ -120,7 +120,7 @@ class Tunnel : public boost::enable_shared_from_this<Tunnel>,
 
     if (which == kServer)
     {
-      if (serverConn_->outputBuffer()->readableBytes() > 0)
+      if (serverConn_->outputBytes() > 0)
       {
         clientConn_->stopRead();
         serverConn_->setWriteCompleteCallback(
@@ -130,7 +130,7 @@ class Tunnel : public boost::enable_shared_from_this<Tunnel>,
     }
     else
     {
-      if (clientConn_->outputBuffer()->readableBytes() > 0)
+      if (clientConn_->outputBytes() > 0)
       {
         serverConn_->stopRead();
         clientConn_->setWriteCompleteCallback(
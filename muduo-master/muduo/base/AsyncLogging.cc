@@ -1,60 +1,244 @@
 #include <muduo/base/AsyncLogging.h>
+#include <muduo/base/BinaryLogging.h>
+#include <muduo/base/CurrentThread.h>
 #include <muduo/base/LogFile.h>
 #include <muduo/base/Timestamp.h>
 
+#include <algorithm>
+
+#include <sched.h>
 #include <stdio.h>
 
 using namespace muduo;
 
+namespace
+{
+const int kMaxFreeBuffers = 32;
+const size_t kMinFreeBuffers = 2;
+const size_t kMaxFullBuffers = 25;
+const int kMaxSpins = 64;
+int g_nextLoggingId = 0;
+
+// the other side holds it for a moment, unless it is preempted
+void lockStaging(int* busy)
+{
+  int spins = 0;
+  while (__atomic_exchange_n(busy, 1, __ATOMIC_ACQUIRE))
+  {
+    if (++spins < kMaxSpins)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    }
+    else
+    {
+      ::sched_yield();
+    }
+  }
+}
+}
+
+__thread int AsyncLogging::t_loggingId_ = 0;
+__thread AsyncLogging::Staging* AsyncLogging::t_staging_ = NULL;
+
 AsyncLogging::AsyncLogging(const string& basename,
                            size_t rollSize,
                            int flushInterval)
-  : flushInterval_(flushInterval),
+  : id_(__atomic_add_fetch(&g_nextLoggingId, 1, __ATOMIC_RELAXED)),
+    flushInterval_(flushInterval),
     running_(false),
+    binary_(false),
     basename_(basename),
     rollSize_(rollSize),
     thread_(boost::bind(&AsyncLogging::threadFunc, this), "Logging"),
     latch_(1),
     mutex_(),
     cond_(mutex_),
-    currentBuffer_(new Buffer),
-    nextBuffer_(new Buffer),
-    buffers_()
+    numFull_(0),
+    freeBuffers_(kMaxFreeBuffers)
 {
-  currentBuffer_->bzero();
-  nextBuffer_->bzero();
-  buffers_.reserve(16);
+  MCHECK(pthread_key_create(&exitKey_, &AsyncLogging::onThreadExit));
+  refill(0);
 }
 
-//前台线程，所有LOG_* 最终都会调用该append函数，将日志信息缓存到AsyncLogging的buffer中 
-//前台线程将currentBuffer_ 、nextBuffer_ 两个buffer 都用掉了。
-void AsyncLogging::append(const char* logline, int len)
+AsyncLogging::~AsyncLogging()
 {
-  //可能有多个线程同时调用LOG_*写入日志，所以需要同步
-  muduo::MutexLockGuard lock(mutex_);
-  //currentBuffer还足够大，可以装下一条日志内容
-  if (currentBuffer_->avail() > len)
+  if (running_)
+  {
+    stop();
+  }
+  MCHECK(pthread_key_delete(exitKey_));
+  for (std::map<pid_t, Staging*>::iterator it = stagings_.begin();
+       it != stagings_.end(); ++it)
+  {
+    Staging* s = it->second;
+    for (size_t i = 0; i < s->full.size(); ++i)
+    {
+      delete s->full[i];
+    }
+    delete s->buffer;
+    delete s;
+  }
+  Buffer* buffer = NULL;
+  while (freeBuffers_.tryTake(&buffer))
   {
-    currentBuffer_->append(logline, len);
+    delete buffer;
   }
-  else//currentBuffer已满，要将之存放到buffers_中
+}
+
+// the backend keeps spares, a logging thread allocates only if it runs out
+AsyncLogging::Buffer* AsyncLogging::newBuffer()
+{
+  Buffer* buffer = NULL;
+  if (!freeBuffers_.tryTake(&buffer))
   {
-    buffers_.push_back(currentBuffer_.release());
+    buffer = new Buffer;
+  }
+  return buffer;
+}
 
-    if (nextBuffer_)
+// 后台线程预先分配并清零，把缺页留在后台
+void AsyncLogging::refill(size_t numFull)
+{
+  // as many as were filled last time, they will be filled again
+  size_t target = std::min(numFull + kMinFreeBuffers, static_cast<size_t>(kMaxFreeBuffers));
+  while (freeBuffers_.size() < target)
+  {
+    Buffer* buffer = new Buffer;
+    buffer->bzero();
+    if (!freeBuffers_.tryPut(buffer))
     {
-      currentBuffer_ = boost::ptr_container::move(nextBuffer_);
+      delete buffer;
+      break;
     }
-    else
+  }
+  // a burst doesn't keep its buffers for good
+  Buffer* buffer = NULL;
+  while (freeBuffers_.size() > target && freeBuffers_.tryTake(&buffer))
+  {
+    delete buffer;
+  }
+}
+
+void AsyncLogging::onThreadExit(void* staging)
+{
+  __atomic_store_n(&static_cast<Staging*>(staging)->exited, true, __ATOMIC_RELEASE);
+  // logging from a later destructor registers again
+  t_loggingId_ = 0;
+}
+
+// 当前线程的staging，第一次append时创建
+AsyncLogging::Staging* AsyncLogging::staging()
+{
+  if (t_loggingId_ != id_)
+  {
+    MutexLockGuard lock(mutex_);
+    Staging*& staging = stagings_[CurrentThread::tid()];
+    if (staging == NULL)
     {
-      currentBuffer_.reset(new Buffer); // Rarely happens
+      staging = new Staging;
     }
-    currentBuffer_->append(logline, len);
+    // the same tid, the backend has not freed it yet
+    __atomic_store_n(&staging->exited, false, __ATOMIC_RELAXED);
+    MCHECK(pthread_setspecific(exitKey_, staging));
+    t_staging_ = staging;
+    t_loggingId_ = id_;
+  }
+  return t_staging_;
+}
+
+//前台线程，所有LOG_* 最终都会调用该append函数，将日志信息缓存到本线程的buffer中
+void AsyncLogging::append(const char* logline, int len)
+{
+  Staging* s = staging();
+  // only the backend takes it, for a moment, every flushInterval
+  lockStaging(&s->busy);
+  if (s->buffer == NULL)
+  {
+    s->buffer = newBuffer();
+  }
+  bool full = false;
+  //buffer还足够大，可以装下一条日志内容
+  if (s->buffer->avail() <= len)
+  {
+    // kept with the partial one, so the backend takes both in order
+    s->full.push_back(s->buffer);
+    s->buffer = newBuffer();
+    // before the backend can take it
+    __atomic_fetch_add(&numFull_, 1, __ATOMIC_RELAXED);
+    full = true;
+  }
+  s->buffer->append(logline, len);
+  __atomic_store_n(&s->busy, 0, __ATOMIC_RELEASE);
+
+  if (full)
+  {
     //通知后台线程，已经有一个满的buffer了，可以将其输出到日志文件了
+    MutexLockGuard lock(mutex_);
     cond_.notify();
   }
 }
 
+// 取走所有满的buffer，以及各线程未满的buffer，返回满的个数
+// full ones come first, a thread's partial one after its full ones
+size_t AsyncLogging::takeBuffers(BufferVector* buffers)
+{
+  BufferVector partial;
+  MutexLockGuard lock(mutex_);
+  for (std::map<pid_t, Staging*>::iterator it = stagings_.begin();
+       it != stagings_.end(); )
+  {
+    Staging* s = it->second;
+    // checked first, its last lines are taken below
+    bool exited = __atomic_load_n(&s->exited, __ATOMIC_ACQUIRE);
+    // skips a busy one, it will be taken next time
+    if (!__atomic_exchange_n(&s->busy, 1, __ATOMIC_ACQUIRE))
+    {
+      buffers->insert(buffers->end(), s->full.begin(), s->full.end());
+      __atomic_fetch_sub(&numFull_, s->full.size(), __ATOMIC_RELAXED);
+      s->full.clear();
+      if (s->buffer != NULL && s->buffer->length() > 0)
+      {
+        partial.push_back(s->buffer);
+        // an idle thread holds no buffer
+        s->buffer = NULL;
+      }
+      __atomic_store_n(&s->busy, 0, __ATOMIC_RELEASE);
+      if (exited)
+      {
+        // an empty buffer may be left
+        if (s->buffer != NULL && !freeBuffers_.tryPut(s->buffer))
+        {
+          delete s->buffer;
+        }
+        delete s;
+        stagings_.erase(it++);
+        continue;
+      }
+    }
+    ++it;
+  }
+  const size_t numFull = buffers->size();
+  buffers->insert(buffers->end(), partial.begin(), partial.end());
+  return numFull;
+}
+
+// 写完的buffer还给前台线程
+void AsyncLogging::recycle(BufferVector* buffers)
+{
+  for (size_t i = 0; i < buffers->size(); ++i)
+  {
+    Buffer* buffer = (*buffers)[i];
+    buffer->reset();
+    if (!freeBuffers_.tryPut(buffer))
+    {
+      delete buffer;
+    }
+  }
+  buffers->clear();
+}
+
 /**
  * 在threadFunc中调用了LogFile对象的append(...)函数，该函数将日志信息写入到日志文件
  * 并实现日志滚动功能。该函数将日志记录的buffer从前台线程转移到后台线程，后台线程进行异步
@@ -66,55 +250,43 @@ void AsyncLogging::threadFunc()
   latch_.countDown();
   //定义一个直接进行IO(输出日志到文件)的LogFile对象 output.append()函数会完成日志输出
   LogFile output(basename_, rollSize_, false);
-  //两个后台线程的buffer
-  BufferPtr newBuffer1(new Buffer);
-  BufferPtr newBuffer2(new Buffer);
-  newBuffer1->bzero();
-  newBuffer2->bzero();
-  //用来和前台的buffers_进行swap
   BufferVector buffersToWrite;
   buffersToWrite.reserve(16);
-  //循环，从AsyncLogging的对象的buffers_中取出已满的buffer将其中数据输出到日志文件
-  while (running_)
+  BinaryLogDecoder decoder;
+  string text;
+  bool running = true;
+  while (running)
   {
-    assert(newBuffer1 && newBuffer1->length() == 0);
-    assert(newBuffer2 && newBuffer2->length() == 0);
     assert(buffersToWrite.empty());
+    running = running_;
 
     {
       muduo::MutexLockGuard lock(mutex_);
-      if (buffers_.empty())  // unusual usage!
+      if (running && __atomic_load_n(&numFull_, __ATOMIC_RELAXED) == 0)  // unusual usage!
       {
-        //睡眠的时间是日志库flush的时间,当cond_的条件满足时，即前台线程已经将一个满的buffer放到buffers_中了
+        //睡眠的时间是日志库flush的时间,当cond_的条件满足时，即前台线程已经将一个满的buffer放到fullBuffers_中了
         //或者超时了，waitForSeconds会从阻塞中返回，继续执行后续代码。
         cond_.waitForSeconds(flushInterval_);
       }
-      /**无论cond是因何醒来，都要将currentBuffer_放到buffers_中。
-       * 如果是因为时间到而醒，那么currentBuffer_还未满，此时也要将其写入到LogFile中；
-       * 如果已经有一个前台buffer满了，那么在前台线程中就已经把这个已满的buffer放到buffers_中了，
-       * 此时还是需要把currentBuffer_放到buffers_中（注意前后放置的不同的buffer，因为在前台线程中
-       * currentBuffer_已经被换成nextBuffer_指向的buffer中了）
-       */
-      buffers_.push_back(currentBuffer_.release());
-      currentBuffer_ = boost::ptr_container::move(newBuffer1);//归还一个buffer
-      buffersToWrite.swap(buffers_);//交换
-      if (!nextBuffer_)
-      {
-        nextBuffer_ = boost::ptr_container::move(newBuffer2);//如果需要归还第二个buffer
-      }
     }
+    //无论cond是因何醒来，都要把各线程未满的buffer也写入到LogFile中
+    size_t numFull = takeBuffers(&buffersToWrite);
 
-    assert(!buffersToWrite.empty());
-
-    if (buffersToWrite.size() > 25)
+    // counts full buffers only, every thread adds a partial one
+    if (numFull > kMaxFullBuffers)
     {
       char buf[256];
       snprintf(buf, sizeof buf, "Dropped log messages at %s, %zd larger buffers\n",
                Timestamp::now().toFormattedString().c_str(),
-               buffersToWrite.size()-2);
+               numFull-2);
       fputs(buf, stderr);
       output.append(buf, static_cast<int>(strlen(buf)));
-      buffersToWrite.erase(buffersToWrite.begin()+2, buffersToWrite.end());
+      for (size_t i = 2; i < numFull; ++i)
+      {
+        // drop non-bzero-ed buffers, avoid trashing
+        delete buffersToWrite[i];
+      }
+      buffersToWrite.erase(buffersToWrite.begin() + 2, buffersToWrite.begin() + numFull);
     }
 
     //将已经满了的buffer内容写入到LogFile进行IO操作。
@@ -122,33 +294,22 @@ void AsyncLogging::threadFunc()
     {
       // FIXME: use unbuffered stdio FILE ? or use ::writev ?
       //append 函数进行磁盘IO,阻塞型IO
-      output.append(buffersToWrite[i].data(), buffersToWrite[i].length());
-    }
-
-    if (buffersToWrite.size() > 2)
-    {
-      // drop non-bzero-ed buffers, avoid trashing
-      buffersToWrite.resize(2);
-    }
-
-    //前台buffer是由newBuffer1,newBuffer2归还的。现在把buffersToWrite中的buffer归还给后台buffer（newBuffer1,newBuffer2）
-    if (!newBuffer1)
-    {
-      assert(!buffersToWrite.empty());
-      newBuffer1 = buffersToWrite.pop_back();
-      newBuffer1->reset();
-    }
-
-    if (!newBuffer2)
-    {
-      assert(!buffersToWrite.empty());
-      newBuffer2 = buffersToWrite.pop_back();
-      newBuffer2->reset();
+      if (binary_)
+      {
+        // 格式化推迟到后台线程
+        text.clear();
+        decoder.decode(buffersToWrite[i]->data(), buffersToWrite[i]->length(), &text);
+        output.append(text.data(), static_cast<int>(text.size()));
+      }
+      else
+      {
+        output.append(buffersToWrite[i]->data(), buffersToWrite[i]->length());
+      }
     }
 
-    buffersToWrite.clear();
+    recycle(&buffersToWrite);
+    refill(numFull);
     output.flush();//flush 日志内容到磁盘
   }
   output.flush();
 }
-
@@ -1,21 +1,35 @@
 #ifndef MUDUO_BASE_ASYNCLOGGING_H
 #define MUDUO_BASE_ASYNCLOGGING_H
 
-#include <muduo/base/BlockingQueue.h>
-#include <muduo/base/BoundedBlockingQueue.h>
 #include <muduo/base/CountDownLatch.h>
+#include <muduo/base/MpmcQueue.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Thread.h>
 #include <muduo/base/LogStream.h>
 
 #include <boost/bind.hpp>
 #include <boost/noncopyable.hpp>
-#include <boost/scoped_ptr.hpp>
-#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <map>
+#include <vector>
+
+#include <pthread.h>
 
 namespace muduo
 {
 
+///
+/// Every thread appends to a 4MB staging buffer of its own, without
+/// a lock shared by threads, and keeps its full buffers until the
+/// backend takes them, together with the partial one, every flushInterval
+/// or as soon as one is full.
+///
+/// Lines of one thread stay in order, those of different threads are
+/// interleaved by buffers, not by time.
+///
+/// The backend allocates spare buffers ahead, a thread which exits
+/// leaves its staging buffer to the backend, which frees it.
+///
 class AsyncLogging : boost::noncopyable
 {
  public:
@@ -24,16 +38,14 @@ class AsyncLogging : boost::noncopyable
                size_t rollSize,
                int flushInterval = 3);
 
-  ~AsyncLogging()
-  {
-    if (running_)
-    {
-      stop();
-    }
-  }
+  ~AsyncLogging();
 
   void append(const char* logline, int len);
 
+  /// The backend decodes records of BinaryLogger, see BinaryLogging.h,
+  /// call before start().
+  void setBinary(bool on) { binary_ = on; }
+
   //启动线程 并执行线程函数
   void start()
   {
@@ -60,11 +72,33 @@ class AsyncLogging : boost::noncopyable
   void threadFunc();//thread_ 变量的 thread func
 
   typedef muduo::detail::FixedBuffer<muduo::detail::kLargeBuffer> Buffer;//4000000个固定字节的buffer
-  typedef boost::ptr_vector<Buffer> BufferVector;//Buffer 指针类型的vector
-  typedef BufferVector::auto_type BufferPtr;//Buffer 类型的指针
+  typedef std::vector<Buffer*> BufferVector;
+
+  // buffer of one thread
+  struct Staging
+  {
+    Staging() : busy(0), exited(false), buffer(NULL) { }
+
+    int busy; /* atomic, spin lock of the owner thread, and the backend */
+    bool exited; /* atomic, the backend frees it after taking the buffer */
+    Buffer* buffer;  // NULL until the thread appends
+    BufferVector full;  // guarded by busy, older than buffer
+  };
+
+  Staging* staging();
+  Buffer* newBuffer();
+  size_t takeBuffers(BufferVector* buffers);
+  void recycle(BufferVector* buffers);
+  void refill(size_t numFull);
+  static void onThreadExit(void* staging);
+
+  static __thread int t_loggingId_;
+  static __thread Staging* t_staging_;
 
+  const int id_;  // unique, in case a new AsyncLogging takes the address
   const int flushInterval_;
   bool running_;
+  bool binary_;
 
   string basename_;//basename_即为程序名
   size_t rollSize_;//滚动日志文件大小
@@ -74,9 +108,10 @@ class AsyncLogging : boost::noncopyable
   muduo::MutexLock mutex_;
   muduo::Condition cond_;
 
-  BufferPtr currentBuffer_;//Buffer ptr
-  BufferPtr nextBuffer_;//Buffer ptr
-  BufferVector buffers_;//Buffer ptr vector
+  std::map<pid_t, Staging*> stagings_;  // guarded by mutex_, by tid
+  pthread_key_t exitKey_;  // marks the Staging of an exiting thread
+  size_t numFull_; /* atomic, in all stagings, wakes the backend */
+  MpmcQueue<Buffer*> freeBuffers_;  // back from the backend
 };
 
 }
@@ -0,0 +1,255 @@
+#include <muduo/base/BinaryLogging.h>
+
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Timestamp.h>
+
+#include <stdio.h>
+#include <string.h>
+
+namespace muduo
+{
+
+// in Logging.cc
+extern const char* LogLevelName[Logger::NUM_LOG_LEVELS];
+extern Logger::OutputFunc g_output;
+extern TimeZone g_logTimeZone;
+
+namespace
+{
+
+// '\0', length, site id, time, tid
+const int kHeaderSize = 1 + 4 + 4 + 8 + 4;
+
+const uint32_t kMaxSites = 16384;
+LogSite* g_sites[kMaxSites];
+uint32_t g_numSites = 0; /* atomic */
+MutexLock g_sitesMutex;
+
+template<typename T>
+bool get(const char** p, const char* end, T* v)
+{
+  if (static_cast<size_t>(end - *p) < sizeof(T))
+  {
+    return false;
+  }
+  memcpy(v, *p, sizeof(T));
+  *p += sizeof(T);
+  return true;
+}
+
+// 缺省在前台线程解码，和LOG_*一样输出文本，只为能用，快要靠AsyncLogging::setBinary
+void defaultBinaryOutput(const char* msg, int len)
+{
+  BinaryLogDecoder decoder;
+  string text;
+  decoder.decode(msg, len, &text);
+  g_output(text.data(), static_cast<int>(text.size()));
+}
+
+Logger::OutputFunc g_binaryOutput = defaultBinaryOutput;
+
+}
+
+}
+
+using namespace muduo;
+
+BinaryLogger::BinaryLogger(LogSite* site)
+{
+  uint32_t id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+  if (id == 0)
+  {
+    registerSite(site);
+    id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+  }
+  // time and tid as they are, formatted by the decoder
+  int64_t now = Timestamp::now().microSecondsSinceEpoch();
+  int32_t tid = CurrentThread::tid();
+  uint32_t length = 0;  // filled by the dtor
+  char header[kHeaderSize];
+  header[0] = '\0';
+  memcpy(header + 1, &length, sizeof length);
+  memcpy(header + 5, &id, sizeof id);
+  memcpy(header + 9, &now, sizeof now);
+  memcpy(header + 17, &tid, sizeof tid);
+  stream_.buffer().append(header, kHeaderSize);
+}
+
+BinaryLogger::~BinaryLogger()
+{
+  BinaryLogStream::Buffer& buf(stream_.buffer());
+  uint32_t length = static_cast<uint32_t>(buf.length());
+  memcpy(buf.current() - length + 1, &length, sizeof length);
+  g_binaryOutput(buf.data(), buf.length());
+}
+
+void BinaryLogger::setOutput(Logger::OutputFunc out)
+{
+  g_binaryOutput = out;
+}
+
+void BinaryLogger::registerSite(LogSite* site)
+{
+  MutexLockGuard lock(g_sitesMutex);
+  // if the table is full, id stays 0, the decoder prints it as an INFO
+  if (__atomic_load_n(&site->id, __ATOMIC_RELAXED) == 0 && g_numSites < kMaxSites)
+  {
+    g_sites[g_numSites] = site;
+    __atomic_store_n(&g_numSites, g_numSites + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&site->id, g_numSites, __ATOMIC_RELEASE);
+  }
+}
+
+const LogSite* BinaryLogger::site(uint32_t id)
+{
+  if (id == 0 || id > __atomic_load_n(&g_numSites, __ATOMIC_ACQUIRE))
+  {
+    return NULL;
+  }
+  return g_sites[id - 1];
+}
+
+BinaryLogDecoder::BinaryLogDecoder()
+  : timeZone_(g_logTimeZone),
+    lastSecond_(-1)
+{
+}
+
+BinaryLogDecoder::BinaryLogDecoder(const TimeZone& tz)
+  : timeZone_(tz),
+    lastSecond_(-1)
+{
+}
+
+void BinaryLogDecoder::decode(const char* data, size_t len, string* output)
+{
+  const char* end = data + len;
+  while (data < end)
+  {
+    if (*data == '\0')
+    {
+      data = decodeRecord(data, end);
+      output->append(stream_.buffer().data(), stream_.buffer().length());
+    }
+    else
+    {
+      // a line of LOG_*
+      const void* eol = memchr(data, '\n', end - data);
+      const char* next = eol ? static_cast<const char*>(eol) + 1 : end;
+      output->append(data, next - data);
+      data = next;
+    }
+  }
+}
+
+// the same as Logger::Impl, see Logging.cc
+const char* BinaryLogDecoder::decodeRecord(const char* data, const char* end)
+{
+  stream_.resetBuffer();
+  uint32_t length = 0;
+  uint32_t id = 0;
+  int64_t time = 0;
+  int32_t tid = 0;
+  const char* p = data + 1;
+  if (!get(&p, end, &length) || !get(&p, end, &id) || !get(&p, end, &time)
+      || !get(&p, end, &tid) || length < kHeaderSize
+      || length > static_cast<size_t>(end - data))
+  {
+    return end;  // truncated, gives up the rest
+  }
+  const char* recordEnd = data + length;
+
+  formatTime(time);
+  char buf[32];
+  int n = snprintf(buf, sizeof buf, "%5d ", tid);
+  stream_.append(buf, n);
+  const LogSite* site = BinaryLogger::site(id);
+  stream_.append(LogLevelName[site ? site->level : Logger::INFO], 6);
+  if (site && site->func)
+  {
+    stream_ << site->func << ' ';
+  }
+
+  while (p < recordEnd)
+  {
+    char tag = *p++;
+    int64_t i = 0;
+    double d = 0;
+    uint32_t len = 0;
+    bool ok = true;
+    switch (tag)
+    {
+      case BinaryLogStream::kSigned:
+        if ((ok = get(&p, recordEnd, &i)))
+          stream_ << i;
+        break;
+      case BinaryLogStream::kUnsigned:
+        if ((ok = get(&p, recordEnd, &i)))
+          stream_ << static_cast<uint64_t>(i);
+        break;
+      case BinaryLogStream::kPointer:
+        if ((ok = get(&p, recordEnd, &i)))
+          stream_ << reinterpret_cast<const void*>(static_cast<uintptr_t>(i));
+        break;
+      case BinaryLogStream::kDouble:
+        if ((ok = get(&p, recordEnd, &d)))
+          stream_ << d;
+        break;
+      case BinaryLogStream::kChar:
+        if ((ok = p < recordEnd))
+          stream_ << *p++;
+        break;
+      case BinaryLogStream::kString:
+        if ((ok = get(&p, recordEnd, &len) && len <= static_cast<size_t>(recordEnd - p)))
+        {
+          stream_.append(p, static_cast<int>(len));
+          p += len;
+        }
+        break;
+      default:
+        ok = false;
+    }
+    if (!ok)
+    {
+      break;
+    }
+  }
+
+  if (site)
+  {
+    const char* slash = strrchr(site->file, '/');
+    stream_ << " - " << (slash ? slash + 1 : site->file) << ':' << site->line << '\n';
+  }
+  else
+  {
+    stream_ << " - (unknown):0\n";
+  }
+  return recordEnd;
+}
+
+void BinaryLogDecoder::formatTime(int64_t microSecondsSinceEpoch)
+{
+  time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / Timestamp::kMicroSecondsPerSecond);
+  int microseconds = static_cast<int>(microSecondsSinceEpoch % Timestamp::kMicroSecondsPerSecond);
+  if (seconds != lastSecond_)
+  {
+    lastSecond_ = seconds;
+    struct tm tm_time;
+    if (timeZone_.valid())
+    {
+      tm_time = timeZone_.toLocalTime(seconds);
+    }
+    else
+    {
+      ::gmtime_r(&seconds, &tm_time);
+    }
+    snprintf(time_, sizeof(time_), "%4d%02d%02d %02d:%02d:%02d",
+        tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+        tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+  }
+
+  stream_.append(time_, 17);
+  Fmt us(timeZone_.valid() ? ".%06d " : ".%06dZ ", microseconds);
+  stream_.append(us.data(), us.length());
+}
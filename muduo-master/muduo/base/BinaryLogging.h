@@ -0,0 +1,210 @@
+#ifndef MUDUO_BASE_BINARYLOGGING_H
+#define MUDUO_BASE_BINARYLOGGING_H
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/TimeZone.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Where a BLOG_* is, one static per call site, registered on first use.
+/// The id goes into every record instead of file, line and level.
+///
+struct LogSite
+{
+  const char* file;
+  int line;
+  Logger::LogLevel level;
+  const char* func;  // NULL except TRACE and DEBUG
+  uint32_t id; /* atomic, 0 until registered */
+};
+
+///
+/// Deferred formatting, like LogStream, but it records arguments
+/// as they are in memory, with a type tag each, nothing is formatted
+/// in the logging thread. Strings are copied, numbers and time are not
+/// converted, until BinaryLogDecoder does in the background.
+///
+/// A record is '\0', uint32 length, uint32 site id, int64 time, int32 tid,
+/// then tagged arguments. It starts with '\0', so decoders pass through
+/// text lines of LOG_* in the same output.
+///
+class BinaryLogStream : boost::noncopyable
+{
+  typedef BinaryLogStream self;
+ public:
+  typedef detail::FixedBuffer<detail::kSmallBuffer> Buffer;
+
+  // type tags
+  enum Tag
+  {
+    kSigned = 'i',
+    kUnsigned = 'u',
+    kDouble = 'd',
+    kChar = 'c',
+    kPointer = 'p',
+    kString = 's'
+  };
+
+  self& operator<<(bool v) { return putInteger(kSigned, v ? 1 : 0); }
+  self& operator<<(short v) { return putInteger(kSigned, v); }
+  self& operator<<(unsigned short v) { return putInteger(kUnsigned, v); }
+  self& operator<<(int v) { return putInteger(kSigned, v); }
+  self& operator<<(unsigned int v) { return putInteger(kUnsigned, v); }
+  self& operator<<(long v) { return putInteger(kSigned, v); }
+  self& operator<<(unsigned long v) { return putInteger(kUnsigned, v); }
+  self& operator<<(long long v) { return putInteger(kSigned, v); }
+  self& operator<<(unsigned long long v) { return putInteger(kUnsigned, v); }
+
+  self& operator<<(const void* p)
+  {
+    return putInteger(kPointer, reinterpret_cast<uintptr_t>(p));
+  }
+
+  self& operator<<(float v) { return operator<<(static_cast<double>(v)); }
+  self& operator<<(double v) { return put(kDouble, &v, sizeof v); }
+  self& operator<<(char v) { return put(kChar, &v, sizeof v); }
+
+  self& operator<<(const char* str)
+  {
+    return str ? putString(str, strlen(str)) : putString("(null)", 6);
+  }
+
+  self& operator<<(const unsigned char* str)
+  {
+    return operator<<(reinterpret_cast<const char*>(str));
+  }
+
+  self& operator<<(const string& v) { return putString(v.data(), v.size()); }
+#ifndef MUDUO_STD_STRING
+  self& operator<<(const std::string& v) { return putString(v.data(), v.size()); }
+#endif
+  self& operator<<(const StringPiece& v) { return putString(v.data(), v.size()); }
+  self& operator<<(const Fmt& fmt) { return putString(fmt.data(), fmt.length()); }
+
+  const Buffer& buffer() const { return buffer_; }
+  Buffer& buffer() { return buffer_; }
+
+ private:
+  template<typename T>
+  self& putInteger(Tag tag, T v)
+  {
+    int64_t x = static_cast<int64_t>(v);
+    return put(tag, &x, sizeof x);
+  }
+
+  self& put(Tag tag, const void* data, size_t len)
+  {
+    if (static_cast<size_t>(buffer_.avail()) > len + 1)
+    {
+      char* p = buffer_.current();
+      *p = static_cast<char>(tag);
+      memcpy(p + 1, data, len);
+      buffer_.add(len + 1);
+    }
+    return *this;
+  }
+
+  self& putString(const char* str, size_t len)
+  {
+    uint32_t n = static_cast<uint32_t>(len);
+    if (static_cast<size_t>(buffer_.avail()) > len + sizeof n + 1)
+    {
+      char* p = buffer_.current();
+      *p = static_cast<char>(kString);
+      memcpy(p + 1, &n, sizeof n);
+      memcpy(p + 1 + sizeof n, str, len);
+      buffer_.add(len + sizeof n + 1);
+    }
+    return *this;
+  }
+
+  Buffer buffer_;
+};
+
+///
+/// Writes one binary record, to the output of setOutput(), by default
+/// it decodes the record, and writes text to the output of Logger.
+///
+class BinaryLogger : boost::noncopyable
+{
+ public:
+  explicit BinaryLogger(LogSite* site);
+  ~BinaryLogger();
+
+  BinaryLogStream& stream() { return stream_; }
+
+  /// eg. AsyncLogging::append of one with setBinary(true),
+  /// whose backend decodes the records.
+  static void setOutput(Logger::OutputFunc);
+
+  /// site of an id in records, NULL if unknown
+  static const LogSite* site(uint32_t id);
+
+ private:
+  static void registerSite(LogSite* site);
+
+  BinaryLogStream stream_;
+};
+
+///
+/// Turns records of BinaryLogger into lines of Logger, and passes through
+/// lines of Logger. Not thread safe, one for each backend.
+///
+class BinaryLogDecoder : boost::noncopyable
+{
+ public:
+  /// in the time zone of Logger::setTimeZone()
+  BinaryLogDecoder();
+  explicit BinaryLogDecoder(const TimeZone& tz);
+
+  /// Appends text of records and lines in @c data to @c output.
+  /// @c data must end at end of a record or a line.
+  void decode(const char* data, size_t len, string* output);
+
+ private:
+  const char* decodeRecord(const char* data, const char* end);
+  void formatTime(int64_t microSecondsSinceEpoch);
+
+  TimeZone timeZone_;
+  time_t lastSecond_;
+  char time_[72];  // fits six %d fields at their widest, so snprintf never truncates
+  LogStream stream_;
+};
+
+}
+
+#define MUDUO_LOG_SITE(level, func) \
+  ({ static muduo::LogSite muduo_log_site_ = { __FILE__, __LINE__, level, func, 0 }; \
+     &muduo_log_site_; })
+
+#define BLOG_TRACE if (muduo::Logger::logLevel() <= muduo::Logger::TRACE) \
+  muduo::BinaryLogger(MUDUO_LOG_SITE(muduo::Logger::TRACE, __func__)).stream()
+#define BLOG_DEBUG if (muduo::Logger::logLevel() <= muduo::Logger::DEBUG) \
+  muduo::BinaryLogger(MUDUO_LOG_SITE(muduo::Logger::DEBUG, __func__)).stream()
+#define BLOG_INFO if (muduo::Logger::logLevel() <= muduo::Logger::INFO) \
+  muduo::BinaryLogger(MUDUO_LOG_SITE(muduo::Logger::INFO, NULL)).stream()
+#define BLOG_WARN muduo::BinaryLogger(MUDUO_LOG_SITE(muduo::Logger::WARN, NULL)).stream()
+#define BLOG_ERROR muduo::BinaryLogger(MUDUO_LOG_SITE(muduo::Logger::ERROR, NULL)).stream()
+
+// Define MUDUO_BINARY_LOG before including any muduo header, and LOG_TRACE
+// to LOG_ERROR of that file become binary, LOG_FATAL and LOG_SYS* do not.
+#ifdef MUDUO_BINARY_LOG
+#undef LOG_TRACE
+#undef LOG_DEBUG
+#undef LOG_INFO
+#undef LOG_WARN
+#undef LOG_ERROR
+#define LOG_TRACE BLOG_TRACE
+#define LOG_DEBUG BLOG_DEBUG
+#define LOG_INFO BLOG_INFO
+#define LOG_WARN BLOG_WARN
+#define LOG_ERROR BLOG_ERROR
+#endif
+
+#endif  // MUDUO_BASE_BINARYLOGGING_H
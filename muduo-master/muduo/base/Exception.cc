@@ -42,16 +42,23 @@ void Exception::fillStackTrace()
   const int len = 200;
   void* buffer[len];
   int nptrs = ::backtrace(buffer, len);
-  char** strings = ::backtrace_symbols(buffer, nptrs);
+  stack_ = stackTrace(buffer, nptrs);
+}
+
+string Exception::stackTrace(void* const* frames, int numFrames)
+{
+  string stack;
+  char** strings = ::backtrace_symbols(frames, numFrames);
   if (strings)
   {
-    for (int i = 0; i < nptrs; ++i)
+    for (int i = 0; i < numFrames; ++i)
     {
       // TODO demangle funcion name with abi::__cxa_demangle
-      stack_.append(strings[i]);
-      stack_.push_back('\n');
+      stack.append(strings[i]);
+      stack.push_back('\n');
     }
     free(strings);
   }
+  return stack;
 }
 
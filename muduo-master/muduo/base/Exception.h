@@ -21,6 +21,9 @@ class Exception : public std::exception
   virtual const char* what() const throw();
   const char* stackTrace() const throw();
 
+  /// Symbolizes frames captured by backtrace(3), one line each.
+  static string stackTrace(void* const* frames, int numFrames);
+
  private:
   void fillStackTrace();
 
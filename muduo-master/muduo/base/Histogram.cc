@@ -0,0 +1,85 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/base/Histogram.h>
+
+#include <algorithm>
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <strings.h>  // bzero
+
+using namespace muduo;
+
+const int Histogram::kSubBits;
+const int Histogram::kSubBuckets;
+const int Histogram::kMaxExponent;
+const int Histogram::kNumBuckets;
+
+Histogram::Histogram()
+  : count_(0),
+    sum_(0),
+    max_(0)
+{
+  ::bzero(counts_, sizeof counts_);
+}
+
+double Histogram::mean() const
+{
+  int64_t n = count();
+  return n > 0 ? static_cast<double>(sum()) / static_cast<double>(n) : 0.0;
+}
+
+int64_t Histogram::bucketLimit(int index)
+{
+  if (index < kSubBuckets)
+  {
+    return index;
+  }
+  int exponent = index / kSubBuckets + kSubBits - 1;
+  int64_t sub = index % kSubBuckets;
+  return ((kSubBuckets + sub + 1) << (exponent - kSubBits)) - 1;
+}
+
+int64_t Histogram::percentile(double p) const
+{
+  int64_t total = 0;
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    total += load(&counts_[i]);
+  }
+  if (total == 0)
+  {
+    return 0;
+  }
+  // rank of the value, 1-based
+  int64_t rank = static_cast<int64_t>(p * static_cast<double>(total) + 0.5);
+  rank = std::min(std::max(rank, static_cast<int64_t>(1)), total);
+  int64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i)
+  {
+    seen += load(&counts_[i]);
+    if (seen >= rank)
+    {
+      return std::min(bucketLimit(i), max());
+    }
+  }
+  return max();
+}
+
+string Histogram::toString() const
+{
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "count %" PRId64 " mean %.1f p50 %" PRId64 " p90 %" PRId64
+           " p99 %" PRId64 " p999 %" PRId64 " max %" PRId64,
+           count(), mean(), percentile(0.5), percentile(0.9),
+           percentile(0.99), percentile(0.999), max());
+  return buf;
+}
@@ -0,0 +1,90 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_HISTOGRAM_H
+#define MUDUO_BASE_HISTOGRAM_H
+
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Log-linear histogram of non-negative integers, like HdrHistogram,
+/// values up to 7 are exact, larger ones fall into one of 8 buckets
+/// per power of two, so percentiles are within 12.5%.
+///
+/// add() must be called in one thread, others may read it meanwhile,
+/// and get an approximate snapshot.
+///
+class Histogram : boost::noncopyable
+{
+ public:
+  static const int kSubBits = 3;
+  static const int kSubBuckets = 1 << kSubBits;
+  static const int kMaxExponent = 40;  // 2^41 microseconds, 25 days
+  static const int kNumBuckets = (kMaxExponent - kSubBits + 2) * kSubBuckets;
+
+  Histogram();
+
+  void add(int64_t value)
+  {
+    value = value < 0 ? 0 : value;
+    int index = bucketOf(value);
+    store(&counts_[index], counts_[index] + 1);
+    store(&count_, count_ + 1);
+    store(&sum_, sum_ + value);
+    if (value > max_)
+    {
+      store(&max_, value);
+    }
+  }
+
+  int64_t count() const { return load(&count_); }
+  int64_t sum() const { return load(&sum_); }
+  int64_t max() const { return load(&max_); }
+  double mean() const;
+
+  /// upper bound of the bucket where @c p (0.0 to 1.0) of values fall within
+  int64_t percentile(double p) const;
+
+  /// "count 42 mean 3.1 p50 2 p90 5 p99 9 p999 15 max 17"
+  string toString() const;
+
+  static int bucketOf(int64_t value)
+  {
+    if (value < kSubBuckets)
+    {
+      return static_cast<int>(value);
+    }
+    int exponent = 63 - __builtin_clzll(static_cast<unsigned long long>(value));
+    if (exponent > kMaxExponent)
+    {
+      return kNumBuckets - 1;
+    }
+    int sub = static_cast<int>(value >> (exponent - kSubBits)) & (kSubBuckets - 1);
+    return (exponent - kSubBits + 1) * kSubBuckets + sub;
+  }
+
+  /// the largest value in bucket @c index
+  static int64_t bucketLimit(int index);
+
+ private:
+  static void store(int64_t* p, int64_t v) { __atomic_store_n(p, v, __ATOMIC_RELAXED); }
+  static int64_t load(const int64_t* p) { return __atomic_load_n(p, __ATOMIC_RELAXED); }
+
+  int64_t count_;
+  int64_t sum_;
+  int64_t max_;
+  int64_t counts_[kNumBuckets];
+};
+
+}
+
+#endif  // MUDUO_BASE_HISTOGRAM_H
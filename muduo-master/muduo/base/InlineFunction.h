@@ -0,0 +1,309 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_INLINEFUNCTION_H
+#define MUDUO_BASE_INLINEFUNCTION_H
+
+#include <boost/function.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+
+#include <assert.h>
+#include <new>
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+#include <type_traits>
+#include <utility>
+#endif
+
+namespace muduo
+{
+
+///
+/// A void() callable like boost::function<void()>, but keeps callables
+/// of up to kInlineSize bytes in place, which is big enough for
+/// boost::bind(&Class::memfun, shared_ptr<Class>, two words) or
+/// boost::bind(&Class::memfun, this, string), so tasks passed among
+/// threads need no allocation besides the payload itself.
+///
+/// Moving never allocates, copying clones the callable.
+///
+class InlineFunction
+{
+ public:
+  static const size_t kInlineSize = 56;
+
+  InlineFunction()
+    : ops_(NULL)
+  {
+  }
+
+  InlineFunction(void (*f)())
+    : ops_(NULL)
+  {
+    if (f)
+    {
+      init(f);
+    }
+  }
+
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+  template<typename F,
+           typename = typename std::enable_if<
+               !std::is_same<typename std::decay<F>::type, InlineFunction>::value>::type>
+  InlineFunction(F&& f)
+    : ops_(NULL)
+  {
+    if (!isEmpty(f))
+    {
+      init(std::forward<F>(f));
+    }
+  }
+
+  InlineFunction(InlineFunction&& rhs) noexcept
+    : ops_(NULL)
+  {
+    moveFrom(rhs);
+  }
+#else
+  template<typename F>
+  InlineFunction(const F& f)
+    : ops_(NULL)
+  {
+    if (!isEmpty(f))
+    {
+      init(f);
+    }
+  }
+#endif
+
+  InlineFunction(const InlineFunction& rhs)
+    : ops_(rhs.ops_)
+  {
+    if (ops_)
+    {
+      ops_->copy(&rhs.storage_, &storage_);
+    }
+  }
+
+  ~InlineFunction()
+  {
+    clear();
+  }
+
+  // copy-and-swap, also moves in C++11
+  InlineFunction& operator=(InlineFunction rhs)
+  {
+    swap(rhs);
+    return *this;
+  }
+
+  void swap(InlineFunction& rhs)
+  {
+    InlineFunction tmp;
+    tmp.moveFrom(rhs);
+    rhs.moveFrom(*this);
+    moveFrom(tmp);
+  }
+
+  void operator()() const
+  {
+    assert(ops_);
+    ops_->invoke(&storage_);
+  }
+
+  bool empty() const { return ops_ == NULL; }
+
+  void clear()
+  {
+    if (ops_)
+    {
+      ops_->destroy(&storage_);
+      ops_ = NULL;
+    }
+  }
+
+  // safe bool idiom, so that "if (f)" works as boost::function does
+  typedef void (InlineFunction::*SafeBool)() const;
+  operator SafeBool() const
+  {
+    return ops_ ? &InlineFunction::operator() : NULL;
+  }
+
+ private:
+  struct Ops
+  {
+    void (*invoke)(void* storage);
+    void (*copy)(const void* src, void* dst);
+    void (*relocate)(void* src, void* dst);  // moves and destroys src
+    void (*destroy)(void* storage);
+  };
+
+  union Storage
+  {
+    char bytes[kInlineSize];
+    void* pointer;
+    long integer;
+    double floating;
+  };
+
+  template<typename F>
+  struct InlineOps
+  {
+    static void invoke(void* storage)
+    {
+      (*static_cast<F*>(storage))();
+    }
+
+    static void copy(const void* src, void* dst)
+    {
+      new (dst) F(*static_cast<const F*>(src));
+    }
+
+    static void relocate(void* src, void* dst)
+    {
+      F* f = static_cast<F*>(src);
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+      new (dst) F(std::move(*f));
+#else
+      new (dst) F(*f);
+#endif
+      f->~F();
+    }
+
+    static void destroy(void* storage)
+    {
+      static_cast<F*>(storage)->~F();
+    }
+
+    static const Ops ops;
+  };
+
+  // too big, keeps a pointer in storage
+  template<typename F>
+  struct HeapOps
+  {
+    static F*& pointer(void* storage) { return *static_cast<F**>(storage); }
+
+    static void invoke(void* storage)
+    {
+      (*pointer(storage))();
+    }
+
+    static void copy(const void* src, void* dst)
+    {
+      pointer(dst) = new F(*pointer(const_cast<void*>(src)));
+    }
+
+    static void relocate(void* src, void* dst)
+    {
+      pointer(dst) = pointer(src);
+    }
+
+    static void destroy(void* storage)
+    {
+      delete pointer(storage);
+    }
+
+    static const Ops ops;
+  };
+
+  template<typename F>
+  struct FitsInline
+  {
+    static const bool value = sizeof(F) <= kInlineSize
+        && boost::alignment_of<Storage>::value % boost::alignment_of<F>::value == 0;
+  };
+
+  template<typename F>
+  static bool isEmpty(const F&) { return false; }
+  static bool isEmpty(void (*f)()) { return f == NULL; }
+  static bool isEmpty(const boost::function<void()>& f) { return f.empty(); }
+
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+  template<typename F>
+  void init(F&& f)
+  {
+    typedef typename std::decay<F>::type Callable;
+    init<Callable>(std::forward<F>(f),
+                   boost::integral_constant<bool, FitsInline<Callable>::value>());
+  }
+
+  template<typename Callable, typename F>
+  void init(F&& f, boost::true_type)
+  {
+    new (&storage_) Callable(std::forward<F>(f));
+    ops_ = &InlineOps<Callable>::ops;
+  }
+
+  template<typename Callable, typename F>
+  void init(F&& f, boost::false_type)
+  {
+    HeapOps<Callable>::pointer(&storage_) = new Callable(std::forward<F>(f));
+    ops_ = &HeapOps<Callable>::ops;
+  }
+#else
+  template<typename F>
+  void init(const F& f)
+  {
+    init(f, boost::integral_constant<bool, FitsInline<F>::value>());
+  }
+
+  template<typename F>
+  void init(const F& f, boost::true_type)
+  {
+    new (&storage_) F(f);
+    ops_ = &InlineOps<F>::ops;
+  }
+
+  template<typename F>
+  void init(const F& f, boost::false_type)
+  {
+    HeapOps<F>::pointer(&storage_) = new F(f);
+    ops_ = &HeapOps<F>::ops;
+  }
+#endif
+
+  // *this must be empty
+  void moveFrom(InlineFunction& rhs)
+  {
+    assert(ops_ == NULL);
+    if (rhs.ops_)
+    {
+      rhs.ops_->relocate(&rhs.storage_, &storage_);
+      ops_ = rhs.ops_;
+      rhs.ops_ = NULL;
+    }
+  }
+
+  const Ops* ops_;
+  mutable Storage storage_;
+};
+
+template<typename F>
+const InlineFunction::Ops InlineFunction::InlineOps<F>::ops =
+{
+  &InlineFunction::InlineOps<F>::invoke,
+  &InlineFunction::InlineOps<F>::copy,
+  &InlineFunction::InlineOps<F>::relocate,
+  &InlineFunction::InlineOps<F>::destroy,
+};
+
+template<typename F>
+const InlineFunction::Ops InlineFunction::HeapOps<F>::ops =
+{
+  &InlineFunction::HeapOps<F>::invoke,
+  &InlineFunction::HeapOps<F>::copy,
+  &InlineFunction::HeapOps<F>::relocate,
+  &InlineFunction::HeapOps<F>::destroy,
+};
+
+inline void swap(InlineFunction& lhs, InlineFunction& rhs)
+{
+  lhs.swap(rhs);
+}
+
+}
+
+#endif  // MUDUO_BASE_INLINEFUNCTION_H
@@ -158,4 +158,9 @@ T* CheckNotNull(Logger::SourceFile file, int line, const char *names, T* ptr)
 
 }
 
+// LOG_TRACE to LOG_ERROR record arguments, formatted in the background
+#ifdef MUDUO_BINARY_LOG
+#include <muduo/base/BinaryLogging.h>
+#endif
+
 #endif  // MUDUO_BASE_LOGGING_H
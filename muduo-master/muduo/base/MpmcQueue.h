@@ -0,0 +1,374 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MPMCQUEUE_H
+#define MUDUO_BASE_MPMCQUEUE_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/Mutex.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <utility>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>  // sysconf
+
+namespace muduo
+{
+
+///
+/// Bounded lock-free multi-producer multi-consumer queue,
+/// after Dmitry Vyukov's bounded MPMC queue, every slot has a sequence
+/// number telling whether it is ready for put or take of the round.
+///
+/// A drop-in of BoundedBlockingQueue, put() and take() spin a while
+/// before they park on a Condition, the other side only takes the lock
+/// when someone is parked.
+/// tryPutBulk() and tryTakeBulk() move a batch with one CAS.
+///
+template<typename T>
+class MpmcQueue : boost::noncopyable
+{
+ public:
+  /// capacity is rounded up to a power of 2
+  explicit MpmcQueue(int maxSize)
+    : mask_(roundUp(maxSize) - 1),
+      buffer_(new Slot[mask_ + 1]),
+      enqueuePos_(0),
+      dequeuePos_(0),
+      mutex_(),
+      notEmpty_(mutex_),
+      notFull_(mutex_),
+      waitingConsumers_(0),
+      waitingProducers_(0),
+      spinLimit_(minSpins() * 4)
+  {
+    for (size_t i = 0; i <= mask_; ++i)
+    {
+      buffer_[i].sequence = i;
+    }
+  }
+
+  ~MpmcQueue()
+  {
+    delete[] buffer_;
+  }
+
+  /// Returns false if full.
+  bool tryPut(const T& x)
+  {
+    size_t pos = 0;
+    if (claim(&enqueuePos_, 0, 1, &pos) == 0)
+    {
+      return false;
+    }
+    publishPut(pos, x);
+    wakeup(&waitingConsumers_, &notEmpty_, false);
+    return true;
+  }
+
+  /// Returns false if empty.
+  bool tryTake(T* x)
+  {
+    size_t pos = 0;
+    if (claim(&dequeuePos_, 1, 1, &pos) == 0)
+    {
+      return false;
+    }
+    publishTake(pos, x);
+    wakeup(&waitingProducers_, &notFull_, false);
+    return true;
+  }
+
+  /// Puts as many of @c n items as there is room, with one CAS,
+  /// returns how many.
+  size_t tryPutBulk(const T* items, size_t n)
+  {
+    size_t pos = 0;
+    size_t claimed = claim(&enqueuePos_, 0, n, &pos);
+    for (size_t i = 0; i < claimed; ++i)
+    {
+      publishPut(pos + i, items[i]);
+    }
+    if (claimed > 0)
+    {
+      wakeup(&waitingConsumers_, &notEmpty_, claimed > 1);
+    }
+    return claimed;
+  }
+
+  /// Takes at most @c n items, with one CAS, returns how many.
+  size_t tryTakeBulk(T* items, size_t n)
+  {
+    size_t pos = 0;
+    size_t claimed = claim(&dequeuePos_, 1, n, &pos);
+    for (size_t i = 0; i < claimed; ++i)
+    {
+      publishTake(pos + i, &items[i]);
+    }
+    if (claimed > 0)
+    {
+      wakeup(&waitingProducers_, &notFull_, claimed > 1);
+    }
+    return claimed;
+  }
+
+  /// Blocks while full.
+  void put(const T& x)
+  {
+    Backoff backoff(this);
+    while (!tryPut(x))
+    {
+      backoff.wait(&waitingProducers_, &notFull_, &enqueuePos_, 0);
+    }
+  }
+
+  /// Blocks while empty.
+  T take()
+  {
+    T x = T();
+    Backoff backoff(this);
+    while (!tryTake(&x))
+    {
+      backoff.wait(&waitingConsumers_, &notEmpty_, &dequeuePos_, 1);
+    }
+    return x;
+  }
+
+  /// Blocks until all @c n are put.
+  void putBulk(const T* items, size_t n)
+  {
+    size_t done = tryPutBulk(items, n);
+    while (done < n)
+    {
+      Backoff backoff(this);
+      size_t count = 0;
+      while ((count = tryPutBulk(items + done, n - done)) == 0)
+      {
+        backoff.wait(&waitingProducers_, &notFull_, &enqueuePos_, 0);
+      }
+      done += count;
+    }
+  }
+
+  /// Blocks while empty, then takes at most @c n items, returns how many.
+  size_t takeBulk(T* items, size_t n)
+  {
+    size_t taken = 0;
+    Backoff backoff(this);
+    while ((taken = tryTakeBulk(items, n)) == 0)
+    {
+      backoff.wait(&waitingConsumers_, &notEmpty_, &dequeuePos_, 1);
+    }
+    return taken;
+  }
+
+  /// Approximate.
+  size_t size() const
+  {
+    size_t enq = __atomic_load_n(&enqueuePos_, __ATOMIC_RELAXED);
+    size_t deq = __atomic_load_n(&dequeuePos_, __ATOMIC_RELAXED);
+    return enq > deq ? std::min(enq - deq, capacity()) : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() == capacity(); }
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  // Spins a while before parking, how long is learnt from recent waits,
+  // like PTHREAD_MUTEX_ADAPTIVE_NP, never on a single CPU.
+  class Backoff : boost::noncopyable
+  {
+   public:
+    explicit Backoff(MpmcQueue* queue)
+      : queue_(queue),
+        limit_(__atomic_load_n(&queue->spinLimit_, __ATOMIC_RELAXED)),
+        spins_(0),
+        parked_(false)
+    {
+    }
+
+    ~Backoff()
+    {
+      if (spins_ > 0 || parked_)
+      {
+        int target = parked_ ? limit_ / 2 : 2 * spins_;
+        target = std::max(std::min(target, maxSpins()), minSpins());
+        __atomic_store_n(&queue_->spinLimit_, limit_ + (target - limit_) / 8,
+                         __ATOMIC_RELAXED);
+      }
+    }
+
+    void wait(int* waiting, Condition* cond, size_t* position, size_t offset)
+    {
+      if (spins_ < limit_)
+      {
+        ++spins_;
+        pause();
+      }
+      else
+      {
+        parked_ = true;
+        queue_->park(waiting, cond, position, offset);
+      }
+    }
+
+   private:
+    MpmcQueue* queue_;
+    const int limit_;
+    int spins_;
+    bool parked_;
+  };
+
+  static int numCpus()
+  {
+    static int n = static_cast<int>(::sysconf(_SC_NPROCESSORS_ONLN));
+    return n;
+  }
+
+  static int maxSpins() { return numCpus() > 1 ? 4000 : 0; }
+  static int minSpins() { return numCpus() > 1 ? 16 : 0; }
+
+  struct Slot
+  {
+    Slot() : sequence(0), value() { }
+
+    size_t sequence; /* atomic */
+    T value;
+  };
+
+  static size_t roundUp(int n)
+  {
+    assert(n > 0);
+    size_t size = 1;
+    while (size < static_cast<size_t>(n))
+    {
+      size <<= 1;
+    }
+    return size;
+  }
+
+  static void pause()
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+  }
+
+  // how far the slot at pos is from being ready, 0 if ready,
+  // negative if the other side hasn't done with it.
+  intptr_t lag(size_t pos, size_t offset) const
+  {
+    size_t seq = __atomic_load_n(&buffer_[pos & mask_].sequence, __ATOMIC_ACQUIRE);
+    return static_cast<intptr_t>(seq - (pos + offset));
+  }
+
+  // Claims up to n ready slots from *position, offset is 0 for put
+  // and 1 for take, returns how many, and the first one in *first.
+  // Once the slots are ready, only the claimer changes them,
+  // so one CAS claims them all.
+  size_t claim(size_t* position, size_t offset, size_t n, size_t* first)
+  {
+    size_t pos = __atomic_load_n(position, __ATOMIC_RELAXED);
+    while (n > 0)
+    {
+      intptr_t dif = lag(pos, offset);
+      if (dif == 0)
+      {
+        size_t ready = 1;
+        while (ready < n && lag(pos + ready, offset) == 0)
+        {
+          ++ready;
+        }
+        if (__atomic_compare_exchange_n(position, &pos, pos + ready, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+          *first = pos;
+          return ready;
+        }
+        // pos is reloaded by the failed CAS
+      }
+      else if (dif < 0)
+      {
+        return 0;  // full for put, empty for take
+      }
+      else
+      {
+        pos = __atomic_load_n(position, __ATOMIC_RELAXED);
+      }
+    }
+    return 0;
+  }
+
+  void publishPut(size_t pos, const T& x)
+  {
+    Slot& slot = buffer_[pos & mask_];
+    slot.value = x;
+    __atomic_store_n(&slot.sequence, pos + 1, __ATOMIC_RELEASE);
+  }
+
+  void publishTake(size_t pos, T* x)
+  {
+    Slot& slot = buffer_[pos & mask_];
+    using std::swap;
+    swap(*x, slot.value);
+    __atomic_store_n(&slot.sequence, pos + mask_ + 1, __ATOMIC_RELEASE);
+  }
+
+  void wakeup(int* waiting, Condition* cond, bool all)
+  {
+    // pairs with the increment-then-check in park()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(waiting, __ATOMIC_RELAXED) > 0)
+    {
+      MutexLockGuard lock(mutex_);
+      if (all)
+      {
+        cond->notifyAll();
+      }
+      else
+      {
+        cond->notify();
+      }
+    }
+  }
+
+  void park(int* waiting, Condition* cond, size_t* position, size_t offset)
+  {
+    MutexLockGuard lock(mutex_);
+    __atomic_fetch_add(waiting, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (lag(__atomic_load_n(position, __ATOMIC_RELAXED), offset) < 0)
+    {
+      cond->wait();
+    }
+    __atomic_fetch_sub(waiting, 1, __ATOMIC_RELAXED);
+  }
+
+  const size_t mask_;
+  Slot* const buffer_;
+  char padding0_[64];
+  size_t enqueuePos_; /* atomic */
+  char padding1_[64 - sizeof(size_t)];
+  size_t dequeuePos_; /* atomic */
+  char padding2_[64 - sizeof(size_t)];
+
+  // for parking only
+  MutexLock mutex_;
+  Condition notEmpty_;
+  Condition notFull_;
+  int waitingConsumers_; /* atomic */
+  int waitingProducers_; /* atomic */
+  int spinLimit_; /* atomic */
+};
+
+}
+
+#endif  // MUDUO_BASE_MPMCQUEUE_H
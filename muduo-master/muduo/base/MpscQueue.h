@@ -0,0 +1,192 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_MPSCQUEUE_H
+#define MUDUO_BASE_MPSCQUEUE_H
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+#include <utility>
+
+#include <stddef.h>
+
+namespace muduo
+{
+
+///
+/// Unbounded lock-free multi-producer single-consumer queue,
+/// after Dmitry Vyukov's intrusive MPSC node-based queue.
+///
+/// push() is wait-free, it is one atomic exchange.
+/// pop() must be called in one thread only, it may fail while a push()
+/// is half done, empty() is false in that case.
+///
+/// Popped nodes are kept in a small pool and reused by push(), so a queue
+/// in steady state does not allocate. The pool is guarded by a try-lock,
+/// whoever loses the race allocates or frees a node instead of waiting.
+///
+template<typename T>
+class MpscQueue : boost::noncopyable
+{
+ public:
+  MpscQueue()
+    : head_(new Node),
+      size_(0),
+      poolLocked_(false),
+      pool_(NULL),
+      poolSize_(0),
+      tail_(head_)
+  {
+  }
+
+  ~MpscQueue()
+  {
+    T x = T();
+    while (pop(&x))
+    {
+    }
+    delete tail_;
+    while (pool_)
+    {
+      Node* node = pool_;
+      pool_ = node->next;
+      delete node;
+    }
+  }
+
+  /// Safe to call from any thread.
+  void push(const T& x)
+  {
+    Node* node = newNode();
+    node->value = x;
+    enqueue(node);
+  }
+
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+  void push(T&& x)
+  {
+    Node* node = newNode();
+    node->value = std::move(x);
+    enqueue(node);
+  }
+#endif
+
+  /// Consumer thread only.
+  bool pop(T* x)
+  {
+    Node* tail = tail_;
+    Node* next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next == NULL)
+    {
+      return false;
+    }
+    // next becomes the dummy node
+    using std::swap;
+    swap(*x, next->value);
+    tail_ = next;
+    recycle(tail);
+    __atomic_fetch_sub(&size_, 1, __ATOMIC_RELAXED);
+    return true;
+  }
+
+  /// Consumer thread only.
+  /// Sequentially consistent with push(), for coalescing wakeups.
+  bool empty() const
+  {
+    return __atomic_load_n(&head_, __ATOMIC_SEQ_CST) == tail_;
+  }
+
+  /// Approximate, safe to call from any thread.
+  size_t size() const
+  {
+    return __atomic_load_n(&size_, __ATOMIC_RELAXED);
+  }
+
+ private:
+  struct Node
+  {
+    Node() : next(NULL), value() { }
+
+    Node* next;
+    T value;
+  };
+
+  static const int kMaxPoolSize = 1024;
+
+  bool tryLockPool()
+  {
+    return !__atomic_exchange_n(&poolLocked_, true, __ATOMIC_ACQUIRE);
+  }
+
+  void unlockPool()
+  {
+    __atomic_store_n(&poolLocked_, false, __ATOMIC_RELEASE);
+  }
+
+  Node* newNode()
+  {
+    Node* node = NULL;
+    if (tryLockPool())
+    {
+      node = pool_;
+      if (node)
+      {
+        pool_ = node->next;
+        --poolSize_;
+      }
+      unlockPool();
+    }
+    if (node)
+    {
+      node->next = NULL;
+      return node;
+    }
+    return new Node;
+  }
+
+  // the old dummy node, its value was swapped out by pop()
+  void recycle(Node* node)
+  {
+    // don't keep resources of the popped value alive in the pool
+    node->value = T();
+    if (tryLockPool())
+    {
+      if (poolSize_ < kMaxPoolSize)
+      {
+        node->next = pool_;
+        pool_ = node;
+        ++poolSize_;
+        node = NULL;
+      }
+      unlockPool();
+    }
+    delete node;
+  }
+
+  void enqueue(Node* node)
+  {
+    __atomic_fetch_add(&size_, 1, __ATOMIC_RELAXED);
+    Node* prev = __atomic_exchange_n(&head_, node, __ATOMIC_SEQ_CST);
+    // pop() can't see node until it is linked
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+  }
+
+  // written by producers
+  Node* head_;
+  size_t size_;
+  char padding_[64 - sizeof(Node*) - sizeof(size_t)];
+  // free nodes, taken by producers, given back by consumer
+  bool poolLocked_;
+  Node* pool_;
+  int poolSize_;
+  char poolPadding_[64 - sizeof(bool) - sizeof(Node*) - sizeof(int)];
+  // owned by consumer, the dummy node
+  Node* tail_;
+};
+
+}
+
+#endif  // MUDUO_BASE_MPSCQUEUE_H
@@ -16,6 +16,7 @@
 #include <assert.h>
 #include <dirent.h>
 #include <pwd.h>
+#include <sched.h>
 #include <stdio.h> // snprintf
 #include <stdlib.h>
 #include <unistd.h>
@@ -49,6 +50,18 @@ int taskDirFilter(const struct dirent* d)
   return 0;
 }
 
+__thread int t_numaNode = -1;
+//过滤器：/sys/devices/system/cpu/cpuN 下的nodeM
+int numaNodeDirFilter(const struct dirent* d)
+{
+  int node = 0;
+  if (::sscanf(d->d_name, "node%d", &node) == 1)
+  {
+    t_numaNode = node;
+  }
+  return 0;
+}
+
 //扫描dir目录下（不包含子目录）满足filter过滤模式的文件
 int scanDir(const char *dirpath, int (*filter)(const struct dirent *))
 {
@@ -252,3 +265,47 @@ std::vector<pid_t> ProcessInfo::threads()
   return result;
 }
 
+string ProcessInfo::cpuAffinity(pid_t tid)
+{
+  string result;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (::sched_getaffinity(tid, sizeof set, &set) == 0)
+  {
+    // ranges of consecutive cpus
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+      if (!CPU_ISSET(cpu, &set))
+      {
+        continue;
+      }
+      int last = cpu;
+      while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set))
+      {
+        ++last;
+      }
+      char buf[32];
+      if (last == cpu)
+      {
+        snprintf(buf, sizeof buf, "%s%d", result.empty() ? "" : ",", cpu);
+      }
+      else
+      {
+        snprintf(buf, sizeof buf, "%s%d-%d", result.empty() ? "" : ",", cpu, last);
+      }
+      result += buf;
+      cpu = last;
+    }
+  }
+  return result;
+}
+
+int ProcessInfo::numaNodeOfCpu(int cpu)
+{
+  char path[64];
+  snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d", cpu);
+  t_numaNode = -1;
+  scanDir(path, numaNodeDirFilter);
+  return t_numaNode;
+}
+
@@ -62,6 +62,11 @@ namespace ProcessInfo
 
   int numThreads();//线程数量
   std::vector<pid_t> threads();//线程队列
+
+  /// cpus thread tid may run on, eg. "0-3,8"
+  string cpuAffinity(pid_t tid);
+  /// NUMA node of cpu, -1 if unknown
+  int numaNodeOfCpu(int cpu);
 }
 
 }
@@ -88,23 +88,50 @@ namespace muduo
       typedef muduo::Thread::ThreadFunc ThreadFunc;
       ThreadFunc func_;
       string name_;
+      std::vector<int> cpus_;
       pid_t* tid_;
       CountDownLatch* latch_;
 
       ThreadData(const ThreadFunc& func,
                 const string& name,
+                const std::vector<int>& cpus,
                 pid_t* tid,
                 CountDownLatch* latch)
         : func_(func),
           name_(name),
+          cpus_(cpus),
           tid_(tid),
           latch_(latch)
       { 
 
       }
 
+      void setAffinity()
+      {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t i = 0; i < cpus_.size(); ++i)
+        {
+          if (0 <= cpus_[i] && cpus_[i] < CPU_SETSIZE)
+          {
+            CPU_SET(cpus_[i], &set);
+          }
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof set, &set);
+        if (err != 0)
+        {
+          errno = err;
+          LOG_SYSERR << "Failed in pthread_setaffinity_np, thread " << name_;
+        }
+      }
+
       void runInThread()
       {
+        // before anything is allocated in this thread
+        if (!cpus_.empty())
+        {
+          setAffinity();
+        }
         *tid_ = muduo::CurrentThread::tid();
         tid_ = NULL;
         latch_->countDown();
@@ -244,7 +271,7 @@ void Thread::start()
   assert(!started_);
   started_ = true;
   // FIXME: move(func_)
-  detail::ThreadData* data = new detail::ThreadData(func_, name_, &tid_, &latch_);
+  detail::ThreadData* data = new detail::ThreadData(func_, name_, cpus_, &tid_, &latch_);
   if (pthread_create(&pthreadId_, NULL, &detail::startThread, data))
   {
     started_ = false;
@@ -9,6 +9,7 @@
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <pthread.h>
+#include <vector>
 
 namespace muduo
 {
@@ -26,6 +27,12 @@ namespace muduo
 
       ~Thread();
 
+      /// Pins the thread to @c cpus, must be called before start().
+      /// It is done before ThreadFunc runs, so memory first touched by
+      /// the thread is allocated on the NUMA node of those cpus.
+      void setCpuAffinity(const std::vector<int>& cpus) { cpus_ = cpus; }
+      const std::vector<int>& cpuAffinity() const { return cpus_; }
+
       void start();
 
       int join(); // return pthread_join()
@@ -49,6 +56,7 @@ namespace muduo
       pid_t      tid_;
       ThreadFunc func_;
       string     name_;
+      std::vector<int> cpus_;
       CountDownLatch latch_;
 
       static AtomicInt32 numCreated_;
@@ -42,6 +42,7 @@ void ThreadPool::start(int numThreads)
     snprintf(id, sizeof id, "%d", i+1);
     threads_.push_back(new muduo::Thread(
           boost::bind(&ThreadPool::runInThread, this), name_+id));
+    threads_[i].setCpuAffinity(cpus_);
     threads_[i].start();
   }
   if (numThreads == 0 && threadInitCallback_)
@@ -121,7 +122,7 @@ ThreadPool::Task ThreadPool::take()
   Task task;
   if (!queue_.empty())
   {
-    task = queue_.front();
+    task.swap(queue_.front());
     queue_.pop_front();
     if (maxQueueSize_ > 0)
     {
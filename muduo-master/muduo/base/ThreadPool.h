@@ -7,6 +7,7 @@
 #define MUDUO_BASE_THREADPOOL_H
 
 #include <muduo/base/Condition.h>
+#include <muduo/base/InlineFunction.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Thread.h>
 #include <muduo/base/Types.h>
@@ -16,6 +17,7 @@
 #include <boost/ptr_container/ptr_vector.hpp>
 
 #include <deque>
+#include <vector>
 
 namespace muduo
 {
@@ -23,7 +25,7 @@ namespace muduo
 class ThreadPool : boost::noncopyable
 {
  public:
-  typedef boost::function<void ()> Task;
+  typedef InlineFunction Task;
 
   explicit ThreadPool(const string& nameArg = string("ThreadPool"));
   ~ThreadPool();
@@ -32,6 +34,9 @@ class ThreadPool : boost::noncopyable
   void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
   void setThreadInitCallback(const Task& cb)
   { threadInitCallback_ = cb; }
+  /// Every worker runs on any of @c cpus, eg. those of one NUMA node.
+  void setCpuAffinity(const std::vector<int>& cpus)
+  { cpus_ = cpus; }
 
   void start(int numThreads);
   void stop();
@@ -57,6 +62,7 @@ class ThreadPool : boost::noncopyable
   Condition notFull_;
   string name_;
   Task threadInitCallback_;
+  std::vector<int> cpus_;
   boost::ptr_vector<muduo::Thread> threads_;
   std::deque<Task> queue_;
   size_t maxQueueSize_;
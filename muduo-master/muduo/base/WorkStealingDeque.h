@@ -0,0 +1,160 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_WORKSTEALINGDEQUE_H
+#define MUDUO_BASE_WORKSTEALINGDEQUE_H
+
+#include <boost/noncopyable.hpp>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace muduo
+{
+
+///
+/// Bounded lock-free work-stealing deque, after Chase and Lev,
+/// with the C11 memory orders of Le, Pop, Cohen and Zappa Nardelli,
+/// "Correct and Efficient Work-Stealing for Weak Memory Models".
+///
+/// The owner thread pushes and pops at the bottom, like a stack,
+/// other threads steal from the top, oldest first.
+///
+/// Items are kept by value, T must be default constructible and
+/// swappable without allocation, eg. InlineFunction.  The race is on
+/// the index only, the winner swaps the item out of its slot afterwards,
+/// and the owner doesn't reuse a slot until the item is gone.
+///
+template<typename T>
+class WorkStealingDeque : boost::noncopyable
+{
+ public:
+  /// @c capacity must be a power of 2
+  explicit WorkStealingDeque(size_t capacity = 1024)
+    : top_(0),
+      bottom_(0),
+      mask_(static_cast<int64_t>(capacity) - 1),
+      buffer_(new Slot[capacity])
+  {
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  }
+
+  ~WorkStealingDeque()
+  {
+    delete[] buffer_;
+  }
+
+  size_t capacity() const { return static_cast<size_t>(mask_ + 1); }
+
+  /// Owner thread only, swaps @c *x in, returns false if full.
+  bool push(T* x)
+  {
+    int64_t b = __atomic_load_n(&bottom_, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&top_, __ATOMIC_ACQUIRE);
+    Slot& slot = buffer_[b & mask_];
+    // a thief may still be taking the item out of the slot
+    if (b - t > mask_ || __atomic_load_n(&slot.full, __ATOMIC_ACQUIRE))
+    {
+      return false;
+    }
+    using std::swap;
+    swap(slot.value, *x);
+    __atomic_store_n(&slot.full, true, __ATOMIC_RELAXED);
+    // a release store instead of the fence, the same on x86
+    __atomic_store_n(&bottom_, b + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  /// Owner thread only, swaps the newest one into @c *x,
+  /// returns false if empty.
+  bool pop(T* x)
+  {
+    int64_t b = __atomic_load_n(&bottom_, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&bottom_, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&top_, __ATOMIC_RELAXED);
+    bool taken = false;
+    if (t <= b)
+    {
+      taken = true;
+      if (t == b)
+      {
+        // the last one, races with thieves
+        taken = __atomic_compare_exchange_n(&top_, &t, t + 1, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&bottom_, b + 1, __ATOMIC_RELAXED);
+      }
+    }
+    else
+    {
+      __atomic_store_n(&bottom_, b + 1, __ATOMIC_RELAXED);
+    }
+    if (taken)
+    {
+      takeOut(&buffer_[b & mask_], x);
+    }
+    return taken;
+  }
+
+  /// Any thread, swaps the oldest one into @c *x,
+  /// returns false if empty or lost a race.
+  bool steal(T* x)
+  {
+    int64_t t = __atomic_load_n(&top_, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&bottom_, __ATOMIC_ACQUIRE);
+    if (t < b
+        && __atomic_compare_exchange_n(&top_, &t, t + 1, false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+    {
+      takeOut(&buffer_[t & mask_], x);
+      return true;
+    }
+    return false;
+  }
+
+  /// Approximate, safe to call from any thread.
+  size_t size() const
+  {
+    int64_t b = __atomic_load_n(&bottom_, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&top_, __ATOMIC_RELAXED);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+  }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  struct Slot
+  {
+    Slot() : value(), full(false) { }
+
+    T value;
+    bool full; /* atomic, cleared by whoever takes the value */
+  };
+
+  static void takeOut(Slot* slot, T* x)
+  {
+    using std::swap;
+    swap(*x, slot->value);
+    // what *x held before is dropped here, not left in the slot
+    T dropped = T();
+    swap(dropped, slot->value);
+    __atomic_store_n(&slot->full, false, __ATOMIC_RELEASE);
+  }
+
+  // thieves write top_, the owner writes bottom_
+  int64_t top_;
+  char padding_[64 - sizeof(int64_t)];
+  int64_t bottom_;
+  const int64_t mask_;
+  Slot* const buffer_;
+};
+
+}
+
+#endif  // MUDUO_BASE_WORKSTEALINGDEQUE_H
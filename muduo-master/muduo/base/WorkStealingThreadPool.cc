@@ -0,0 +1,365 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/base/WorkStealingThreadPool.h>
+
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/Exception.h>
+#include <muduo/base/WorkStealingDeque.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+#include <deque>
+
+#include <assert.h>
+#include <stdio.h>
+
+using namespace muduo;
+
+struct WorkStealingThreadPool::Worker : boost::noncopyable
+{
+  Worker() : inboxSize(0), victim(0) { }
+
+  WorkStealingDeque<Task> deque;
+  MutexLock mutex;
+  std::deque<Task> inbox;  // guarded by mutex, from other threads
+  size_t inboxSize; /* atomic */
+  size_t victim;  // where to steal next
+};
+
+namespace
+{
+// the pool and worker of current thread, if it is a worker
+__thread WorkStealingThreadPool* t_pool = NULL;
+__thread int t_worker = -1;
+
+typedef WorkStealingThreadPool::Task Task;
+
+// Moves the first @c n of inbox to deque, in reverse order, so the owner
+// runs them oldest first, and thieves take the newest.
+// The first one goes to @c task, nothing is copied.
+// A push fails if a thief is still taking an item out of the slot,
+// those not moved stay in the inbox.
+void takeBatch(std::deque<Task>* inbox, size_t n, WorkStealingDeque<Task>* deque, Task* task)
+{
+  assert(n > 0 && n <= inbox->size());
+  task->swap(inbox->front());
+  size_t i = n - 1;
+  while (i > 0 && deque->push(&(*inbox)[i]))
+  {
+    --i;
+  }
+  // [1, i] are left
+  inbox->erase(inbox->begin() + static_cast<ptrdiff_t>(i + 1),
+               inbox->begin() + static_cast<ptrdiff_t>(n));
+  inbox->pop_front();
+}
+}
+
+WorkStealingThreadPool::WorkStealingThreadPool(const string& nameArg)
+  : name_(nameArg),
+    running_(false),
+    mutex_(),
+    notEmpty_(mutex_),
+    sleeping_(0)
+{
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool()
+{
+  if (running_)
+  {
+    stop();
+  }
+}
+
+void WorkStealingThreadPool::start(int numThreads)
+{
+  assert(threads_.empty());
+  running_ = true;
+  workers_.reserve(numThreads);
+  threads_.reserve(numThreads);
+  for (int i = 0; i < numThreads; ++i)
+  {
+    workers_.push_back(new Worker);
+    workers_[i].victim = (i + 1) % numThreads;
+  }
+  for (int i = 0; i < numThreads; ++i)
+  {
+    char id[32];
+    snprintf(id, sizeof id, "%d", i+1);
+    threads_.push_back(new muduo::Thread(
+          boost::bind(&WorkStealingThreadPool::runInThread, this, i), name_+id));
+    threads_[i].setCpuAffinity(cpus_);
+    threads_[i].start();
+  }
+  if (numThreads == 0 && threadInitCallback_)
+  {
+    threadInitCallback_();
+  }
+}
+
+void WorkStealingThreadPool::stop()
+{
+  {
+  MutexLockGuard lock(mutex_);
+  __atomic_store_n(&running_, false, __ATOMIC_SEQ_CST);
+  notEmpty_.notifyAll();
+  }
+  for_each(threads_.begin(),
+           threads_.end(),
+           boost::bind(&muduo::Thread::join, _1));
+}
+
+size_t WorkStealingThreadPool::queueSize() const
+{
+  size_t n = 0;
+  for (size_t i = 0; i < workers_.size(); ++i)
+  {
+    n += workers_[i].deque.size() + __atomic_load_n(&workers_[i].inboxSize, __ATOMIC_RELAXED);
+  }
+  return n;
+}
+
+void WorkStealingThreadPool::run(const Task& task)
+{
+  if (threads_.empty())
+  {
+    task();
+  }
+  else
+  {
+    Task copy(task);
+    submit(&copy);
+  }
+}
+
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+void WorkStealingThreadPool::run(Task&& task)
+{
+  if (threads_.empty())
+  {
+    task();
+  }
+  else
+  {
+    submit(&task);
+  }
+}
+#endif
+
+void WorkStealingThreadPool::runAll(const std::vector<Task>& tasks)
+{
+  if (threads_.empty())
+  {
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+      tasks[i]();
+    }
+  }
+  else if (!tasks.empty())
+  {
+    submit(tasks);
+  }
+}
+
+WorkStealingThreadPool::Worker* WorkStealingThreadPool::submitTarget()
+{
+  if (t_pool == this)
+  {
+    return &workers_[t_worker];
+  }
+  // the same worker for the same thread, eg. an IO thread
+  return &workers_[static_cast<size_t>(CurrentThread::tid()) % workers_.size()];
+}
+
+void WorkStealingThreadPool::submit(Task* task)
+{
+  Worker* target = submitTarget();
+  if (t_pool != this || !target->deque.push(task))
+  {
+    MutexLockGuard lock(target->mutex);
+    target->inbox.push_back(Task());
+    target->inbox.back().swap(*task);
+    __atomic_store_n(&target->inboxSize, target->inbox.size(), __ATOMIC_RELAXED);
+  }
+  wakeupIfSleeping(1);
+}
+
+void WorkStealingThreadPool::submit(const std::vector<Task>& tasks)
+{
+  Worker* target = submitTarget();
+  size_t i = 0;
+  if (t_pool == this)
+  {
+    for (; i < tasks.size(); ++i)
+    {
+      Task copy(tasks[i]);
+      if (!target->deque.push(&copy))
+      {
+        break;
+      }
+    }
+  }
+  if (i < tasks.size())
+  {
+    MutexLockGuard lock(target->mutex);
+    target->inbox.insert(target->inbox.end(), tasks.begin() + i, tasks.end());
+    __atomic_store_n(&target->inboxSize, target->inbox.size(), __ATOMIC_RELAXED);
+  }
+  wakeupIfSleeping(tasks.size());
+}
+
+bool WorkStealingThreadPool::findTask(Worker* self, Task* task)
+{
+  return self->deque.pop(task) || takeInbox(self, task) || steal(self, task);
+}
+
+bool WorkStealingThreadPool::takeInbox(Worker* self, Task* task)
+{
+  if (__atomic_load_n(&self->inboxSize, __ATOMIC_RELAXED) == 0)
+  {
+    return false;
+  }
+  MutexLockGuard lock(self->mutex);
+  size_t room = self->deque.capacity() - self->deque.size();
+  size_t n = std::min(self->inbox.size(), room + 1);
+  if (n > 0)
+  {
+    takeBatch(&self->inbox, n, &self->deque, task);
+  }
+  __atomic_store_n(&self->inboxSize, self->inbox.size(), __ATOMIC_RELAXED);
+  return n > 0;
+}
+
+bool WorkStealingThreadPool::steal(Worker* self, Task* task)
+{
+  const size_t n = workers_.size();
+  // deques first, they need no lock
+  for (size_t i = 0; i < n; ++i)
+  {
+    Worker& victim = workers_[(self->victim + i) % n];
+    if (&victim != self)
+    {
+      if (victim.deque.steal(task))
+      {
+        self->victim = (self->victim + i) % n;
+        return true;
+      }
+    }
+  }
+  // then half of an inbox, whose owner is busy
+  for (size_t i = 0; i < n; ++i)
+  {
+    Worker& victim = workers_[(self->victim + i) % n];
+    if (&victim != self && __atomic_load_n(&victim.inboxSize, __ATOMIC_RELAXED) > 0)
+    {
+      MutexLockGuard lock(victim.mutex);
+      size_t room = self->deque.capacity() - self->deque.size();
+      size_t half = (victim.inbox.size() + 1) / 2;
+      size_t k = std::min(half, room + 1);
+      if (k > 0)
+      {
+        takeBatch(&victim.inbox, k, &self->deque, task);
+        __atomic_store_n(&victim.inboxSize, victim.inbox.size(), __ATOMIC_RELAXED);
+        self->victim = (self->victim + i) % n;
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool WorkStealingThreadPool::hasTask() const
+{
+  for (size_t i = 0; i < workers_.size(); ++i)
+  {
+    if (!workers_[i].deque.empty()
+        || __atomic_load_n(&workers_[i].inboxSize, __ATOMIC_RELAXED) > 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingThreadPool::wakeupIfSleeping(size_t numTasks)
+{
+  // pairs with the increment-then-check in park()
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&sleeping_, __ATOMIC_RELAXED) > 0)
+  {
+    MutexLockGuard lock(mutex_);
+    if (numTasks > 1)
+    {
+      notEmpty_.notifyAll();
+    }
+    else
+    {
+      notEmpty_.notify();
+    }
+  }
+}
+
+void WorkStealingThreadPool::park()
+{
+  MutexLockGuard lock(mutex_);
+  __atomic_fetch_add(&sleeping_, 1, __ATOMIC_SEQ_CST);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  if (__atomic_load_n(&running_, __ATOMIC_RELAXED) && !hasTask())
+  {
+    notEmpty_.wait();
+  }
+  __atomic_fetch_sub(&sleeping_, 1, __ATOMIC_RELAXED);
+}
+
+void WorkStealingThreadPool::runInThread(int index)
+{
+  t_pool = this;
+  t_worker = index;
+  Worker* self = &workers_[index];
+  try
+  {
+    if (threadInitCallback_)
+    {
+      threadInitCallback_();
+    }
+    Task task;
+    while (__atomic_load_n(&running_, __ATOMIC_ACQUIRE))
+    {
+      if (findTask(self, &task))
+      {
+        task();
+        // drops what it holds before parking
+        task.clear();
+      }
+      else
+      {
+        park();
+      }
+    }
+  }
+  catch (const Exception& ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    fprintf(stderr, "stack trace: %s\n", ex.stackTrace());
+    abort();
+  }
+  catch (const std::exception& ex)
+  {
+    fprintf(stderr, "exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    fprintf(stderr, "reason: %s\n", ex.what());
+    abort();
+  }
+  catch (...)
+  {
+    fprintf(stderr, "unknown exception caught in WorkStealingThreadPool %s\n", name_.c_str());
+    throw; // rethrow
+  }
+  t_pool = NULL;
+  t_worker = -1;
+}
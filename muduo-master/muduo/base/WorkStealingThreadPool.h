@@ -0,0 +1,102 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#ifndef MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+#define MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/InlineFunction.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <vector>
+
+namespace muduo
+{
+
+///
+/// Thread pool for many short tasks, a drop-in of ThreadPool,
+/// without a queue shared by all workers.
+///
+/// Every worker has a lock-free WorkStealingDeque, and an inbox for
+/// other threads. A thread submits to the inbox of the same worker
+/// every time, so tasks of one EventLoop stay together, and IO threads
+/// don't contend with each other. Workers take their inbox in one batch,
+/// tasks run by a worker go to its own deque, idle workers steal from
+/// the others.
+///
+/// Tasks are kept by value, one which fits in InlineFunction needs
+/// no allocation on its way to a worker.
+///
+/// Queues are unbounded, there is no setMaxQueueSize().
+///
+class WorkStealingThreadPool : boost::noncopyable
+{
+ public:
+  typedef InlineFunction Task;
+
+  explicit WorkStealingThreadPool(const string& nameArg = string("WorkStealingThreadPool"));
+  ~WorkStealingThreadPool();
+
+  // Must be called before start().
+  void setThreadInitCallback(const Task& cb)
+  { threadInitCallback_ = cb; }
+  /// Every worker runs on any of @c cpus, eg. those of one NUMA node.
+  void setCpuAffinity(const std::vector<int>& cpus)
+  { cpus_ = cpus; }
+
+  void start(int numThreads);
+  /// Tasks not run yet are dropped.
+  void stop();
+
+  const string& name() const
+  { return name_; }
+
+  /// Approximate.
+  size_t queueSize() const;
+
+  /// Thread safe, never blocks.
+  void run(const Task& f);
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+  void run(Task&& f);
+#endif
+  /// Submits all of @c tasks at the cost of one.
+  void runAll(const std::vector<Task>& tasks);
+
+ private:
+  struct Worker;
+
+  // swaps *task in, no copy
+  void submit(Task* task);
+  void submit(const std::vector<Task>& tasks);
+  Worker* submitTarget();
+  bool findTask(Worker* self, Task* task);
+  bool takeInbox(Worker* self, Task* task);
+  bool steal(Worker* self, Task* task);
+  bool hasTask() const;
+  void wakeupIfSleeping(size_t numTasks);
+  void park();
+  void runInThread(int index);
+
+  string name_;
+  Task threadInitCallback_;
+  std::vector<int> cpus_;
+  boost::ptr_vector<Worker> workers_;
+  boost::ptr_vector<muduo::Thread> threads_;
+  bool running_; /* atomic */
+
+  // idle workers wait here
+  MutexLock mutex_;
+  Condition notEmpty_;
+  int sleeping_; /* atomic */
+};
+
+}
+
+#endif  // MUDUO_BASE_WORKSTEALINGTHREADPOOL_H
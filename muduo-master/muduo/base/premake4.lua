@@ -8,11 +8,13 @@ project "base"
     headers('*.h')
     files {
             'AsyncLogging.cc',
+            'BinaryLogging.cc',
             'Condition.cc',
             'CountDownLatch.cc',
             'Date.cc',
             'Exception.cc',
             'FileUtil.cc',
+            'Histogram.cc',
             'LogFile.cc',
             'Logging.cc',
             'LogStream.cc',
@@ -21,4 +23,5 @@ project "base"
             'TimeZone.cc',
             'Thread.cc',
             'ThreadPool.cc',
+            'WorkStealingThreadPool.cc',
      }
@@ -0,0 +1,145 @@
+#include <muduo/base/AsyncLogging.h>
+#include <muduo/base/FileUtil.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// threads append numbered lines, some of them exit before others start,
+// every line must be in the log, those of one thread in order.
+
+namespace
+{
+
+const int kThreads = 4;
+const int kRounds = 2;
+// about 1.5 buffers of 4MB for every thread
+const int kLines = 60000;
+const char* kBasename = "asynclogging_unittest";
+
+void check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    printf("failed: %s\n", what);
+    abort();
+  }
+}
+
+void appendLines(muduo::AsyncLogging* log, int thread)
+{
+  char line[128];
+  for (int i = 0; i < kLines; ++i)
+  {
+    int len = snprintf(line, sizeof line,
+                       "%d %d the quick brown fox jumps over the lazy dog"
+                       " the quick brown fox jumps\n", thread, i);
+    log->append(line, len);
+  }
+}
+
+// log files of this test, oldest first
+std::vector<muduo::string> logFiles()
+{
+  std::vector<muduo::string> files;
+  DIR* dir = ::opendir(".");
+  check(dir != NULL, "opendir");
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    if (strncmp(entry->d_name, kBasename, strlen(kBasename)) == 0)
+    {
+      files.push_back(entry->d_name);
+    }
+  }
+  ::closedir(dir);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+void checkLines(const muduo::string& content)
+{
+  std::vector<int> next(kThreads * kRounds, 0);
+  size_t pos = 0;
+  while (pos < content.size())
+  {
+    size_t eol = content.find('\n', pos);
+    check(eol != muduo::string::npos, "whole lines");
+    // not sscanf(), which takes strlen() of the rest every time
+    char* end = NULL;
+    int thread = static_cast<int>(strtol(content.c_str() + pos, &end, 10));
+    int seq = static_cast<int>(strtol(end, &end, 10));
+    check(end < content.c_str() + eol, "parse");
+    check(thread >= 0 && thread < kThreads * kRounds, "thread");
+    if (seq != next[thread])
+    {
+      printf("thread %d expects %d got %d\n", thread, next[thread], seq);
+      abort();
+    }
+    ++next[thread];
+    pos = eol + 1;
+  }
+  for (int i = 0; i < kThreads * kRounds; ++i)
+  {
+    if (next[i] != kLines)
+    {
+      printf("thread %d has %d lines of %d\n", i, next[i], kLines);
+      abort();
+    }
+  }
+}
+
+}
+
+int main()
+{
+  char dir[] = "/tmp/asynclogging_unittest.XXXXXX";
+  check(::mkdtemp(dir) != NULL, "mkdtemp");
+  check(::chdir(dir) == 0, "chdir");
+
+  {
+  // partial buffers of every thread are taken whenever one is full
+  muduo::AsyncLogging log(kBasename, 1000*1000*1000, 1);
+  log.start();
+  for (int round = 0; round < kRounds; ++round)
+  {
+    boost::ptr_vector<muduo::Thread> threads;
+    for (int i = 0; i < kThreads; ++i)
+    {
+      threads.push_back(new muduo::Thread(
+            boost::bind(appendLines, &log, round * kThreads + i)));
+      threads.back().start();
+    }
+    // their stagings are left to the backend
+    for (int i = 0; i < kThreads; ++i)
+    {
+      threads[i].join();
+    }
+  }
+  log.stop();
+  }
+
+  std::vector<muduo::string> files(logFiles());
+  check(!files.empty(), "log file");
+  muduo::string content;
+  for (size_t i = 0; i < files.size(); ++i)
+  {
+    muduo::string part;
+    check(muduo::FileUtil::readFile(files[i], 100*1000*1000, &part) == 0, "readFile");
+    content += part;
+    ::unlink(files[i].c_str());
+  }
+  check(::chdir("/") == 0, "chdir");
+  check(::rmdir(dir) == 0, "rmdir");
+
+  checkLines(content);
+  printf("%d lines of %d threads in order\n", kLines * kThreads * kRounds, kThreads * kRounds);
+}
@@ -0,0 +1,110 @@
+#include <muduo/base/BinaryLogging.h>
+#include <muduo/base/Timestamp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+// BLOG_* must print what LOG_* prints, then compares how long
+// the logging thread spends on each.
+
+muduo::string g_text;
+muduo::string g_binary;
+int64_t g_total;
+
+void textOutput(const char* msg, int len)
+{
+  g_text.append(msg, len);
+}
+
+void binaryOutput(const char* msg, int len)
+{
+  g_binary.append(msg, len);
+}
+
+void nopOutput(const char* msg, int len)
+{
+  g_total += len;
+}
+
+// lines without time, which differs
+muduo::string strip(const muduo::string& text)
+{
+  muduo::string result;
+  size_t pos = 0;
+  while (pos < text.size())
+  {
+    size_t eol = text.find('\n', pos);
+    eol = eol == muduo::string::npos ? text.size() : eol + 1;
+    muduo::string line(text.substr(pos, eol - pos));
+    result += line.size() > 26 ? line.substr(26) : line;
+    pos = eol;
+  }
+  return result;
+}
+
+// on one line, both have the same __LINE__
+#define BOTH(level, args) LOG_##level << args; BLOG_##level << args
+
+void check()
+{
+  muduo::BinaryLogDecoder decoder;
+  muduo::string decoded;
+  decoder.decode(g_binary.data(), g_binary.size(), &decoded);
+  muduo::string expected(strip(g_text));
+  muduo::string actual(strip(decoded));
+  if (expected != actual)
+  {
+    printf("expected:\n%s\nactual:\n%s\n", expected.c_str(), actual.c_str());
+    abort();
+  }
+  printf("%s", decoded.c_str());
+}
+
+void bench(const char* type, bool binary)
+{
+  muduo::Logger::setOutput(nopOutput);
+  muduo::BinaryLogger::setOutput(nopOutput);
+  g_total = 0;
+  const int n = 1000 * 1000;
+  muduo::Timestamp start(muduo::Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    if (binary)
+    {
+      BLOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i << ' ' << 3.14;
+    }
+    else
+    {
+      LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i << ' ' << 3.14;
+    }
+  }
+  double seconds = timeDifference(muduo::Timestamp::now(), start);
+  printf("%8s: %f seconds, %" PRId64 " bytes, %10.2f msg/s\n",
+         type, seconds, g_total, n / seconds);
+}
+
+int main()
+{
+  muduo::Logger::setLogLevel(muduo::Logger::TRACE);
+  muduo::Logger::setOutput(textOutput);
+  muduo::BinaryLogger::setOutput(binaryOutput);
+
+  BOTH(TRACE, "trace");
+  BOTH(DEBUG, "debug " << 42);
+  BOTH(INFO, "Hello " << -1 << ' ' << 2u << ' ' << 12345678901LL << " " << 1.5 << " " << 0.1f);
+  BOTH(WARN, "World " << true << false << static_cast<const void*>(&g_total));
+  BOTH(ERROR, muduo::string("Error ") << muduo::StringPiece("piece") << muduo::Fmt(" %5.2f", 2.5));
+  BOTH(INFO, static_cast<const char*>(NULL) << 'x' << static_cast<short>(-3));
+
+  // LOG_* lines between records are passed through
+  g_binary += "a text line\n";
+  g_text += "a text line\n";
+  BOTH(INFO, "after text");
+  check();
+
+  muduo::Logger::setLogLevel(muduo::Logger::INFO);
+  bench("LOG", false);
+  bench("BLOG", true);
+}
@@ -0,0 +1,56 @@
+#include <muduo/base/Histogram.h>
+
+//#define BOOST_TEST_MODULE HistogramTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+
+#include <stdint.h>
+
+using muduo::Histogram;
+
+BOOST_AUTO_TEST_CASE(testHistogramBuckets)
+{
+  // every value falls into the first bucket whose limit is >= it
+  for (int64_t v = 0; v < 100000; ++v)
+  {
+    int b = Histogram::bucketOf(v);
+    BOOST_REQUIRE_LE(v, Histogram::bucketLimit(b));
+    if (b > 0)
+    {
+      BOOST_REQUIRE_GT(v, Histogram::bucketLimit(b-1));
+    }
+  }
+  for (int i = 0; i + 1 < Histogram::kNumBuckets; ++i)
+  {
+    BOOST_REQUIRE_LT(Histogram::bucketLimit(i), Histogram::bucketLimit(i+1));
+    BOOST_REQUIRE_EQUAL(Histogram::bucketOf(Histogram::bucketLimit(i)), i);
+  }
+  BOOST_CHECK_EQUAL(Histogram::bucketOf(std::numeric_limits<int64_t>::max()), Histogram::kNumBuckets - 1);
+}
+
+BOOST_AUTO_TEST_CASE(testHistogramPercentile)
+{
+  Histogram h;
+  BOOST_CHECK_EQUAL(h.percentile(0.5), 0);
+  for (int64_t v = 1; v <= 1000; ++v)
+  {
+    h.add(v);
+  }
+  h.add(-1);  // as 0
+  BOOST_CHECK_EQUAL(h.count(), 1001);
+  BOOST_CHECK_EQUAL(h.max(), 1000);
+  BOOST_CHECK_EQUAL(h.sum(), 500500);
+
+  // within 12.5%
+  int64_t p50 = h.percentile(0.5);
+  BOOST_CHECK_GE(p50, 500);
+  BOOST_CHECK_LE(p50, 500 * 9 / 8);
+  int64_t p99 = h.percentile(0.99);
+  BOOST_CHECK_GE(p99, 990);
+  BOOST_CHECK_LE(p99, 1000);
+  BOOST_CHECK_EQUAL(h.percentile(1.0), 1000);
+  BOOST_CHECK_EQUAL(h.percentile(0.0), 0);
+}
@@ -0,0 +1,96 @@
+#include <muduo/base/InlineFunction.h>
+#include <muduo/base/Types.h>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <vector>
+#include <assert.h>
+
+int g_sum = 0;
+int g_live = 0;  // of Counter
+
+void inc()
+{
+  ++g_sum;
+}
+
+class Counter
+{
+ public:
+  Counter() { ++g_live; }
+  Counter(const Counter&) { ++g_live; }
+  ~Counter() { --g_live; }
+
+  void add(int x) { g_sum += x; }
+  void add3(int x, int y, int z) { g_sum += x + y + z; }
+  void addSize(const muduo::string& s) { g_sum += static_cast<int>(s.size()); }
+};
+
+int main()
+{
+  using muduo::InlineFunction;
+
+  {
+  InlineFunction f;
+  assert(!f);
+  assert(f.empty());
+  InlineFunction g(inc);
+  assert(g);
+  g();
+  assert(g_sum == 1);
+  void (*null)() = NULL;
+  InlineFunction h(null);
+  assert(!h);
+  boost::function<void()> empty;
+  InlineFunction i(empty);
+  assert(!i);
+  }
+
+  {
+  boost::shared_ptr<Counter> counter(new Counter);
+  muduo::string str(100, 'x');
+  // fits in place, and too big
+  InlineFunction small(boost::bind(&Counter::addSize, counter.get(), str));
+  InlineFunction big(boost::bind(&Counter::add3, counter, 1, 2, 3));
+  g_sum = 0;
+  small();
+  big();
+  assert(g_sum == 106);
+
+  std::vector<InlineFunction> tasks;
+  for (int i = 0; i < 100; ++i)
+  {
+    tasks.push_back(i % 2 ? small : big);
+  }
+  g_sum = 0;
+  for (size_t i = 0; i < tasks.size(); ++i)
+  {
+    tasks[i]();
+  }
+  assert(g_sum == 50 * 106);
+
+  tasks[0].swap(tasks[1]);
+  swap(tasks[2], tasks[3]);
+  InlineFunction copy;
+  copy = tasks[0];
+  copy.clear();
+  assert(!copy);
+  boost::function<void()> back(small);
+  g_sum = 0;
+  back();
+  assert(g_sum == 100);
+  assert(counter.use_count() == 1 + 1 + 50);
+  }
+  assert(g_live == 0);
+
+  {
+  Counter counter;
+  InlineFunction f(boost::bind(&Counter::add, counter, 1));
+  InlineFunction g(f);
+  assert(g_live == 3);
+  f = InlineFunction();
+  assert(g_live == 2);
+  }
+  assert(g_live == 0);
+}
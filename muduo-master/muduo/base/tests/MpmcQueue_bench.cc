@@ -0,0 +1,190 @@
+#include <muduo/base/BlockingQueue.h>
+#include <muduo/base/BoundedBlockingQueue.h>
+#include <muduo/base/MpmcQueue.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+
+// producers put numbers, consumers take them until -1,
+// compares queues between IO threads and workers.
+
+const int kCapacity = 1024;
+const int kBatch = 16;
+
+// the same interface for all
+template<typename Queue>
+struct Adapter
+{
+  static Queue* create() { return new Queue(kCapacity); }
+  static void put(Queue* q, const int64_t* items, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      q->put(items[i]);
+    }
+  }
+  static size_t take(Queue* q, int64_t* items, size_t)
+  {
+    items[0] = q->take();
+    return 1;
+  }
+};
+
+template<>
+struct Adapter<muduo::BlockingQueue<int64_t> >
+{
+  typedef muduo::BlockingQueue<int64_t> Queue;
+  static Queue* create() { return new Queue; }
+  static void put(Queue* q, const int64_t* items, size_t n)
+  {
+    for (size_t i = 0; i < n; ++i)
+    {
+      q->put(items[i]);
+    }
+  }
+  static size_t take(Queue* q, int64_t* items, size_t)
+  {
+    items[0] = q->take();
+    return 1;
+  }
+};
+
+struct BulkMpmcQueue : muduo::MpmcQueue<int64_t>
+{
+  explicit BulkMpmcQueue(int maxSize) : muduo::MpmcQueue<int64_t>(maxSize) { }
+};
+
+template<>
+struct Adapter<BulkMpmcQueue>
+{
+  typedef BulkMpmcQueue Queue;
+  static Queue* create() { return new Queue(kCapacity); }
+  static void put(Queue* q, const int64_t* items, size_t n)
+  {
+    q->putBulk(items, n);
+  }
+  static size_t take(Queue* q, int64_t* items, size_t n)
+  {
+    return q->takeBulk(items, n);
+  }
+};
+
+template<typename Queue>
+class Bench
+{
+ public:
+  Bench(const char* name, int numProducers, int numConsumers, int64_t times)
+    : name_(name),
+      numConsumers_(numConsumers),
+      times_(times),
+      queue_(Adapter<Queue>::create()),
+      latch_(1)
+  {
+    for (int i = 0; i < numProducers; ++i)
+    {
+      producers_.push_back(new muduo::Thread(
+            boost::bind(&Bench::produce, this), "producer"));
+    }
+    for (int i = 0; i < numConsumers; ++i)
+    {
+      consumers_.push_back(new muduo::Thread(
+            boost::bind(&Bench::consume, this), "consumer"));
+    }
+  }
+
+  ~Bench()
+  {
+    delete queue_;
+  }
+
+  void run()
+  {
+    for_each(producers_.begin(), producers_.end(), boost::bind(&muduo::Thread::start, _1));
+    for_each(consumers_.begin(), consumers_.end(), boost::bind(&muduo::Thread::start, _1));
+    muduo::Timestamp start(muduo::Timestamp::now());
+    latch_.countDown();
+    for_each(producers_.begin(), producers_.end(), boost::bind(&muduo::Thread::join, _1));
+    for (int i = 0; i < numConsumers_; ++i)
+    {
+      int64_t stop = -1;
+      Adapter<Queue>::put(queue_, &stop, 1);
+    }
+    for_each(consumers_.begin(), consumers_.end(), boost::bind(&muduo::Thread::join, _1));
+    double seconds = timeDifference(muduo::Timestamp::now(), start);
+    int64_t total = times_ * static_cast<int64_t>(producers_.size());
+    printf("%-22s %d producers %d consumers: %.3f s %6.2f Mops/s\n",
+           name_, static_cast<int>(producers_.size()), numConsumers_,
+           seconds, static_cast<double>(total) / seconds / 1e6);
+  }
+
+ private:
+  void produce()
+  {
+    latch_.wait();
+    int64_t items[kBatch];
+    for (int64_t i = 0; i < times_; i += kBatch)
+    {
+      size_t n = 0;
+      for (; n < kBatch && i + static_cast<int64_t>(n) < times_; ++n)
+      {
+        items[n] = i + static_cast<int64_t>(n);
+      }
+      Adapter<Queue>::put(queue_, items, n);
+    }
+  }
+
+  void consume()
+  {
+    int64_t items[kBatch];
+    int stops = 0;
+    while (stops == 0)
+    {
+      size_t n = Adapter<Queue>::take(queue_, items, kBatch);
+      for (size_t i = 0; i < n; ++i)
+      {
+        if (items[i] < 0)
+        {
+          ++stops;
+        }
+      }
+    }
+    for (int i = 1; i < stops; ++i)
+    {
+      int64_t stop = -1;
+      Adapter<Queue>::put(queue_, &stop, 1);
+    }
+  }
+
+  const char* name_;
+  const int numConsumers_;
+  const int64_t times_;
+  Queue* queue_;
+  muduo::CountDownLatch latch_;
+  boost::ptr_vector<muduo::Thread> producers_;
+  boost::ptr_vector<muduo::Thread> consumers_;
+};
+
+template<typename Queue>
+void bench(const char* name, int producers, int consumers, int64_t times)
+{
+  Bench<Queue> b(name, producers, consumers, times);
+  b.run();
+}
+
+int main(int argc, char* argv[])
+{
+  int64_t times = argc > 1 ? atoi(argv[1]) : 1000000;
+  int maxThreads = argc > 2 ? atoi(argv[2]) : 4;
+  for (int threads = 1; threads <= maxThreads; threads *= 2)
+  {
+    bench<muduo::BlockingQueue<int64_t> >("BlockingQueue", threads, threads, times);
+    bench<muduo::BoundedBlockingQueue<int64_t> >("BoundedBlockingQueue", threads, threads, times);
+    bench<muduo::MpmcQueue<int64_t> >("MpmcQueue", threads, threads, times);
+    bench<BulkMpmcQueue>("MpmcQueue bulk", threads, threads, times);
+  }
+}
@@ -0,0 +1,177 @@
+#include <muduo/base/MpmcQueue.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+// every producer puts its id and sequence number, every consumer checks
+// those of one producer come out in order, and all of them come out.
+// odd producers and consumers use the bulk calls.
+class Test
+{
+ public:
+  Test(int numProducers, int numConsumers, int64_t times)
+    : numProducers_(numProducers),
+      numConsumers_(numConsumers),
+      times_(times),
+      queue_(64),
+      latch_(1),
+      total_(0)
+  {
+    for (int i = 0; i < numProducers; ++i)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "producer %d", i);
+      threads_.push_back(new muduo::Thread(
+            boost::bind(&Test::produce, this, i), muduo::string(name)));
+    }
+    for (int i = 0; i < numConsumers; ++i)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "consumer %d", i);
+      consumers_.push_back(new muduo::Thread(
+            boost::bind(&Test::consume, this, i), muduo::string(name)));
+    }
+  }
+
+  void run()
+  {
+    for_each(threads_.begin(), threads_.end(), boost::bind(&muduo::Thread::start, _1));
+    for_each(consumers_.begin(), consumers_.end(), boost::bind(&muduo::Thread::start, _1));
+    muduo::Timestamp start(muduo::Timestamp::now());
+    latch_.countDown();
+    for_each(threads_.begin(), threads_.end(), boost::bind(&muduo::Thread::join, _1));
+    for (int i = 0; i < numConsumers_; ++i)
+    {
+      queue_.put(-1);
+    }
+    for_each(consumers_.begin(), consumers_.end(), boost::bind(&muduo::Thread::join, _1));
+    muduo::Timestamp end(muduo::Timestamp::now());
+
+    if (total_ != numProducers_ * times_ || !queue_.empty())
+    {
+      printf("expects %" PRId64 " items, got %" PRId64 "\n", numProducers_ * times_, total_);
+      abort();
+    }
+    double seconds = timeDifference(end, start);
+    printf("%d producers %d consumers %" PRId64 " items %.3f s %.2f Mops/s\n",
+           numProducers_, numConsumers_, total_, seconds,
+           static_cast<double>(total_) / seconds / 1e6);
+  }
+
+ private:
+  void produce(int id)
+  {
+    latch_.wait();
+    int64_t items[16];
+    for (int64_t i = 0; i < times_; )
+    {
+      if (id % 2 == 0)
+      {
+        queue_.put((static_cast<int64_t>(id) << 32) | i);
+        ++i;
+      }
+      else
+      {
+        size_t n = 0;
+        for (; n < 16 && i < times_; ++n, ++i)
+        {
+          items[n] = (static_cast<int64_t>(id) << 32) | i;
+        }
+        queue_.putBulk(items, n);
+      }
+    }
+  }
+
+  void consume(int id)
+  {
+    std::vector<int64_t> expected(numProducers_);
+    int64_t count = 0;
+    int64_t items[16];
+    int stops = 0;
+    while (stops == 0)
+    {
+      size_t n = 1;
+      if (id % 2 == 0)
+      {
+        items[0] = queue_.take();
+      }
+      else
+      {
+        n = queue_.takeBulk(items, 16);
+      }
+      for (size_t i = 0; i < n; ++i)
+      {
+        int64_t x = items[i];
+        if (x < 0)
+        {
+          ++stops;  // one for each consumer, the last ones
+          continue;
+        }
+        int producer = static_cast<int>(x >> 32);
+        int64_t seq = x & 0xFFFFFFFF;
+        if (seq < expected[producer])
+        {
+          printf("producer %d expects > %" PRId64 " got %" PRId64 "\n",
+                 producer, expected[producer], seq);
+          abort();
+        }
+        expected[producer] = seq + 1;
+        ++count;
+      }
+    }
+    // a bulk take may get those of others
+    for (int i = 1; i < stops; ++i)
+    {
+      queue_.put(-1);
+    }
+    __atomic_fetch_add(&total_, count, __ATOMIC_RELAXED);
+  }
+
+  const int numProducers_;
+  const int numConsumers_;
+  const int64_t times_;
+  muduo::MpmcQueue<int64_t> queue_;
+  muduo::CountDownLatch latch_;
+  int64_t total_;
+  boost::ptr_vector<muduo::Thread> threads_;
+  boost::ptr_vector<muduo::Thread> consumers_;
+};
+
+int main(int argc, char* argv[])
+{
+  int64_t times = argc > 1 ? atoi(argv[1]) : 100000;
+  for (int threads = 1; threads <= 4; threads *= 2)
+  {
+    Test t(threads, threads, times);
+    t.run();
+  }
+
+  {
+    // bounded, FIFO, rounded up
+    muduo::MpmcQueue<muduo::string> queue(3);
+    muduo::string x;
+    if (queue.capacity() != 4 || queue.tryTake(&x)
+        || !queue.tryPut("hello") || !queue.tryPut("world")
+        || queue.size() != 2 || !queue.tryTake(&x) || x != "hello")
+    {
+      printf("wrong queue\n");
+      abort();
+    }
+    const muduo::string items[4] = { "a", "b", "c", "d" };
+    muduo::string out[4];
+    if (queue.tryPutBulk(items, 4) != 3 || !queue.full()
+        || queue.tryTakeBulk(out, 4) != 4 || out[0] != "world" || out[3] != "c")
+    {
+      printf("wrong bulk\n");
+      abort();
+    }
+  }
+}
@@ -0,0 +1,125 @@
+#include <muduo/base/MpscQueue.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+// every producer pushes its id and sequence number,
+// the consumer checks they come out in order.
+class Test
+{
+ public:
+  Test(int numProducers, int64_t times)
+    : numProducers_(numProducers),
+      times_(times),
+      latch_(1)
+  {
+    for (int i = 0; i < numProducers; ++i)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "producer %d", i);
+      threads_.push_back(new muduo::Thread(
+            boost::bind(&Test::produce, this, i), muduo::string(name)));
+    }
+  }
+
+  void run()
+  {
+    for_each(threads_.begin(), threads_.end(), boost::bind(&muduo::Thread::start, _1));
+    muduo::Timestamp start(muduo::Timestamp::now());
+    latch_.countDown();
+
+    std::vector<int64_t> expected(numProducers_);
+    int64_t total = 0;
+    int64_t spins = 0;
+    while (total < numProducers_ * times_)
+    {
+      int64_t x = 0;
+      if (queue_.pop(&x))
+      {
+        int producer = static_cast<int>(x >> 32);
+        int64_t seq = x & 0xFFFFFFFF;
+        if (seq != expected[producer]++)
+        {
+          printf("producer %d expects %" PRId64 " got %" PRId64 "\n", producer, expected[producer]-1, seq);
+          abort();
+        }
+        ++total;
+      }
+      else
+      {
+        ++spins;
+      }
+    }
+    muduo::Timestamp end(muduo::Timestamp::now());
+    for_each(threads_.begin(), threads_.end(), boost::bind(&muduo::Thread::join, _1));
+    assert(queue_.empty());
+    assert(queue_.size() == 0);
+
+    double seconds = timeDifference(end, start);
+    printf("%d producers %" PRId64 " items %.3f s %.1f Mops/s, %" PRId64 " empty pops\n",
+           numProducers_, total, seconds, static_cast<double>(total) / seconds / 1e6, spins);
+  }
+
+ private:
+  void produce(int id)
+  {
+    latch_.wait();
+    for (int64_t i = 0; i < times_; ++i)
+    {
+      queue_.push((static_cast<int64_t>(id) << 32) | i);
+    }
+  }
+
+  const int numProducers_;
+  const int64_t times_;
+  muduo::MpscQueue<int64_t> queue_;
+  muduo::CountDownLatch latch_;
+  boost::ptr_vector<muduo::Thread> threads_;
+};
+
+int main(int argc, char* argv[])
+{
+  int64_t times = argc > 1 ? atoi(argv[1]) : 200000;
+  for (int producers = 1; producers <= 8; producers *= 2)
+  {
+    Test t(producers, times);
+    t.run();
+  }
+
+  {
+    // leftovers are deleted
+    muduo::MpscQueue<muduo::string> queue;
+    queue.push("hello");
+    queue.push("world");
+    muduo::string x;
+    bool ok = queue.pop(&x);
+    assert(ok && x == "hello"); (void)ok;
+    assert(queue.size() == 1);
+  }
+
+  {
+    // recycled nodes don't keep popped values alive
+    muduo::MpscQueue<boost::shared_ptr<int> > queue;
+    boost::shared_ptr<int> p(new int(42));
+    for (int i = 0; i < 3; ++i)
+    {
+      queue.push(p);
+      boost::shared_ptr<int> x;
+      bool ok = queue.pop(&x);
+      assert(ok && x == p); (void)ok;
+      x.reset();
+      assert(p.use_count() == 1);
+    }
+    assert(queue.empty());
+  }
+}
@@ -1,5 +1,7 @@
 #include <muduo/base/ProcessInfo.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #define __STDC_FORMAT_MACROS
 #include <inttypes.h>
 
@@ -14,5 +16,25 @@ int main()
   printf("threads = %zd\n", muduo::ProcessInfo::threads().size());
   printf("num threads = %d\n", muduo::ProcessInfo::numThreads());
   printf("status = %s\n", muduo::ProcessInfo::procStatus().c_str());
+  printf("cpu affinity = %s\n", muduo::ProcessInfo::cpuAffinity(0).c_str());
 
+  // cpu0 is listed under the directory of its node, if the kernel has NUMA
+  int node = muduo::ProcessInfo::numaNodeOfCpu(0);
+  printf("numa node of cpu0 = %d\n", node);
+  struct stat st;
+  if (::stat("/sys/devices/system/node", &st) == 0)
+  {
+    char path[64];
+    snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpu0", node);
+    if (node < 0 || ::stat(path, &st) != 0)
+    {
+      printf("%s not found\n", path);
+      abort();
+    }
+  }
+  if (muduo::ProcessInfo::numaNodeOfCpu(1 << 20) != -1)
+  {
+    printf("numa node of a missing cpu should be -1\n");
+    abort();
+  }
 }
@@ -0,0 +1,110 @@
+#include <muduo/base/ThreadPool.h>
+#include <muduo/base/WorkStealingThreadPool.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+
+// producers (like IO threads) submit tasks which spin for a while,
+// compares ThreadPool with WorkStealingThreadPool.
+
+int64_t g_done = 0;
+muduo::CountDownLatch* g_allDone = NULL;
+int64_t g_total = 0;
+
+void task(int iterations)
+{
+  volatile int x = 0;
+  for (int i = 0; i < iterations; ++i)
+  {
+    x = x + i;
+  }
+  if (__atomic_add_fetch(&g_done, 1, __ATOMIC_RELAXED) == g_total)
+  {
+    g_allDone->countDown();
+  }
+}
+
+template<typename Pool>
+void produce(Pool* pool, int tasks, int iterations, int batch, muduo::CountDownLatch* start)
+{
+  start->wait();
+  for (int i = 0; i < tasks; ++i)
+  {
+    pool->run(boost::bind(task, iterations));
+  }
+  (void)batch;
+}
+
+// submits @c batch tasks at a time
+void produceBatch(muduo::WorkStealingThreadPool* pool, int tasks, int iterations,
+                  int batch, muduo::CountDownLatch* start)
+{
+  start->wait();
+  std::vector<muduo::WorkStealingThreadPool::Task> pending;
+  for (int i = 0; i < tasks; ++i)
+  {
+    pending.push_back(boost::bind(task, iterations));
+    if (static_cast<int>(pending.size()) == batch || i == tasks - 1)
+    {
+      pool->runAll(pending);
+      pending.clear();
+    }
+  }
+}
+
+template<typename Pool, typename Produce>
+void bench(const char* name, Produce produceFunc, int numThreads, int numProducers,
+           int tasks, int iterations, int batch)
+{
+  Pool pool(name);
+  pool.start(numThreads);
+
+  g_done = 0;
+  g_total = static_cast<int64_t>(tasks) * numProducers;
+  muduo::CountDownLatch allDone(1);
+  g_allDone = &allDone;
+  muduo::CountDownLatch start(1);
+  boost::ptr_vector<muduo::Thread> producers;
+  for (int i = 0; i < numProducers; ++i)
+  {
+    producers.push_back(new muduo::Thread(
+          boost::bind(produceFunc, &pool, tasks, iterations, batch, &start), "producer"));
+    producers.back().start();
+  }
+
+  muduo::Timestamp begin(muduo::Timestamp::now());
+  start.countDown();
+  allDone.wait();
+  double seconds = timeDifference(muduo::Timestamp::now(), begin);
+  for_each(producers.begin(), producers.end(), boost::bind(&muduo::Thread::join, _1));
+  pool.stop();
+
+  printf("%-24s threads %2d producers %d spin %5d batch %3d: %.3f s %8.0f tasks/s\n",
+         name, numThreads, numProducers, iterations, batch,
+         seconds, static_cast<double>(g_total) / seconds);
+}
+
+int main(int argc, char* argv[])
+{
+  int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+  int numProducers = argc > 2 ? atoi(argv[2]) : 4;
+  int tasks = argc > 3 ? atoi(argv[3]) : 200000;
+
+  // short tasks, where the queue matters, then long ones
+  const int spins[] = { 0, 100, 10000 };
+  for (size_t i = 0; i < sizeof spins / sizeof spins[0]; ++i)
+  {
+    int n = spins[i] >= 10000 ? tasks / 10 : tasks;
+    bench<muduo::ThreadPool>("ThreadPool",
+        produce<muduo::ThreadPool>, numThreads, numProducers, n, spins[i], 1);
+    bench<muduo::WorkStealingThreadPool>("WorkStealingThreadPool",
+        produce<muduo::WorkStealingThreadPool>, numThreads, numProducers, n, spins[i], 1);
+    bench<muduo::WorkStealingThreadPool>("WorkStealingThreadPool",
+        produceBatch, numThreads, numProducers, n, spins[i], 32);
+  }
+}
@@ -0,0 +1,145 @@
+#include <muduo/base/WorkStealingDeque.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#define __STDC_FORMAT_MACROS
+#include <inttypes.h>
+
+// the owner pushes and pops, thieves steal meanwhile,
+// every item must be taken exactly once.
+class Test
+{
+ public:
+  Test(int numThieves, int64_t times)
+    : numThieves_(numThieves),
+      times_(times),
+      taken_(times, 0),
+      done_(false),
+      deque_(256),
+      latch_(1)
+  {
+    for (int i = 0; i < numThieves; ++i)
+    {
+      char name[32];
+      snprintf(name, sizeof name, "thief %d", i);
+      threads_.push_back(new muduo::Thread(
+            boost::bind(&Test::steal, this), muduo::string(name)));
+    }
+  }
+
+  void run()
+  {
+    for_each(threads_.begin(), threads_.end(), boost::bind(&muduo::Thread::start, _1));
+    muduo::Timestamp start(muduo::Timestamp::now());
+    latch_.countDown();
+
+    int64_t popped = 0;
+    for (int64_t i = 0; i < times_; )
+    {
+      int* item = &taken_[i];
+      bool pushed = deque_.push(&item);
+      if (pushed)
+      {
+        ++i;
+      }
+      // pops one of three, leaves the rest to thieves
+      if (!pushed || i % 3 == 0)
+      {
+        int* x = NULL;
+        if (deque_.pop(&x))
+        {
+          take(x);
+          ++popped;
+        }
+      }
+    }
+    int* x = NULL;
+    while (deque_.pop(&x))
+    {
+      take(x);
+      ++popped;
+    }
+    __atomic_store_n(&done_, true, __ATOMIC_RELEASE);
+    for_each(threads_.begin(), threads_.end(), boost::bind(&muduo::Thread::join, _1));
+    muduo::Timestamp end(muduo::Timestamp::now());
+
+    for (int64_t i = 0; i < times_; ++i)
+    {
+      if (taken_[i] != 1)
+      {
+        printf("item %" PRId64 " taken %d times\n", i, taken_[i]);
+        abort();
+      }
+    }
+    if (!deque_.empty())
+    {
+      printf("deque is not empty\n");
+      abort();
+    }
+    double seconds = timeDifference(end, start);
+    printf("%d thieves %" PRId64 " items %.3f s, %" PRId64 " popped\n",
+           numThieves_, times_, seconds, popped);
+  }
+
+ private:
+  void take(int* x)
+  {
+    __atomic_fetch_add(x, 1, __ATOMIC_RELAXED);
+  }
+
+  void steal()
+  {
+    latch_.wait();
+    while (!__atomic_load_n(&done_, __ATOMIC_ACQUIRE))
+    {
+      int* x = NULL;
+      if (deque_.steal(&x))
+      {
+        take(x);
+      }
+    }
+  }
+
+  const int numThieves_;
+  const int64_t times_;
+  std::vector<int> taken_;
+  bool done_; /* atomic */
+  muduo::WorkStealingDeque<int*> deque_;
+  muduo::CountDownLatch latch_;
+  boost::ptr_vector<muduo::Thread> threads_;
+};
+
+int main(int argc, char* argv[])
+{
+  int64_t times = argc > 1 ? atoi(argv[1]) : 200000;
+  for (int thieves = 0; thieves <= 4; thieves = thieves ? thieves * 2 : 1)
+  {
+    Test t(thieves, times);
+    t.run();
+  }
+
+  {
+    // LIFO for the owner, FIFO for thieves, bounded
+    muduo::WorkStealingDeque<int> deque(4);
+    for (int i = 0; i < 4; ++i)
+    {
+      int item = i;
+      deque.push(&item);
+    }
+    int x = 4;
+    if (deque.push(&x) || deque.size() != 4
+        || !deque.pop(&x) || x != 3 || !deque.steal(&x) || x != 0
+        || !deque.pop(&x) || x != 2 || !deque.pop(&x) || x != 1
+        || deque.pop(&x) || deque.steal(&x))
+    {
+      printf("wrong order\n");
+      abort();
+    }
+  }
+}
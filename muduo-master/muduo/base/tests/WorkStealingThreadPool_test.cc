@@ -0,0 +1,354 @@
+#include <muduo/base/WorkStealingThreadPool.h>
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/CurrentThread.h>
+#include <muduo/base/Thread.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/shared_ptr.hpp>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>  // usleep
+
+namespace
+{
+
+void check(bool ok, const char* what)
+{
+  if (!ok)
+  {
+    printf("failed: %s\n", what);
+    abort();
+  }
+}
+
+// waits for *flag without a condition, gives up after 10 seconds
+bool waitFor(const int* flag, int value)
+{
+  muduo::Timestamp deadline(muduo::addTime(muduo::Timestamp::now(), 10.0));
+  while (__atomic_load_n(flag, __ATOMIC_ACQUIRE) != value)
+  {
+    if (deadline < muduo::Timestamp::now())
+      return false;
+    usleep(1000);
+  }
+  return true;
+}
+
+void count(std::vector<int>* counts, int i, muduo::CountDownLatch* latch)
+{
+  __atomic_fetch_add(&(*counts)[i], 1, __ATOMIC_RELAXED);
+  latch->countDown();
+}
+
+// submits from a worker, which goes to its own deque
+void spawn(muduo::WorkStealingThreadPool* pool, std::vector<int>* counts,
+           int begin, int end, muduo::CountDownLatch* latch)
+{
+  for (int i = begin; i < end; ++i)
+  {
+    pool->run(boost::bind(count, counts, i, latch));
+  }
+  latch->countDown();
+}
+
+void produce(muduo::WorkStealingThreadPool* pool, std::vector<int>* counts,
+             int begin, int end, muduo::CountDownLatch* latch)
+{
+  std::vector<muduo::WorkStealingThreadPool::Task> batch;
+  for (int i = begin; i < end; ++i)
+  {
+    // one of three in batches
+    if (i % 3 == 0)
+    {
+      batch.push_back(boost::bind(count, counts, i, latch));
+      if (batch.size() == 16)
+      {
+        pool->runAll(batch);
+        batch.clear();
+      }
+    }
+    else
+    {
+      pool->run(boost::bind(count, counts, i, latch));
+    }
+  }
+  pool->runAll(batch);
+}
+
+// every task runs once, from producers, in batches, and from workers
+void testEveryTaskRuns()
+{
+  const int kProducers = 3;
+  const int kTasks = 30000;
+  const int kSpawned = 3000;
+  std::vector<int> counts(kProducers * kTasks + kSpawned, 0);
+  muduo::CountDownLatch latch(static_cast<int>(counts.size()) + 1);
+
+  muduo::WorkStealingThreadPool pool("EveryTaskRuns");
+  pool.start(4);
+  boost::ptr_vector<muduo::Thread> producers;
+  for (int i = 0; i < kProducers; ++i)
+  {
+    producers.push_back(new muduo::Thread(
+          boost::bind(produce, &pool, &counts, i * kTasks, (i + 1) * kTasks, &latch)));
+    producers.back().start();
+  }
+  const int spawnBegin = kProducers * kTasks;
+  pool.run(boost::bind(spawn, &pool, &counts, spawnBegin, spawnBegin + kSpawned, &latch));
+  for (int i = 0; i < kProducers; ++i)
+  {
+    producers[i].join();
+  }
+  latch.wait();
+  pool.stop();
+
+  for (size_t i = 0; i < counts.size(); ++i)
+  {
+    if (counts[i] != 1)
+    {
+      printf("task %zu run %d times\n", i, counts[i]);
+      abort();
+    }
+  }
+  check(pool.queueSize() == 0, "queue is empty");
+  printf("%zu tasks\n", counts.size());
+}
+
+void countDone(std::vector<int>* counts, int i, int* done)
+{
+  __atomic_fetch_add(&(*counts)[i], 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add(done, 1, __ATOMIC_RELEASE);
+}
+
+// copied slowly by any thread but its owner, which keeps a thief
+// in the middle of taking it out of a deque slot
+struct SlowToSteal
+{
+  SlowToSteal(pid_t o, int* s, int* d)
+    : owner(o), stealing(s), done(d)
+  { }
+
+  SlowToSteal(const SlowToSteal& rhs)
+    : owner(rhs.owner), stealing(rhs.stealing), done(rhs.done)
+  {
+    if (muduo::CurrentThread::tid() != owner)
+    {
+      __atomic_store_n(stealing, 1, __ATOMIC_RELEASE);
+      usleep(200*1000);
+    }
+  }
+
+  void operator()() const
+  {
+    __atomic_fetch_add(done, 1, __ATOMIC_RELEASE);
+  }
+
+  pid_t owner;
+  int* stealing;
+  int* done;
+};
+
+struct InboxFill
+{
+  InboxFill() : pool(NULL), worker(0), numWorkers(0), stealing(0), done(0) { }
+
+  muduo::WorkStealingThreadPool* pool;
+  int worker;
+  int numWorkers;
+  int stealing; /* atomic */
+  int done; /* atomic */
+  std::vector<int> counts;
+};
+
+// from a thread which submits to the inbox of f->worker
+void fillInbox(InboxFill* f, bool* filled)
+{
+  if (muduo::CurrentThread::tid() % f->numWorkers == f->worker)
+  {
+    std::vector<muduo::WorkStealingThreadPool::Task> batch;
+    for (size_t i = 0; i < f->counts.size(); ++i)
+    {
+      batch.push_back(boost::bind(countDone, &f->counts, static_cast<int>(i), &f->done));
+    }
+    f->pool->runAll(batch);
+    *filled = true;
+  }
+}
+
+// on a worker: the only task of its deque is being stolen, then its
+// inbox gets more than the deque holds, which it takes when this returns
+void stealThenFill(InboxFill* f, muduo::CountDownLatch* latch)
+{
+  // workers are named after their index, from 1
+  const char* name = muduo::CurrentThread::name();
+  f->worker = name[strlen(name) - 1] - '1';
+  f->pool->run(SlowToSteal(muduo::CurrentThread::tid(), &f->stealing, &f->done));
+  check(waitFor(&f->stealing, 1), "stealing");
+  bool filled = false;
+  while (!filled)
+  {
+    muduo::Thread filler(boost::bind(fillInbox, f, &filled));
+    filler.start();
+    filler.join();
+  }
+  latch->countDown();
+}
+
+// the batch taken from an inbox fills the deque, its last push lands on
+// the slot a thief is still taking out, the rest stays in the inbox
+void testInboxPastCapacity()
+{
+  InboxFill f;
+  f.numWorkers = 2;
+  f.counts.resize(3000, 0);
+
+  muduo::WorkStealingThreadPool pool("InboxPastCapacity");
+  f.pool = &pool;
+  pool.start(f.numWorkers);
+  muduo::CountDownLatch latch(1);
+  pool.run(boost::bind(stealThenFill, &f, &latch));
+  latch.wait();
+  // a dropped task never finishes
+  check(waitFor(&f.done, static_cast<int>(f.counts.size()) + 1), "every task finished");
+  pool.stop();
+
+  for (size_t i = 0; i < f.counts.size(); ++i)
+  {
+    if (f.counts[i] != 1)
+    {
+      printf("task %zu run %d times\n", i, f.counts[i]);
+      abort();
+    }
+  }
+  printf("%zu tasks through a full deque\n", f.counts.size());
+}
+
+struct Stealing
+{
+  Stealing() : blockedTid(0), done(0), stolen(0) { }
+
+  pid_t blockedTid;
+  int done; /* atomic */
+  int stolen; /* atomic */
+};
+
+void recordThread(Stealing* s)
+{
+  if (muduo::CurrentThread::tid() != s->blockedTid)
+  {
+    __atomic_fetch_add(&s->stolen, 1, __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_add(&s->done, 1, __ATOMIC_RELEASE);
+}
+
+// a worker queues more than its deque holds, then blocks until
+// all of them are done, which only the others can do
+void block(muduo::WorkStealingThreadPool* pool, Stealing* s, int n,
+           bool* finished, muduo::CountDownLatch* latch)
+{
+  s->blockedTid = muduo::CurrentThread::tid();
+  for (int i = 0; i < n; ++i)
+  {
+    pool->run(boost::bind(recordThread, s));
+  }
+  *finished = waitFor(&s->done, n);
+  latch->countDown();
+}
+
+void testStealing()
+{
+  const int kTasks = 3000;
+  Stealing s;
+  bool finished = false;
+  {
+  muduo::WorkStealingThreadPool pool("Stealing");
+  pool.start(3);
+  muduo::CountDownLatch latch(1);
+  pool.run(boost::bind(block, &pool, &s, kTasks, &finished, &latch));
+  latch.wait();
+  }
+  check(finished, "others ran tasks of a blocked worker");
+  check(s.stolen == kTasks, "all stolen");
+  printf("%d tasks stolen\n", s.stolen);
+}
+
+void hold(const boost::shared_ptr<int>& token, int* ran)
+{
+  (void)token;
+  __atomic_fetch_add(ran, 1, __ATOMIC_RELAXED);
+}
+
+void openGate(int* gate)
+{
+  usleep(50*1000);
+  __atomic_store_n(gate, 1, __ATOMIC_RELEASE);
+}
+
+void waitGate(int* gate, int* started)
+{
+  __atomic_store_n(started, 1, __ATOMIC_RELEASE);
+  waitFor(gate, 1);
+}
+
+// stop() joins workers while tasks are queued, they are dropped and freed
+void testStop()
+{
+  const int kTasks = 1000;
+  boost::shared_ptr<int> token(new int(0));
+  int ran = 0;
+  int gate = 0;
+  int started = 0;
+  {
+  muduo::WorkStealingThreadPool pool("Stop");
+  pool.start(2);
+  pool.run(boost::bind(waitGate, &gate, &started));
+  pool.run(boost::bind(waitGate, &gate, &started));
+  for (int i = 0; i < kTasks; ++i)
+  {
+    pool.run(boost::bind(hold, token, &ran));
+  }
+  check(waitFor(&started, 1), "started");
+  // stop() waits for the running ones
+  muduo::Thread opener(boost::bind(openGate, &gate));
+  opener.start();
+  pool.stop();
+  opener.join();
+  // one of the gates may be left too
+  int queued = static_cast<int>(pool.queueSize());
+  check(ran + queued == kTasks || ran + queued == kTasks + 1, "every task ran or is queued");
+  check(token.use_count() == 1 + kTasks - ran, "queued tasks hold their bindings");
+  printf("%d of %d tasks run before stop()\n", ran, kTasks);
+  }
+  check(token.use_count() == 1, "dropped tasks are freed");
+
+  // idle workers wake up and quit
+  muduo::WorkStealingThreadPool idle("Idle");
+  idle.start(4);
+  usleep(10*1000);
+  muduo::Timestamp start(muduo::Timestamp::now());
+  idle.stop();
+  check(timeDifference(muduo::Timestamp::now(), start) < 1.0, "idle stop");
+
+  // without threads, tasks run in the caller
+  muduo::WorkStealingThreadPool inline_("Inline");
+  inline_.start(0);
+  int ranInline = 0;
+  inline_.run(boost::bind(hold, token, &ranInline));
+  check(ranInline == 1, "runs in caller");
+  inline_.stop();
+}
+
+}
+
+int main()
+{
+  testEveryTaskRuns();
+  testInboxPastCapacity();
+  testStealing();
+  testStop();
+  printf("done\n");
+}
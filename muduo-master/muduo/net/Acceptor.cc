@@ -39,6 +39,8 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
   /**当acceptChannel_上的readable事件发生时，回调Acceptor::handleRead(...)函数 */
   acceptChannel_.setReadCallback(
       boost::bind(&Acceptor::handleRead, this));
+  acceptChannel_.setKind("Acceptor");
+  acceptChannel_.setReadOp(Channel::kAccept);
 }
 
 Acceptor::~Acceptor()
@@ -69,8 +71,26 @@ void Acceptor::handleRead()
 {
   loop_->assertInLoopThread();
   InetAddress peerAddr;
-  //FIXME loop until no more
-  int connfd = acceptSocket_.accept(&peerAddr);
+  int connfd = -1;
+  if (acceptChannel_.hasReadResult())
+  {
+    // accepted by the poller already
+    connfd = static_cast<int>(acceptChannel_.readResult());
+    if (connfd >= 0)
+    {
+      peerAddr.setSockAddrInet6(
+          *static_cast<const struct sockaddr_in6*>(acceptChannel_.readData()));
+    }
+    else
+    {
+      errno = -connfd;
+    }
+  }
+  else
+  {
+    //FIXME loop until no more
+    connfd = acceptSocket_.accept(&peerAddr);
+  }
   if (connfd >= 0)
   {
     // string hostport = peerAddr.toIpPort();
@@ -44,6 +44,10 @@ class Acceptor : boost::noncopyable
   bool listenning() const { return listenning_; }
   void listen();
 
+  /// see Socket::setReusePortCpuSteering
+  bool setCpuSteering(int groupSize)
+  { return acceptSocket_.setReusePortCpuSteering(groupSize); }
+
  private:
   void handleRead();
 
@@ -11,7 +11,10 @@
 
 #include <muduo/net/SocketsOps.h>
 
+#include <limits>
+
 #include <errno.h>
+#include <sys/ioctl.h>
 #include <sys/uio.h>
 
 using namespace muduo;
@@ -22,19 +25,80 @@ const char Buffer::kCRLF[] = "\r\n";
 const size_t Buffer::kCheapPrepend;
 const size_t Buffer::kInitialSize;
 
-ssize_t Buffer::readFd(int fd, int* savedErrno)
+namespace
+{
+const size_t kExtraBufSize = 65536;
+}
+
+ssize_t Buffer::readFd(int fd, int* savedErrno, bool* drained)
+{
+  if (buffer_ == NULL)
+  {
+    // released after drained, take a block from the allocator again
+    ensureWritableBytes(kInitialSize);
+  }
+  bool shortRead = false;
+  const ssize_t n = readOnce(fd, savedErrno, std::numeric_limits<size_t>::max(), &shortRead);
+  if (drained)
+  {
+    *drained = shortRead;
+  }
+  return n;
+}
+
+ssize_t Buffer::readFd(int fd, int* savedErrno,
+                       size_t sizeHint, size_t maxBytes, bool useFionread,
+                       bool* drained)
+{
+  assert(maxBytes > 0);
+  ssize_t result = 0;
+  size_t total = 0;
+  bool shortRead = false;
+  while (!shortRead && total < maxBytes)
+  {
+    size_t expected = sizeHint;
+    int available = 0;
+    if (useFionread && sizeHint > kExtraBufSize
+        && ::ioctl(fd, FIONREAD, &available) == 0 && available > 0)
+    {
+      expected = static_cast<size_t>(available);
+    }
+    ensureWritableBytes(std::min(expected, maxBytes - total));
+
+    const ssize_t n = readOnce(fd, savedErrno, maxBytes - total, &shortRead);
+    if (n <= 0)
+    {
+      // EOF or error after some data will be seen by the next read.
+      shortRead = n < 0 && (*savedErrno == EAGAIN || *savedErrno == EWOULDBLOCK);
+      if (total == 0)
+      {
+        result = n;
+      }
+      break;
+    }
+    total += n;
+    result = static_cast<ssize_t>(total);
+  }
+  if (drained)
+  {
+    *drained = shortRead;
+  }
+  return result;
+}
+
+ssize_t Buffer::readOnce(int fd, int* savedErrno, size_t maxBytes, bool* drained)
 {
   // saved an ioctl()/FIONREAD call to tell how much to read
-  char extrabuf[65536];
+  char extrabuf[kExtraBufSize];
   struct iovec vec[2];
-  const size_t writable = writableBytes();
+  const size_t writable = std::min(writableBytes(), maxBytes);
   vec[0].iov_base = begin()+writerIndex_;
   vec[0].iov_len = writable;
   vec[1].iov_base = extrabuf;
-  vec[1].iov_len = sizeof extrabuf;
+  vec[1].iov_len = std::min(sizeof extrabuf, maxBytes - writable);
   // when there is enough space in this buffer, don't read into extrabuf.
   // when extrabuf is used, we read 128k-1 bytes at most.
-  const int iovcnt = (writable < sizeof extrabuf) ? 2 : 1;
+  const int iovcnt = (writable < sizeof extrabuf && vec[1].iov_len > 0) ? 2 : 1;
   const ssize_t n = sockets::readv(fd, vec, iovcnt);
   if (n < 0)
   {
@@ -46,13 +110,10 @@ ssize_t Buffer::readFd(int fd, int* savedErrno)
   }
   else
   {
-    writerIndex_ = buffer_.size();
+    writerIndex_ += writable;
     append(extrabuf, n - writable);
   }
-  // if (n == writable + sizeof extrabuf)
-  // {
-  //   goto line_30;
-  // }
+  const size_t requested = vec[0].iov_len + (iovcnt == 2 ? vec[1].iov_len : 0);
+  *drained = n >= 0 && implicit_cast<size_t>(n) < requested;
   return n;
 }
-
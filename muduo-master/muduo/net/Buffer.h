@@ -15,10 +15,10 @@
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 
+#include <muduo/net/BufferAllocator.h>
 #include <muduo/net/Endian.h>
 
 #include <algorithm>
-#include <vector>
 
 #include <assert.h>
 #include <string.h>
@@ -39,6 +39,9 @@ namespace net
 /// |                   |                  |                  |
 /// 0      <=      readerIndex   <=   writerIndex    <=     size
 /// @endcode
+///
+/// The storage comes from a BufferAllocator, or from the heap if none is given.
+/// A block from an allocator may be larger than asked for, all of it is writable.
 class Buffer : public muduo::copyable
 {
  public:
@@ -46,30 +49,100 @@ class Buffer : public muduo::copyable
   static const size_t kInitialSize = 1024;
 
   explicit Buffer(size_t initialSize = kInitialSize)
-    : buffer_(kCheapPrepend + initialSize),
+    : buffer_(NULL),
+      size_(0),
+      capacity_(0),
       readerIndex_(kCheapPrepend),
       writerIndex_(kCheapPrepend)
   {
+    allocate(kCheapPrepend + initialSize);
     assert(readableBytes() == 0);
     assert(writableBytes() == initialSize);
     assert(prependableBytes() == kCheapPrepend);
   }
 
-  // implicit copy-ctor, move-ctor, dtor and assignment are fine
-  // NOTE: implicit move-ctor is added in g++ 4.6
+  /// Draws storage from allocator, which is kept alive by this buffer.
+  /// If initialSize is 0, nothing is allocated until the first write.
+  explicit Buffer(const BufferAllocatorPtr& allocator,
+                  size_t initialSize = kInitialSize)
+    : buffer_(NULL),
+      size_(0),
+      capacity_(0),
+      readerIndex_(0),
+      writerIndex_(0),
+      allocator_(allocator)
+  {
+    if (initialSize > 0)
+    {
+      allocate(kCheapPrepend + initialSize);
+      readerIndex_ = kCheapPrepend;
+      writerIndex_ = kCheapPrepend;
+    }
+  }
+
+  // copies share the allocator
+  Buffer(const Buffer& rhs)
+    : buffer_(NULL),
+      size_(0),
+      capacity_(0),
+      readerIndex_(rhs.readerIndex_),
+      writerIndex_(rhs.writerIndex_),
+      allocator_(rhs.allocator_)
+  {
+    if (rhs.buffer_)
+    {
+      allocate(rhs.size_);
+      ::memcpy(buffer_, rhs.buffer_, rhs.writerIndex_);
+    }
+  }
+
+  Buffer& operator=(const Buffer& rhs)
+  {
+    Buffer copy(rhs);
+    swap(copy);
+    return *this;
+  }
+
+  ~Buffer()
+  {
+    deallocate();
+  }
+
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+  Buffer(Buffer&& rhs)
+    : buffer_(rhs.buffer_),
+      size_(rhs.size_),
+      capacity_(rhs.capacity_),
+      readerIndex_(rhs.readerIndex_),
+      writerIndex_(rhs.writerIndex_),
+      allocator_(std::move(rhs.allocator_))
+  {
+    rhs.buffer_ = NULL;
+    rhs.size_ = rhs.capacity_ = rhs.readerIndex_ = rhs.writerIndex_ = 0;
+  }
+
+  Buffer& operator=(Buffer&& rhs)
+  {
+    swap(rhs);
+    return *this;
+  }
+#endif
 
   void swap(Buffer& rhs)
   {
-    buffer_.swap(rhs.buffer_);
+    std::swap(buffer_, rhs.buffer_);
+    std::swap(size_, rhs.size_);
+    std::swap(capacity_, rhs.capacity_);
     std::swap(readerIndex_, rhs.readerIndex_);
     std::swap(writerIndex_, rhs.writerIndex_);
+    allocator_.swap(rhs.allocator_);
   }
 
   size_t readableBytes() const
   { return writerIndex_ - readerIndex_; }
 
   size_t writableBytes() const
-  { return buffer_.size() - writerIndex_; }
+  { return size_ - writerIndex_; }
 
   size_t prependableBytes() const
   { return readerIndex_; }
@@ -152,8 +225,9 @@ class Buffer : public muduo::copyable
 
   void retrieveAll()
   {
-    readerIndex_ = kCheapPrepend;
-    writerIndex_ = kCheapPrepend;
+    // a released buffer has no prependable bytes
+    readerIndex_ = buffer_ ? kCheapPrepend : 0;
+    writerIndex_ = readerIndex_;
   }
 
   string retrieveAllAsString()
@@ -353,6 +427,11 @@ class Buffer : public muduo::copyable
 
   void prepend(const void* /*restrict*/ data, size_t len)
   {
+    if (buffer_ == NULL)
+    {
+      // released, or lazily allocated
+      allocateEmpty(kInitialSize);
+    }
     assert(len <= prependableBytes());
     readerIndex_ -= len;
     const char* d = static_cast<const char*>(data);
@@ -361,38 +440,119 @@ class Buffer : public muduo::copyable
 
   void shrink(size_t reserve)
   {
-    // FIXME: use vector::shrink_to_fit() in C++ 11 if possible.
-    Buffer other;
+    Buffer other(allocator_);
     other.ensureWritableBytes(readableBytes()+reserve);
     other.append(toStringPiece());
     swap(other);
   }
 
+  /// Gives the storage back to the allocator, the buffer must be empty.
+  /// Storage will be allocated again on the next write.
+  void release()
+  {
+    assert(readableBytes() == 0);
+    deallocate();
+    readerIndex_ = 0;
+    writerIndex_ = 0;
+  }
+
   size_t internalCapacity() const
   {
-    return buffer_.capacity();
+    return capacity_;
   }
 
+  const BufferAllocatorPtr& allocator() const
+  { return allocator_; }
+
   /// Read data directly into buffer.
   ///
   /// It may implement with readv(2)
-  /// @return result of read(2), @c errno is saved
-  ssize_t readFd(int fd, int* savedErrno);
+  /// @return result of read(2), @c errno is saved, @c *drained is set
+  /// if the read was short, i.e. fd had no more data.
+  ssize_t readFd(int fd, int* savedErrno, bool* drained = NULL);
+
+  /// Reads until fd is drained or @c maxBytes are read.
+  ///
+  /// The writable region is pre-sized to @c sizeHint, usually the size of
+  /// recent reads, and excess data lands in a stack buffer as readFd(fd, savedErrno).
+  /// If @c useFionread and sizeHint is larger than the stack buffer,
+  /// i.e. a bulk transfer, ioctl(FIONREAD) tells how much to make room for.
+  /// @return bytes read, or result of the first read(2) if nothing is read,
+  /// @c errno is saved, @c *drained is set if read(2) hit EAGAIN or
+  /// was short, otherwise fd may have more data, EOF or error to read.
+  ssize_t readFd(int fd, int* savedErrno,
+                 size_t sizeHint, size_t maxBytes, bool useFionread,
+                 bool* drained = NULL);
 
  private:
+  // one readv(2) of at most maxBytes, drained is set if it is a short read
+  ssize_t readOnce(int fd, int* savedErrno, size_t maxBytes, bool* drained);
+
 
   char* begin()
-  { return &*buffer_.begin(); }
+  { return buffer_; }
 
   const char* begin() const
-  { return &*buffer_.begin(); }
+  { return buffer_; }
+
+  void allocate(size_t size)
+  {
+    assert(buffer_ == NULL);
+    capacity_ = size;
+    buffer_ = allocator_ ? allocator_->allocate(&capacity_) : new char[size];
+    assert(capacity_ >= size);
+    size_ = allocator_ ? capacity_ : size;
+  }
+
+  void allocateEmpty(size_t writable)
+  {
+    allocate(kCheapPrepend + writable);
+    readerIndex_ = kCheapPrepend;
+    writerIndex_ = kCheapPrepend;
+  }
+
+  void deallocate()
+  {
+    if (buffer_)
+    {
+      if (allocator_)
+      {
+        allocator_->deallocate(buffer_, capacity_);
+      }
+      else
+      {
+        delete[] buffer_;
+      }
+      buffer_ = NULL;
+      size_ = capacity_ = 0;
+    }
+  }
+
+  // like vector::resize(), grows geometrically
+  void resize(size_t size)
+  {
+    if (size > capacity_)
+    {
+      Buffer other(allocator_, 0);
+      other.allocate(std::max(size, 2*capacity_));
+      ::memcpy(other.buffer_, buffer_, writerIndex_);
+      std::swap(buffer_, other.buffer_);
+      std::swap(capacity_, other.capacity_);
+    }
+    size_ = allocator_ ? capacity_ : size;
+  }
 
   void makeSpace(size_t len)
   {
-    if (writableBytes() + prependableBytes() < len + kCheapPrepend)
+    if (buffer_ == NULL)
+    {
+      // released, or lazily allocated
+      allocateEmpty(len);
+    }
+    else if (writableBytes() + prependableBytes() < len + kCheapPrepend)
     {
       // FIXME: move readable data
-      buffer_.resize(writerIndex_+len);
+      resize(writerIndex_+len);
     }
     else
     {
@@ -409,9 +569,12 @@ class Buffer : public muduo::copyable
   }
 
  private:
-  std::vector<char> buffer_;
+  char* buffer_;
+  size_t size_;       // usable bytes, like vector::size()
+  size_t capacity_;   // allocated bytes
   size_t readerIndex_;
   size_t writerIndex_;
+  BufferAllocatorPtr allocator_;  // NULL means the heap
 
   static const char kCRLF[];
 };
@@ -0,0 +1,164 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <muduo/net/BufferAllocator.h>
+
+#include <set>
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t SlabBufferAllocator::kMinBlockSize;
+const int SlabBufferAllocator::kNumClasses;
+
+namespace
+{
+// all live SlabBufferAllocators, for Inspector
+MutexLock& registryMutex()
+{
+  static MutexLock mutex;
+  return mutex;
+}
+
+std::set<SlabBufferAllocator*>& registry()
+{
+  static std::set<SlabBufferAllocator*> allocators;
+  return allocators;
+}
+}
+
+BufferAllocator::~BufferAllocator()
+{
+}
+
+SlabBufferAllocator::SlabBufferAllocator(const string& nameArg,
+                                         size_t maxCachedBytes)
+  : name_(nameArg),
+    maxCachedBytes_(maxCachedBytes)
+{
+  ::bzero(&stats_, sizeof stats_);
+  MutexLockGuard lock(registryMutex());
+  registry().insert(this);
+}
+
+SlabBufferAllocator::~SlabBufferAllocator()
+{
+  {
+  MutexLockGuard lock(registryMutex());
+  registry().erase(this);
+  }
+  for (int i = 0; i < kNumClasses; ++i)
+  {
+    for (size_t j = 0; j < freeLists_[i].size(); ++j)
+    {
+      delete[] freeLists_[i][j];
+    }
+  }
+}
+
+// returns -1 if size is too large for slabs
+int SlabBufferAllocator::sizeClass(size_t size)
+{
+  size_t blockSize = kMinBlockSize;
+  for (int i = 0; i < kNumClasses; ++i)
+  {
+    if (size <= blockSize)
+    {
+      return i;
+    }
+    blockSize *= 2;
+  }
+  return -1;
+}
+
+char* SlabBufferAllocator::allocate(size_t* size)
+{
+  const int cls = sizeClass(*size);
+  if (cls >= 0)
+  {
+    *size = kMinBlockSize << cls;
+  }
+
+  char* block = NULL;
+  {
+  MutexLockGuard lock(mutex_);
+  ++stats_.allocations;
+  stats_.bytesInUse += *size;
+  if (cls >= 0 && !freeLists_[cls].empty())
+  {
+    block = freeLists_[cls].back();
+    freeLists_[cls].pop_back();
+    ++stats_.hits;
+    stats_.bytesCached -= *size;
+  }
+  }
+
+  if (block == NULL)
+  {
+    block = new char[*size];
+  }
+  return block;
+}
+
+void SlabBufferAllocator::deallocate(char* block, size_t size)
+{
+  const int cls = sizeClass(size);
+  assert(cls < 0 || size == kMinBlockSize << cls);
+  {
+  MutexLockGuard lock(mutex_);
+  ++stats_.deallocations;
+  stats_.bytesInUse -= size;
+  if (cls >= 0 && implicit_cast<size_t>(stats_.bytesCached) + size <= maxCachedBytes_)
+  {
+    freeLists_[cls].push_back(block);
+    stats_.bytesCached += size;
+    block = NULL;
+  }
+  }
+  delete[] block;
+}
+
+SlabBufferAllocator::Stats SlabBufferAllocator::stats() const
+{
+  MutexLockGuard lock(mutex_);
+  return stats_;
+}
+
+string SlabBufferAllocator::statsString() const
+{
+  Stats s = stats();
+  char buf[256];
+  snprintf(buf, sizeof buf,
+           "%s allocations %" PRId64 " deallocations %" PRId64 " hits %" PRId64
+           " bytesInUse %" PRId64 " bytesCached %" PRId64 "\n",
+           name_.c_str(), s.allocations, s.deallocations, s.hits,
+           s.bytesInUse, s.bytesCached);
+  return buf;
+}
+
+string SlabBufferAllocator::allStats()
+{
+  string result;
+  MutexLockGuard lock(registryMutex());
+  for (std::set<SlabBufferAllocator*>::const_iterator it = registry().begin();
+       it != registry().end(); ++it)
+  {
+    result += (*it)->statsString();
+  }
+  return result;
+}
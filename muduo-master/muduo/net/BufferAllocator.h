@@ -0,0 +1,93 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_BUFFERALLOCATOR_H
+#define MUDUO_NET_BUFFERALLOCATOR_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Types.h>
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Storage allocator of Buffer.
+///
+/// Implementations must be thread safe, as a Buffer could be destroyed
+/// in any thread.
+class BufferAllocator : boost::noncopyable
+{
+ public:
+  virtual ~BufferAllocator();
+
+  /// Allocates at least *size bytes, *size is set to the actual block size.
+  virtual char* allocate(size_t* size) = 0;
+
+  /// Returns a block got from allocate(), size is the actual block size.
+  virtual void deallocate(char* block, size_t size) = 0;
+};
+
+typedef boost::shared_ptr<BufferAllocator> BufferAllocatorPtr;
+
+///
+/// Size-classed slab pool, one per EventLoop.
+///
+/// Blocks of 1KiB to 64KiB are rounded up to a power of two and recycled
+/// through per-class free lists, larger ones go to the heap directly.
+class SlabBufferAllocator : public BufferAllocator
+{
+ public:
+  static const size_t kMinBlockSize = 1024;
+  static const int kNumClasses = 7;  // 1KiB .. 64KiB
+
+  struct Stats
+  {
+    int64_t allocations;
+    int64_t deallocations;
+    int64_t hits;         // allocations served from free lists
+    int64_t bytesInUse;
+    int64_t bytesCached;  // in free lists
+  };
+
+  explicit SlabBufferAllocator(const string& name,
+                               size_t maxCachedBytes = 64*1024*1024);
+  virtual ~SlabBufferAllocator();
+
+  virtual char* allocate(size_t* size);
+  virtual void deallocate(char* block, size_t size);
+
+  const string& name() const { return name_; }
+  Stats stats() const;
+  string statsString() const;
+
+  /// Statistics of all live slab allocators, one line each.
+  static string allStats();
+
+ private:
+  static int sizeClass(size_t size);
+
+  const string name_;
+  const size_t maxCachedBytes_;
+  mutable MutexLock mutex_;
+  std::vector<char*> freeLists_[kNumClasses];  // @GuardedBy mutex_
+  Stats stats_;                                // @GuardedBy mutex_
+};
+
+}
+}
+
+#endif  // MUDUO_NET_BUFFERALLOCATOR_H
@@ -14,6 +14,7 @@
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <muduo/base/InlineFunction.h>
 #include <muduo/base/Timestamp.h>
 
 namespace muduo
@@ -43,7 +44,7 @@ namespace net
 class Buffer;
 class TcpConnection;
 typedef boost::shared_ptr<TcpConnection> TcpConnectionPtr;
-typedef boost::function<void()> TimerCallback;
+typedef InlineFunction TimerCallback;
 typedef boost::function<void (const TcpConnectionPtr&)> ConnectionCallback;
 typedef boost::function<void (const TcpConnectionPtr&)> CloseCallback;
 typedef boost::function<void (const TcpConnectionPtr&)> WriteCompleteCallback;
@@ -31,6 +31,15 @@ Channel::Channel(EventLoop* loop, int fd__)
     revents_(0),//已经发生的事件 bit pattern
     index_(-1),//channel->fd 在poller->pollfds_中的索引
     logHup_(true),//?????
+    edgeTriggered_(false),
+    kind_("Channel"),
+    ownerName_(NULL),
+    readOp_(kNoReadOp),
+    hasReadResult_(false),
+    hasWriteResult_(false),
+    readResult_(0),
+    writeResult_(0),
+    readData_(NULL),
     tied_(false),//????
     eventHandling_(false),//true 表示正在执行handleEvent()函数
     addedToLoop_(false)//true 表示已加入IO thread,即已加入到poller_的channels成员中
@@ -102,6 +111,8 @@ void Channel::handleEvent(Timestamp receiveTime)
   {
     handleEventWithGuard(receiveTime);
   }
+  hasReadResult_ = false;
+  hasWriteResult_ = false;
 }
 
 /**
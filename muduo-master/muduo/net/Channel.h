@@ -18,6 +18,10 @@
 
 #include <muduo/base/Timestamp.h>
 
+#include <sys/types.h>  // ssize_t
+
+struct iovec;
+
 namespace muduo
 {
 namespace net
@@ -91,6 +95,49 @@ class Channel : boost::noncopyable
   //判断channel是否关注POOLIN事件
   bool isReading() const { return events_ & kReadEvent; }
 
+  /// Registers with EPOLLET and a fixed interest set, so enabling and
+  /// disabling reading or writing won't cost an epoll_ctl(2).
+  /// Callbacks must read or write until EAGAIN.
+  /// Must be called before the channel is added, ignored by poll(2).
+  void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+  bool isEdgeTriggered() const { return edgeTriggered_; }
+
+  /// Lets the poller do recv(2) or accept(2) on readable events itself,
+  /// if it does completion-based I/O (UringPoller), so the read callback
+  /// sees the result with hasReadResult(). Other pollers report readiness.
+  /// Must be called before the channel is added.
+  enum ReadOp { kNoReadOp, kRecv, kAccept };
+  void setReadOp(ReadOp op) { readOp_ = op; }
+  ReadOp readOp() const { return readOp_; }
+
+  /// Fills at most count iovecs with data to write, returns how many.
+  /// The data must stay unchanged until the write callback sees it written
+  /// with hasWriteResult(), 0 means writability should be reported instead.
+  typedef boost::function<int(struct iovec* vec, int count)> GatherCallback;
+  /// Lets a completion-based poller write on writable events itself.
+  void setGatherCallback(const GatherCallback& cb)
+  { gatherCallback_ = cb; }
+  const GatherCallback& gatherCallback() const { return gatherCallback_; }
+
+  /// Valid in the callbacks after a completion-based read,
+  /// readResult() is bytes received in readData(), 0 for end of file,
+  /// the accepted fd with its peer address in readData(), or -errno.
+  bool hasReadResult() const { return hasReadResult_; }
+  ssize_t readResult() const { return readResult_; }
+  const void* readData() const { return readData_; }
+  /// Valid in the callbacks after a completion-based write,
+  /// writeResult() is bytes written, or -errno.
+  bool hasWriteResult() const { return hasWriteResult_; }
+  ssize_t writeResult() const { return writeResult_; }
+
+  // used by pollers
+  void setReadResult(ssize_t result, const void* data)
+  { hasReadResult_ = true; readResult_ = result; readData_ = data; }
+  void setWriteResult(ssize_t result)
+  { hasWriteResult_ = true; writeResult_ = result; }
+  // the owner, which must outlive memory lent to the kernel, may be NULL
+  boost::shared_ptr<void> lockTie() const { return tie_.lock(); }
+
   // for Poller
   int index() { return index_; }
   void set_index(int idx) { index_ = idx; }
@@ -101,6 +148,15 @@ class Channel : boost::noncopyable
 
   void doNotLogHup() { logHup_ = false; }
 
+  /// What owns the channel, eg. "TcpConnection", for handler statistics
+  /// of the loop, must be a string literal.
+  void setKind(const char* kind) { kind_ = kind; }
+  const char* kind() const { return kind_; }
+  /// Which one it is, eg. name of the TcpConnection, for slow callback
+  /// reports of Watchdog, must outlive the channel.
+  void setOwnerName(const string* name) { ownerName_ = name; }
+  const string* ownerName() const { return ownerName_; }
+
   EventLoop* ownerLoop() { return loop_; }
   void remove();
 
@@ -124,6 +180,16 @@ class Channel : boost::noncopyable
   int        revents_; // it's the received event types of epoll or poll
   int        index_;   // used by Poller.  channel 对应的fd_在poller->pollfds_ 中对应的index
   bool       logHup_;
+  bool       edgeTriggered_;
+  const char* kind_;
+  const string* ownerName_;
+
+  ReadOp readOp_;
+  bool hasReadResult_;
+  bool hasWriteResult_;
+  ssize_t readResult_;
+  ssize_t writeResult_;
+  const void* readData_;
 
   boost::weak_ptr<void> tie_;
   bool tied_;
@@ -134,6 +200,7 @@ class Channel : boost::noncopyable
   EventCallback writeCallback_;
   EventCallback closeCallback_;
   EventCallback errorCallback_;
+  GatherCallback gatherCallback_;
 };
 
 }
@@ -11,13 +11,17 @@
 #include <muduo/base/Logging.h>
 #include <muduo/base/Mutex.h>
 #include <muduo/net/Channel.h>
+#include <muduo/net/LoopStats.h>
 #include <muduo/net/Poller.h>
 #include <muduo/net/SocketsOps.h>
 #include <muduo/net/TimerQueue.h>
+#include <muduo/net/Watchdog.h>
 
 #include <boost/bind.hpp>
 
 #include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/eventfd.h>
 #include <unistd.h>
 
@@ -45,6 +49,41 @@ int createEventfd()
   return evtfd;
 }
 
+string loopName()
+{
+  char buf[64];
+  snprintf(buf, sizeof buf, "%s-%d", CurrentThread::name(), CurrentThread::tid());
+  return buf;
+}
+
+// MUDUO_BUSY_POLL=<microseconds> spins after activity before blocking
+int64_t busyPollMicroSeconds()
+{
+  const char* spin = ::getenv("MUDUO_BUSY_POLL");
+  int64_t us = spin ? ::atoll(spin) : 0;
+  return us > 0 ? us : 0;
+}
+
+// MUDUO_WATCHDOG=<milliseconds> reports callbacks slower than that
+int64_t slowThresholdMicroSeconds()
+{
+  const char* ms = ::getenv("MUDUO_WATCHDOG");
+  int64_t us = ms ? ::atoll(ms) * 1000 : 0;
+  return us > 0 ? us : 0;
+}
+
+// MUDUO_TIMING_WHEEL=<tick in milliseconds> keeps timers in a TimingWheel
+double timerTickSeconds()
+{
+  const char* tick = ::getenv("MUDUO_TIMING_WHEEL");
+  if (tick == NULL)
+  {
+    return 0.0;
+  }
+  double ms = ::atof(tick);
+  return (ms > 0.0 ? ms : 1.0) / 1000.0;
+}
+
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 class IgnoreSigPipe
 {
@@ -82,10 +121,21 @@ EventLoop::EventLoop()
     iteration_(0),
     threadId_(CurrentThread::tid()),//记住本loop对象所属线程  即为当前线程
     poller_(Poller::newDefaultPoller(this)),//IO multiplexing
-    timerQueue_(new TimerQueue(this)),
+    timerQueue_(new TimerQueue(this, timerTickSeconds())),
     wakeupFd_(createEventfd()),//linux 可通过eventfd (详见createEventFd())来实现线程间通信
     wakeupChannel_(new Channel(this, wakeupFd_)),//根据wakeupFd_创建wakeupChannel_
-    currentActiveChannel_(NULL)
+    bufferAllocator_(new SlabBufferAllocator(loopName())),
+    currentActiveChannel_(NULL),
+    stats_(new LoopStats(loopName())),
+    sleeping_(0),
+    connectionCount_(0),
+    pendingOutputBytes_(0),
+    latencyMicroSeconds_(0),
+    busyPollMicroSeconds_(busyPollMicroSeconds()),
+    slowThresholdUs_(slowThresholdMicroSeconds()),
+    callbackStart_(0),
+    iterationStart_(0),
+    slowCallback_(false)
 {
   LOG_DEBUG << "EventLoop created " << this << " in thread " << threadId_;
   //确保当前线程只有一个EventLoop 对象，即 one loop per thread
@@ -110,6 +160,7 @@ EventLoop::EventLoop()
    * 在 poller_->updateChannel(channel)中会根据channel->fd()将channel对应的fd，及该fd上关注的
    * events添加到pollfds_数组中，poller->poll(...)便可实现IO MULTIPLEXING  
    */
+  wakeupChannel_->setKind("wakeup");
   wakeupChannel_->enableReading();//设置wakeupChannel_对应的wakeupFd_关注kReadEvent事件，并将wakeupFd_在poller_->pollfds_中update
 }
 
@@ -135,11 +186,43 @@ void EventLoop::loop()
   looping_ = true;
   quit_ = false;  // FIXME: what if someone calls quit() before loop() ?
   LOG_TRACE << "EventLoop " << this << " start looping";
+  if (slowThresholdUs_ > 0)
+  {
+    Watchdog::instance().add(this);
+  }
 
+  Timestamp lastActive;  // end of last iteration that did something
+  Timestamp now(Timestamp::now());  // end of last iteration
   while (!quit_)
   {
     activeChannels_.clear();
-    pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_);
+    int timeoutMs = kPollTimeMs;
+    if (busyPollMicroSeconds_ > 0
+        && now.microSecondsSinceEpoch() - lastActive.microSecondsSinceEpoch()
+           < busyPollMicroSeconds_)
+    {
+      // spinning, sleeping_ stays 0, so queueInLoop() needs no wakeup
+      timeoutMs = 0;
+    }
+    else
+    {
+      // from now on, queueInLoop() wakes us up, unless there are functors already
+      __atomic_store_n(&sleeping_, 1, __ATOMIC_SEQ_CST);
+      if (!pendingFunctors_.empty())
+      {
+        __atomic_store_n(&sleeping_, 0, __ATOMIC_RELAXED);
+        timeoutMs = 0;
+      }
+    }
+    pollReturnTime_ = poller_->poll(timeoutMs, &activeChannels_);
+    __atomic_store_n(&sleeping_, 0, __ATOMIC_RELAXED);
+    if (slowThresholdUs_ > 0)
+    {
+      __atomic_store_n(&iterationStart_, pollReturnTime_.microSecondsSinceEpoch(),
+                       __ATOMIC_RELEASE);
+    }
+    stats_->pollWait().add(pollReturnTime_.microSecondsSinceEpoch()
+                           - now.microSecondsSinceEpoch());
     ++iteration_;//记录poll()被调用的次数
     if (Logger::logLevel() <= Logger::TRACE)
     {
@@ -148,23 +231,103 @@ void EventLoop::loop()
 
     // TODO sort channel by priority
     eventHandling_ = true;
+    Timestamp handled(pollReturnTime_);
     for (ChannelList::iterator it = activeChannels_.begin();
         it != activeChannels_.end(); ++it)
     {
       currentActiveChannel_ = *it;
+      beginCallback(handled);
       //处理activeChannels_上已发生的事件，回调注册的事件处理函数
       currentActiveChannel_->handleEvent(pollReturnTime_);
+      Timestamp end(Timestamp::now());
+      int64_t elapsed = end.microSecondsSinceEpoch() - handled.microSecondsSinceEpoch();
+      stats_->handlerTime(currentActiveChannel_->kind()).add(elapsed);
+      endCallback(currentActiveChannel_, elapsed);
+      handled = end;
     }
     currentActiveChannel_ = NULL;
     eventHandling_ = false;
+    const bool active = !activeChannels_.empty() || !pendingFunctors_.empty();
     //执行timerQueue_中 等待的functors
-    doPendingFunctors();
+    doPendingFunctors(handled);
+
+    now = Timestamp::now();
+    if (active)
+    {
+      lastActive = now;
+    }
+    // average of recent 8 or so iterations
+    int64_t busy = now.microSecondsSinceEpoch()
+                   - pollReturnTime_.microSecondsSinceEpoch();
+    int64_t latency = latencyMicroSeconds_ + (busy - latencyMicroSeconds_) / 8;
+    __atomic_store_n(&latencyMicroSeconds_, latency, __ATOMIC_RELAXED);
+    stats_->iterationTime().add(busy);
+    endIteration(busy, activeChannels_.size());
   }
 
+  if (slowThresholdUs_ > 0)
+  {
+    Watchdog::instance().remove(this);
+  }
   LOG_TRACE << "EventLoop " << this << " stop looping";
   looping_ = false;
 }
 
+void EventLoop::setSlowThreshold(double seconds)
+{
+  assert(!looping_);
+  slowThresholdUs_ = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+}
+
+void EventLoop::endCallback(const Channel* channel, int64_t elapsed)
+{
+  if (slowThresholdUs_ > 0)
+  {
+    __atomic_store_n(&callbackStart_, 0, __ATOMIC_RELEASE);
+    if (elapsed >= slowThresholdUs_)
+    {
+      char buf[64];
+      snprintf(buf, sizeof buf, " took %.1f ms", static_cast<double>(elapsed) / 1000.0);
+      string message = stats_->name() + " ";
+      if (channel)
+      {
+        message += channel->kind();
+        if (channel->ownerName())
+        {
+          message += " " + *channel->ownerName();
+        }
+      }
+      else
+      {
+        message += "pending functor";
+      }
+      message += buf;
+      LOG_WARN << "Slow callback in " << message;
+      Watchdog::instance().report(message);
+      slowCallback_ = true;
+    }
+  }
+}
+
+void EventLoop::endIteration(int64_t elapsed, size_t numEvents)
+{
+  if (slowThresholdUs_ > 0)
+  {
+    __atomic_store_n(&iterationStart_, 0, __ATOMIC_RELEASE);
+    // many callbacks, none of them slow by itself
+    if (elapsed >= slowThresholdUs_ && !slowCallback_)
+    {
+      char buf[96];
+      snprintf(buf, sizeof buf, " iteration took %.1f ms, %zd events",
+               static_cast<double>(elapsed) / 1000.0, numEvents);
+      string message = stats_->name() + buf;
+      LOG_WARN << "Slow iteration in " << message;
+      Watchdog::instance().report(message);
+    }
+    slowCallback_ = false;
+  }
+}
+
 void EventLoop::quit()
 {
   quit_ = true;
@@ -201,23 +364,28 @@ void EventLoop::runInLoop(const Functor& cb)
  */
 void EventLoop::queueInLoop(const Functor& cb)
 {
-  
-  {
-      MutexLockGuard lock(mutex_);
-      pendingFunctors_.push_back(cb);
-  }
+  pendingFunctors_.push(PendingFunctor(cb));
+  wakeupIfSleeping();
+}
 
-  //queueInLoop不在loop的IO线程被调用，或者loop()正在执行pendingFunctors_中的函数，则需要wakeup loopThread
-  if (!isInLoopThread() || callingPendingFunctors_)
+/**
+ * 只有loop线程正阻塞在poll中时才写wakeupFd_，多个生产者只有一个会写;
+ * loop线程自己queue的functor在下一次poll之前已经看得到，不用wakeup
+ */
+void EventLoop::wakeupIfSleeping()
+{
+  // pairs with the store-then-check in loop()
+  if (!isInLoopThread()
+      && __atomic_load_n(&sleeping_, __ATOMIC_SEQ_CST)
+      && __atomic_exchange_n(&sleeping_, 0, __ATOMIC_ACQ_REL))
   {
-    wakeup();//唤醒IO thread， 会执行loop 函数中的doPendingFunctors()
+    wakeup();
   }
 }
 
 
 size_t EventLoop::queueSize() const
 {
-  MutexLockGuard lock(mutex_);
   return pendingFunctors_.size();
 }
 
@@ -275,15 +443,11 @@ void EventLoop::runInLoop(Functor&& cb)
 
 void EventLoop::queueInLoop(Functor&& cb)
 {
-  {
-  MutexLockGuard lock(mutex_);
-  pendingFunctors_.push_back(std::move(cb));  // emplace_back
-  }
-
-  if (!isInLoopThread() || callingPendingFunctors_)
-  {
-    wakeup();
-  }
+  PendingFunctor pending;
+  pending.functor = std::move(cb);
+  pending.queuedTime = Timestamp::now().microSecondsSinceEpoch();
+  pendingFunctors_.push(std::move(pending));
+  wakeupIfSleeping();
 }
 
 TimerId EventLoop::runAt(const Timestamp& time, TimerCallback&& cb)
@@ -375,22 +539,48 @@ void EventLoop::handleRead()
 /**
  * 执行用户pendingFunctors_队列中的用户的回调函数
  */
-void EventLoop::doPendingFunctors()
+void EventLoop::doPendingFunctors(Timestamp start)
 {
-  std::vector<Functor> functors;
+  // only those queued so far, functors queued meanwhile run in next
+  // iteration, so busy producers can't keep the loop from polling.
+  const size_t n = pendingFunctors_.size();
+  if (n == 0)
+  {
+    return;
+  }
   callingPendingFunctors_ = true;
 
+  PendingFunctor pending;
+  size_t count = 0;
+  while (count < n && pendingFunctors_.pop(&pending))
   {
-    MutexLockGuard lock(mutex_);
-    //why swap（）？？？
-    functors.swap(pendingFunctors_);
+    if (count++ == 0)
+    {
+      // the oldest one waited the longest
+      stats_->functorLatency().add(start.microSecondsSinceEpoch() - pending.queuedTime);
+    }
+    if (slowThresholdUs_ > 0)
+    {
+      Timestamp begin(Timestamp::now());
+      beginCallback(begin);
+      pending.functor();
+      endCallback(NULL, Timestamp::now().microSecondsSinceEpoch()
+                        - begin.microSecondsSinceEpoch());
+    }
+    else
+    {
+      pending.functor();
+    }
+    pending.functor.clear();  // releases bound objects now
   }
+  callingPendingFunctors_ = false;
 
-  for (size_t i = 0; i < functors.size(); ++i)
+  if (count > 0)
   {
-    functors[i]();
+    stats_->functorsPerBatch().add(static_cast<int64_t>(count));
+    stats_->functorsTime().add(Timestamp::now().microSecondsSinceEpoch()
+                               - start.microSecondsSinceEpoch());
   }
-  callingPendingFunctors_ = false;
 }
 
 
@@ -11,6 +11,7 @@
 #ifndef MUDUO_NET_EVENTLOOP_H
 #define MUDUO_NET_EVENTLOOP_H
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/any.hpp>
@@ -20,7 +21,10 @@
 
 #include <muduo/base/Mutex.h>
 #include <muduo/base/CurrentThread.h>
+#include <muduo/base/InlineFunction.h>
+#include <muduo/base/MpscQueue.h>
 #include <muduo/base/Timestamp.h>
+#include <muduo/net/BufferAllocator.h>
 #include <muduo/net/Callbacks.h>
 #include <muduo/net/TimerId.h>
 
@@ -30,8 +34,10 @@ namespace net
 {
 
 class Channel;
+class LoopStats;
 class Poller;
 class TimerQueue;
+class Watchdog;
 
 ///
 /// Reactor, at most one per thread.
@@ -40,7 +46,7 @@ class TimerQueue;
 class EventLoop : boost::noncopyable
 {
  public:
-  typedef boost::function<void()> Functor;
+  typedef InlineFunction Functor;
 
   EventLoop();
   ~EventLoop();  // force out-line dtor, for scoped_ptr members.
@@ -75,11 +81,50 @@ class EventLoop : boost::noncopyable
 
   /// Queues callback in the loop thread.
   /// Runs after finish pooling.
-  /// Safe to call from other threads.
+  /// Safe to call from other threads, it is lock free,
+  /// and wakes up the loop only if it is waiting in poll.
   void queueInLoop(const Functor& cb);
 
   size_t queueSize() const;
 
+  ///
+  /// Busy polling, the loop polls without blocking until nothing happens
+  /// for @c microSeconds, and cross-thread queueInLoop() skips the wakeup
+  /// meanwhile. It trades CPU for latency, 0 turns it off.
+  /// It needs a spare CPU, a loop spinning on the only CPU delays its peer
+  /// by up to @c microSeconds on every round trip.
+  /// MUDUO_BUSY_POLL=<microseconds> sets it for all loops.
+  /// Not thread safe, call it before loop() or in the loop thread.
+  ///
+  void setBusyPoll(int64_t microSeconds)
+  { busyPollMicroSeconds_ = microSeconds; }
+  int64_t busyPoll() const { return busyPollMicroSeconds_; }
+
+  ///
+  /// Slow callback watchdog, logs what and where any event handler or
+  /// functor, or one iteration of the loop, is running for longer than
+  /// @c seconds, with its stack, 0 turns it off. MUDUO_WATCHDOG=<milliseconds> sets it for all loops.
+  /// The stack is taken by a signal, which interrupts a sleep or poll in
+  /// the slow callback. Call it before loop().
+  ///
+  void setSlowThreshold(double seconds);
+  double slowThreshold() const
+  { return static_cast<double>(slowThresholdUs_) / Timestamp::kMicroSecondsPerSecond; }
+
+  ///
+  /// Load of this loop, for EventLoopThreadPool placement policies.
+  /// Safe to read from other threads.
+  ///
+  int connectionCount() const
+  { return __atomic_load_n(&connectionCount_, __ATOMIC_RELAXED); }
+  /// bytes in output queues of its connections
+  int64_t pendingOutputBytes() const
+  { return __atomic_load_n(&pendingOutputBytes_, __ATOMIC_RELAXED); }
+  /// moving average of time spent on handling events and functors,
+  /// from poll returns to next poll, in microseconds
+  int64_t latencyMicroSeconds() const
+  { return __atomic_load_n(&latencyMicroSeconds_, __ATOMIC_RELAXED); }
+
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
   void runInLoop(Functor&& cb);
   void queueInLoop(Functor&& cb);
@@ -119,6 +164,11 @@ class EventLoop : boost::noncopyable
   void updateChannel(Channel* channel);
   void removeChannel(Channel* channel);
   bool hasChannel(Channel* channel);
+  void addConnections(int n)
+  { __atomic_fetch_add(&connectionCount_, n, __ATOMIC_RELAXED); }
+  void addPendingOutputBytes(int64_t n)
+  { __atomic_fetch_add(&pendingOutputBytes_, n, __ATOMIC_RELAXED); }
+  LoopStats* stats() { return get_pointer(stats_); }
 
   // pid_t threadId() const { return threadId_; }
   //断言当前线程是否为 创建loop对象的IO线程
@@ -142,12 +192,36 @@ class EventLoop : boost::noncopyable
   boost::any* getMutableContext()
   { return &context_; }
 
+  ///
+  /// Pool of input buffers of connections in this loop,
+  /// a SlabBufferAllocator by default.
+  ///
+  const BufferAllocatorPtr& bufferAllocator() const
+  { return bufferAllocator_; }
+
+  /// Must be called before any connection is created in this loop.
+  void setBufferAllocator(const BufferAllocatorPtr& allocator)
+  { bufferAllocator_ = allocator; }
+
   static EventLoop* getEventLoopOfCurrentThread();
 
  private:
+  friend class Watchdog;
+
   void abortNotInLoopThread();
   void handleRead();  // waked up
-  void doPendingFunctors();
+  void doPendingFunctors(Timestamp start);
+  void wakeupIfSleeping();
+  // for Watchdog, only when the slow threshold is set
+  void beginCallback(Timestamp start)
+  {
+    if (slowThresholdUs_ > 0)
+    {
+      __atomic_store_n(&callbackStart_, start.microSecondsSinceEpoch(), __ATOMIC_RELEASE);
+    }
+  }
+  void endCallback(const Channel* channel, int64_t elapsed);
+  void endIteration(int64_t elapsed, size_t numEvents);
 
   void printActiveChannels() const; // DEBUG
 
@@ -167,13 +241,42 @@ class EventLoop : boost::noncopyable
   // we don't expose Channel to client.
   boost::scoped_ptr<Channel> wakeupChannel_;
   boost::any context_;
+  BufferAllocatorPtr bufferAllocator_;
 
   // scratch variables
   ChannelList activeChannels_;
   Channel* currentActiveChannel_;
 
-  mutable MutexLock mutex_;
-  std::vector<Functor> pendingFunctors_; // @GuardedBy mutex_
+  struct PendingFunctor
+  {
+    Functor functor;
+    int64_t queuedTime;  // microseconds since epoch
+
+    PendingFunctor() : queuedTime(0) { }
+    explicit PendingFunctor(const Functor& f)
+      : functor(f), queuedTime(Timestamp::now().microSecondsSinceEpoch()) { }
+
+    // for MpscQueue::pop, swaps without cloning functors
+    friend void swap(PendingFunctor& lhs, PendingFunctor& rhs)
+    {
+      lhs.functor.swap(rhs.functor);
+      std::swap(lhs.queuedTime, rhs.queuedTime);
+    }
+  };
+
+  boost::scoped_ptr<LoopStats> stats_;
+  MpscQueue<PendingFunctor> pendingFunctors_;
+  int sleeping_; /* atomic, waiting in poll and not waked up yet */
+
+  // load, written by this loop and its connections
+  int connectionCount_; /* atomic */
+  int64_t pendingOutputBytes_; /* atomic */
+  int64_t latencyMicroSeconds_; /* atomic */
+  int64_t busyPollMicroSeconds_;
+  int64_t slowThresholdUs_;
+  int64_t callbackStart_; /* atomic, 0 if not in a callback */
+  int64_t iterationStart_; /* atomic, 0 if waiting in poll */
+  bool slowCallback_;  // in this iteration, which is reported for it
 };
 
 }
@@ -32,6 +32,12 @@ class EventLoopThread : boost::noncopyable
   EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(),
                   const string& name = string());
   ~EventLoopThread();
+
+  /// Must be called before startLoop(),
+  /// EventLoop and its buffers are allocated on the local NUMA node.
+  void setCpuAffinity(const std::vector<int>& cpus)
+  { thread_.setCpuAffinity(cpus); }
+
   EventLoop* startLoop();
 
  private:
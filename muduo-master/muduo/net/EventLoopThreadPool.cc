@@ -45,6 +45,10 @@ void EventLoopThreadPool::start(const ThreadInitCallback& cb)
     char buf[name_.size() + 32];
     snprintf(buf, sizeof buf, "%s%d", name_.c_str(), i);
     EventLoopThread* t = new EventLoopThread(cb, buf);
+    if (!cpus_.empty())
+    {
+      t->setCpuAffinity(std::vector<int>(1, cpus_[static_cast<size_t>(i) % cpus_.size()]));
+    }
     threads_.push_back(t);
     loops_.push_back(t->startLoop());
   }
@@ -62,8 +66,13 @@ EventLoop* EventLoopThreadPool::getNextLoop()
 
   if (!loops_.empty())
   {
-    // round-robin
-    loop = loops_[next_];
+    size_t index = static_cast<size_t>(next_);
+    if (placementPolicy_)
+    {
+      index = placementPolicy_(loops_, static_cast<size_t>(next_));
+      assert(index < loops_.size());
+    }
+    loop = loops_[index];
     ++next_;
     if (implicit_cast<size_t>(next_) >= loops_.size())
     {
@@ -73,6 +82,65 @@ EventLoop* EventLoopThreadPool::getNextLoop()
   return loop;
 }
 
+namespace
+{
+
+// the least loaded loop, the first one from next if there are ties
+template<typename Load>
+size_t leastLoaded(const std::vector<EventLoop*>& loops, size_t next, Load load)
+{
+  size_t best = next;
+  int64_t bestLoad = load(loops[next]);
+  for (size_t i = 1; i < loops.size(); ++i)
+  {
+    size_t index = (next + i) % loops.size();
+    int64_t l = load(loops[index]);
+    if (l < bestLoad)
+    {
+      best = index;
+      bestLoad = l;
+    }
+  }
+  return best;
+}
+
+int64_t connectionCount(const EventLoop* loop)
+{
+  return loop->connectionCount();
+}
+
+int64_t pendingOutputBytes(const EventLoop* loop)
+{
+  return loop->pendingOutputBytes();
+}
+
+int64_t latencyMicroSeconds(const EventLoop* loop)
+{
+  return loop->latencyMicroSeconds();
+}
+
+}
+
+size_t EventLoopThreadPool::roundRobin(const std::vector<EventLoop*>&, size_t next)
+{
+  return next;
+}
+
+size_t EventLoopThreadPool::leastConnections(const std::vector<EventLoop*>& loops, size_t next)
+{
+  return leastLoaded(loops, next, connectionCount);
+}
+
+size_t EventLoopThreadPool::leastPendingBytes(const std::vector<EventLoop*>& loops, size_t next)
+{
+  return leastLoaded(loops, next, pendingOutputBytes);
+}
+
+size_t EventLoopThreadPool::leastLatency(const std::vector<EventLoop*>& loops, size_t next)
+{
+  return leastLoaded(loops, next, latencyMicroSeconds);
+}
+
 EventLoop* EventLoopThreadPool::getLoopForHash(size_t hashCode)
 {
   baseLoop_->assertInLoopThread();
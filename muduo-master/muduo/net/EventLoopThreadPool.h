@@ -32,13 +32,32 @@ class EventLoopThreadPool : boost::noncopyable
  public:
   typedef boost::function<void(EventLoop*)> ThreadInitCallback;
 
+  /// Picks one of @c loops for a new connection, returns its index.
+  /// @c next is the round-robin choice, policies start looking from it,
+  /// so that equally loaded loops still take turns.
+  typedef boost::function<size_t (const std::vector<EventLoop*>& loops,
+                                  size_t next)> PlacementPolicy;
+
   EventLoopThreadPool(EventLoop* baseLoop, const string& nameArg);
   ~EventLoopThreadPool();
   void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+  /// Pins loop i to cpus[i % cpus.size()], must be called before start().
+  void setCpuAffinity(const std::vector<int>& cpus) { cpus_ = cpus; }
   void start(const ThreadInitCallback& cb = ThreadInitCallback());
 
+  /// Round-robin by default.
+  /// Not thread safe, call it in the loop thread of baseLoop.
+  void setPlacementPolicy(const PlacementPolicy& policy)
+  { placementPolicy_ = policy; }
+
+  // placement policies, by load counters of EventLoop
+  static size_t roundRobin(const std::vector<EventLoop*>& loops, size_t next);
+  static size_t leastConnections(const std::vector<EventLoop*>& loops, size_t next);
+  static size_t leastPendingBytes(const std::vector<EventLoop*>& loops, size_t next);
+  static size_t leastLatency(const std::vector<EventLoop*>& loops, size_t next);
+
   // valid after calling start()
-  /// round-robin
+  /// by placement policy
   EventLoop* getNextLoop();
 
   /// with the same hash code, it will always return the same EventLoop
@@ -59,6 +78,8 @@ class EventLoopThreadPool : boost::noncopyable
   bool started_;
   int numThreads_;
   int next_;
+  std::vector<int> cpus_;
+  PlacementPolicy placementPolicy_;
   boost::ptr_vector<EventLoopThread> threads_;
   std::vector<EventLoop*> loops_;
 };
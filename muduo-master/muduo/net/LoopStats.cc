@@ -0,0 +1,137 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/LoopStats.h>
+
+#include <muduo/base/Mutex.h>
+
+#include <set>
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>  // bzero
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int LoopStats::kMaxKinds;
+
+namespace
+{
+// all live LoopStats, for Inspector
+MutexLock& registryMutex()
+{
+  static MutexLock mutex;
+  return mutex;
+}
+
+std::set<LoopStats*>& registry()
+{
+  static std::set<LoopStats*> stats;
+  return stats;
+}
+
+void appendLine(string* out, const char* title, const Histogram& h)
+{
+  char buf[64];
+  snprintf(buf, sizeof buf, "  %-24s ", title);
+  *out += buf;
+  *out += h.toString();
+  *out += '\n';
+}
+}
+
+LoopStats::LoopStats(const string& nameArg)
+  : name_(nameArg),
+    timersFired_(0),
+    numKinds_(0)
+{
+  ::bzero(kinds_, sizeof kinds_);
+  MutexLockGuard lock(registryMutex());
+  registry().insert(this);
+}
+
+LoopStats::~LoopStats()
+{
+  MutexLockGuard lock(registryMutex());
+  registry().erase(this);
+}
+
+Histogram& LoopStats::handlerTime(const char* kind)
+{
+  for (int i = 0; i < numKinds_; ++i)
+  {
+    // the same literal may have different addresses in different files
+    if (kinds_[i] == kind || ::strcmp(kinds_[i], kind) == 0)
+    {
+      return handlerTimes_[i];
+    }
+  }
+  int index = numKinds_;
+  if (index == kMaxKinds - 1)
+  {
+    // full, the last one takes the rest
+    kinds_[index] = "others";
+    __atomic_store_n(&numKinds_, index + 1, __ATOMIC_RELEASE);
+  }
+  else if (index == kMaxKinds)
+  {
+    return handlerTimes_[kMaxKinds - 1];
+  }
+  else
+  {
+    kinds_[index] = kind;
+    __atomic_store_n(&numKinds_, index + 1, __ATOMIC_RELEASE);
+  }
+  return handlerTimes_[index];
+}
+
+string LoopStats::toString() const
+{
+  string result = name_ + "\n";
+  char buf[64];
+  snprintf(buf, sizeof buf, "  %-24s %" PRId64 "\n", "timers fired",
+           __atomic_load_n(&timersFired_, __ATOMIC_RELAXED));
+  result += buf;
+  // utilization = busy / (busy + waiting)
+  int64_t busy = iterationTime_.sum();
+  int64_t total = busy + pollWait_.sum();
+  snprintf(buf, sizeof buf, "  %-24s %.1f%%\n", "utilization",
+           total > 0 ? 100.0 * static_cast<double>(busy) / static_cast<double>(total) : 0.0);
+  result += buf;
+  appendLine(&result, "poll wait", pollWait_);
+  appendLine(&result, "iteration time", iterationTime_);
+  appendLine(&result, "functors per batch", functorsPerBatch_);
+  appendLine(&result, "functors time", functorsTime_);
+  appendLine(&result, "functor latency", functorLatency_);
+  appendLine(&result, "timer lag", timerLag_);
+  int n = __atomic_load_n(&numKinds_, __ATOMIC_ACQUIRE);
+  for (int i = 0; i < n; ++i)
+  {
+    string title = string("handler ") + kinds_[i];
+    appendLine(&result, title.c_str(), handlerTimes_[i]);
+  }
+  return result;
+}
+
+string LoopStats::allStats()
+{
+  string result;
+  MutexLockGuard lock(registryMutex());
+  for (std::set<LoopStats*>::const_iterator it = registry().begin();
+       it != registry().end(); ++it)
+  {
+    result += (*it)->toString();
+  }
+  return result;
+}
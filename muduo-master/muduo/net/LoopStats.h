@@ -0,0 +1,81 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_LOOPSTATS_H
+#define MUDUO_NET_LOOPSTATS_H
+
+#include <muduo/base/Histogram.h>
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Always-on statistics of one EventLoop, times in microseconds.
+///
+/// Written by the loop thread only, read by Inspector from other threads.
+///
+class LoopStats : boost::noncopyable
+{
+ public:
+  static const int kMaxKinds = 16;
+
+  explicit LoopStats(const string& name);
+  ~LoopStats();
+
+  const string& name() const { return name_; }
+
+  /// time blocked in poll, zero for busy polls
+  Histogram& pollWait() { return pollWait_; }
+  /// from poll returns to next poll
+  Histogram& iterationTime() { return iterationTime_; }
+  /// functors run per doPendingFunctors, when there are any
+  Histogram& functorsPerBatch() { return functorsPerBatch_; }
+  /// time of running functors per doPendingFunctors
+  Histogram& functorsTime() { return functorsTime_; }
+  /// time the first functor of a batch waited in the queue
+  Histogram& functorLatency() { return functorLatency_; }
+  /// how late timers fire
+  Histogram& timerLag() { return timerLag_; }
+  /// time of Channel::handleEvent, by Channel::kind()
+  Histogram& handlerTime(const char* kind);
+
+  void addTimersFired(int n)
+  { __atomic_store_n(&timersFired_, timersFired_ + n, __ATOMIC_RELAXED); }
+
+  string toString() const;
+
+  /// of all loops, for Inspector
+  static string allStats();
+
+ private:
+  const string name_;
+  Histogram pollWait_;
+  Histogram iterationTime_;
+  Histogram functorsPerBatch_;
+  Histogram functorsTime_;
+  Histogram functorLatency_;
+  Histogram timerLag_;
+  int64_t timersFired_;
+
+  // kinds are few, linear search beats a map, and readers need no lock
+  const char* kinds_[kMaxKinds];
+  Histogram handlerTimes_[kMaxKinds];
+  int numKinds_; /* atomic */
+};
+
+}
+}
+
+#endif  // MUDUO_NET_LOOPSTATS_H
@@ -0,0 +1,296 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/OutputQueue.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/SocketsOps.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>  // IOV_MAX
+#include <fcntl.h>  // splice
+#include <string.h>
+#include <sys/ioctl.h>  // FIONREAD
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t OutputQueue::kChunkSize;
+
+namespace
+{
+const int kMaxIovecs = IOV_MAX;
+}
+
+OutputQueue::OutputQueue(const BufferAllocatorPtr& allocator)
+  : allocator_(allocator),
+    readableBytes_(0)
+{
+}
+
+OutputQueue::~OutputQueue()
+{
+  retrieveAll();
+}
+
+char* OutputQueue::allocChunk()
+{
+  if (allocator_)
+  {
+    size_t size = kChunkSize;
+    char* chunk = allocator_->allocate(&size);
+    assert(size == kChunkSize);
+    return chunk;
+  }
+  return new char[kChunkSize];
+}
+
+void OutputQueue::freeChunk(char* chunk)
+{
+  if (allocator_)
+  {
+    allocator_->deallocate(chunk, kChunkSize);
+  }
+  else
+  {
+    delete[] chunk;
+  }
+}
+
+void OutputQueue::append(const char* /*restrict*/ data, size_t len)
+{
+  while (len > 0)
+  {
+    if (segments_.empty() || segments_.back().chunk == NULL
+        || segments_.back().data + segments_.back().len == segments_.back().chunk + kChunkSize)
+    {
+      appendSegment(kMemory, NULL, -1, 0, 0, boost::shared_ptr<const void>());
+      segments_.back().chunk = allocChunk();
+      segments_.back().data = segments_.back().chunk;
+    }
+
+    Segment& tail = segments_.back();
+    char* end = tail.chunk + (tail.data - tail.chunk) + tail.len;
+    size_t n = std::min(len, implicit_cast<size_t>(tail.chunk + kChunkSize - end));
+    ::memcpy(end, data, n);
+    tail.len += n;
+    readableBytes_ += n;
+    data += n;
+    len -= n;
+  }
+}
+
+void OutputQueue::appendRef(const char* data, size_t len,
+                            const boost::shared_ptr<const void>& holder)
+{
+  if (len > 0)
+  {
+    appendSegment(kMemory, data, -1, 0, len, holder);
+  }
+}
+
+void OutputQueue::appendFile(int fd, int64_t offset, size_t len,
+                             const boost::shared_ptr<const void>& holder)
+{
+  if (len > 0)
+  {
+    appendSegment(kFile, NULL, fd, offset, len, holder);
+  }
+}
+
+void OutputQueue::appendPipe(int pipefd, size_t len,
+                             const boost::shared_ptr<const void>& holder)
+{
+  if (len > 0)
+  {
+    appendSegment(kPipe, NULL, pipefd, 0, len, holder);
+  }
+}
+
+void OutputQueue::appendSegment(Kind kind, const char* data, int fd, int64_t offset,
+                                size_t len, const boost::shared_ptr<const void>& holder)
+{
+  Segment seg;
+  seg.kind = kind;
+  seg.chunk = NULL;
+  seg.data = data;
+  seg.fd = fd;
+  seg.offset = offset;
+  seg.len = len;
+  seg.holder = holder;
+  segments_.push_back(seg);
+  readableBytes_ += len;
+}
+
+void OutputQueue::appendFrom(OutputQueue* other, size_t len)
+{
+  assert(other != this);
+  assert(other->allocator_ == allocator_);
+  assert(len <= other->readableBytes_);
+  while (len > 0)
+  {
+    Segment& head = other->segments_.front();
+    if (len >= head.len)
+    {
+      // the chunk, if any, is ours now
+      segments_.push_back(head);
+      readableBytes_ += head.len;
+      other->readableBytes_ -= head.len;
+      len -= head.len;
+      other->segments_.pop_front();
+    }
+    else
+    {
+      if (head.chunk)
+      {
+        append(head.data, len);
+      }
+      else
+      {
+        appendSegment(head.kind, head.data, head.fd, head.offset, len, head.holder);
+      }
+      other->retrieve(len);
+      len = 0;
+    }
+  }
+}
+
+void OutputQueue::popFront()
+{
+  assert(!segments_.empty());
+  if (segments_.front().chunk)
+  {
+    freeChunk(segments_.front().chunk);
+  }
+  segments_.pop_front();
+}
+
+void OutputQueue::retrieve(size_t len)
+{
+  assert(len <= readableBytes_);
+  readableBytes_ -= len;
+  while (len > 0)
+  {
+    Segment& head = segments_.front();
+    if (len < head.len)
+    {
+      if (head.kind == kMemory)
+      {
+        head.data += len;
+      }
+      head.offset += len;
+      head.len -= len;
+      len = 0;
+    }
+    else
+    {
+      len -= head.len;
+      popFront();
+    }
+  }
+}
+
+void OutputQueue::retrieveAll()
+{
+  while (!segments_.empty())
+  {
+    popFront();
+  }
+  readableBytes_ = 0;
+}
+
+ssize_t OutputQueue::writeFd(int fd, int* savedErrno)
+{
+  if (!segments_.empty() && segments_.front().kind != kMemory)
+  {
+    return writeFile(fd, savedErrno);
+  }
+
+  struct iovec vec[kMaxIovecs];
+  const int iovcnt = gather(vec, kMaxIovecs);
+  const ssize_t n = sockets::writev(fd, vec, iovcnt);
+  if (n < 0)
+  {
+    *savedErrno = errno;
+  }
+  else
+  {
+    retrieve(n);
+  }
+  return n;
+}
+
+int OutputQueue::gather(struct iovec* vec, int count) const
+{
+  int iovcnt = 0;
+  for (std::deque<Segment>::const_iterator it = segments_.begin();
+       it != segments_.end() && it->kind == kMemory && iovcnt < count; ++it)
+  {
+    vec[iovcnt].iov_base = const_cast<char*>(it->data);
+    vec[iovcnt].iov_len = it->len;
+    ++iovcnt;
+  }
+  return iovcnt;
+}
+
+ssize_t OutputQueue::writeFile(int fd, int* savedErrno)
+{
+  const Segment& head = segments_.front();
+  ssize_t n = 0;
+  if (head.kind == kFile)
+  {
+    off_t offset = head.offset;
+    n = ::sendfile(fd, head.fd, &offset, head.len);
+  }
+  else
+  {
+    assert(head.kind == kPipe);
+    n = ::splice(head.fd, NULL, fd, NULL, head.len,
+                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+  }
+
+  if (n < 0)
+  {
+    *savedErrno = errno;
+  }
+  else if (n == 0)
+  {
+    // the file was truncated, or the writer of pipe is gone,
+    // the peer will never get the bytes it was promised.
+    LOG_ERROR << "OutputQueue::writeFile - unexpected EOF of fd " << head.fd
+              << ", " << head.len << " bytes left";
+    *savedErrno = EIO;
+    n = -1;
+  }
+  else
+  {
+    retrieve(n);
+  }
+  return n;
+}
+
+int OutputQueue::waitingPipe() const
+{
+  if (segments_.empty() || segments_.front().kind != kPipe)
+  {
+    return -1;
+  }
+  int pipefd = segments_.front().fd;
+  int readable = 0;
+  if (::ioctl(pipefd, FIONREAD, &readable) == 0 && readable == 0)
+  {
+    return pipefd;
+  }
+  return -1;
+}
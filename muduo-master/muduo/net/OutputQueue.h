@@ -0,0 +1,133 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_OUTPUTQUEUE_H
+#define MUDUO_NET_OUTPUTQUEUE_H
+
+#include <muduo/base/Types.h>
+#include <muduo/net/BufferAllocator.h>
+
+#include <deque>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <sys/types.h>  // ssize_t
+
+struct iovec;
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// Output queue of TcpConnection.
+///
+/// A list of fixed size chunks, which come from the allocator of the loop,
+/// plus segments referring to memory owned by someone else,
+/// and file or pipe regions which are sent without copying.
+/// Chunks filled in one thread and freed in another go back to the
+/// same pool, so the staging queue of a connection can be appended by
+/// any thread.
+/// Appending never moves queued data, and writeFd() gathers the leading
+/// memory segments with a single writev(2).
+///
+/// Not thread safe, it is always accessed in the loop thread.
+class OutputQueue : boost::noncopyable
+{
+ public:
+  static const size_t kChunkSize = 4096;
+
+  explicit OutputQueue(const BufferAllocatorPtr& allocator = BufferAllocatorPtr());
+  ~OutputQueue();
+
+  size_t readableBytes() const
+  { return readableBytes_; }
+
+  bool empty() const
+  { return readableBytes_ == 0; }
+
+  size_t numSegments() const
+  { return segments_.size(); }
+
+  /// Copies data into the tail chunk, allocates new chunks when full.
+  void append(const char* /*restrict*/ data, size_t len);
+
+  /// Queues [data, data+len) without copying,
+  /// @c holder keeps the memory alive until it is written.
+  void appendRef(const char* data, size_t len,
+                 const boost::shared_ptr<const void>& holder);
+
+  /// Queues [offset, offset+len) of file fd, it will be sent with sendfile(2).
+  /// fd is not owned, it must stay open until written.
+  void appendFile(int fd, int64_t offset, size_t len,
+                  const boost::shared_ptr<const void>& holder);
+
+  /// Queues len bytes from pipe fd, it will be sent with splice(2).
+  /// fd is not owned.
+  void appendPipe(int pipefd, size_t len,
+                  const boost::shared_ptr<const void>& holder);
+
+  /// Moves the leading len bytes of other to the end of this queue,
+  /// whole segments change hands without copying their data.
+  /// Both queues must share the same allocator.
+  void appendFrom(OutputQueue* other, size_t len);
+
+  void retrieve(size_t len);
+  void retrieveAll();
+
+  /// Writes pending data with writev(2), at most IOV_MAX segments,
+  /// or with sendfile(2)/splice(2) if the first segment is a file or a pipe.
+  ///
+  /// Written bytes are retrieved from the queue. A file or pipe segment
+  /// which hits end of file fails with EIO and stays, the connection
+  /// should be closed then.
+  /// @return result of writev(2), @c errno is saved
+  ssize_t writeFd(int fd, int* savedErrno);
+
+  /// Fills vec with the leading memory segments, at most count of them,
+  /// returns how many. They stay unchanged until retrieved.
+  int gather(struct iovec* vec, int count) const;
+
+  /// The pipe fd at the head of queue if it has no data ready, or -1.
+  /// writeFd() fails with EAGAIN then, even if the socket is writable.
+  int waitingPipe() const;
+
+ private:
+  enum Kind { kMemory, kFile, kPipe };
+
+  struct Segment
+  {
+    Kind kind;
+    char* chunk;          // owned chunk, or NULL for other segments
+    const char* data;     // first readable byte of kMemory
+    int fd;               // kFile or kPipe
+    int64_t offset;       // kFile
+    size_t len;           // readable bytes
+    boost::shared_ptr<const void> holder;
+  };
+
+  char* allocChunk();
+  void freeChunk(char* chunk);
+  void appendSegment(Kind kind, const char* data, int fd, int64_t offset,
+                     size_t len, const boost::shared_ptr<const void>& holder);
+  void popFront();
+  ssize_t writeFile(int fd, int* savedErrno);
+
+  BufferAllocatorPtr allocator_;  // NULL means the heap
+  std::deque<Segment> segments_;
+  size_t readableBytes_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_OUTPUTQUEUE_H
@@ -12,6 +12,8 @@
 #include <muduo/net/InetAddress.h>
 #include <muduo/net/SocketsOps.h>
 
+#include <assert.h>
+#include <linux/filter.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <strings.h>  // bzero
@@ -93,6 +95,23 @@ void Socket::setTcpNoDelay(bool on)
   // FIXME CHECK
 }
 
+void Socket::setBusyPoll(int microSeconds)
+{
+#ifdef SO_BUSY_POLL
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_BUSY_POLL,
+                         &microSeconds, static_cast<socklen_t>(sizeof microSeconds));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "SO_BUSY_POLL failed.";
+  }
+#else
+  if (microSeconds > 0)
+  {
+    LOG_ERROR << "SO_BUSY_POLL is not supported.";
+  }
+#endif
+}
+
 void Socket::setReuseAddr(bool on)
 {
   int optval = on ? 1 : 0;
@@ -119,6 +138,32 @@ void Socket::setReusePort(bool on)
 #endif
 }
 
+bool Socket::setReusePortCpuSteering(int groupSize)
+{
+  assert(groupSize > 0);
+#ifdef SO_ATTACH_REUSEPORT_CBPF
+  // A = cpu; A %= groupSize; return A
+  struct sock_filter code[] = {
+    { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+    { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(groupSize) },
+    { BPF_RET | BPF_A, 0, 0, 0 },
+  };
+  struct sock_fprog prog;
+  prog.len = static_cast<unsigned short>(sizeof code / sizeof code[0]);
+  prog.filter = code;
+  int ret = ::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF,
+                         &prog, static_cast<socklen_t>(sizeof prog));
+  if (ret < 0)
+  {
+    LOG_SYSERR << "SO_ATTACH_REUSEPORT_CBPF failed.";
+  }
+  return ret == 0;
+#else
+  LOG_ERROR << "SO_ATTACH_REUSEPORT_CBPF is not supported.";
+  return false;
+#endif
+}
+
 void Socket::setKeepAlive(bool on)
 {
   int optval = on ? 1 : 0;
@@ -64,6 +64,13 @@ class Socket : boost::noncopyable
   ///
   void setTcpNoDelay(bool on);
 
+  ///
+  /// SO_BUSY_POLL, the kernel busy polls the device queue for
+  /// up to @c microSeconds on blocking reads, poll and epoll_wait.
+  /// Raising it needs CAP_NET_ADMIN.
+  ///
+  void setBusyPoll(int microSeconds);
+
   ///
   /// Enable/disable SO_REUSEADDR
   ///
@@ -74,6 +81,13 @@ class Socket : boost::noncopyable
   ///
   void setReusePort(bool on);
 
+  ///
+  /// Steers new connections of the SO_REUSEPORT group of this socket
+  /// to socket (cpu % groupSize), where cpu handles the SYN,
+  /// sockets are numbered in the order they listen.
+  ///
+  bool setReusePortCpuSteering(int groupSize);
+
   ///
   /// Enable/disable SO_KEEPALIVE
   ///
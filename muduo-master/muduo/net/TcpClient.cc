@@ -63,6 +63,7 @@ TcpClient::TcpClient(EventLoop* loop,
     messageCallback_(defaultMessageCallback),
     retry_(false),
     connect_(true),
+    edgeTriggered_(false),
     nextConnId_(1)
 {
   connector_->setNewConnectionCallback(
@@ -154,6 +155,7 @@ void TcpClient::newConnection(int sockfd)
   conn->setWriteCompleteCallback(writeCompleteCallback_);
   conn->setCloseCallback(
       boost::bind(&TcpClient::removeConnection, this, _1)); // FIXME: unsafe
+  conn->setEdgeTriggered(edgeTriggered_);
   {
     MutexLockGuard lock(mutex_);
     connection_ = conn;
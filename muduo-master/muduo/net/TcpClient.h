@@ -48,6 +48,10 @@ class TcpClient : boost::noncopyable
   bool retry() const { return retry_; }
   void enableRetry() { retry_ = true; }
 
+  /// Uses edge-triggered epoll for connections made afterwards.
+  /// Not thread safe.
+  void setEdgeTriggered(bool on) { edgeTriggered_ = on; }
+
   const string& name() const
   { return name_; }
 
@@ -89,6 +93,7 @@ class TcpClient : boost::noncopyable
   WriteCompleteCallback writeCompleteCallback_;
   bool retry_;   // atomic
   bool connect_; // atomic
+  bool edgeTriggered_;
   // always in loop thread
   int nextConnId_;
   mutable MutexLock mutex_;
@@ -12,16 +12,23 @@
 #include <muduo/base/WeakCallback.h>
 #include <muduo/net/Channel.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/net/OutputQueue.h>
 #include <muduo/net/Socket.h>
 #include <muduo/net/SocketsOps.h>
 
 #include <boost/bind.hpp>
 
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+#include <functional>
+#endif
+
 #include <errno.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
+const size_t TcpConnection::kDefaultReadBudget;
+
 //连接建立完成的默认回调函数
 void muduo::net::defaultConnectionCallback(const TcpConnectionPtr& conn)
 {
@@ -60,7 +67,14 @@ TcpConnection::TcpConnection(EventLoop* loop,
     channel_(new Channel(loop, sockfd)),
     localAddr_(localAddr),
     peerAddr_(peerAddr),
-    highWaterMark_(64*1024*1024)
+    highWaterMark_(64*1024*1024),
+    readBudget_(0),
+    readSizeHint_(Buffer::kInitialSize),
+    readWithFionread_(false),
+    inputBuffer_(loop->bufferAllocator(), 0),
+    outputQueue_(new OutputQueue(loop->bufferAllocator())),
+    staging_(new OutputQueue(loop->bufferAllocator())),
+    reportedOutputBytes_(0)
 {
   /**
    * 设置channel_的各回调函数
@@ -73,10 +87,17 @@ TcpConnection::TcpConnection(EventLoop* loop,
       boost::bind(&TcpConnection::handleClose, this));
   channel_->setErrorCallback(
       boost::bind(&TcpConnection::handleError, this));
+  channel_->setKind("TcpConnection");
+  channel_->setOwnerName(&name_);
+  // for completion-based pollers, which recv(2) and writev(2) by themselves
+  channel_->setReadOp(Channel::kRecv);
+  channel_->setGatherCallback(
+      boost::bind(&OutputQueue::gather, get_pointer(outputQueue_), _1, _2));
 
   LOG_DEBUG << "TcpConnection::ctor[" <<  name_ << "] at " << this
             << " fd=" << sockfd;
   socket_->setKeepAlive(true);
+  loop_->addConnections(1);
 }
 
 
@@ -90,6 +111,8 @@ TcpConnection::~TcpConnection()
             << " fd=" << channel_->fd()
             << " state=" << stateToString();
   assert(state_ == kDisconnected);
+  loop_->addConnections(-1);
+  loop_->addPendingOutputBytes(-static_cast<int64_t>(reportedOutputBytes_));
 }
 
 
@@ -107,6 +130,23 @@ string TcpConnection::getTcpInfoString() const
   return buf;
 }
 
+size_t TcpConnection::outputBytes() const
+{
+  return outputQueue_->readableBytes();
+}
+
+// keeps loop_->pendingOutputBytes() up to date, after outputQueue_ changes
+void TcpConnection::reportOutputBytes()
+{
+  const size_t bytes = outputQueue_->readableBytes();
+  if (bytes != reportedOutputBytes_)
+  {
+    loop_->addPendingOutputBytes(static_cast<int64_t>(bytes)
+                                 - static_cast<int64_t>(reportedOutputBytes_));
+    reportedOutputBytes_ = bytes;
+  }
+}
+
 /**
  * void TcpConnection::send(const void* data, int len);
  * void TcpConnection::send(const StringPiece& message);
@@ -132,16 +172,16 @@ void TcpConnection::send(const StringPiece& message)
     }
     else
     {
+      // copied once, the loop queues the rest of it by reference
+      boost::shared_ptr<const string> copy(new string(message.data(), message.size()));
       loop_->runInLoop(
-          boost::bind(&TcpConnection::sendInLoop,
+          boost::bind(&TcpConnection::sendSharedInLoop,
                       this,     // FIXME
-                      message.as_string()));
-                    //std::forward<string>(message)));
+                      copy));
     }
   }
 }
 
-// FIXME efficiency!!!
 void TcpConnection::send(Buffer* buf)
 {
   if (state_ == kConnected)
@@ -152,12 +192,147 @@ void TcpConnection::send(Buffer* buf)
       buf->retrieveAll();
     }
     else
+    {
+      // copied into chunks of staging_, which the loop moves to outputQueue_.
+      // queued under the lock, so functors take their bytes in order.
+      MutexLockGuard lock(stagingMutex_);
+      const size_t len = buf->readableBytes();
+      staging_->append(buf->peek(), len);
+      loop_->queueInLoop(
+          boost::bind(&TcpConnection::sendStagedInLoop,
+                      this,     // FIXME
+                      len));
+      buf->retrieveAll();
+    }
+  }
+}
+
+void TcpConnection::send(std::vector<string>* messages)
+{
+  if (state_ == kConnected)
+  {
+    boost::shared_ptr<std::vector<string> > batch(new std::vector<string>);
+    batch->swap(*messages);
+    if (loop_->isInLoopThread())
+    {
+      sendBatchInLoop(batch);
+    }
+    else
+    {
+      loop_->runInLoop(
+          boost::bind(&TcpConnection::sendBatchInLoop,
+                      this,     // FIXME
+                      batch));
+    }
+  }
+}
+
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+void TcpConnection::send(string&& message)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendOwnedStringInLoop(message);
+    }
+    else
+    {
+      // std::bind moves, boost::bind copies
+      loop_->runInLoop(
+          std::bind(&TcpConnection::sendOwnedStringInLoop,
+                    this,  // FIXME
+                    std::move(message)));
+    }
+  }
+}
+
+void TcpConnection::send(const char* message)
+{
+  send(StringPiece(message));
+}
+
+void TcpConnection::send(Buffer&& message)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendOwnedBufferInLoop(message);
+    }
+    else
+    {
+      loop_->runInLoop(
+          std::bind(&TcpConnection::sendOwnedBufferInLoop,
+                    this,  // FIXME
+                    std::move(message)));
+    }
+  }
+}
+
+void TcpConnection::send(std::vector<string>&& messages)
+{
+  send(&messages);
+}
+#endif
+
+/**
+ * message 以引用方式进入outputQueue_，跨线程调用时只拷贝shared_ptr，不拷贝数据
+ */
+void TcpConnection::send(const boost::shared_ptr<const string>& message)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendSharedInLoop(message);
+    }
+    else
+    {
+      loop_->runInLoop(
+          boost::bind(&TcpConnection::sendSharedInLoop,
+                      this,     // FIXME
+                      message));
+    }
+  }
+}
+
+/**
+ * 文件内容不经过用户空间，由handleWrite()调用sendfile(2)/splice(2)发送，与其他数据保持顺序
+ */
+void TcpConnection::sendFile(int fd, int64_t offset, size_t len,
+                             const boost::shared_ptr<const void>& holder)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendFileInLoop(fd, offset, len, holder);
+    }
+    else
+    {
+      loop_->runInLoop(
+          boost::bind(&TcpConnection::sendFileInLoop,
+                      this,     // FIXME
+                      fd, offset, len, holder));
+    }
+  }
+}
+
+void TcpConnection::sendPipe(int pipefd, size_t len)
+{
+  if (state_ == kConnected)
+  {
+    if (loop_->isInLoopThread())
+    {
+      sendPipeInLoop(pipefd, len);
+    }
+    else
     {
       loop_->runInLoop(
-          boost::bind(&TcpConnection::sendInLoop,
+          boost::bind(&TcpConnection::sendPipeInLoop,
                       this,     // FIXME
-                      buf->retrieveAllAsString()));
-                    //std::forward<string>(message)));
+                      pipefd, len));
     }
   }
 }
@@ -167,10 +342,171 @@ void TcpConnection::sendInLoop(const StringPiece& message)
   sendInLoop(message.data(), message.size());
 }
 
+void TcpConnection::sendSharedInLoop(const boost::shared_ptr<const string>& message)
+{
+  sendInLoop(message->data(), message->size(), message);
+}
+
+void TcpConnection::sendStagedInLoop(size_t len)
+{
+  loop_->assertInLoopThread();
+  const size_t oldLen = outputQueue_->readableBytes();
+  const bool idle = !channel_->isWriting() && oldLen == 0;
+  {
+    MutexLockGuard lock(stagingMutex_);
+    if (state_ == kDisconnected)
+    {
+      staging_->retrieve(len);
+    }
+    else
+    {
+      outputQueue_->appendFrom(get_pointer(staging_), len);
+    }
+  }
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  if (len > 0)
+  {
+    writeQueuedInLoop(oldLen, idle);
+  }
+}
+
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
 /**
- * TcpConnection发送数据的核心函数；
+ * message归本连接所有：小消息未写完的部分拷贝进outputQueue_，大消息转移到holder中按引用排队
+ */
+void TcpConnection::sendOwnedStringInLoop(string& message)
+{
+  if (message.size() < OutputQueue::kChunkSize)
+  {
+    sendInLoop(message.data(), message.size());
+  }
+  else
+  {
+    boost::shared_ptr<string> holder(new string);
+    holder->swap(message);
+    sendInLoop(holder->data(), holder->size(), holder);
+  }
+}
+
+void TcpConnection::sendOwnedBufferInLoop(Buffer& message)
+{
+  if (message.readableBytes() < OutputQueue::kChunkSize)
+  {
+    sendInLoop(message.peek(), message.readableBytes());
+    message.retrieveAll();
+  }
+  else
+  {
+    boost::shared_ptr<Buffer> holder(new Buffer(std::move(message)));
+    sendInLoop(holder->peek(), holder->readableBytes(), holder);
+  }
+}
+#endif
+
+/**
+ * 所有消息先进入outputQueue_（小消息拷贝，大消息按引用），若之前没有待发数据，一次writev写出
+ */
+void TcpConnection::sendBatchInLoop(const boost::shared_ptr<std::vector<string> >& messages)
+{
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+
+  const size_t oldLen = outputQueue_->readableBytes();
+  const bool idle = !channel_->isWriting() && oldLen == 0;
+  for (std::vector<string>::const_iterator it = messages->begin();
+       it != messages->end(); ++it)
+  {
+    if (it->size() < OutputQueue::kChunkSize)
+    {
+      outputQueue_->append(it->data(), it->size());
+    }
+    else
+    {
+      outputQueue_->appendRef(it->data(), it->size(), messages);
+    }
+  }
+  if (outputQueue_->readableBytes() != oldLen)
+  {
+    writeQueuedInLoop(oldLen, idle);
+  }
+}
+
+/**
+ * 数据已追加到outputQueue_；若之前没有待发数据，一次writev写出，否则等待handleWrite()
  */
+void TcpConnection::writeQueuedInLoop(size_t oldLen, bool idle)
+{
+  if (idle)
+  {
+    int savedErrno = 0;
+    ssize_t n = outputQueue_->writeFd(channel_->fd(), &savedErrno);
+    if (n < 0 && savedErrno != EWOULDBLOCK)
+    {
+      errno = savedErrno;
+      LOG_SYSERR << "TcpConnection::writeQueuedInLoop";
+      if (savedErrno == EPIPE || savedErrno == ECONNRESET)
+      {
+        outputQueue_->retrieveAll();
+        reportOutputBytes();
+        return;
+      }
+      // a file or pipe ends early, the rest can not be sent
+      if (savedErrno == EIO)
+      {
+        reportOutputBytes();
+        forceCloseInLoop();
+        return;
+      }
+    }
+    if (outputQueue_->empty())
+    {
+      reportOutputBytes();
+      if (writeCompleteCallback_)
+      {
+        loop_->queueInLoop(boost::bind(writeCompleteCallback_, shared_from_this()));
+      }
+      return;
+    }
+  }
+  reportOutputBytes();
+
+  const size_t newLen = outputQueue_->readableBytes();
+  if (newLen >= highWaterMark_
+      && oldLen < highWaterMark_
+      && highWaterMarkCallback_)
+  {
+    loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), newLen));
+  }
+  if (!channel_->isWriting())
+  {
+    channel_->enableWriting();
+    // edge-triggered, the socket may be writable still
+    if (channel_->isEdgeTriggered())
+    {
+      handleWrite();
+    }
+  }
+}
+
 void TcpConnection::sendInLoop(const void* data, size_t len)
+{
+  sendInLoop(data, len, boost::shared_ptr<const void>());
+}
+
+/**
+ * TcpConnection发送数据的核心函数；
+ * holder为空时，未写完的数据拷贝到outputQueue_的chunk中；否则只保存引用，由holder保证数据有效
+ */
+void TcpConnection::sendInLoop(const void* data, size_t len,
+                               const boost::shared_ptr<const void>& holder)
 {
   loop_->assertInLoopThread();
   ssize_t nwrote = 0;
@@ -186,9 +522,9 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   /**
    * if no thing in output queue, try writing directly,直接将data写入channel_->fd()
    * !channel_->isWriting() 为true表示channel_还未关注POLLOUT事件（writable事件）
-   * outputBuffer_.readableBytes() == 0 表示outputBuffer_中还未填充数据
+   * outputQueue_->empty() 表示outputQueue_中还未填充数据
    */
-  if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) // why????
+  if (!channel_->isWriting() && outputQueue_->empty()) // why????
   {
     //nwrote 实际写入channel_->fd()中的字节数
     nwrote = sockets::write(channel_->fd(), data, len);
@@ -220,8 +556,8 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
   assert(remaining <= len);
   if (!faultError && remaining > 0)
   {
-    size_t oldLen = outputBuffer_.readableBytes();
-    //outputBuffer_中原有的数据oldLen和data中剩余的数据的总和的字节数超过了highWaterMark_，此时需要回调
+    size_t oldLen = outputQueue_->readableBytes();
+    //outputQueue_中原有的数据oldLen和data中剩余的数据的总和的字节数超过了highWaterMark_，此时需要回调
     //highWaterMarkCallback_进行相关处理...
     if (oldLen + remaining >= highWaterMark_
         && oldLen < highWaterMark_
@@ -229,18 +565,78 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     {
       loop_->queueInLoop(boost::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
     }
-    //将data中余下数据存储到outputBuffer_中
-    outputBuffer_.append(static_cast<const char*>(data)+nwrote, remaining);
+    //将data中余下数据存储到outputQueue_中
+    if (holder)
+    {
+      outputQueue_->appendRef(static_cast<const char*>(data)+nwrote, remaining, holder);
+    }
+    else
+    {
+      outputQueue_->append(static_cast<const char*>(data)+nwrote, remaining);
+    }
+    reportOutputBytes();
     //channel_开始关注POLLOUT事件
     if (!channel_->isWriting())
     {
       channel_->enableWriting();
+      // edge-triggered, the socket may be writable already, eg. while
+      // writing was disabled for an empty head pipe
+      if (channel_->isEdgeTriggered())
+      {
+        handleWrite();
+      }
     }
   }
 }
 
 
 
+/**
+ * 文件和pipe数据总是先进入outputQueue_，由handleWrite()发送
+ */
+void TcpConnection::sendFileInLoop(int fd, int64_t offset, size_t len,
+                                   const boost::shared_ptr<const void>& holder)
+{
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  outputQueue_->appendFile(fd, offset, len, holder);
+  reportOutputBytes();
+  if (!channel_->isWriting())
+  {
+    channel_->enableWriting();
+    // edge-triggered, the socket may be writable already
+    if (channel_->isEdgeTriggered())
+    {
+      handleWrite();
+    }
+  }
+}
+
+void TcpConnection::sendPipeInLoop(int pipefd, size_t len)
+{
+  loop_->assertInLoopThread();
+  if (state_ == kDisconnected)
+  {
+    LOG_WARN << "disconnected, give up writing";
+    return;
+  }
+  outputQueue_->appendPipe(pipefd, len, boost::shared_ptr<const void>());
+  reportOutputBytes();
+  if (!channel_->isWriting())
+  {
+    channel_->enableWriting();
+    // edge-triggered, the socket may be writable already
+    if (channel_->isEdgeTriggered())
+    {
+      handleWrite();
+    }
+  }
+}
+
 /**
  * 在LOOP IO THREAD 中关闭连接......
  */
@@ -349,11 +745,24 @@ const char* TcpConnection::stateToString() const
 
 
 
+void TcpConnection::setEdgeTriggered(bool on)
+{
+  assert(state_ == kConnecting);
+  channel_->setEdgeTriggered(on);
+}
+
+
+
 void TcpConnection::setTcpNoDelay(bool on)
 {
   socket_->setTcpNoDelay(on);
 }
 
+void TcpConnection::setBusyPoll(int microSeconds)
+{
+  socket_->setBusyPoll(microSeconds);
+}
+
 
 
 void TcpConnection::startRead()
@@ -370,6 +779,21 @@ void TcpConnection::startReadInLoop()
   {
     channel_->enableReading();
     reading_ = true;
+    // edges came while not reading were dropped
+    if (channel_->isEdgeTriggered())
+    {
+      loop_->queueInLoop(boost::bind(&TcpConnection::continueReading,
+                                     shared_from_this(), Timestamp::now()));
+    }
+  }
+}
+
+void TcpConnection::continueReading(Timestamp receiveTime)
+{
+  loop_->assertInLoopThread();
+  if (reading_ && (state_ == kConnected || state_ == kDisconnecting))
+  {
+    handleRead(receiveTime);
   }
 }
 
@@ -390,6 +814,11 @@ void TcpConnection::stopReadInLoop()
     channel_->disableReading();
     reading_ = false;
   }
+  // an idle connection holds no memory, the block goes back to loop's pool
+  if (inputBuffer_.readableBytes() == 0)
+  {
+    inputBuffer_.release();
+  }
 }
 
 
@@ -422,6 +851,15 @@ void TcpConnection::connectDestroyed()
     connectionCallback_(shared_from_this());
   }
   channel_->remove();//删除poller_ 的map中对应的channel
+  if (pipeChannel_)
+  {
+    // disabling it again would add the fd back, which may be closed by now
+    if (!pipeChannel_->isNoneEvent())
+    {
+      pipeChannel_->disableAll();
+    }
+    pipeChannel_->remove();
+  }
 }
 
 
@@ -437,17 +875,64 @@ void TcpConnection::handleRead(Timestamp receiveTime)
   loop_->assertInLoopThread();
   int savedErrno = 0;
   //读取接收缓冲区的消息
-  ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+  ssize_t n = 0;
+  bool drained = true;
+  if (channel_->hasReadResult())
+  {
+    // received by the poller already
+    n = channel_->readResult();
+    if (n > 0)
+    {
+      inputBuffer_.append(static_cast<const char*>(channel_->readData()), n);
+    }
+    else if (n < 0)
+    {
+      savedErrno = static_cast<int>(-n);
+      n = -1;
+    }
+  }
+  else if (readBudget_ > 0 || channel_->isEdgeTriggered())
+  {
+    const size_t budget = readBudget_ > 0 ? readBudget_ : kDefaultReadBudget;
+    n = inputBuffer_.readFd(channel_->fd(), &savedErrno,
+                            readSizeHint_, budget, readWithFionread_, &drained);
+  }
+  else
+  {
+    n = inputBuffer_.readFd(channel_->fd(), &savedErrno, &drained);
+  }
   if (n > 0)
   {
+    // pre-sizes the buffer for the next read, bulk transfers read in one go
+    readSizeHint_ = std::max(implicit_cast<size_t>(n), readSizeHint_ - readSizeHint_/4);
+    readSizeHint_ = std::max(readSizeHint_, Buffer::kInitialSize);
     //messageCallback_ was set in TcpServer::newConnection(); 
     //messageCallback_ 来自于TcpServer的messageCallback_
     messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    // gives back a block grown by a burst once recent reads are much
+    // smaller, and the default block once small reads drained the socket,
+    // an idle connection holds none.  A bulk transfer keeps its block.
+    if (inputBuffer_.readableBytes() == 0
+        && (inputBuffer_.internalCapacity() > 4 * readSizeHint_
+            || (drained && readSizeHint_ == Buffer::kInitialSize)))
+    {
+      inputBuffer_.release();
+    }
+    // edge-triggered, no more event for what is left in the socket
+    if (!drained && channel_->isEdgeTriggered())
+    {
+      loop_->queueInLoop(boost::bind(&TcpConnection::continueReading,
+                                     shared_from_this(), receiveTime));
+    }
   }
   else if (n == 0)
   {
     handleClose();
   }
+  else if (savedErrno == EAGAIN && channel_->isEdgeTriggered())
+  {
+    // nothing to read, after startRead() or continueReading()
+  }
   else
   {
     errno = savedErrno;//errno定义在errno.h中，是外部变量，任何包含了errno.h的源文件都可以获取errno的当前值
@@ -457,26 +942,49 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 }
 
 /**
- * channel_的writeCallback_,主要工作是将outputBuffer_中数据写到channel_->fd()中，直至
- * outputBuffer_.readableBytes()==0,表示数据已全部写入fd；
+ * channel_的writeCallback_,主要工作是将outputQueue_中数据写到channel_->fd()中，直至
+ * outputQueue_->empty(),表示数据已全部写入fd；
  */
 void TcpConnection::handleWrite()
 {
   loop_->assertInLoopThread();
+  int savedErrno = 0;
+  ssize_t n = 0;
+  if (channel_->hasWriteResult())
+  {
+    // written by the poller already, maybe after writing is disabled
+    n = channel_->writeResult();
+    if (n >= 0)
+    {
+      outputQueue_->retrieve(n);
+    }
+    else
+    {
+      savedErrno = static_cast<int>(-n);
+      n = -1;
+    }
+    reportOutputBytes();
+  }
   //channel_已关注POLLOUT事件
   if (channel_->isWriting())
   {
-    //将outputBuffer_中的数据写入到channel_->fd(),返回值n表示实际写入的字节数
-    ssize_t n = sockets::write(channel_->fd(),
-                               outputBuffer_.peek(),
-                               outputBuffer_.readableBytes());
-    if (n > 0)
+    //一次writev将outputQueue_中的各段数据写入到channel_->fd(),返回值n表示实际写入的字节数,
+    //已写入的数据在writeFd中被retrieve；队首为文件或pipe时使用sendfile/splice
+    //文件段或pipe提前遇到EOF时失败,errno为EIO,只能关闭连接
+    if (!channel_->hasWriteResult())
     {
-      //从outputBuffer_中提取出n字节的数据并更新buffer的readIdx、writeIdx .
-      outputBuffer_.retrieve(n);
-
-      //outputBuffer_中的数据已全部写入channel_->fd()
-      if (outputBuffer_.readableBytes() == 0)
+      n = outputQueue_->writeFd(channel_->fd(), &savedErrno);
+      // edge-triggered, writes until EAGAIN, or no more event comes
+      while (channel_->isEdgeTriggered() && n >= 0 && !outputQueue_->empty())
+      {
+        n = outputQueue_->writeFd(channel_->fd(), &savedErrno);
+      }
+      reportOutputBytes();
+    }
+    if (n >= 0)
+    {
+      //outputQueue_中的数据已全部写入channel_->fd()
+      if (outputQueue_->empty())
       {
         //取消 channel_上的POLLOUT事件！！！如果不取消会发生什么？？？
         channel_->disableWriting();
@@ -492,9 +1000,26 @@ void TcpConnection::handleWrite()
         }
       }
     }
+    else if (savedErrno == EWOULDBLOCK)
+    {
+      // the socket stays writable while the head pipe is empty,
+      // waits for the pipe instead of spinning on POLLOUT.
+      int pipefd = outputQueue_->waitingPipe();
+      if (pipefd >= 0)
+      {
+        channel_->disableWriting();
+        watchPipe(pipefd);
+      }
+    }
     else
     {
+      errno = savedErrno;
       LOG_SYSERR << "TcpConnection::handleWrite";
+      // a file or pipe ends early, the peer would wait for the rest forever
+      if (savedErrno == EIO)
+      {
+        forceCloseInLoop();
+      }
       // if (state_ == kDisconnecting)
       // {
       //   shutdownInLoop();
@@ -508,6 +1033,59 @@ void TcpConnection::handleWrite()
   }
 }
 
+void TcpConnection::watchPipe(int pipefd)
+{
+  loop_->assertInLoopThread();
+  if (pipeChannel_ && pipeChannel_->fd() != pipefd)
+  {
+    if (!pipeChannel_->isNoneEvent())
+    {
+      pipeChannel_->disableAll();
+    }
+    pipeChannel_->remove();
+    pipeChannel_.reset();
+  }
+  if (!pipeChannel_)
+  {
+    pipeChannel_.reset(new Channel(loop_, pipefd));
+    pipeChannel_->setReadCallback(
+        boost::bind(&TcpConnection::handlePipeReadable, this));
+    // the writer has gone, splice(2) sees EOF
+    pipeChannel_->setCloseCallback(
+        boost::bind(&TcpConnection::handlePipeReadable, this));
+    pipeChannel_->setErrorCallback(
+        boost::bind(&TcpConnection::handlePipeReadable, this));
+    pipeChannel_->setKind("TcpConnection pipe");
+    pipeChannel_->setOwnerName(&name_);
+    pipeChannel_->tie(shared_from_this());
+  }
+  pipeChannel_->enableReading();
+}
+
+/**
+ * pipeChannel_的回调，pipe中有数据(或写端已关闭)，重新关注channel_上的POLLOUT
+ * pipeChannel_不能在自己的回调中销毁，只取消其关注的事件
+ */
+void TcpConnection::handlePipeReadable()
+{
+  loop_->assertInLoopThread();
+  pipeChannel_->disableAll();
+  if (state_ == kDisconnected || outputQueue_->empty())
+  {
+    return;
+  }
+  if (!channel_->isWriting())
+  {
+    channel_->enableWriting();
+  }
+  // edge-triggered, the socket may be writable already, and an edge
+  // seen since writing was enabled is gone
+  if (channel_->isEdgeTriggered())
+  {
+    loop_->queueInLoop(boost::bind(&TcpConnection::handleWrite, shared_from_this()));
+  }
+}
+
 /**
  * channel_的closeCallback_，即为TcpServer::removeConnection(const TcpConnectionPtr& conn)
  * TcpServer::removeConnection(...)---->TcpServer::removeConnectionInLoop(...)---->
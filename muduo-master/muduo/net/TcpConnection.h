@@ -11,6 +11,7 @@
 #ifndef MUDUO_NET_TCPCONNECTION_H
 #define MUDUO_NET_TCPCONNECTION_H
 
+#include <muduo/base/Mutex.h>
 #include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 #include <muduo/net/Callbacks.h>
@@ -23,6 +24,8 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <vector>
+
 // struct tcp_info is in <netinet/tcp.h>
 struct tcp_info;
 
@@ -33,6 +36,7 @@ namespace net
 
 class Channel;
 class EventLoop;
+class OutputQueue;
 class Socket;
 
 ///
@@ -63,16 +67,37 @@ class TcpConnection : boost::noncopyable,
   bool getTcpInfo(struct tcp_info*) const;
   string getTcpInfoString() const;
 
-  // void send(string&& message); // C++11
   void send(const void* message, int len);
   void send(const StringPiece& message);
-  // void send(Buffer&& message); // C++11
-  void send(Buffer* message);  // this one will swap data
+  void send(Buffer* message);  // this one will retrieve all data
+  // all messages are passed to the loop in one functor, and written with
+  // one writev(2). this one will swap data, messages is empty afterwards.
+  void send(std::vector<string>* messages);
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+  // messages are moved into the loop thread, not copied
+  void send(string&& message);
+  void send(const char* message);  // or literals would be ambiguous
+  void send(Buffer&& message);
+  void send(std::vector<string>&& messages);
+#endif
+  // queued by reference, message must not be modified afterwards
+  void send(const boost::shared_ptr<const string>& message);
+  // sends [offset, offset+len) of file fd with sendfile(2), in order with other data.
+  // fd is not owned, keep it open until written, e.g. close it in WriteCompleteCallback,
+  // or let holder own it, which is released when the region is written.
+  void sendFile(int fd, int64_t offset, size_t len,
+                const boost::shared_ptr<const void>& holder = boost::shared_ptr<const void>());
+  // sends len bytes from pipe fd with splice(2), in order with other data.
+  // while the pipe is empty, it is watched for readability instead of the socket
+  // for writability, so it must not be watched by another Channel of this loop.
+  void sendPipe(int pipefd, size_t len);
   void shutdown(); // NOT thread safe, no simultaneous calling
   // void shutdownAndForceCloseAfter(double seconds); // NOT thread safe, no simultaneous calling
   void forceClose();
   void forceCloseWithDelay(double seconds);
   void setTcpNoDelay(bool on);
+  /// see Socket::setBusyPoll, for EventLoop::setBusyPoll
+  void setBusyPoll(int microSeconds);
   // reading or not
   void startRead();
   void stopRead();
@@ -99,17 +124,35 @@ class TcpConnection : boost::noncopyable,
   void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
   { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
 
+  /// Reads at most maxBytes on each readable event, until the socket is drained.
+  /// 0 means one read(2) per event, which is the default, except for
+  /// edge-triggered connections, which read up to kDefaultReadBudget.
+  /// NOT thread safe, call it in the loop thread.
+  void setReadBudget(size_t maxBytes)
+  { readBudget_ = maxBytes; }
+
+  /// Makes room for bulk reads with ioctl(FIONREAD), off by default.
+  void setReadWithFionread(bool on)
+  { readWithFionread_ = on; }
+
+  static const size_t kDefaultReadBudget = 256*1024;
+
   /// Advanced interface
   Buffer* inputBuffer()
   { return &inputBuffer_; }
 
-  Buffer* outputBuffer()
-  { return &outputBuffer_; }
+  /// Bytes queued but not written to the socket yet.
+  /// NOT thread safe, call it in the loop thread.
+  size_t outputBytes() const;
 
   /// Internal use only.
   void setCloseCallback(const CloseCallback& cb)
   { closeCallback_ = cb; }
 
+  /// Internal use only, must be called before connectEstablished().
+  /// Uses EPOLLET, reading and writing until EAGAIN.
+  void setEdgeTriggered(bool on);
+
   // called when TcpServer accepts a new connection
   void connectEstablished();   // should be called only once
   // called when TcpServer has removed me from its map
@@ -119,20 +162,36 @@ class TcpConnection : boost::noncopyable,
   enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
   void handleRead(Timestamp receiveTime);
   void handleWrite();
+  void handlePipeReadable();
+  void watchPipe(int pipefd);
   void handleClose();
   void handleError();
 
-  // void sendInLoop(string&& message);
   void sendInLoop(const StringPiece& message);
   void sendInLoop(const void* message, size_t len);
+  void sendInLoop(const void* message, size_t len,
+                  const boost::shared_ptr<const void>& holder);
+  void sendSharedInLoop(const boost::shared_ptr<const string>& message);
+  void sendStagedInLoop(size_t len);
+  void sendBatchInLoop(const boost::shared_ptr<std::vector<string> >& messages);
+  void writeQueuedInLoop(size_t oldLen, bool idle);
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+  void sendOwnedStringInLoop(string& message);
+  void sendOwnedBufferInLoop(Buffer& message);
+#endif
+  void sendFileInLoop(int fd, int64_t offset, size_t len,
+                      const boost::shared_ptr<const void>& holder);
+  void sendPipeInLoop(int pipefd, size_t len);
   void shutdownInLoop();
 
   // void shutdownAndForceCloseInLoop(double seconds);
   void forceCloseInLoop();
   void setState(StateE s) { state_ = s; }
+  void reportOutputBytes();
   const char* stateToString() const;
   void startReadInLoop();
   void stopReadInLoop();
+  void continueReading(Timestamp receiveTime);
 
   EventLoop* loop_;
   const string name_;
@@ -142,6 +201,7 @@ class TcpConnection : boost::noncopyable,
   // we don't expose those classes to client.
   boost::scoped_ptr<Socket> socket_;
   boost::scoped_ptr<Channel> channel_;
+  boost::scoped_ptr<Channel> pipeChannel_;  // head pipe of outputQueue_ while it is empty
 
   const InetAddress localAddr_;
   const InetAddress peerAddr_;
@@ -151,8 +211,15 @@ class TcpConnection : boost::noncopyable,
   HighWaterMarkCallback highWaterMarkCallback_;
   CloseCallback closeCallback_;
   size_t highWaterMark_;
+  size_t readBudget_;
+  size_t readSizeHint_;  // decaying maximum of recent reads
+  bool readWithFionread_;
   Buffer inputBuffer_;
-  Buffer outputBuffer_; // FIXME: use list<Buffer> as output buffer.
+  boost::scoped_ptr<OutputQueue> outputQueue_;
+  MutexLock stagingMutex_;
+  // filled by send(Buffer*) in other threads, drained by sendStagedInLoop()
+  boost::scoped_ptr<OutputQueue> staging_;  // GUARDED BY stagingMutex_
+  size_t reportedOutputBytes_;  // added to loop_->pendingOutputBytes()
   boost::any context_;
   // FIXME: creationTime_, lastReceiveTime_
   //        bytesReceived_, bytesSent_
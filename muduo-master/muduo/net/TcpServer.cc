@@ -8,6 +8,7 @@
 
 #include <muduo/net/TcpServer.h>
 
+#include <muduo/base/CountDownLatch.h>
 #include <muduo/base/Logging.h>
 #include <muduo/net/Acceptor.h>
 #include <muduo/net/EventLoop.h>
@@ -21,6 +22,50 @@
 using namespace muduo;
 using namespace muduo::net;
 
+/// kReusePortPerLoop, lives in the loop and is only touched there,
+/// except for creation and destruction when the loop waits for them.
+struct TcpServer::LoopAcceptor
+{
+  LoopAcceptor(EventLoop* ioLoop, int i)
+    : loop(ioLoop),
+      index(i),
+      nextConnId(1)
+  {
+  }
+
+  EventLoop* loop;
+  const int index;
+  boost::scoped_ptr<Acceptor> acceptor;
+  ConnectionMap connections;
+  int nextConnId;
+};
+
+namespace
+{
+
+void runAndCountDown(const boost::function<void()>& f, CountDownLatch* latch)
+{
+  f();
+  latch->countDown();
+}
+
+// runs f in loop and waits for it
+void runInLoopAndWait(EventLoop* loop, const boost::function<void()>& f)
+{
+  if (loop->isInLoopThread())
+  {
+    f();
+  }
+  else
+  {
+    CountDownLatch latch(1);
+    loop->runInLoop(boost::bind(runAndCountDown, f, &latch));
+    latch.wait();
+  }
+}
+
+}
+
 /**
  * 设置默认的connectionCallback_ 和messageCallback_，设置acceptor_的newConnectionCallback_为
  * TcpServer::newConnection（...），在新连接建立完成时(即acceptor_->accept(...)函数返回的connfd>0时)
@@ -33,15 +78,22 @@ TcpServer::TcpServer(EventLoop* loop,
   : loop_(CHECK_NOTNULL(loop)),
     ipPort_(listenAddr.toIpPort()),
     name_(nameArg),
-    acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+    listenAddr_(listenAddr),
+    acceptor_(option == kReusePortPerLoop ? NULL
+              : new Acceptor(loop, listenAddr, option == kReusePort)),
     threadPool_(new EventLoopThreadPool(loop, name_)),
     connectionCallback_(defaultConnectionCallback),
     messageCallback_(defaultMessageCallback),
-    nextConnId_(1)
+    nextConnId_(1),
+    edgeTriggered_(false),
+    cpuSteering_(false)
 {
   //！！！！！ acceptor->accept()函数返回connfd后会调用newConnectionCallback_   
-  acceptor_->setNewConnectionCallback(
-      boost::bind(&TcpServer::newConnection, this, _1, _2));
+  if (acceptor_)
+  {
+    acceptor_->setNewConnectionCallback(
+        boost::bind(&TcpServer::newConnection, this, _1, _2));
+  }
 }
 
 /**
@@ -63,6 +115,13 @@ TcpServer::~TcpServer()
     conn->getLoop()->runInLoop(
       boost::bind(&TcpConnection::connectDestroyed, conn));
   }
+
+  // the IO loops are still running, they go away with threadPool_
+  for (size_t i = 0; i < loopAcceptors_.size(); ++i)
+  {
+    LoopAcceptor* la = get_pointer(loopAcceptors_[i]);
+    runInLoopAndWait(la->loop, boost::bind(&TcpServer::stopLoopAcceptor, la));
+  }
 }
 
 void TcpServer::setThreadNum(int numThreads)
@@ -71,6 +130,11 @@ void TcpServer::setThreadNum(int numThreads)
   threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setCpuAffinity(const std::vector<int>& cpus)
+{
+  threadPool_->setCpuAffinity(cpus);
+}
+
 /**
  * Acceptor::listen(...)开启监听......
  */
@@ -80,6 +144,11 @@ void TcpServer::start()
   {
     threadPool_->start(threadInitCallback_);
 
+    if (!acceptor_)
+    {
+      startLoopAcceptors();
+      return;
+    }
     assert(!acceptor_->listenning());
     
     loop_->runInLoop(
@@ -87,6 +156,35 @@ void TcpServer::start()
   }
 }
 
+/**
+ * kReusePortPerLoop: 每个IO loop各自bind一个SO_REUSEPORT监听套接字，
+ * 由内核分发新连接，连接就留在accept它的loop中，不再经过loop_。
+ * 逐个listen，让套接字在reuseport组中的序号与loop的序号一致。
+ */
+void TcpServer::startLoopAcceptors()
+{
+  loop_->assertInLoopThread();
+  assert(loopAcceptors_.empty());
+  std::vector<EventLoop*> loops(threadPool_->getAllLoops());
+  for (size_t i = 0; i < loops.size(); ++i)
+  {
+    boost::shared_ptr<LoopAcceptor> la(new LoopAcceptor(loops[i], static_cast<int>(i)));
+    // Acceptor's channel belongs to loops[i], but it isn't registered until listen()
+    la->acceptor.reset(new Acceptor(loops[i], listenAddr_, true));
+    la->acceptor->setNewConnectionCallback(
+        boost::bind(&TcpServer::newLoopConnection, this, get_pointer(la), _1, _2));
+    runInLoopAndWait(loops[i],
+        boost::bind(&Acceptor::listen, get_pointer(la->acceptor)));
+    loopAcceptors_.push_back(la);
+  }
+
+  if (cpuSteering_)
+  {
+    // one program for the whole group
+    loopAcceptors_[0]->acceptor->setCpuSteering(static_cast<int>(loops.size()));
+  }
+}
+
 /**
  * TcpServer::newConnection(...)为acceptor_的newConnectionCallback_;
  * newConnection(...)根据已建立连接的connfd创建TcpConnection对象conn
@@ -101,6 +199,25 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
   ++nextConnId_;
   string connName = name_ + buf;
 
+  TcpConnectionPtr conn(createConnection(ioLoop, connName, sockfd, peerAddr));
+  //将conn添加到connections_                                          
+  connections_[connName] = conn;
+  /**设置conn断开连接时的回调函数为TcpServer::removeConnection(...),断开连接时应将conn从TcpServer
+   * 的connections_中删除，并将conn对应的channel_从poller的channels_中删除
+   */
+  conn->setCloseCallback(
+      boost::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
+  /**
+   * 在connectEstablished（）中应设置conn对应的channel所关注的事件
+   */
+  ioLoop->runInLoop(boost::bind(&TcpConnection::connectEstablished, conn));
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop* ioLoop,
+                                             const string& connName,
+                                             int sockfd,
+                                             const InetAddress& peerAddr)
+{
   LOG_INFO << "TcpServer::newConnection [" << name_
            << "] - new connection [" << connName
            << "] from " << peerAddr.toIpPort();
@@ -112,24 +229,28 @@ void TcpServer::newConnection(int sockfd, const InetAddress& peerAddr)
                                           sockfd,
                                           localAddr,
                                           peerAddr));
-  //将conn添加到connections_                                          
-  connections_[connName] = conn;
   /*set connection **Callback in TcpServer class */
   conn->setConnectionCallback(connectionCallback_);
   conn->setMessageCallback(messageCallback_);
   conn->setWriteCompleteCallback(writeCompleteCallback_);
-  
-  /**设置conn断开连接时的回调函数为TcpServer::removeConnection(...),断开连接时应将conn从TcpServer
-   * 的connections_中删除，并将conn对应的channel_从poller的channels_中删除
-   */
-  conn->setCloseCallback(
-      boost::bind(&TcpServer::removeConnection, this, _1)); // FIXME: unsafe
-  /**
-   * 在connectEstablished（）中应设置conn对应的channel所关注的事件
-   */
-  ioLoop->runInLoop(boost::bind(&TcpConnection::connectEstablished, conn));
+  conn->setEdgeTriggered(edgeTriggered_);
+  return conn;
 }
 
+void TcpServer::newLoopConnection(LoopAcceptor* la, int sockfd, const InetAddress& peerAddr)
+{
+  la->loop->assertInLoopThread();
+  char buf[64];
+  snprintf(buf, sizeof buf, "-%s#%d.%d", ipPort_.c_str(), la->index, la->nextConnId);
+  ++la->nextConnId;
+  string connName = name_ + buf;
+
+  TcpConnectionPtr conn(createConnection(la->loop, connName, sockfd, peerAddr));
+  la->connections[connName] = conn;
+  conn->setCloseCallback(
+      boost::bind(&TcpServer::removeLoopConnection, this, la, _1)); // FIXME: unsafe
+  conn->connectEstablished();
+}
 
 /**
  * TcpServer::removeConnection为 TcpConnection的closeCallback_ ，当TcpConnection断开时需要将TcpServer的
@@ -155,3 +276,28 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr& conn)
       boost::bind(&TcpConnection::connectDestroyed, conn));
 }
 
+
+void TcpServer::stopLoopAcceptor(LoopAcceptor* la)
+{
+  la->loop->assertInLoopThread();
+  la->acceptor.reset();
+  for (ConnectionMap::iterator it(la->connections.begin());
+      it != la->connections.end(); ++it)
+  {
+    it->second->connectDestroyed();
+  }
+  la->connections.clear();
+}
+
+void TcpServer::removeLoopConnection(LoopAcceptor* la, const TcpConnectionPtr& conn)
+{
+  la->loop->assertInLoopThread();
+  LOG_INFO << "TcpServer::removeLoopConnection [" << name_
+           << "] - connection " << conn->name();
+
+  size_t n = la->connections.erase(conn->name());
+  (void)n;
+  assert(n == 1);
+  la->loop->queueInLoop(
+      boost::bind(&TcpConnection::connectDestroyed, conn));
+}
@@ -16,6 +16,7 @@
 #include <muduo/net/TcpConnection.h>
 
 #include <map>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
@@ -41,6 +42,9 @@ class TcpServer : boost::noncopyable
   {
     kNoReusePort,
     kReusePort,
+    /// Every IO loop accepts on its own SO_REUSEPORT socket, the kernel
+    /// spreads new connections, which stay in the loop that accepts them.
+    kReusePortPerLoop,
   };
 
   //TcpServer(EventLoop* loop, const InetAddress& listenAddr);
@@ -64,8 +68,14 @@ class TcpServer : boost::noncopyable
   /// - 1 means all I/O in another thread.
   /// - N means a thread pool with N threads, new connections
   ///   are assigned on a round-robin basis.
+  ///   With kReusePortPerLoop, they are accepted in the N threads.
 
   void setThreadNum(int numThreads);
+  /// Pins IO thread i to cpus[i % cpus.size()], see EventLoopThreadPool.
+  /// With setCpuSteering(), give cpus 0 to N-1 in order.
+  /// Not thread safe, call it before @c start.
+  void setCpuAffinity(const std::vector<int>& cpus);
+
   void setThreadInitCallback(const ThreadInitCallback& cb)
   { threadInitCallback_ = cb; }
   /// valid after calling start()
@@ -99,6 +109,19 @@ class TcpServer : boost::noncopyable
   void setWriteCompleteCallback(const WriteCompleteCallback& cb)
   { writeCompleteCallback_ = cb; }
 
+  /// Uses edge-triggered epoll for new connections, which saves
+  /// an epoll_ctl(2) each time a connection starts or stops writing.
+  /// Not thread safe, call it before @c start.
+  void setEdgeTriggered(bool on)
+  { edgeTriggered_ = on; }
+
+  /// With kReusePortPerLoop, a connection goes to loop (cpu % N) in
+  /// threadPool()->getAllLoops(), where cpu handles its first packet,
+  /// which keeps it on one CPU if the IO threads are pinned in order.
+  /// Needs Linux 4.5, not thread safe, call it before @c start.
+  void setCpuSteering(bool on)
+  { cpuSteering_ = on; }
+
  private:
   /// Not thread safe, but in loop 
   void newConnection(int sockfd, const InetAddress& peerAddr);
@@ -106,12 +129,23 @@ class TcpServer : boost::noncopyable
   void removeConnection(const TcpConnectionPtr& conn);
   /// Not thread safe, but in loop
   void removeConnectionInLoop(const TcpConnectionPtr& conn);
+  TcpConnectionPtr createConnection(EventLoop* ioLoop, const string& connName,
+                                    int sockfd, const InetAddress& peerAddr);
+
+  // kReusePortPerLoop
+  struct LoopAcceptor;
+  void startLoopAcceptors();
+  /// Not thread safe, but in acceptor's loop
+  void newLoopConnection(LoopAcceptor* acceptor, int sockfd, const InetAddress& peerAddr);
+  void removeLoopConnection(LoopAcceptor* acceptor, const TcpConnectionPtr& conn);
+  static void stopLoopAcceptor(LoopAcceptor* acceptor);
 
   typedef std::map<string, TcpConnectionPtr> ConnectionMap;
 
   EventLoop* loop_;  // the acceptor loop
   const string ipPort_;
   const string name_;
+  const InetAddress listenAddr_;
   boost::scoped_ptr<Acceptor> acceptor_; // avoid revealing Acceptor，acceptor用于接受新连接。   
   boost::shared_ptr<EventLoopThreadPool> threadPool_;
   
@@ -123,7 +157,11 @@ class TcpServer : boost::noncopyable
   AtomicInt32 started_;
   // always in loop thread
   int nextConnId_;
+  bool edgeTriggered_;
+  bool cpuSteering_;
   ConnectionMap connections_;//一个TcpServer对象保存着多个TcpConnection
+  // kReusePortPerLoop, one per IO loop, each has its own connections
+  std::vector<boost::shared_ptr<LoopAcceptor> > loopAcceptors_;
 };
 
 }
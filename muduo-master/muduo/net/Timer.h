@@ -32,7 +32,11 @@ class Timer : boost::noncopyable
       expiration_(when),
       interval_(interval),
       repeat_(interval > 0.0),
-      sequence_(s_numCreated_.incrementAndGet())
+      sequence_(s_numCreated_.incrementAndGet()),
+      wheelPrev_(NULL),
+      wheelNext_(NULL),
+      wheelSlot_(NULL),
+      wheelTick_(0)
   { }
 
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
@@ -41,7 +45,11 @@ class Timer : boost::noncopyable
       expiration_(when),
       interval_(interval),
       repeat_(interval > 0.0),
-      sequence_(s_numCreated_.incrementAndGet())
+      sequence_(s_numCreated_.incrementAndGet()),
+      wheelPrev_(NULL),
+      wheelNext_(NULL),
+      wheelSlot_(NULL),
+      wheelTick_(0)
   { }
 #endif
 
@@ -56,14 +64,25 @@ class Timer : boost::noncopyable
 
   void restart(Timestamp now);
 
+  /// Sets up a retired timer as a new one, with a new sequence.
+  void reuse(TimerCallback cb, Timestamp when, double interval);
+
   static int64_t numCreated() { return s_numCreated_.get(); }
 
  private:
-  const TimerCallback callback_;
+  // not const, a timer of TimingWheel is reused
+  TimerCallback callback_;
   Timestamp expiration_;
-  const double interval_;
-  const bool repeat_;
-  const int64_t sequence_;
+  double interval_;
+  bool repeat_;
+  int64_t sequence_;
+
+  // for TimingWheel, an intrusive list node, a retired timer has no slot
+  friend class TimingWheel;
+  Timer* wheelPrev_;
+  Timer* wheelNext_;
+  Timer** wheelSlot_;
+  int64_t wheelTick_;
 
   static AtomicInt64 s_numCreated_;
 };
@@ -14,8 +14,10 @@
 
 #include <muduo/base/Logging.h>
 #include <muduo/net/EventLoop.h>
+#include <muduo/net/LoopStats.h>
 #include <muduo/net/Timer.h>
 #include <muduo/net/TimerId.h>
+#include <muduo/net/TimingWheel.h>
 
 #include <boost/bind.hpp>
 
@@ -107,16 +109,18 @@ using namespace muduo::net::detail;
  * TimerQueue(EventLoop* loop)主要设置了timerfdChannel_的readCallback_并在timerfdChannel_上注册kReadEvent
  * 事件，timerfdChannel_中的fd在定时器超时的那一刻变得readable，即发生kReadEvent事件；
  */
-TimerQueue::TimerQueue(EventLoop* loop)
+TimerQueue::TimerQueue(EventLoop* loop, double tickSeconds)
   : loop_(loop),
     timerfd_(createTimerfd()),//createTimerfd 将时间变成了一个文件fd，该fd在timer超时的那一刻变得readable
     timerfdChannel_(loop, timerfd_),//利用timerfd_创建timerfdChannel_
     timers_(),//timers list
-    callingExpiredTimers_(false)
+    callingExpiredTimers_(false),
+    wheel_(tickSeconds > 0.0 ? new TimingWheel(tickSeconds, Timestamp::now()) : NULL)
 {
   timerfdChannel_.setReadCallback(
       boost::bind(&TimerQueue::handleRead, this));
   // we are always reading the timerfd, we disarm it with timerfd_settime.
+  timerfdChannel_.setKind("TimerQueue");
   timerfdChannel_.enableReading();
 }
 
@@ -148,7 +152,15 @@ TimerId TimerQueue::addTimer(const TimerCallback& cb,
                              double interval)
 {
   //创建新的timer，timer中指定了在何时调用Callback 
-  Timer* timer = new Timer(cb, when, interval);
+  Timer* timer = recycledTimer();
+  if (timer)
+  {
+    timer->reuse(cb, when, interval);
+  }
+  else
+  {
+    timer = new Timer(cb, when, interval);
+  }
   //addTimerInLoop 实际addTimer的函数....
   loop_->runInLoop(
       boost::bind(&TimerQueue::addTimerInLoop, this, timer));
@@ -160,13 +172,27 @@ TimerId TimerQueue::addTimer(TimerCallback&& cb,
                              Timestamp when,
                              double interval)
 {
-  Timer* timer = new Timer(std::move(cb), when, interval);
+  Timer* timer = recycledTimer();
+  if (timer)
+  {
+    timer->reuse(std::move(cb), when, interval);
+  }
+  else
+  {
+    timer = new Timer(std::move(cb), when, interval);
+  }
   loop_->runInLoop(
       boost::bind(&TimerQueue::addTimerInLoop, this, timer));
   return TimerId(timer, timer->sequence());
 }
 #endif
 
+// a retired timer of the wheel, in the loop thread only
+Timer* TimerQueue::recycledTimer()
+{
+  return wheel_ && loop_->isInLoopThread() ? wheel_->recycle() : NULL;
+}
+
 void TimerQueue::cancel(TimerId timerId)
 {
   loop_->runInLoop(
@@ -185,7 +211,7 @@ void TimerQueue::addTimerInLoop(Timer* timer)
   if (earliestChanged)
   {
     //重置定时器的超时时刻
-    resetTimerfd(timerfd_, timer->expiration());
+    resetTimerfd(timerfd_, wheel_ ? wheelExpiration_ : timer->expiration());
   }
 }
 
@@ -195,6 +221,18 @@ void TimerQueue::addTimerInLoop(Timer* timer)
 bool TimerQueue::insert(Timer* timer)
 {
   loop_->assertInLoopThread();
+  if (wheel_)
+  {
+    // the timerfd is set to the end of ticks
+    Timestamp when = wheel_->insert(timer, loop_->pollReturnTime());
+    if (!wheelExpiration_.valid() || when < wheelExpiration_)
+    {
+      wheelExpiration_ = when;
+      return true;
+    }
+    return false;
+  }
+
   assert(timers_.size() == activeTimers_.size());
   bool earliestChanged = false;
   Timestamp when = timer->expiration();
@@ -230,6 +268,18 @@ void TimerQueue::cancelInLoop(TimerId timerId)
   assert(timers_.size() == activeTimers_.size());
   //要取消的定时器timer
   ActiveTimer timer(timerId.timer_, timerId.sequence_);
+  if (wheel_)
+  {
+    if (wheel_->remove(timer.first, timer.second))
+    {
+      wheel_->retire(timer.first);
+    }
+    else if (callingExpiredTimers_)
+    {
+      cancelingTimers_.insert(timer);
+    }
+    return;
+  }
   //查找该定时器
   ActiveTimerSet::iterator it = activeTimers_.find(timer);
 
@@ -262,6 +312,14 @@ void TimerQueue::handleRead()
   //获取该时刻前所有的定时器列表，即超时的定时器列表；timerfd_关联着多个定时器的触发
   std::vector<Entry> expired = getExpired(now);
 
+  LoopStats* stats = loop_->stats();
+  stats->addTimersFired(static_cast<int>(expired.size()));
+  for (size_t i = 0; i < expired.size(); ++i)
+  {
+    stats->timerLag().add(now.microSecondsSinceEpoch()
+                          - expired[i].second->expiration().microSecondsSinceEpoch());
+  }
+
   callingExpiredTimers_ = true;
   cancelingTimers_.clear();
   // safe to callback outside critical section
@@ -283,6 +341,17 @@ std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
 {
   assert(timers_.size() == activeTimers_.size());
   std::vector<Entry> expired;
+  if (wheel_)
+  {
+    std::vector<Timer*> fired;
+    wheel_->advance(now, &fired);
+    expired.reserve(fired.size());
+    for (size_t i = 0; i < fired.size(); ++i)
+    {
+      expired.push_back(Entry(fired[i]->expiration(), fired[i]));
+    }
+    return expired;
+  }
   //UINTPTR_MAX 表示最大的地址
   Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
   //返回第一个未到期的timer的迭代器
@@ -327,11 +396,24 @@ void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now)
     {
       // FIXME move to a free list
       //一次性定时器或者已被取消的定时器是不能重置的，则应该删除该定时器
-      delete it->second; // FIXME: no delete please
+      if (wheel_)
+      {
+        // kept for reuse, and for cancel() of a stale TimerId
+        wheel_->retire(it->second);
+      }
+      else
+      {
+        delete it->second; // FIXME: no delete please
+      }
     }
   }
 
-  if (!timers_.empty())
+  if (wheel_)
+  {
+    nextExpire = wheel_->nextExpiration();
+    wheelExpiration_ = nextExpire;
+  }
+  else if (!timers_.empty())
   {
     //获取最早到期的定时器超时时间
     nextExpire = timers_.begin()->second->expiration();
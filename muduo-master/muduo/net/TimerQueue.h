@@ -15,6 +15,7 @@
 #include <vector>
 
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <muduo/base/Mutex.h>
 #include <muduo/base/Timestamp.h>
@@ -29,15 +30,20 @@ namespace net
 class EventLoop;
 class Timer;
 class TimerId;
+class TimingWheel;
 
 ///
 /// A best efforts timer queue.
 /// No guarantee that the callback will be on time.
 ///
+/// Timers are kept in a std::set by default, with @c tickSeconds > 0.0
+/// they are kept in a TimingWheel instead, inserting and canceling are
+/// O(1), but timers fire at the end of the tick, up to one tick late.
+///
 class TimerQueue : boost::noncopyable
 {
  public:
-  explicit TimerQueue(EventLoop* loop);
+  explicit TimerQueue(EventLoop* loop, double tickSeconds = 0.0);
   ~TimerQueue();
 
   ///
@@ -77,6 +83,7 @@ class TimerQueue : boost::noncopyable
   /**
    * 以下成员函数只可能在其所属的IO线程中调用，因而不必加锁，服务器性能杀手之一是锁竞争，尽可能少用锁
    */
+  Timer* recycledTimer();
   void addTimerInLoop(Timer* timer);
   void cancelInLoop(TimerId timerId);
   // called when timerfd alarms
@@ -101,6 +108,10 @@ class TimerQueue : boost::noncopyable
   ActiveTimerSet activeTimers_;
   bool callingExpiredTimers_; /* atomic   */ //是否正在处理超时事件
   ActiveTimerSet cancelingTimers_;//保存的是被取消的定时器
+
+  // used instead of timers_ and activeTimers_ if not null
+  boost::scoped_ptr<TimingWheel> wheel_;
+  Timestamp wheelExpiration_;  // timerfd_ is set to
 };
 
 }
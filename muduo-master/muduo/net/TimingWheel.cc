@@ -0,0 +1,238 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/TimingWheel.h>
+
+#include <muduo/net/Timer.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <string.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const int TimingWheel::kLevelBits;
+const int TimingWheel::kSlots;
+const int TimingWheel::kLevels;
+
+TimingWheel::TimingWheel(double tickSeconds, Timestamp start)
+  : tickMicroSeconds_(std::max(static_cast<int64_t>(tickSeconds * Timestamp::kMicroSecondsPerSecond),
+                               implicit_cast<int64_t>(1))),
+    start_(start),
+    currentTick_(0),
+    size_(0),
+    retired_(NULL)
+{
+  ::bzero(slots_, sizeof slots_);
+}
+
+TimingWheel::~TimingWheel()
+{
+  for (int level = 0; level < kLevels; ++level)
+  {
+    for (int slot = 0; slot < kSlots; ++slot)
+    {
+      Timer* timer = slots_[level][slot];
+      while (timer)
+      {
+        Timer* next = timer->wheelNext_;
+        delete timer;
+        timer = next;
+      }
+    }
+  }
+  while (retired_)
+  {
+    Timer* next = retired_->wheelNext_;
+    delete retired_;
+    retired_ = next;
+  }
+}
+
+int64_t TimingWheel::tickOf(Timestamp when) const
+{
+  int64_t delta = when.microSecondsSinceEpoch() - start_.microSecondsSinceEpoch();
+  return delta <= 0 ? 0 : (delta + tickMicroSeconds_ - 1) / tickMicroSeconds_;
+}
+
+// ticks ended by now
+int64_t TimingWheel::elapsedTicks(Timestamp now) const
+{
+  return (now.microSecondsSinceEpoch() - start_.microSecondsSinceEpoch()) / tickMicroSeconds_;
+}
+
+Timestamp TimingWheel::timeOf(int64_t tick) const
+{
+  return Timestamp(start_.microSecondsSinceEpoch() + tick * tickMicroSeconds_);
+}
+
+Timestamp TimingWheel::insert(Timer* timer, Timestamp now)
+{
+  if (size_ == 0)
+  {
+    // nothing to fire or cascade, skips ticks passed while idle,
+    // which advance() would otherwise walk one by one.
+    currentTick_ = std::max(currentTick_, elapsedTicks(now));
+  }
+  timer->wheelTick_ = std::max(tickOf(timer->expiration()), currentTick_ + 1);
+  link(timer);
+  ++size_;
+  return timeOf(timer->wheelTick_);
+}
+
+bool TimingWheel::remove(Timer* timer, int64_t sequence)
+{
+  // fired, removed or reused since
+  if (timer->wheelSlot_ == NULL || timer->sequence() != sequence)
+  {
+    return false;
+  }
+  unlink(timer);
+  --size_;
+  return true;
+}
+
+void TimingWheel::retire(Timer* timer)
+{
+  assert(timer->wheelSlot_ == NULL);
+  timer->callback_.clear();
+  timer->wheelNext_ = retired_;
+  retired_ = timer;
+}
+
+Timer* TimingWheel::recycle()
+{
+  Timer* timer = retired_;
+  if (timer)
+  {
+    retired_ = timer->wheelNext_;
+    timer->wheelNext_ = NULL;
+  }
+  return timer;
+}
+
+void TimingWheel::advance(Timestamp now, std::vector<Timer*>* expired)
+{
+  const int64_t target = elapsedTicks(now);
+  while (currentTick_ < target)
+  {
+    if (size_ == 0)
+    {
+      currentTick_ = target;
+      break;
+    }
+
+    ++currentTick_;
+    const int index = static_cast<int>(currentTick_ & (kSlots-1));
+    if (index == 0)
+    {
+      // level 0 wraps around, moves down timers of next 64 ticks
+      for (int level = 1; level < kLevels; ++level)
+      {
+        const int slot = static_cast<int>((currentTick_ >> (kLevelBits*level)) & (kSlots-1));
+        cascade(level, slot);
+        if (slot != 0)
+        {
+          break;
+        }
+      }
+    }
+
+    Timer* timer = slots_[0][index];
+    slots_[0][index] = NULL;
+    while (timer)
+    {
+      assert(timer->wheelTick_ == currentTick_);
+      Timer* next = timer->wheelNext_;
+      timer->wheelPrev_ = timer->wheelNext_ = NULL;
+      timer->wheelSlot_ = NULL;
+      --size_;
+      expired->push_back(timer);
+      timer = next;
+    }
+  }
+}
+
+Timestamp TimingWheel::nextExpiration() const
+{
+  if (size_ == 0)
+  {
+    return Timestamp::invalid();
+  }
+  // looks no further than the next cascading, so an idle wheel
+  // wakes up once per 64 ticks at most.
+  int64_t tick = currentTick_ + 1;
+  while ((tick & (kSlots-1)) != 0 && slots_[0][tick & (kSlots-1)] == NULL)
+  {
+    ++tick;
+  }
+  return timeOf(tick);
+}
+
+void TimingWheel::link(Timer* timer)
+{
+  int64_t tick = timer->wheelTick_;
+  const int64_t delta = tick - currentTick_;
+  assert(delta >= 0);
+  int level = 0;
+  while (level < kLevels-1 && delta >= (implicit_cast<int64_t>(1) << (kLevelBits*(level+1))))
+  {
+    ++level;
+  }
+  const int64_t span = implicit_cast<int64_t>(1) << (kLevelBits*kLevels);
+  if (delta >= span)
+  {
+    // too far away, parks at the last slot and is cascaded again
+    tick = currentTick_ + span - 1;
+  }
+
+  const int slot = static_cast<int>((tick >> (kLevelBits*level)) & (kSlots-1));
+  Timer** head = &slots_[level][slot];
+  timer->wheelSlot_ = head;
+  timer->wheelPrev_ = NULL;
+  timer->wheelNext_ = *head;
+  if (*head)
+  {
+    (*head)->wheelPrev_ = timer;
+  }
+  *head = timer;
+}
+
+void TimingWheel::unlink(Timer* timer)
+{
+  assert(timer->wheelSlot_);
+  if (timer->wheelPrev_)
+  {
+    timer->wheelPrev_->wheelNext_ = timer->wheelNext_;
+  }
+  else
+  {
+    assert(*timer->wheelSlot_ == timer);
+    *timer->wheelSlot_ = timer->wheelNext_;
+  }
+  if (timer->wheelNext_)
+  {
+    timer->wheelNext_->wheelPrev_ = timer->wheelPrev_;
+  }
+  timer->wheelPrev_ = timer->wheelNext_ = NULL;
+  timer->wheelSlot_ = NULL;
+}
+
+void TimingWheel::cascade(int level, int slot)
+{
+  Timer* timer = slots_[level][slot];
+  slots_[level][slot] = NULL;
+  while (timer)
+  {
+    Timer* next = timer->wheelNext_;
+    link(timer);
+    timer = next;
+  }
+}
@@ -0,0 +1,93 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_TIMINGWHEEL_H
+#define MUDUO_NET_TIMINGWHEEL_H
+
+#include <muduo/base/Timestamp.h>
+
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+class Timer;
+
+///
+/// Hierarchical timing wheel, storage of TimerQueue with O(1) insert and remove.
+///
+/// Time is divided into ticks, a timer fires in the first tick that
+/// ends after its expiration, so it is late by less than one tick.
+/// Level 0 has one slot per tick for the next 64 ticks, each upper level
+/// has 64 slots spanning 64 times longer, whose timers are moved down
+/// (cascaded) when the lower level wraps around.
+///
+/// Timers fired or removed are retired to the wheel, not freed, so a stale
+/// TimerId still points to a Timer, whose sequence tells it apart.
+/// They are reused by recycle(), and freed with the wheel.
+///
+/// Not thread safe, it is always accessed in the loop thread.
+class TimingWheel : boost::noncopyable
+{
+ public:
+  static const int kLevelBits = 6;
+  static const int kSlots = 1 << kLevelBits;
+  static const int kLevels = 5;  // 2^30 ticks, 12 days at 1ms
+
+  TimingWheel(double tickSeconds, Timestamp start);
+  ~TimingWheel();  // deletes pending and retired timers
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  /// Takes ownership of timer, an empty wheel catches up with @c now first.
+  /// @return the end of the tick it fires in.
+  Timestamp insert(Timer* timer, Timestamp now);
+
+  /// Removes timer if it is still pending, the caller retires it.
+  /// @c timer must be one inserted to this wheel, pending or retired.
+  bool remove(Timer* timer, int64_t sequence);
+
+  /// Takes a timer which fired or was removed, drops its callback.
+  void retire(Timer* timer);
+
+  /// A retired timer to be set up by Timer::reuse(), NULL if none.
+  Timer* recycle();
+
+  /// Moves out timers which fire by @c now, ownership is passed to caller.
+  void advance(Timestamp now, std::vector<Timer*>* expired);
+
+  /// When advance() has something to do next, either firing timers or
+  /// cascading, invalid if empty.
+  Timestamp nextExpiration() const;
+
+ private:
+  int64_t tickOf(Timestamp when) const;
+  int64_t elapsedTicks(Timestamp now) const;
+  Timestamp timeOf(int64_t tick) const;
+  void link(Timer* timer);
+  void unlink(Timer* timer);
+  void cascade(int level, int slot);
+
+  const int64_t tickMicroSeconds_;
+  const Timestamp start_;
+  int64_t currentTick_;  // last tick processed
+  Timer* slots_[kLevels][kSlots];  // heads of doubly linked lists
+  size_t size_;  // pending timers
+  Timer* retired_;  // singly linked by wheelNext_
+};
+
+}
+}
+#endif  // MUDUO_NET_TIMINGWHEEL_H
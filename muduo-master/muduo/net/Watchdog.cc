@@ -0,0 +1,355 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/Watchdog.h>
+
+#include <muduo/base/Exception.h>
+#include <muduo/base/Logging.h>
+#include <muduo/base/Singleton.h>
+#include <muduo/net/Channel.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/LoopStats.h>
+
+#include <boost/bind.hpp>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <execinfo.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>  // bzero
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const size_t Watchdog::kMaxReports;
+
+namespace
+{
+const int kMaxFrames = 64;
+const int kWaitCaptureMs = 100;
+
+int stackSignal()
+{
+  return SIGRTMIN + 1;
+}
+
+// low bits of StackCapture::state, the rest is the sequence number
+enum CaptureStatus { kPending, kWriting, kCaptured, kMissed };
+
+int64_t captureTag(int seq)
+{
+  return static_cast<int64_t>(static_cast<uint32_t>(seq)) << 2;
+}
+
+// filled by the signal handler in the loop thread,
+// one capture at a time, by the watchdog thread.
+// the signal carries the sequence number, a late one can't claim a newer capture.
+struct StackCapture
+{
+  EventLoop* loop;
+  const int64_t* watched;  // callbackStart_ or iterationStart_ of loop
+  int64_t start;
+  int64_t state;  /* atomic, captureTag(seq) | CaptureStatus */
+  int numFrames;
+  void* frames[kMaxFrames];
+  char what[128];
+};
+
+StackCapture g_capture;
+
+// async-signal-safe strncat
+void append(char* buf, size_t len, const char* str, size_t n)
+{
+  size_t pos = ::strlen(buf);
+  n = pos + n < len ? n : len - pos - 1;
+  ::memcpy(buf + pos, str, n);
+  buf[pos + n] = '\0';
+}
+
+}
+
+Watchdog& Watchdog::instance()
+{
+  return Singleton<Watchdog>::instance();
+}
+
+Watchdog::Watchdog()
+  : checkMutex_(),
+    mutex_(),
+    cond_(mutex_),
+    seq_(0),
+    thread_(boost::bind(&Watchdog::threadFunc, this), "Watchdog")
+{
+  // backtrace() loads libgcc on first call, which is not safe in a handler
+  void* frames[1];
+  ::backtrace(frames, 1);
+
+  struct sigaction sa;
+  ::bzero(&sa, sizeof sa);
+  sa.sa_sigaction = &Watchdog::captureStack;
+  sa.sa_flags = SA_RESTART | SA_SIGINFO;
+  ::sigemptyset(&sa.sa_mask);
+  if (::sigaction(stackSignal(), &sa, NULL) < 0)
+  {
+    LOG_SYSERR << "Watchdog::Watchdog sigaction";
+  }
+  thread_.start();
+}
+
+Watchdog::~Watchdog()
+{
+}
+
+void Watchdog::no_destroy()
+{
+}
+
+void Watchdog::add(EventLoop* loop)
+{
+  MutexLockGuard lock(mutex_);
+  loops_[loop] = Reported();
+  cond_.notify();
+}
+
+void Watchdog::remove(EventLoop* loop)
+{
+  // waits for a check in progress, so the loop is never checked after this
+  MutexLockGuard checking(checkMutex_);
+  MutexLockGuard lock(mutex_);
+  loops_.erase(loop);
+}
+
+void Watchdog::report(const string& message)
+{
+  MutexLockGuard lock(mutex_);
+  appendReport(message);
+}
+
+string Watchdog::reports() const
+{
+  string result;
+  MutexLockGuard lock(mutex_);
+  for (std::deque<string>::const_iterator it = reports_.begin();
+       it != reports_.end(); ++it)
+  {
+    result += *it;
+    result += '\n';
+  }
+  return result;
+}
+
+void Watchdog::appendReport(const string& message)
+{
+  mutex_.assertLocked();
+  reports_.push_back(Timestamp::now().toFormattedString() + " " + message);
+  if (reports_.size() > kMaxReports)
+  {
+    reports_.pop_front();
+  }
+}
+
+void Watchdog::threadFunc()
+{
+  while (true)
+  {
+    {
+      MutexLockGuard lock(mutex_);
+      while (loops_.empty())
+      {
+        cond_.wait();
+      }
+
+      // checks twice per the smallest threshold, so a slow callback is
+      // caught by 1.5x threshold at most
+      int64_t interval = 0;
+      for (LoopMap::const_iterator it = loops_.begin(); it != loops_.end(); ++it)
+      {
+        int64_t threshold = it->first->slowThresholdUs_;
+        if (interval == 0 || threshold < interval)
+        {
+          interval = threshold;
+        }
+      }
+      interval = std::max(interval / 2, static_cast<int64_t>(1000));
+      cond_.waitForSeconds(static_cast<double>(interval) / Timestamp::kMicroSecondsPerSecond);
+    }
+
+    // waiting for a capture doesn't hold mutex_, loops keep reporting,
+    // and can't be removed while checked.
+    MutexLockGuard checking(checkMutex_);
+    LoopMap loops;
+    {
+      MutexLockGuard lock(mutex_);
+      loops = loops_;
+    }
+    int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    for (LoopMap::iterator it = loops.begin(); it != loops.end(); ++it)
+    {
+      EventLoop* loop = it->first;
+      Reported& reported = it->second;
+      reported.callback = check(loop, &loop->callbackStart_, reported.callback, now, NULL);
+      // an iteration which has a slow callback is reported for that callback
+      int64_t iteration = __atomic_load_n(&loop->iterationStart_, __ATOMIC_ACQUIRE);
+      if (reported.callback >= iteration)
+      {
+        reported.iteration = iteration;
+      }
+      reported.iteration = check(loop, &loop->iterationStart_, reported.iteration, now,
+                                 "iteration");
+    }
+    MutexLockGuard lock(mutex_);
+    for (LoopMap::const_iterator it = loops.begin(); it != loops.end(); ++it)
+    {
+      LoopMap::iterator found = loops_.find(it->first);
+      if (found != loops_.end())
+      {
+        found->second = it->second;
+      }
+    }
+  }
+}
+
+int64_t Watchdog::check(EventLoop* loop, const int64_t* watched, int64_t reported,
+                        int64_t now, const char* what)
+{
+  checkMutex_.assertLocked();
+  int64_t start = __atomic_load_n(watched, __ATOMIC_ACQUIRE);
+  if (start == 0 || start == reported || now - start < loop->slowThresholdUs_)
+  {
+    return reported;
+  }
+
+  if (!capture(loop, watched, start))
+  {
+    // finished meanwhile, or blocked the signal
+    return start;
+  }
+
+  char buf[64];
+  snprintf(buf, sizeof buf, " running for %.1f ms",
+           static_cast<double>(now - start) / 1000.0);
+  string message = loop->stats_->name() + " ";
+  if (what)
+  {
+    message += what;
+    message += buf;
+    message += ", now in ";
+    message += g_capture.what;
+  }
+  else
+  {
+    message += g_capture.what;
+    message += buf;
+  }
+  message += '\n';
+  message += Exception::stackTrace(g_capture.frames, g_capture.numFrames);
+  LOG_WARN << "Slow " << (what ? what : "callback") << " in " << message;
+  MutexLockGuard lock(mutex_);
+  appendReport(message);
+  return start;
+}
+
+bool Watchdog::capture(EventLoop* loop, const int64_t* watched, int64_t start)
+{
+  const int seq = ++seq_;
+  const int64_t tag = captureTag(seq);
+  g_capture.loop = loop;
+  g_capture.watched = watched;
+  g_capture.start = start;
+  g_capture.numFrames = 0;
+  g_capture.what[0] = '\0';
+  __atomic_store_n(&g_capture.state, tag | kPending, __ATOMIC_SEQ_CST);
+
+  siginfo_t info;
+  ::bzero(&info, sizeof info);
+  info.si_signo = stackSignal();
+  info.si_code = SI_QUEUE;
+  info.si_pid = ::getpid();
+  info.si_uid = ::getuid();
+  info.si_value.sival_int = seq;
+  if (::syscall(SYS_rt_tgsigqueueinfo, ::getpid(), loop->threadId_, stackSignal(), &info) < 0)
+  {
+    LOG_SYSERR << "Watchdog::capture rt_tgsigqueueinfo";
+    __atomic_store_n(&g_capture.state, tag | kMissed, __ATOMIC_SEQ_CST);
+    return false;
+  }
+
+  int64_t state = tag | kPending;
+  for (int i = 0; i < kWaitCaptureMs && state == (tag | kPending); ++i)
+  {
+    ::usleep(1000);
+    state = __atomic_load_n(&g_capture.state, __ATOMIC_ACQUIRE);
+  }
+  // gives up, unless the handler has claimed it
+  if (state == (tag | kPending)
+      && __atomic_compare_exchange_n(&g_capture.state, &state, tag | kMissed,
+                                     false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE))
+  {
+    return false;
+  }
+  // the handler is not blocked by anything, it finishes soon
+  while (state == (tag | kWriting))
+  {
+    ::sched_yield();
+    state = __atomic_load_n(&g_capture.state, __ATOMIC_ACQUIRE);
+  }
+  return state == (tag | kCaptured);
+}
+
+void Watchdog::captureStack(int, siginfo_t* info, void*)
+{
+  int savedErrno = errno;
+  const int64_t tag = captureTag(info->si_value.sival_int);
+  int64_t expected = tag | kPending;
+  // a signal of an older capture, which was given up, fails here
+  if (info->si_code == SI_QUEUE
+      && __atomic_compare_exchange_n(&g_capture.state, &expected, tag | kWriting,
+                                     false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+  {
+    int status = kMissed;
+    EventLoop* loop = EventLoop::getEventLoopOfCurrentThread();
+    if (loop != NULL
+        && loop == g_capture.loop
+        && __atomic_load_n(g_capture.watched, __ATOMIC_RELAXED) == g_capture.start)
+    {
+      g_capture.numFrames = ::backtrace(g_capture.frames, kMaxFrames);
+      // the channel is alive while its handler runs
+      Channel* channel = loop->currentActiveChannel_;
+      if (__atomic_load_n(&loop->callbackStart_, __ATOMIC_RELAXED) == 0)
+      {
+        // between callbacks of a slow iteration
+        const char kLoop[] = "EventLoop";
+        append(g_capture.what, sizeof g_capture.what, kLoop, sizeof kLoop - 1);
+      }
+      else if (channel != NULL)
+      {
+        append(g_capture.what, sizeof g_capture.what, channel->kind(), ::strlen(channel->kind()));
+        const string* owner = channel->ownerName();
+        if (owner != NULL)
+        {
+          append(g_capture.what, sizeof g_capture.what, " ", 1);
+          append(g_capture.what, sizeof g_capture.what, owner->data(), owner->size());
+        }
+      }
+      else
+      {
+        const char kFunctor[] = "pending functor";
+        append(g_capture.what, sizeof g_capture.what, kFunctor, sizeof kFunctor - 1);
+      }
+      status = kCaptured;
+    }
+    __atomic_store_n(&g_capture.state, tag | status, __ATOMIC_RELEASE);
+  }
+  errno = savedErrno;
+}
@@ -0,0 +1,94 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_WATCHDOG_H
+#define MUDUO_NET_WATCHDOG_H
+
+#include <muduo/base/Condition.h>
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Thread.h>
+
+#include <deque>
+#include <map>
+
+#include <boost/noncopyable.hpp>
+
+#include <signal.h>
+
+namespace muduo
+{
+namespace net
+{
+
+class EventLoop;
+
+///
+/// Watches EventLoops with EventLoop::setSlowThreshold(), in a thread
+/// of its own. When a loop is stuck in one callback, or in one iteration
+/// of many callbacks, for longer than the threshold, it signals the loop
+/// thread to capture the stack, and logs it with what the callback is,
+/// eg. "TcpConnection name".
+///
+/// The loop only stores the start time of each callback and iteration,
+/// nothing else happens until one is slow. The signal is SIGRTMIN+1,
+/// a blocking syscall in the slow callback may return EINTR.
+///
+class Watchdog : boost::noncopyable
+{
+ public:
+  static const size_t kMaxReports = 16;
+
+  static Watchdog& instance();
+
+  Watchdog();
+  ~Watchdog();
+  void no_destroy();  // for Singleton, the thread runs until exit
+
+  /// Thread safe.
+  void add(EventLoop* loop);
+  void remove(EventLoop* loop);
+
+  /// Keeps the recent kMaxReports slow callbacks, for Inspector,
+  /// loops report those finished late here.
+  void report(const string& message);
+  string reports() const;
+
+ private:
+  // starts of the last slow callback and iteration reported
+  struct Reported
+  {
+    Reported() : callback(0), iteration(0) { }
+    int64_t callback;
+    int64_t iteration;
+  };
+  typedef std::map<EventLoop*, Reported> LoopMap;
+
+  void threadFunc();
+  // returns start of the callback or iteration checked
+  int64_t check(EventLoop* loop, const int64_t* watched, int64_t reported,
+                int64_t now, const char* what);
+  bool capture(EventLoop* loop, const int64_t* watched, int64_t start);
+  void appendReport(const string& message);
+  static void captureStack(int signo, siginfo_t* info, void* context);
+
+  // held while checking, remove() waits for it, report() doesn't
+  MutexLock checkMutex_;
+  mutable MutexLock mutex_;
+  Condition cond_;
+  LoopMap loops_;
+  std::deque<string> reports_;
+  int seq_;  // of captures, in watchdog thread
+  Thread thread_;
+};
+
+}
+}
+
+#endif  // MUDUO_NET_WATCHDOG_H
@@ -41,17 +41,20 @@ class ZlibInputStream : boost::noncopyable
   int zerror_;
 };
 
-// input is uncompressed data, output zlib compressed data
+// input is uncompressed data, output zlib compressed data,
+// or gzip, eg. for "Content-Encoding: gzip" of HTTP
 class ZlibOutputStream : boost::noncopyable
 {
  public:
-  explicit ZlibOutputStream(Buffer* output)
+  explicit ZlibOutputStream(Buffer* output, bool gzip = false)
     : output_(output),
       zerror_(Z_OK),
       bufferSize_(1024)
   {
     bzero(&zstream_, sizeof zstream_);
-    zerror_ = deflateInit(&zstream_, Z_DEFAULT_COMPRESSION);
+    // 16 more window bits for a gzip header and trailer
+    zerror_ = deflateInit2(&zstream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                           gzip ? MAX_WBITS + 16 : MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
   }
 
   ~ZlibOutputStream()
@@ -9,6 +9,13 @@
 
 #include <muduo/net/Buffer.h>
 #include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpScanner.h>
+
+#include <algorithm>
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
 
 using namespace muduo;
 using namespace muduo::net;
@@ -17,14 +24,14 @@ bool HttpContext::processRequestLine(const char* begin, const char* end)
 {
   bool succeed = false;
   const char* start = begin;
-  const char* space = std::find(start, end, ' ');
+  const char* space = detail::findEither(start, end, ' ', ' ');
   if (space != end && request_.setMethod(start, space))
   {
     start = space+1;
-    space = std::find(start, end, ' ');
+    const char* question = detail::findEither(start, end, ' ', '?');
+    space = *question == '?' ? detail::findEither(question, end, ' ', ' ') : question;
     if (space != end)
     {
-      const char* question = std::find(start, space, '?');
       if (question != space)
       {
         request_.setPath(start, question);
@@ -56,62 +63,295 @@ bool HttpContext::processRequestLine(const char* begin, const char* end)
   return succeed;
 }
 
+namespace
+{
+
+const size_t kMaxChunkSizeLine = 1024;
+
+// header values are case-insensitive, so are tokens in them
+bool equalsIgnoreCase(const char* begin, const char* end, const char* token)
+{
+  size_t len = strlen(token);
+  return static_cast<size_t>(end - begin) == len && strncasecmp(begin, token, len) == 0;
+}
+
+bool containsToken(const char* begin, const char* end, const char* token)
+{
+  while (begin < end)
+  {
+    const char* comma = std::find(begin, end, ',');
+    const char* last = comma;
+    while (begin < last && isspace(*begin))
+      ++begin;
+    while (begin < last && isspace(*(last-1)))
+      --last;
+    if (equalsIgnoreCase(begin, last, token))
+    {
+      return true;
+    }
+    begin = comma == end ? end : comma + 1;
+  }
+  return false;
+}
+
+}
+
+// [begin, end) are the request line and headers, till the empty line,
+// scanned a line at a time, headers are offsets into the copy
+bool HttpContext::processHeaders(const char* begin, const char* end)
+{
+  request_.setHeaderBlock(begin, end);
+  // every CR is followed by one more byte, end is "\r\n\r\n"
+  const char* eol = detail::findEither(begin, end, '\r', '\r');
+  if (eol[1] != '\n' || !processRequestLine(begin, eol))
+  {
+    return fail(400);
+  }
+  const char* p = eol + 2;
+  while (true)
+  {
+    const char* colon = detail::findEither(p, end, ':', '\r');
+    if (*colon == '\r')
+    {
+      if (colon == p && colon[1] == '\n')
+      {
+        break;  // empty line, end of header
+      }
+      return fail(400);
+    }
+    eol = detail::findEither(colon + 1, end, '\r', '\r');
+    if (eol[1] != '\n' || colon == p || isspace(*p))
+    {
+      return fail(400);  // obsolete line folding too
+    }
+    const char* value = colon + 1;
+    while (value < eol && isspace(*value))
+      ++value;
+    const char* valueEnd = eol;
+    while (value < valueEnd && isspace(*(valueEnd-1)))
+      --valueEnd;
+    request_.indexHeader(p - begin, colon - begin, value - begin, valueEnd - begin);
+    if (!processHeader(p, colon, value, valueEnd))
+    {
+      return false;
+    }
+    p = eol + 2;
+  }
+  return processHeadersEnd();
+}
+
+// framing headers
+bool HttpContext::processHeader(const char* begin, const char* colon,
+                                const char* value, const char* valueEnd)
+{
+  bool ok = true;
+  if (equalsIgnoreCase(begin, colon, "Content-Length"))
+  {
+    // digits only, a second one smells of request smuggling
+    if (value == valueEnd || hasContentLength_)
+    {
+      return fail(400);
+    }
+    size_t length = 0;
+    for (const char* p = value; p < valueEnd; ++p)
+    {
+      if (!isdigit(*p))
+      {
+        return fail(400);
+      }
+      length = length * 10 + (*p - '0');
+      if (length > maxBodySize_)
+      {
+        return fail(413);
+      }
+    }
+    hasContentLength_ = true;
+    contentLength_ = length;
+  }
+  else if (equalsIgnoreCase(begin, colon, "Transfer-Encoding"))
+  {
+    // only chunked is supported, no gzip
+    chunked_ = equalsIgnoreCase(value, valueEnd, "chunked");
+    ok = chunked_ || fail(400);
+  }
+  else if (equalsIgnoreCase(begin, colon, "Connection"))
+  {
+    connectionClose_ = connectionClose_ || containsToken(value, valueEnd, "close");
+    connectionKeepAlive_ = connectionKeepAlive_ || containsToken(value, valueEnd, "keep-alive");
+  }
+  else if (equalsIgnoreCase(begin, colon, "Expect"))
+  {
+    expectContinue_ = equalsIgnoreCase(value, valueEnd, "100-continue");
+  }
+  return ok;
+}
+
+bool HttpContext::processHeadersEnd()
+{
+  if (chunked_ && hasContentLength_)
+  {
+    // request smuggling, RFC 7230 3.3.3
+    return fail(400);
+  }
+  if (chunked_)
+  {
+    state_ = kExpectChunkSize;
+  }
+  else if (contentLength_ > 0)
+  {
+    state_ = kExpectBody;
+  }
+  else
+  {
+    state_ = kGotAll;
+  }
+  return true;
+}
+
+// hex digits, then chunk extensions, which are ignored
+bool HttpContext::processChunkSize(const char* begin, const char* end)
+{
+  size_t size = 0;
+  const char* p = begin;
+  for (; p < end && isxdigit(*p); ++p)
+  {
+    size = size * 16 + (isdigit(*p) ? *p - '0' : tolower(*p) - 'a' + 10);
+    if (size > maxBodySize_)
+    {
+      return fail(413);
+    }
+  }
+  if (p == begin || (p < end && *p != ';' && *p != ' ' && *p != '\t'))
+  {
+    return fail(400);
+  }
+  if (request_.body().size() + size > maxBodySize_)
+  {
+    return fail(413);
+  }
+  chunkLeft_ = size;
+  state_ = size > 0 ? kExpectChunkData : kExpectTrailers;
+  return true;
+}
+
 // return false if any error
 bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime)
 {
+  lastReceiveTime_ = receiveTime;
+  if (bodyInBuffer_ > 0 && state_ != kGotAll)
+  {
+    // the body of the last request, which is done
+    buf->retrieve(std::min(bodyInBuffer_, buf->readableBytes()));
+    bodyInBuffer_ = 0;
+  }
+
   bool ok = true;
   bool hasMore = true;
-  while (hasMore)
+  while (ok && hasMore)
   {
-    if (state_ == kExpectRequestLine)
+    if (state_ == kExpectRequestLine || state_ == kExpectHeaders)
     {
-      const char* crlf = buf->findCRLF();
-      if (crlf)
+      // all headers at once, rescans only new data
+      const char* begin = buf->peek();
+      const char* end = detail::findHeadersEnd(begin + scanned_, buf->beginWrite());
+      if (end == NULL)
       {
-        ok = processRequestLine(buf->peek(), crlf);
-        if (ok)
+        scanned_ = buf->readableBytes() > 3 ? buf->readableBytes() - 3 : 0;
+        ok = buf->readableBytes() <= maxHeaderSize_ || fail(431);
+        hasMore = false;
+      }
+      else
+      {
+        scanned_ = 0;
+        ok = static_cast<size_t>(end - begin) <= maxHeaderSize_ || fail(431);
+        if (ok && processHeaders(begin, end))
         {
           request_.setReceiveTime(receiveTime);
-          buf->retrieveUntil(crlf + 2);
-          state_ = kExpectHeaders;
         }
         else
         {
-          hasMore = false;
+          ok = false;
         }
-      }
-      else
-      {
-        hasMore = false;
+        buf->retrieveUntil(end);
       }
     }
-    else if (state_ == kExpectHeaders)
+    else if (state_ == kExpectTrailers || state_ == kExpectChunkSize)
     {
       const char* crlf = buf->findCRLF();
-      if (crlf)
+      if (crlf == NULL)
       {
-        const char* colon = std::find(buf->peek(), crlf, ':');
-        if (colon != crlf)
+        // a line too long for us
+        if (state_ == kExpectChunkSize)
         {
-          request_.addHeader(buf->peek(), colon, crlf);
+          ok = buf->readableBytes() <= kMaxChunkSizeLine || fail(400);
         }
         else
         {
-          // empty line, end of header
-          // FIXME:
+          ok = headerSize_ + buf->readableBytes() <= maxHeaderSize_ || fail(431);
+        }
+        hasMore = false;
+        continue;
+      }
+
+      if (state_ == kExpectChunkSize)
+      {
+        ok = processChunkSize(buf->peek(), crlf);
+      }
+      else
+      {
+        // trailers are ignored, until an empty line
+        headerSize_ += crlf + 2 - buf->peek();
+        ok = headerSize_ <= maxHeaderSize_ || fail(431);
+        if (crlf == buf->peek())
+        {
           state_ = kGotAll;
-          hasMore = false;
         }
-        buf->retrieveUntil(crlf + 2);
+      }
+      buf->retrieveUntil(crlf + 2);
+    }
+    else if (state_ == kExpectBody)
+    {
+      // waits for all of it, then no copying
+      if (buf->readableBytes() >= contentLength_)
+      {
+        request_.setBodyInBuffer(buf->peek(), buf->peek() + contentLength_);
+        bodyInBuffer_ = contentLength_;
+        state_ = kGotAll;
+      }
+      hasMore = false;
+    }
+    else if (state_ == kExpectChunkData)
+    {
+      size_t n = std::min(chunkLeft_, buf->readableBytes());
+      request_.appendBody(buf->peek(), n);
+      buf->retrieve(n);
+      chunkLeft_ -= n;
+      if (chunkLeft_ == 0)
+      {
+        state_ = kExpectChunkEnd;
       }
       else
       {
         hasMore = false;
       }
     }
-    else if (state_ == kExpectBody)
+    else if (state_ == kExpectChunkEnd)
+    {
+      if (buf->readableBytes() < 2)
+      {
+        hasMore = false;
+      }
+      else
+      {
+        ok = (buf->peek()[0] == '\r' && buf->peek()[1] == '\n') || fail(400);
+        buf->retrieve(2);
+        state_ = kExpectChunkSize;
+      }
+    }
+    else
     {
-      // FIXME:
+      // kGotAll, reset() first
+      hasMore = false;
     }
   }
   return ok;
@@ -30,27 +30,98 @@ class HttpContext : public muduo::copyable
     kExpectRequestLine,
     kExpectHeaders,
     kExpectBody,
+    kExpectChunkSize,
+    kExpectChunkData,
+    kExpectChunkEnd,
+    kExpectTrailers,
     kGotAll,
   };
 
+  static const size_t kDefaultMaxHeaderSize = 64 * 1024;
+  static const size_t kDefaultMaxBodySize = 8 * 1024 * 1024;
+
   HttpContext()
-    : state_(kExpectRequestLine)
+    : state_(kExpectRequestLine),
+      maxHeaderSize_(kDefaultMaxHeaderSize),
+      maxBodySize_(kDefaultMaxBodySize),
+      headerSize_(0),
+      scanned_(0),
+      contentLength_(0),
+      chunkLeft_(0),
+      bodyInBuffer_(0),
+      errorStatus_(0),
+      numRequests_(0),
+      hasContentLength_(false),
+      chunked_(false),
+      connectionClose_(false),
+      connectionKeepAlive_(false),
+      expectContinue_(false)
   {
   }
 
   // default copy-ctor, dtor and assignment are fine
 
-  // return false if any error
+  // the request line and headers, 431 if larger
+  void setMaxHeaderSize(size_t size)
+  { maxHeaderSize_ = size; }
+
+  // 413 if larger
+  void setMaxBodySize(size_t size)
+  { maxBodySize_ = size; }
+
+  // return false if any error, see errorStatus().
+  // Parses incrementally, call it again when more data arrives,
+  // a Content-Length body is left in buf until the next call.
   bool parseRequest(Buffer* buf, Timestamp receiveTime);
 
   bool gotAll() const
   { return state_ == kGotAll; }
 
+  // 400, 413 or 431, after parseRequest() returns false
+  int errorStatus() const
+  { return errorStatus_; }
+
+  // the client waits for "100 Continue" before it sends the body
+  bool expectContinue() const
+  { return expectContinue_ && state_ != kGotAll; }
+
+  void clearExpectContinue()
+  { expectContinue_ = false; }
+
+  // HTTP/1.1 unless "Connection: close", HTTP/1.0 if "Connection: keep-alive"
+  bool keepAlive() const
+  {
+    return request_.getVersion() == HttpRequest::kHttp11
+      ? !connectionClose_ : connectionKeepAlive_;
+  }
+
+  // requests done on this connection, by reset()
+  int numRequests() const
+  { return numRequests_; }
+
+  // invalid if nothing received
+  Timestamp lastReceiveTime() const
+  { return lastReceiveTime_; }
+
   void reset()
   {
+    if (state_ == kGotAll)
+    {
+      ++numRequests_;
+    }
     state_ = kExpectRequestLine;
     HttpRequest dummy;
     request_.swap(dummy);
+    headerSize_ = 0;
+    scanned_ = 0;
+    contentLength_ = 0;
+    chunkLeft_ = 0;
+    errorStatus_ = 0;
+    hasContentLength_ = false;
+    chunked_ = false;
+    connectionClose_ = false;
+    connectionKeepAlive_ = false;
+    expectContinue_ = false;
   }
 
   const HttpRequest& request() const
@@ -61,9 +132,34 @@ class HttpContext : public muduo::copyable
 
  private:
   bool processRequestLine(const char* begin, const char* end);
+  bool processHeaders(const char* begin, const char* end);
+  bool processHeader(const char* begin, const char* colon,
+                     const char* value, const char* valueEnd);
+  bool processHeadersEnd();
+  bool processChunkSize(const char* begin, const char* end);
+  bool fail(int status)
+  {
+    errorStatus_ = status;
+    return false;
+  }
 
   HttpRequestParseState state_;
   HttpRequest request_;
+  size_t maxHeaderSize_;
+  size_t maxBodySize_;
+  size_t headerSize_;  // of trailers
+  size_t scanned_;  // for the end of headers
+  size_t contentLength_;
+  size_t chunkLeft_;
+  size_t bodyInBuffer_;  // of the last request, to be retrieved
+  int errorStatus_;
+  int numRequests_;
+  Timestamp lastReceiveTime_;
+  bool hasContentLength_;
+  bool chunked_;
+  bool connectionClose_;
+  bool connectionKeepAlive_;
+  bool expectContinue_;
 };
 
 }
@@ -12,12 +12,16 @@
 #define MUDUO_NET_HTTP_HTTPREQUEST_H
 
 #include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
 #include <muduo/base/Timestamp.h>
 #include <muduo/base/Types.h>
 
 #include <map>
+#include <vector>
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <strings.h>
 
 namespace muduo
 {
@@ -38,7 +42,8 @@ class HttpRequest : public muduo::copyable
 
   HttpRequest()
     : method_(kInvalid),
-      version_(kUnknown)
+      version_(kUnknown),
+      headersBuilt_(false)
   {
   }
 
@@ -53,7 +58,7 @@ class HttpRequest : public muduo::copyable
   bool setMethod(const char* start, const char* end)
   {
     assert(method_ == kInvalid);
-    string m(start, end);
+    StringPiece m(start, static_cast<int>(end - start));
     if (m == "GET")
     {
       method_ = kGet;
@@ -132,35 +137,109 @@ class HttpRequest : public muduo::copyable
   Timestamp receiveTime() const
   { return receiveTime_; }
 
+  // for HttpContext, the request line and headers as received,
+  // with indexHeader() they are not copied one by one.
+  void setHeaderBlock(const char* start, const char* end)
+  {
+    headerBlock_.assign(start, end);
+    headerIndex_.clear();
+    headersBuilt_ = false;
+  }
+
+  // offsets in the header block
+  void indexHeader(size_t nameBegin, size_t nameEnd, size_t valueBegin, size_t valueEnd)
+  {
+    Header header = { static_cast<uint32_t>(nameBegin),
+                      static_cast<uint32_t>(nameEnd - nameBegin),
+                      static_cast<uint32_t>(valueBegin),
+                      static_cast<uint32_t>(valueEnd - valueBegin) };
+    headerIndex_.push_back(header);
+    headersBuilt_ = false;
+  }
+
   void addHeader(const char* start, const char* colon, const char* end)
   {
-    string field(start, colon);
-    ++colon;
-    while (colon < end && isspace(*colon))
+    const char* value = colon + 1;
+    while (value < end && isspace(*value))
     {
-      ++colon;
+      ++value;
     }
-    string value(colon, end);
-    while (!value.empty() && isspace(value[value.size()-1]))
+    while (value < end && isspace(*(end-1)))
     {
-      value.resize(value.size()-1);
+      --end;
     }
-    headers_[field] = value;
+    size_t base = headerBlock_.size();
+    headerBlock_.append(start, end);
+    indexHeader(base, base + (colon - start), base + (value - start), base + (end - start));
   }
 
-  string getHeader(const string& field) const
+  size_t numHeaders() const
+  { return headerIndex_.size(); }
+
+  StringPiece headerName(size_t i) const
+  { return piece(headerIndex_[i].nameOffset, headerIndex_[i].nameLength); }
+
+  StringPiece headerValue(size_t i) const
+  { return piece(headerIndex_[i].valueOffset, headerIndex_[i].valueLength); }
+
+  /// Case-insensitive, the last one if repeated, no copying,
+  /// data() is NULL if there is none.
+  StringPiece findHeader(const StringPiece& field) const
   {
-    string result;
-    std::map<string, string>::const_iterator it = headers_.find(field);
-    if (it != headers_.end())
+    for (size_t i = headerIndex_.size(); i > 0; --i)
     {
-      result = it->second;
+      StringPiece name(headerName(i-1));
+      if (name.size() == field.size()
+          && strncasecmp(name.data(), field.data(), name.size()) == 0)
+      {
+        return headerValue(i-1);
+      }
     }
-    return result;
+    return StringPiece();
+  }
+
+  string getHeader(const string& field) const
+  {
+    return findHeader(field).as_string();
   }
 
+  // built on first call, prefer findHeader()
   const std::map<string, string>& headers() const
-  { return headers_; }
+  {
+    if (!headersBuilt_)
+    {
+      headers_.clear();
+      for (size_t i = 0; i < headerIndex_.size(); ++i)
+      {
+        headers_[headerName(i).as_string()] = headerValue(i).as_string();
+      }
+      headersBuilt_ = true;
+    }
+    return headers_;
+  }
+
+  /// Empty if there is no body.
+  /// A Content-Length body points into the input Buffer, no copying,
+  /// valid until the next HttpContext::parseRequest(), keepBody() if
+  /// the request outlives the callback.
+  StringPiece body() const
+  { return bodyInBuffer_.data() ? bodyInBuffer_ : StringPiece(body_); }
+
+  void setBodyInBuffer(const char* start, const char* end)
+  { bodyInBuffer_.set(start, static_cast<int>(end - start)); }
+
+  // chunked bodies are put together here
+  void appendBody(const char* data, size_t len)
+  { body_.append(data, len); }
+
+  void keepBody()
+  {
+    if (bodyInBuffer_.data())
+    {
+      body_.assign(bodyInBuffer_.data(), bodyInBuffer_.size());
+      bodyInBuffer_.clear();
+    }
+  }
 
   void swap(HttpRequest& that)
   {
@@ -169,16 +248,37 @@ class HttpRequest : public muduo::copyable
     path_.swap(that.path_);
     query_.swap(that.query_);
     receiveTime_.swap(that.receiveTime_);
+    headerBlock_.swap(that.headerBlock_);
+    headerIndex_.swap(that.headerIndex_);
     headers_.swap(that.headers_);
+    std::swap(headersBuilt_, that.headersBuilt_);
+    body_.swap(that.body_);
+    std::swap(bodyInBuffer_, that.bodyInBuffer_);
   }
 
  private:
+  struct Header
+  {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    uint32_t valueOffset;
+    uint32_t valueLength;
+  };
+
+  StringPiece piece(uint32_t offset, uint32_t length) const
+  { return StringPiece(headerBlock_.data() + offset, static_cast<int>(length)); }
+
   Method method_;
   Version version_;
   string path_;
   string query_;
   Timestamp receiveTime_;
-  std::map<string, string> headers_;
+  string headerBlock_;
+  std::vector<Header> headerIndex_;
+  mutable std::map<string, string> headers_;
+  mutable bool headersBuilt_;
+  string body_;
+  StringPiece bodyInBuffer_;
 };
 
 }
@@ -11,39 +11,199 @@
 #include <muduo/net/Buffer.h>
 
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 using namespace muduo;
 using namespace muduo::net;
 
-void HttpResponse::appendToBuffer(Buffer* output) const
+namespace
+{
+
+__thread char t_date[64];
+__thread int t_dateLength = 0;  // 0 if not cached
+
+// "HTTP/1.1 200 OK\r\n", NULL if not a known code
+const char* statusLine(int code, StringPiece* reason)
+{
+  const char* line = NULL;
+  switch (code)
+  {
+#define MUDUO_HTTP_STATUS(code, text) \
+    case code: line = "HTTP/1.1 " #code " " text "\r\n"; break;
+    MUDUO_HTTP_STATUS(100, "Continue")
+    MUDUO_HTTP_STATUS(200, "OK")
+    MUDUO_HTTP_STATUS(204, "No Content")
+    MUDUO_HTTP_STATUS(206, "Partial Content")
+    MUDUO_HTTP_STATUS(301, "Moved Permanently")
+    MUDUO_HTTP_STATUS(302, "Found")
+    MUDUO_HTTP_STATUS(304, "Not Modified")
+    MUDUO_HTTP_STATUS(400, "Bad Request")
+    MUDUO_HTTP_STATUS(403, "Forbidden")
+    MUDUO_HTTP_STATUS(404, "Not Found")
+    MUDUO_HTTP_STATUS(405, "Method Not Allowed")
+    MUDUO_HTTP_STATUS(413, "Payload Too Large")
+    MUDUO_HTTP_STATUS(416, "Range Not Satisfiable")
+    MUDUO_HTTP_STATUS(431, "Request Header Fields Too Large")
+    MUDUO_HTTP_STATUS(500, "Internal Server Error")
+    MUDUO_HTTP_STATUS(503, "Service Unavailable")
+#undef MUDUO_HTTP_STATUS
+    default:
+      return NULL;
+  }
+  // "HTTP/1.1 200 " is 13 chars
+  reason->set(line + 13, static_cast<int>(strlen(line)) - 15);
+  return line;
+}
+
+// "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n", RFC 7231 7.1.1.1
+int formatDate(char* buf, size_t size)
+{
+  static const char* const kDays[] = {
+    "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+  static const char* const kMonths[] = {
+    "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+    "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+  time_t now = ::time(NULL);
+  struct tm tm;
+  ::gmtime_r(&now, &tm);
+  return snprintf(buf, size, "Date: %s, %02d %s %4d %02d:%02d:%02d GMT\r\n",
+                  kDays[tm.tm_wday], tm.tm_mday, kMonths[tm.tm_mon], tm.tm_year + 1900,
+                  tm.tm_hour, tm.tm_min, tm.tm_sec);
+}
+
+void appendDecimal(Buffer* output, size_t value)
 {
   char buf[32];
-  snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
-  output->append(buf);
-  output->append(statusMessage_);
-  output->append("\r\n");
+  char* p = buf + sizeof buf;
+  do
+  {
+    *--p = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  output->append(p, buf + sizeof buf - p);
+}
+
+}
+
+void HttpResponse::cacheDate()
+{
+  t_dateLength = formatDate(t_date, sizeof t_date);
+}
+
+void HttpResponse::addHeader(const StringPiece& key, const StringPiece& value)
+{
+  size_t len = key.size() + value.size() + 4;
+  if (moreHeaders_.empty() && headersLength_ + len <= kInlineHeaders)
+  {
+    char* p = headers_ + headersLength_;
+    memcpy(p, key.data(), key.size());
+    p += key.size();
+    memcpy(p, ": ", 2);
+    memcpy(p + 2, value.data(), value.size());
+    memcpy(p + 2 + value.size(), "\r\n", 2);
+    headersLength_ += len;
+  }
+  else
+  {
+    if (moreHeaders_.empty())
+    {
+      moreHeaders_.assign(headers_, headersLength_);
+    }
+    moreHeaders_.append(key.data(), key.size());
+    moreHeaders_.append(": ");
+    moreHeaders_.append(value.data(), value.size());
+    moreHeaders_.append("\r\n");
+  }
+}
 
+void HttpResponse::appendHeadToBuffer(Buffer* output) const
+{
+  StringPiece reason;
+  const char* line = statusLine(statusCode_, &reason);
+  if (line && (statusMessage_.empty() || reason == statusMessage_))
+  {
+    output->append(line);
+  }
+  else
+  {
+    output->append("HTTP/1.1 ");
+    appendDecimal(output, statusCode_);
+    output->append(" ");
+    output->append(statusMessage_);
+    output->append("\r\n");
+  }
+
+  if (t_dateLength > 0)
+  {
+    output->append(t_date, t_dateLength);
+  }
+  else
+  {
+    char date[64];
+    output->append(date, formatDate(date, sizeof date));
+  }
+
+  if (statusCode_ != k204NoContent && statusCode_ != k304NotModified)
+  {
+    output->append("Content-Length: ");
+    appendDecimal(output, bodyLength());
+    output->append("\r\n");
+  }
   if (closeConnection_)
   {
     output->append("Connection: close\r\n");
   }
   else
   {
-    snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());
-    output->append(buf);
     output->append("Connection: Keep-Alive\r\n");
   }
 
-  for (std::map<string, string>::const_iterator it = headers_.begin();
-       it != headers_.end();
-       ++it)
+  if (moreHeaders_.empty())
   {
-    output->append(it->first);
-    output->append(": ");
-    output->append(it->second);
-    output->append("\r\n");
+    output->append(headers_, headersLength_);
+  }
+  else
+  {
+    output->append(moreHeaders_);
   }
-
   output->append("\r\n");
-  output->append(body_);
+
+  if (!hasBodyReference() && !headOnly_)
+  {
+    output->append(body_);
+  }
+}
+
+void HttpResponse::appendToBuffer(Buffer* output) const
+{
+  appendHeadToBuffer(output);
+  if (headOnly_)
+  {
+    return;
+  }
+  else if (sharedBody_)
+  {
+    output->append(*sharedBody_);
+  }
+  else if (bodyFd_ >= 0)
+  {
+    output->ensureWritableBytes(bodyLength_);
+    char* p = output->beginWrite();
+    size_t done = 0;
+    while (done < bodyLength_)
+    {
+      ssize_t n = ::pread(bodyFd_, p + done, bodyLength_ - done,
+                          static_cast<off_t>(bodyOffset_ + done));
+      if (n <= 0)
+      {
+        // truncated file, zeros keep Content-Length right
+        memset(p + done, 0, bodyLength_ - done);
+        break;
+      }
+      done += n;
+    }
+    output->hasWritten(bodyLength_);
+  }
 }
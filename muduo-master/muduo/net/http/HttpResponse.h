@@ -12,9 +12,12 @@
 #define MUDUO_NET_HTTP_HTTPRESPONSE_H
 
 #include <muduo/base/copyable.h>
+#include <muduo/base/StringPiece.h>
 #include <muduo/base/Types.h>
 
-#include <map>
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
 
 namespace muduo
 {
@@ -22,27 +25,52 @@ namespace net
 {
 
 class Buffer;
+
+/// Status lines are precomputed, headers go to an inline buffer,
+/// so a small response allocates nothing.
+/// The body is copied, or referenced, or a region of a file.
 class HttpResponse : public muduo::copyable
 {
  public:
   enum HttpStatusCode
   {
     kUnknown,
+    k100Continue = 100,
     k200Ok = 200,
+    k204NoContent = 204,
+    k206PartialContent = 206,
     k301MovedPermanently = 301,
+    k302Found = 302,
+    k304NotModified = 304,
     k400BadRequest = 400,
+    k403Forbidden = 403,
     k404NotFound = 404,
+    k405MethodNotAllowed = 405,
+    k413PayloadTooLarge = 413,
+    k416RangeNotSatisfiable = 416,
+    k431RequestHeaderFieldsTooLarge = 431,
+    k500InternalServerError = 500,
+    k503ServiceUnavailable = 503,
   };
 
   explicit HttpResponse(bool close)
     : statusCode_(kUnknown),
-      closeConnection_(close)
+      closeConnection_(close),
+      headOnly_(false),
+      headersLength_(0),
+      bodyFd_(-1),
+      bodyOffset_(0),
+      bodyLength_(0)
   {
   }
 
   void setStatusCode(HttpStatusCode code)
   { statusCode_ = code; }
 
+  HttpStatusCode statusCode() const
+  { return statusCode_; }
+
+  /// Only if not the standard one, which is in the precomputed status line.
   void setStatusMessage(const string& message)
   { statusMessage_ = message; }
 
@@ -52,25 +80,104 @@ class HttpResponse : public muduo::copyable
   bool closeConnection() const
   { return closeConnection_; }
 
-  void setContentType(const string& contentType)
+  /// A response to HEAD, Content-Length is that of the body,
+  /// but the body is not sent.
+  void setHeadOnly(bool on)
+  { headOnly_ = on; }
+
+  bool headOnly() const
+  { return headOnly_; }
+
+  void setContentType(const StringPiece& contentType)
   { addHeader("Content-Type", contentType); }
 
-  // FIXME: replace string with StringPiece
-  void addHeader(const string& key, const string& value)
-  { headers_[key] = value; }
+  /// Appends, a key set twice is sent twice.
+  void addHeader(const StringPiece& key, const StringPiece& value);
 
+  /// copied
   void setBody(const string& body)
-  { body_ = body; }
+  {
+    body_ = body;
+    clearBodyReference();
+  }
 
+  /// Not copied, not even into the output Buffer, keep it unchanged.
+  void setBody(const boost::shared_ptr<const string>& body)
+  {
+    clearBodyReference();
+    sharedBody_ = body;
+  }
+
+  /// Sent with sendfile(2), the fd is not owned, keep it open until written,
+  /// or let @c holder own it, see TcpConnection::sendFile().
+  void setBodyFile(int fd, int64_t offset, size_t length,
+                   const boost::shared_ptr<const void>& holder = boost::shared_ptr<const void>())
+  {
+    clearBodyReference();
+    bodyFd_ = fd;
+    bodyOffset_ = offset;
+    bodyLength_ = length;
+    bodyHolder_ = holder;
+  }
+
+  size_t bodyLength() const
+  {
+    return bodyFd_ >= 0 ? bodyLength_ : sharedBody_ ? sharedBody_->size() : body_.size();
+  }
+
+  /// A body by reference or a file region, not in appendHeadToBuffer().
+  bool hasBodyReference() const
+  { return sharedBody_ || bodyFd_ >= 0; }
+
+  const boost::shared_ptr<const string>& sharedBody() const
+  { return sharedBody_; }
+
+  int bodyFd() const
+  { return bodyFd_; }
+
+  int64_t bodyOffset() const
+  { return bodyOffset_; }
+
+  const boost::shared_ptr<const void>& bodyHolder() const
+  { return bodyHolder_; }
+
+  /// Status line, headers and the body, all copied, a file region is read.
   void appendToBuffer(Buffer* output) const;
 
+  /// The same, but a body by reference or a file region is left to the caller,
+  /// eg. TcpConnection::send() or TcpConnection::sendFile().
+  void appendHeadToBuffer(Buffer* output) const;
+
+  /// Caches the Date header of this thread, HttpServer calls it
+  /// every second in each loop, by a timer.
+  /// Threads which never call it format the date for every response.
+  static void cacheDate();
+
  private:
-  std::map<string, string> headers_;
+  static const size_t kInlineHeaders = 256;
+
+  void clearBodyReference()
+  {
+    sharedBody_.reset();
+    bodyFd_ = -1;
+    bodyHolder_.reset();
+  }
+
   HttpStatusCode statusCode_;
   // FIXME: add http version
   string statusMessage_;
   bool closeConnection_;
+  bool headOnly_;
+  // "Key: Value\r\n" one after another, moved to moreHeaders_ if too long
+  char headers_[kInlineHeaders];
+  size_t headersLength_;
+  string moreHeaders_;
   string body_;
+  boost::shared_ptr<const string> sharedBody_;
+  int bodyFd_;
+  int64_t bodyOffset_;
+  size_t bodyLength_;
+  boost::shared_ptr<const void> bodyHolder_;
 };
 
 }
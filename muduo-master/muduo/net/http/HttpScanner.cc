@@ -0,0 +1,170 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/http/HttpScanner.h>
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__SSE2__)
+#define MUDUO_HTTP_SSE2 1
+#include <emmintrin.h>
+#if __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define MUDUO_HTTP_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+using namespace muduo::net::detail;
+
+namespace
+{
+
+typedef const char* (*FindFunc)(const char*, const char*, char, char);
+
+const char* findScalar(const char* p, const char* end, char c1, char c2)
+{
+  for (; p < end; ++p)
+  {
+    if (*p == c1 || *p == c2)
+    {
+      break;
+    }
+  }
+  return p;
+}
+
+#ifdef MUDUO_HTTP_SSE2
+// loads may not go past end, it may be the end of the Buffer
+const char* findSse2(const char* p, const char* end, char c1, char c2)
+{
+  const __m128i v1 = _mm_set1_epi8(c1);
+  const __m128i v2 = _mm_set1_epi8(c2);
+  for (; end - p >= 16; p += 16)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, v1), _mm_cmpeq_epi8(x, v2)));
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  return findScalar(p, end, c1, c2);
+}
+#endif
+
+#ifdef MUDUO_HTTP_AVX2
+__attribute__((target("avx2")))
+const char* findAvx2(const char* p, const char* end, char c1, char c2)
+{
+  const __m256i v1 = _mm256_set1_epi8(c1);
+  const __m256i v2 = _mm256_set1_epi8(c2);
+  for (; end - p >= 32; p += 32)
+  {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(x, v1),
+                                                    _mm256_cmpeq_epi8(x, v2)));
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+  }
+  // VEX encoded here, no SSE/AVX transition
+  if (end - p >= 16)
+  {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, _mm256_castsi256_si128(v1)),
+                                              _mm_cmpeq_epi8(x, _mm256_castsi256_si128(v2))));
+    if (mask != 0)
+    {
+      return p + __builtin_ctz(mask);
+    }
+    p += 16;
+  }
+  return findScalar(p, end, c1, c2);
+}
+#endif
+
+bool supported(HttpScanKind kind)
+{
+  switch (kind)
+  {
+    case kScanScalar:
+      return true;
+#ifdef MUDUO_HTTP_SSE2
+    case kScanSse2:
+      return true;
+#endif
+#ifdef MUDUO_HTTP_AVX2
+    case kScanAvx2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+FindFunc findFunc(HttpScanKind kind)
+{
+  switch (kind)
+  {
+#ifdef MUDUO_HTTP_SSE2
+    case kScanSse2:
+      return findSse2;
+#endif
+#ifdef MUDUO_HTTP_AVX2
+    case kScanAvx2:
+      return findAvx2;
+#endif
+    default:
+      return findScalar;
+  }
+}
+
+HttpScanKind bestKind()
+{
+  return supported(kScanAvx2) ? kScanAvx2 : supported(kScanSse2) ? kScanSse2 : kScanScalar;
+}
+
+HttpScanKind g_kind = bestKind();
+FindFunc g_find = findFunc(g_kind);
+
+}
+
+const char* muduo::net::detail::findEither(const char* begin, const char* end, char c1, char c2)
+{
+  return g_find(begin, end, c1, c2);
+}
+
+const char* muduo::net::detail::findHeadersEnd(const char* begin, const char* end)
+{
+  const char* cr = g_find(begin, end, '\r', '\r');
+  while (end - cr >= 4)
+  {
+    if (memcmp(cr, "\r\n\r\n", 4) == 0)
+    {
+      return cr + 4;
+    }
+    cr = g_find(cr + 1, end, '\r', '\r');
+  }
+  return NULL;
+}
+
+bool muduo::net::detail::setHttpScanKind(HttpScanKind kind)
+{
+  if (!supported(kind))
+  {
+    return false;
+  }
+  g_kind = kind;
+  g_find = findFunc(kind);
+  return true;
+}
+
+HttpScanKind muduo::net::detail::httpScanKind()
+{
+  return g_kind;
+}
@@ -0,0 +1,41 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_HTTP_HTTPSCANNER_H
+#define MUDUO_NET_HTTP_HTTPSCANNER_H
+
+namespace muduo
+{
+namespace net
+{
+namespace detail
+{
+
+// Delimiter scanning of HttpContext, 32 or 16 bytes at a time,
+// with AVX2 if the CPU has it, or SSE2, or byte by byte.
+enum HttpScanKind
+{
+  kScanScalar,
+  kScanSse2,
+  kScanAvx2
+};
+
+// the first of c1 or c2 in [begin, end), end if none
+const char* findEither(const char* begin, const char* end, char c1, char c2);
+
+// past the "\r\n\r\n" in [begin, end), NULL if none
+const char* findHeadersEnd(const char* begin, const char* end);
+
+// for tests and benchmarks, returns false if the CPU can't
+bool setHttpScanKind(HttpScanKind kind);
+HttpScanKind httpScanKind();
+
+}
+}
+}
+
+#endif  // MUDUO_NET_HTTP_HTTPSCANNER_H
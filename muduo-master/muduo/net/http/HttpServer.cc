@@ -10,12 +10,15 @@
 #include <muduo/net/http/HttpServer.h>
 
 #include <muduo/base/Logging.h>
+#include <muduo/net/EventLoop.h>
 #include <muduo/net/http/HttpContext.h>
 #include <muduo/net/http/HttpRequest.h>
 #include <muduo/net/http/HttpResponse.h>
 
 #include <boost/bind.hpp>
 
+#include <map>
+
 using namespace muduo;
 using namespace muduo::net;
 
@@ -26,6 +29,8 @@ namespace net
 namespace detail
 {
 
+__thread bool t_dateTimer = false;  // of HttpResponse::cacheDate
+
 void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
 {
   resp->setStatusCode(HttpResponse::k404NotFound);
@@ -33,6 +38,64 @@ void defaultHttpCallback(const HttpRequest&, HttpResponse* resp)
   resp->setCloseConnection(true);
 }
 
+const char* errorResponse(int status)
+{
+  switch (status)
+  {
+    case 413:
+      return "HTTP/1.1 413 Payload Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    case 431:
+      return "HTTP/1.1 431 Request Header Fields Too Large\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    default:
+      return "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+  }
+}
+
+// a request handled by the executor, and its response
+struct HttpTask : boost::noncopyable
+{
+  HttpTask(const TcpConnectionPtr& c, int64_t seq, bool close)
+    : conn(c),
+      loop(c->getLoop()),
+      sequence(seq),
+      response(close)
+  {
+  }
+
+  boost::weak_ptr<TcpConnection> conn;
+  EventLoop* loop;
+  int64_t sequence;
+  HttpRequest request;
+  HttpResponse response;
+};
+
+typedef boost::shared_ptr<HttpTask> HttpTaskPtr;
+
+// context of a connection
+struct HttpSession
+{
+  HttpSession()
+    : nextRequest(0),
+      nextResponse(0),
+      closing(false),
+      readingStopped(false)
+  {
+  }
+
+  int inFlight() const
+  { return static_cast<int>(nextRequest - nextResponse); }
+
+  HttpContext context;
+
+  // of the executor, requests are numbered, responses done out of order
+  // wait in done, until those before them are sent
+  int64_t nextRequest;
+  int64_t nextResponse;
+  std::map<int64_t, HttpTaskPtr> done;
+  bool closing;  // no more requests, shutdown after the last response
+  bool readingStopped;
+};
+
 }
 }
 }
@@ -42,7 +105,12 @@ HttpServer::HttpServer(EventLoop* loop,
                        const string& name,
                        TcpServer::Option option)
   : server_(loop, listenAddr, name, option),
-    httpCallback_(detail::defaultHttpCallback)
+    httpCallback_(detail::defaultHttpCallback),
+    idleTimeout_(0),
+    maxRequestsPerConnection_(0),
+    maxHeaderSize_(HttpContext::kDefaultMaxHeaderSize),
+    maxBodySize_(HttpContext::kDefaultMaxBodySize),
+    maxInFlight_(0)
 {
   server_.setConnectionCallback(
       boost::bind(&HttpServer::onConnection, this, _1));
@@ -54,18 +122,74 @@ HttpServer::~HttpServer()
 {
 }
 
+void HttpServer::setThreadPool(ThreadPool* pool, int maxInFlight)
+{
+  void (ThreadPool::*run)(const ThreadPool::Task&) = &ThreadPool::run;
+  setExecutor(boost::bind(run, pool, _1), maxInFlight);
+}
+
 void HttpServer::start()
 {
+  server_.setThreadInitCallback(&HttpServer::onThreadInit);
   LOG_WARN << "HttpServer[" << server_.name()
     << "] starts listenning on " << server_.ipPort();
   server_.start();
 }
 
+// in the loop thread, the base loop if no threads
+void HttpServer::onThreadInit(EventLoop* loop)
+{
+  // the first HttpServer of the loop
+  if (!detail::t_dateTimer)
+  {
+    detail::t_dateTimer = true;
+    HttpResponse::cacheDate();
+    loop->runEvery(1.0, &HttpResponse::cacheDate);
+  }
+}
+
 void HttpServer::onConnection(const TcpConnectionPtr& conn)
 {
   if (conn->connected())
   {
-    conn->setContext(HttpContext());
+    detail::HttpSession session;
+    session.context.setMaxHeaderSize(maxHeaderSize_);
+    session.context.setMaxBodySize(maxBodySize_);
+    conn->setContext(session);
+    if (idleTimeout_ > 0)
+    {
+      conn->getLoop()->runAfter(idleTimeout_,
+          boost::bind(&HttpServer::onIdleCheck, this, boost::weak_ptr<TcpConnection>(conn)));
+    }
+  }
+}
+
+// one timer for each connection, rearmed to the time it becomes idle
+void HttpServer::onIdleCheck(const boost::weak_ptr<TcpConnection>& weakConn)
+{
+  TcpConnectionPtr conn(weakConn.lock());
+  if (!conn || !conn->connected())
+  {
+    return;
+  }
+  const detail::HttpSession& session = boost::any_cast<const detail::HttpSession&>(conn->getContext());
+  const HttpContext& context = session.context;
+  double idle = context.lastReceiveTime().valid()
+    ? timeDifference(Timestamp::now(), context.lastReceiveTime())
+    : idleTimeout_;  // nothing since connected
+  if (conn->outputBytes() > 0 || session.inFlight() > 0)
+  {
+    idle = 0;  // a slow reader or a slow request, not idle
+  }
+  if (idle >= idleTimeout_)
+  {
+    LOG_DEBUG << "HttpServer[" << server_.name() << "] closes idle " << conn->name();
+    conn->forceClose();
+  }
+  else
+  {
+    conn->getLoop()->runAfter(idleTimeout_ - idle,
+        boost::bind(&HttpServer::onIdleCheck, this, weakConn));
   }
 }
 
@@ -73,34 +197,191 @@ void HttpServer::onMessage(const TcpConnectionPtr& conn,
                            Buffer* buf,
                            Timestamp receiveTime)
 {
-  HttpContext* context = boost::any_cast<HttpContext>(conn->getMutableContext());
+  detail::HttpSession* session = boost::any_cast<detail::HttpSession>(conn->getMutableContext());
+  if (!conn->connected() || session->closing)
+  {
+    // shutting down, requests after "Connection: close" are ignored
+    buf->retrieveAll();
+    return;
+  }
 
-  if (!context->parseRequest(buf, receiveTime))
+  HttpContext* context = &session->context;
+  // all pipelined requests in buf, responses in order
+  Buffer output(conn->getLoop()->bufferAllocator());
+  bool close = false;
+  while (!close && !session->readingStopped)
   {
-    conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
-    conn->shutdown();
+    if (!context->parseRequest(buf, receiveTime))
+    {
+      close = true;
+      if (session->inFlight() > 0)
+      {
+        // after those in flight
+        detail::HttpTaskPtr task(new detail::HttpTask(conn, session->nextRequest++, true));
+        task->response.setStatusCode(
+            static_cast<HttpResponse::HttpStatusCode>(context->errorStatus()));
+        session->done[task->sequence] = task;
+      }
+      else
+      {
+        output.append(detail::errorResponse(context->errorStatus()));
+      }
+    }
+    else if (context->gotAll())
+    {
+      close = closeAfter(*context);
+      if (executor_)
+      {
+        dispatch(conn, session, close);
+      }
+      else
+      {
+        close = onRequest(conn, context->request(), close, &output);
+      }
+      context->reset();
+      if (!close && executor_ && maxInFlight_ > 0 && session->inFlight() >= maxInFlight_)
+      {
+        // the rest stays in buf, until flush()
+        session->readingStopped = true;
+        conn->stopRead();
+      }
+    }
+    else
+    {
+      // or the client waits a while and sends the body,
+      // a 100 before those in flight would be out of order
+      if (context->expectContinue() && session->inFlight() == 0)
+      {
+        output.append("HTTP/1.1 100 Continue\r\n\r\n");
+      }
+      context->clearExpectContinue();
+      break;
+    }
   }
 
-  if (context->gotAll())
+  if (output.readableBytes() > 0)
+  {
+    conn->send(&output);
+  }
+  if (close)
   {
-    onRequest(conn, context->request());
-    context->reset();
+    buf->retrieveAll();
+    if (session->inFlight() > 0)
+    {
+      session->closing = true;
+    }
+    else
+    {
+      conn->shutdown();
+    }
   }
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& req)
+bool HttpServer::closeAfter(const HttpContext& context) const
+{
+  return !context.keepAlive() ||
+    (maxRequestsPerConnection_ > 0 && context.numRequests() + 1 >= maxRequestsPerConnection_);
+}
+
+bool HttpServer::onRequest(const TcpConnectionPtr& conn, const HttpRequest& request,
+                           bool close, Buffer* output)
 {
-  const string& connection = req.getHeader("Connection");
-  bool close = connection == "close" ||
-    (req.getVersion() == HttpRequest::kHttp10 && connection != "Keep-Alive");
   HttpResponse response(close);
-  httpCallback_(req, &response);
-  Buffer buf;
-  response.appendToBuffer(&buf);
-  conn->send(&buf);
-  if (response.closeConnection())
+  httpCallback_(request, &response);
+  if (request.method() == HttpRequest::kHead)
   {
-    conn->shutdown();
+    response.setHeadOnly(true);
+  }
+  return writeResponse(conn, response, output);
+}
+
+// returns whether to close the connection after it
+bool HttpServer::writeResponse(const TcpConnectionPtr& conn, const HttpResponse& response,
+                               Buffer* output)
+{
+  response.appendHeadToBuffer(output);
+  if (response.hasBodyReference() && !response.headOnly())
+  {
+    // what is before it goes first
+    conn->send(output);
+    if (response.sharedBody())
+    {
+      conn->send(response.sharedBody());
+    }
+    else
+    {
+      conn->sendFile(response.bodyFd(), response.bodyOffset(), response.bodyLength(),
+                     response.bodyHolder());
+    }
   }
+  return response.closeConnection();
+}
+
+void HttpServer::dispatch(const TcpConnectionPtr& conn, detail::HttpSession* session, bool close)
+{
+  detail::HttpTaskPtr task(new detail::HttpTask(conn, session->nextRequest++, close));
+  // the body is in buf, which is going on
+  session->context.request().keepBody();
+  task->request.swap(session->context.request());
+  executor_(boost::bind(&HttpServer::runRequest, this, task));
 }
 
+// in a thread of the executor
+void HttpServer::runRequest(const detail::HttpTaskPtr& task)
+{
+  httpCallback_(task->request, &task->response);
+  if (task->request.method() == HttpRequest::kHead)
+  {
+    task->response.setHeadOnly(true);
+  }
+  // Date is cached in the IO thread, so is it written there
+  task->loop->runInLoop(boost::bind(&HttpServer::onResponse, this, task));
+}
+
+void HttpServer::onResponse(const detail::HttpTaskPtr& task)
+{
+  TcpConnectionPtr conn(task->conn.lock());
+  if (!conn || !conn->connected())
+  {
+    return;
+  }
+  detail::HttpSession* session = boost::any_cast<detail::HttpSession>(conn->getMutableContext());
+  session->done[task->sequence] = task;
+  flush(conn, session);
+}
+
+// sends what is done in order, resumes reading if not too many in flight
+void HttpServer::flush(const TcpConnectionPtr& conn, detail::HttpSession* session)
+{
+  Buffer output(conn->getLoop()->bufferAllocator());
+  bool close = false;
+  std::map<int64_t, detail::HttpTaskPtr>::iterator it = session->done.begin();
+  while (!close && it != session->done.end() && it->first == session->nextResponse)
+  {
+    close = writeResponse(conn, it->second->response, &output);
+    ++session->nextResponse;
+    session->done.erase(it++);
+  }
+  if (output.readableBytes() > 0)
+  {
+    conn->send(&output);
+  }
+
+  if (close || (session->closing && session->inFlight() == 0))
+  {
+    // those after a "Connection: close" of the callback are dropped
+    session->closing = true;
+    session->done.clear();
+    conn->inputBuffer()->retrieveAll();
+    conn->shutdown();
+  }
+  else if (session->readingStopped && session->inFlight() < maxInFlight_)
+  {
+    session->readingStopped = false;
+    conn->startRead();
+    if (conn->inputBuffer()->readableBytes() > 0)
+    {
+      onMessage(conn, conn->inputBuffer(), Timestamp::now());
+    }
+  }
+}
@@ -11,26 +11,44 @@
 #ifndef MUDUO_NET_HTTP_HTTPSERVER_H
 #define MUDUO_NET_HTTP_HTTPSERVER_H
 
+#include <muduo/base/ThreadPool.h>
 #include <muduo/net/TcpServer.h>
 #include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
 
 namespace muduo
 {
 namespace net
 {
 
+class HttpContext;
 class HttpRequest;
 class HttpResponse;
 
+namespace detail
+{
+struct HttpSession;
+struct HttpTask;
+}
+
 /// A simple embeddable HTTP server designed for report status of a program.
 /// It is not a fully HTTP 1.1 compliant server, but provides minimum features
 /// that can communicate with HttpClient and Web browser.
 /// It is synchronous, just like Java Servlet.
+///
+/// Keep-alive and pipelining of HTTP/1.1, all requests in one read are
+/// answered in one send(), bodies of Content-Length or chunked.
+/// HEAD is answered without the body, see StaticFileHandler for files.
+///
+/// With setThreadPool() or setExecutor(), the callback runs in other threads,
+/// responses are sent in the order of requests, in the IO thread.
 class HttpServer : boost::noncopyable
 {
  public:
   typedef boost::function<void (const HttpRequest&,
                                 HttpResponse*)> HttpCallback;
+  /// Runs a task in some thread, eg. ThreadPool::run().
+  typedef boost::function<void (const ThreadPool::Task&)> Executor;
 
   HttpServer(EventLoop* loop,
              const InetAddress& listenAddr,
@@ -52,6 +70,38 @@ class HttpServer : boost::noncopyable
     server_.setThreadNum(numThreads);
   }
 
+  /// Closes a connection which sends nothing for @c seconds,
+  /// waiting for a request or in the middle of one, 0 (default) never.
+  void setIdleTimeout(double seconds)
+  { idleTimeout_ = seconds; }
+
+  /// "Connection: close" after @c n requests, 0 (default) no limit.
+  void setMaxRequestsPerConnection(int n)
+  { maxRequestsPerConnection_ = n; }
+
+  /// 431 for a larger request line and headers, default 64KiB.
+  void setMaxHeaderSize(size_t size)
+  { maxHeaderSize_ = size; }
+
+  /// 413 for a larger body, default 8MiB.
+  void setMaxBodySize(size_t size)
+  { maxBodySize_ = size; }
+
+  /// Calls HttpCallback in @c pool, which must be thread safe then,
+  /// so that slow requests don't hold up others of the IO thread.
+  /// A connection stops reading when @c maxInFlight of its requests
+  /// are not answered, until some of them are, 0 no limit.
+  /// Stop the pool before destroying the server.
+  void setThreadPool(ThreadPool* pool, int maxInFlight = 16);
+
+  /// The same, for other executors, it is called in IO threads,
+  /// and should not block for long, eg. a ThreadPool without setMaxQueueSize().
+  void setExecutor(const Executor& executor, int maxInFlight = 16)
+  {
+    executor_ = executor;
+    maxInFlight_ = maxInFlight;
+  }
+
   void start();
 
  private:
@@ -59,10 +109,27 @@ class HttpServer : boost::noncopyable
   void onMessage(const TcpConnectionPtr& conn,
                  Buffer* buf,
                  Timestamp receiveTime);
-  void onRequest(const TcpConnectionPtr&, const HttpRequest&);
+  bool onRequest(const TcpConnectionPtr& conn, const HttpRequest& request,
+                 bool close, Buffer* output);
+  bool closeAfter(const HttpContext& context) const;
+  static bool writeResponse(const TcpConnectionPtr& conn, const HttpResponse& response,
+                            Buffer* output);
+  // of the executor
+  void dispatch(const TcpConnectionPtr& conn, detail::HttpSession* session, bool close);
+  void runRequest(const boost::shared_ptr<detail::HttpTask>& task);
+  void onResponse(const boost::shared_ptr<detail::HttpTask>& task);
+  void flush(const TcpConnectionPtr& conn, detail::HttpSession* session);
+  static void onThreadInit(EventLoop* loop);
+  void onIdleCheck(const boost::weak_ptr<TcpConnection>& weakConn);
 
   TcpServer server_;
   HttpCallback httpCallback_;
+  double idleTimeout_;
+  int maxRequestsPerConnection_;
+  size_t maxHeaderSize_;
+  size_t maxBodySize_;
+  Executor executor_;
+  int maxInFlight_;
 };
 
 }
@@ -0,0 +1,731 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+#include <muduo/net/http/StaticFileHandler.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/base/Timestamp.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/net/ZlibStream.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+struct StaticFileHandler::File : boost::noncopyable
+{
+  File()
+    : fd(-1),
+      size(0),
+      mtime(0),
+      ino(0),
+      contentType(NULL),
+      compressible(false),
+      cached(false),
+      lastUsed(0)
+  {
+  }
+
+  ~File()
+  {
+    if (fd >= 0)
+    {
+      ::close(fd);
+    }
+  }
+
+  // in memory, guarded by mutex_ of the handler
+  size_t bytes() const
+  {
+    size_t n = content ? content->size() : 0;
+    for (int i = 0; i < 3; ++i)
+    {
+      if (variants[i] && variants[i] != content)
+      {
+        n += variants[i]->size();
+      }
+    }
+    return n;
+  }
+
+  int fd;
+  int64_t size;
+  time_t mtime;
+  ino_t ino;
+  const char* contentType;
+  bool compressible;
+  string etag;          // "mtime-size" in hex, with the quotes
+  string lastModified;
+  boost::shared_ptr<const string> content;  // NULL if too large
+
+  // guarded by mutex_ of the handler
+  // by Encoding, content itself if compression doesn't make it smaller
+  boost::shared_ptr<const string> variants[3];
+  bool cached;
+  Timestamp checked;
+  int64_t lastUsed;
+};
+
+namespace
+{
+
+struct MimeType
+{
+  const char* extension;
+  const char* type;
+  bool compressible;
+};
+
+const MimeType kMimeTypes[] =
+{
+  { "html", "text/html; charset=utf-8", true },
+  { "htm", "text/html; charset=utf-8", true },
+  { "css", "text/css; charset=utf-8", true },
+  { "js", "application/javascript; charset=utf-8", true },
+  { "json", "application/json", true },
+  { "xml", "application/xml", true },
+  { "svg", "image/svg+xml", true },
+  { "txt", "text/plain; charset=utf-8", true },
+  { "log", "text/plain; charset=utf-8", true },
+  { "csv", "text/csv; charset=utf-8", true },
+  { "md", "text/markdown; charset=utf-8", true },
+  { "wasm", "application/wasm", true },
+  { "png", "image/png", false },
+  { "jpg", "image/jpeg", false },
+  { "jpeg", "image/jpeg", false },
+  { "gif", "image/gif", false },
+  { "webp", "image/webp", false },
+  { "ico", "image/x-icon", false },
+  { "woff", "font/woff", false },
+  { "woff2", "font/woff2", false },
+  { "pdf", "application/pdf", false },
+  { "mp4", "video/mp4", false },
+  { "gz", "application/gzip", false },
+  { "zip", "application/zip", false },
+};
+
+const MimeType kDefaultMimeType = { "", "application/octet-stream", false };
+
+// compressing smaller ones doesn't pay
+const size_t kMinCompressSize = 256;
+
+const char* const kEncodingNames[] = { "identity", "gzip", "deflate" };
+
+const MimeType& mimeType(const string& path)
+{
+  size_t dot = path.rfind('.');
+  if (dot != string::npos && path.find('/', dot) == string::npos)
+  {
+    const char* extension = path.c_str() + dot + 1;
+    for (size_t i = 0; i < sizeof kMimeTypes / sizeof kMimeTypes[0]; ++i)
+    {
+      if (::strcasecmp(extension, kMimeTypes[i].extension) == 0)
+      {
+        return kMimeTypes[i];
+      }
+    }
+  }
+  return kDefaultMimeType;
+}
+
+int hexValue(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// "/a%20b/" to "/a b/index.html", false for ".." or '\0'
+bool decodePath(const StringPiece& path, string* decoded)
+{
+  decoded->reserve(path.size() + 10);
+  for (int i = 0; i < path.size(); ++i)
+  {
+    char c = path[i];
+    if (c == '%' && i + 2 < path.size() &&
+        hexValue(path[i+1]) >= 0 && hexValue(path[i+2]) >= 0)
+    {
+      c = static_cast<char>(hexValue(path[i+1]) * 16 + hexValue(path[i+2]));
+      i += 2;
+    }
+    if (c == '\0')
+    {
+      return false;
+    }
+    decoded->push_back(c);
+  }
+  if (decoded->empty() || (*decoded)[0] != '/')
+  {
+    decoded->insert(decoded->begin(), '/');
+  }
+
+  // no way out of root
+  for (size_t start = 0; start < decoded->size(); )
+  {
+    size_t end = decoded->find('/', start + 1);
+    if (end == string::npos)
+    {
+      end = decoded->size();
+    }
+    if (decoded->compare(start, end - start, "/..") == 0)
+    {
+      return false;
+    }
+    start = end;
+  }
+
+  if ((*decoded)[decoded->size() - 1] == '/')
+  {
+    decoded->append("index.html");
+  }
+  return true;
+}
+
+StringPiece trim(StringPiece s)
+{
+  while (!s.empty() && (s[0] == ' ' || s[0] == '\t'))
+  {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s[s.size() - 1] == ' ' || s[s.size() - 1] == '\t'))
+  {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+// calls f with each item of a comma separated list, until it returns true
+template<typename Func>
+bool anyOf(StringPiece list, Func f)
+{
+  while (!list.empty())
+  {
+    const char* comma = static_cast<const char*>(memchr(list.data(), ',', list.size()));
+    int len = comma ? static_cast<int>(comma - list.data()) : list.size();
+    if (f(trim(StringPiece(list.data(), len))))
+    {
+      return true;
+    }
+    list.remove_prefix(comma ? len + 1 : len);
+  }
+  return false;
+}
+
+// whether an item of If-None-Match is the ETag of the file,
+// of any Content-Encoding, weak comparison
+struct EtagMatches
+{
+  explicit EtagMatches(const string& etag) : etag_(etag) { }
+
+  bool operator()(StringPiece tag) const
+  {
+    if (tag == "*")
+    {
+      return true;
+    }
+    if (tag.starts_with("W/"))
+    {
+      tag.remove_prefix(2);
+    }
+    // "mtime-size" or "mtime-size-gzip"
+    StringPiece base(etag_.data(), static_cast<int>(etag_.size()) - 1);
+    return tag.starts_with(base) &&
+      (tag.size() == base.size() + 1 || tag[base.size()] == '-') &&
+      tag[tag.size() - 1] == '"';
+  }
+
+  const string& etag_;
+};
+
+// Accept-Encoding, "gzip;q=0" is not
+struct Accepts
+{
+  explicit Accepts(const char* coding) : coding_(coding) { }
+
+  bool operator()(StringPiece item) const
+  {
+    StringPiece params;
+    const char* semicolon = static_cast<const char*>(memchr(item.data(), ';', item.size()));
+    if (semicolon)
+    {
+      params = StringPiece(semicolon + 1, static_cast<int>(item.end() - semicolon - 1));
+      item = trim(StringPiece(item.data(), static_cast<int>(semicolon - item.data())));
+    }
+    if (::strncasecmp(item.data(), coding_, item.size()) != 0
+        || coding_[item.size()] != '\0')
+    {
+      return false;
+    }
+    params = trim(params);
+    if (params.starts_with("q=") || params.starts_with("Q="))
+    {
+      params.remove_prefix(2);
+      for (int i = 0; i < params.size(); ++i)
+      {
+        if (params[i] != '0' && params[i] != '.')
+        {
+          return true;
+        }
+      }
+      return false;
+    }
+    return true;
+  }
+
+  const char* coding_;
+};
+
+bool parseNumber(StringPiece s, int64_t* n)
+{
+  if (s.empty() || s.size() > 18)
+  {
+    return false;
+  }
+  *n = 0;
+  for (int i = 0; i < s.size(); ++i)
+  {
+    if (s[i] < '0' || s[i] > '9')
+    {
+      return false;
+    }
+    *n = *n * 10 + (s[i] - '0');
+  }
+  return true;
+}
+
+// A single range of "bytes=first-last", "bytes=first-", "bytes=-suffix".
+// Returns 1 if it is satisfiable, -1 if not, 0 to ignore it,
+// which is a syntax error, or a list of ranges.
+int parseRange(StringPiece range, int64_t size, int64_t* first, int64_t* last)
+{
+  if (!range.starts_with("bytes="))
+  {
+    return 0;
+  }
+  range.remove_prefix(6);
+  const char* dash = static_cast<const char*>(memchr(range.data(), '-', range.size()));
+  if (!dash || memchr(range.data(), ',', range.size()))
+  {
+    return 0;
+  }
+  StringPiece from(trim(StringPiece(range.data(), static_cast<int>(dash - range.data()))));
+  StringPiece to(trim(StringPiece(dash + 1, static_cast<int>(range.end() - dash - 1))));
+  if (from.empty())
+  {
+    int64_t suffix = 0;
+    if (!parseNumber(to, &suffix))
+    {
+      return 0;
+    }
+    if (suffix == 0 || size == 0)
+    {
+      return -1;
+    }
+    *first = suffix < size ? size - suffix : 0;
+    *last = size - 1;
+    return 1;
+  }
+
+  if (!parseNumber(from, first))
+  {
+    return 0;
+  }
+  *last = size - 1;
+  if (!to.empty())
+  {
+    int64_t end = 0;
+    if (!parseNumber(to, &end) || end < *first)
+    {
+      return 0;
+    }
+    *last = std::min(end, size - 1);
+  }
+  return *first < size ? 1 : -1;
+}
+
+// RFC 7231 IMF-fixdate only, the one we send, browsers send it back
+bool parseHttpDate(StringPiece date, time_t* t)
+{
+  char buf[64];
+  if (date.size() >= static_cast<int>(sizeof buf))
+  {
+    return false;
+  }
+  memcpy(buf, date.data(), date.size());
+  buf[date.size()] = '\0';
+  struct tm tm;
+  bzero(&tm, sizeof tm);
+  const char* end = ::strptime(buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+  if (end == NULL || *end != '\0')
+  {
+    return false;
+  }
+  *t = ::timegm(&tm);
+  return true;
+}
+
+}
+
+StaticFileHandler::StaticFileHandler(const string& root, const string& prefix)
+  : root_(root),
+    prefix_(prefix),
+    maxCacheBytes_(64 * 1024 * 1024),
+    maxCachedFiles_(1024),
+    maxInMemoryFileSize_(1024 * 1024),
+    revalidateInterval_(1.0),
+    compression_(true),
+    cacheBytes_(0),
+    useCount_(0)
+{
+}
+
+StaticFileHandler::~StaticFileHandler()
+{
+}
+
+size_t StaticFileHandler::numCachedFiles() const
+{
+  MutexLockGuard lock(mutex_);
+  return files_.size();
+}
+
+size_t StaticFileHandler::cacheBytes() const
+{
+  MutexLockGuard lock(mutex_);
+  return cacheBytes_;
+}
+
+void StaticFileHandler::onRequest(const HttpRequest& req, HttpResponse* resp)
+{
+  if (!serve(req, resp))
+  {
+    resp->setStatusCode(HttpResponse::k404NotFound);
+  }
+}
+
+bool StaticFileHandler::serve(const HttpRequest& req, HttpResponse* resp)
+{
+  const string& reqPath = req.path();
+  if (reqPath.compare(0, prefix_.size(), prefix_) != 0 ||
+      (!prefix_.empty() && prefix_[prefix_.size() - 1] != '/'
+       && reqPath.size() > prefix_.size() && reqPath[prefix_.size()] != '/'))
+  {
+    return false;
+  }
+  if (req.method() != HttpRequest::kGet && req.method() != HttpRequest::kHead)
+  {
+    resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+    resp->addHeader("Allow", "GET, HEAD");
+    return true;
+  }
+
+  string path;
+  int status = HttpResponse::k404NotFound;
+  FilePtr file;
+  if (decodePath(StringPiece(reqPath.data() + prefix_.size(),
+                             static_cast<int>(reqPath.size() - prefix_.size())), &path))
+  {
+    file = getFile(path, &status);
+  }
+  if (!file)
+  {
+    if (status == HttpResponse::k301MovedPermanently)
+    {
+      resp->addHeader("Location", reqPath + "/");
+    }
+    resp->setStatusCode(static_cast<HttpResponse::HttpStatusCode>(status));
+    return true;
+  }
+
+  StringPiece range(req.findHeader("Range"));
+  bool vary = compression_ && file->compressible && file->content
+    && file->size >= static_cast<int64_t>(kMinCompressSize);
+  Encoding encoding = kIdentity;
+  boost::shared_ptr<const string> body(file->content);
+  if (vary && range.empty())
+  {
+    StringPiece accept(req.findHeader("Accept-Encoding"));
+    encoding = anyOf(accept, Accepts("gzip")) ? kGzip :
+      anyOf(accept, Accepts("deflate")) ? kDeflate : kIdentity;
+    if (encoding != kIdentity)
+    {
+      body = variant(file, encoding);
+      if (body == file->content)
+      {
+        encoding = kIdentity;
+      }
+    }
+  }
+
+  string etag(file->etag);
+  if (encoding != kIdentity)
+  {
+    etag.insert(etag.size() - 1, string("-") + kEncodingNames[encoding]);
+  }
+  resp->addHeader("ETag", etag);
+  resp->addHeader("Last-Modified", file->lastModified);
+  if (vary)
+  {
+    resp->addHeader("Vary", "Accept-Encoding");
+  }
+
+  StringPiece ifNoneMatch(req.findHeader("If-None-Match"));
+  bool notModified = false;
+  if (!ifNoneMatch.empty())
+  {
+    notModified = anyOf(ifNoneMatch, EtagMatches(file->etag));
+  }
+  else
+  {
+    time_t since = 0;
+    notModified = parseHttpDate(req.findHeader("If-Modified-Since"), &since)
+      && file->mtime <= since;
+  }
+  if (notModified)
+  {
+    resp->setStatusCode(HttpResponse::k304NotModified);
+    return true;
+  }
+
+  resp->addHeader("Accept-Ranges", "bytes");
+  resp->setContentType(file->contentType);
+  StringPiece ifRange(req.findHeader("If-Range"));
+  if (!range.empty() && (ifRange.empty() || ifRange == file->etag || ifRange == file->lastModified))
+  {
+    int64_t first = 0;
+    int64_t last = 0;
+    int result = parseRange(range, file->size, &first, &last);
+    char contentRange[64];
+    if (result < 0)
+    {
+      snprintf(contentRange, sizeof contentRange, "bytes */%lld",
+               static_cast<long long>(file->size));
+      resp->addHeader("Content-Range", contentRange);
+      resp->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+      return true;
+    }
+    else if (result > 0)
+    {
+      snprintf(contentRange, sizeof contentRange, "bytes %lld-%lld/%lld",
+               static_cast<long long>(first), static_cast<long long>(last),
+               static_cast<long long>(file->size));
+      resp->addHeader("Content-Range", contentRange);
+      resp->setStatusCode(HttpResponse::k206PartialContent);
+      resp->setBodyFile(file->fd, first, static_cast<size_t>(last - first + 1), file);
+      return true;
+    }
+  }
+
+  resp->setStatusCode(HttpResponse::k200Ok);
+  if (encoding != kIdentity)
+  {
+    resp->addHeader("Content-Encoding", kEncodingNames[encoding]);
+  }
+  if (body)
+  {
+    resp->setBody(body);
+  }
+  else
+  {
+    resp->setBodyFile(file->fd, 0, static_cast<size_t>(file->size), file);
+  }
+  return true;
+}
+
+StaticFileHandler::FilePtr StaticFileHandler::getFile(const string& path, int* status)
+{
+  Timestamp now(Timestamp::now());
+  FilePtr file;
+  {
+    MutexLockGuard lock(mutex_);
+    std::map<string, FilePtr>::iterator it = files_.find(path);
+    if (it != files_.end())
+    {
+      file = it->second;
+      file->lastUsed = ++useCount_;
+      // the limits may have been lowered
+      evictLocked(file);
+      if (timeDifference(now, file->checked) < revalidateInterval_)
+      {
+        return file;
+      }
+    }
+  }
+
+  if (file)
+  {
+    struct stat st;
+    if (::stat((root_ + path).c_str(), &st) == 0 && st.st_ino == file->ino
+        && st.st_size == file->size && st.st_mtime == file->mtime)
+    {
+      MutexLockGuard lock(mutex_);
+      file->checked = now;
+      return file;
+    }
+  }
+
+  // changed, removed, or not cached, the old one is closed when
+  // all responses of it are written
+  file = loadFile(path, status);
+  if (file)
+  {
+    file->checked = now;
+  }
+  insert(path, file);
+  return file;
+}
+
+StaticFileHandler::FilePtr StaticFileHandler::loadFile(const string& path, int* status) const
+{
+  int fd = ::open((root_ + path).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    *status = errno == EACCES ? HttpResponse::k403Forbidden : HttpResponse::k404NotFound;
+    return FilePtr();
+  }
+  FilePtr file(new File);
+  file->fd = fd;
+
+  struct stat st;
+  bzero(&st, sizeof st);
+  if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+  {
+    *status = S_ISDIR(st.st_mode) ? HttpResponse::k301MovedPermanently
+                                  : HttpResponse::k404NotFound;
+    return FilePtr();
+  }
+  file->size = st.st_size;
+  file->mtime = st.st_mtime;
+  file->ino = st.st_ino;
+  const MimeType& mime = mimeType(path);
+  file->contentType = mime.type;
+  file->compressible = mime.compressible;
+
+  char buf[64];
+  snprintf(buf, sizeof buf, "\"%lx-%llx\"",
+           static_cast<unsigned long>(file->mtime), static_cast<unsigned long long>(file->size));
+  file->etag = buf;
+  struct tm tm;
+  ::gmtime_r(&file->mtime, &tm);
+  file->lastModified.assign(buf, ::strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm));
+
+  if (file->size <= static_cast<int64_t>(maxInMemoryFileSize_))
+  {
+    boost::shared_ptr<string> content(new string(static_cast<size_t>(file->size), '\0'));
+    size_t done = 0;
+    while (done < content->size())
+    {
+      ssize_t n = ::pread(fd, &(*content)[done], content->size() - done, static_cast<off_t>(done));
+      if (n <= 0)
+      {
+        break;
+      }
+      done += n;
+    }
+    if (done < content->size())
+    {
+      // truncated while reading, the next stat(2) sees it
+      LOG_WARN << "StaticFileHandler " << path << " short read " << done;
+      content->resize(done);
+      file->size = static_cast<int64_t>(done);
+    }
+    file->content = content;
+  }
+  return file;
+}
+
+// the old one of path is replaced, or removed if file is NULL
+void StaticFileHandler::insert(const string& path, const FilePtr& file)
+{
+  MutexLockGuard lock(mutex_);
+  std::map<string, FilePtr>::iterator it = files_.find(path);
+  if (it != files_.end())
+  {
+    cacheBytes_ -= it->second->bytes();
+    it->second->cached = false;
+    files_.erase(it);
+  }
+  if (!file)
+  {
+    return;
+  }
+  file->cached = true;
+  file->lastUsed = ++useCount_;
+  cacheBytes_ += file->bytes();
+  files_[path] = file;
+  evictLocked(file);
+}
+
+// the least recently used but @c keep, a linear scan, but it is rare
+void StaticFileHandler::evictLocked(const FilePtr& keep)
+{
+  mutex_.assertLocked();
+  while ((cacheBytes_ > maxCacheBytes_ || files_.size() > maxCachedFiles_) && files_.size() > 1)
+  {
+    std::map<string, FilePtr>::iterator lru = files_.end();
+    for (std::map<string, FilePtr>::iterator it = files_.begin(); it != files_.end(); ++it)
+    {
+      if (it->second != keep && (lru == files_.end() || it->second->lastUsed < lru->second->lastUsed))
+      {
+        lru = it;
+      }
+    }
+    cacheBytes_ -= lru->second->bytes();
+    lru->second->cached = false;
+    files_.erase(lru);
+  }
+}
+
+// compressed on first use, out of the lock, two threads may both do it
+boost::shared_ptr<const string> StaticFileHandler::variant(const FilePtr& file, Encoding encoding)
+{
+  {
+    MutexLockGuard lock(mutex_);
+    if (file->variants[encoding])
+    {
+      return file->variants[encoding];
+    }
+  }
+
+  Buffer output;
+  bool ok = false;
+  {
+    ZlibOutputStream stream(&output, encoding == kGzip);
+    ok = stream.write(*file->content) && stream.finish();
+  }
+  boost::shared_ptr<const string> compressed(file->content);
+  if (ok && output.readableBytes() < file->content->size())
+  {
+    compressed.reset(new string(output.peek(), output.readableBytes()));
+  }
+  else if (!ok)
+  {
+    LOG_ERROR << "StaticFileHandler " << kEncodingNames[encoding] << " failed";
+  }
+
+  MutexLockGuard lock(mutex_);
+  if (!file->variants[encoding])
+  {
+    size_t before = file->bytes();
+    file->variants[encoding] = compressed;
+    if (file->cached)
+    {
+      cacheBytes_ += file->bytes() - before;
+      evictLocked(file);
+    }
+  }
+  return file->variants[encoding];
+}
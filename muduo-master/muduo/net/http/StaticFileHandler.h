@@ -0,0 +1,109 @@
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+//
+// This is a public header file, it must only include public header files.
+
+#ifndef MUDUO_NET_HTTP_STATICFILEHANDLER_H
+#define MUDUO_NET_HTTP_STATICFILEHANDLER_H
+
+#include <muduo/base/Mutex.h>
+#include <muduo/base/Types.h>
+
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <map>
+
+namespace muduo
+{
+namespace net
+{
+
+class HttpRequest;
+class HttpResponse;
+
+///
+/// Serves files under a directory, for HttpServer.
+///
+/// Opened files are cached, small ones with their contents, which are
+/// sent by reference, large ones are sent with sendfile(2).
+/// Text files are compressed with gzip or deflate on the first request
+/// which accepts it, and the compressed variant is cached too.
+/// Supports ETag, If-None-Match, If-Modified-Since, a single Range
+/// with If-Range, and HEAD.
+///
+/// Thread safe, one handler for all IO threads of a HttpServer.
+/// @code
+/// StaticFileHandler files("/var/www", "/static/");
+/// server.setHttpCallback(boost::bind(&StaticFileHandler::onRequest, &files, _1, _2));
+/// @endcode
+class StaticFileHandler : boost::noncopyable
+{
+ public:
+  /// Paths starting with @c prefix are files under @c root,
+  /// eg. "/static/a.js" is root + "/a.js".
+  explicit StaticFileHandler(const string& root, const string& prefix = "/");
+  ~StaticFileHandler();
+
+  // Not thread safe, set them before serving.
+
+  /// Contents and compressed variants cached, default 64MiB.
+  void setMaxCacheBytes(size_t bytes)
+  { maxCacheBytes_ = bytes; }
+
+  /// Files cached, each keeps an fd open, default 1024.
+  void setMaxCachedFiles(size_t n)
+  { maxCachedFiles_ = n; }
+
+  /// Larger files are sent with sendfile(2), not compressed, default 1MiB.
+  void setMaxInMemoryFileSize(size_t bytes)
+  { maxInMemoryFileSize_ = bytes; }
+
+  /// A cached file is stat(2)ed at most once in @c seconds, default 1.
+  void setRevalidateInterval(double seconds)
+  { revalidateInterval_ = seconds; }
+
+  /// Default on.
+  void setCompression(bool on)
+  { compression_ = on; }
+
+  /// Returns false and leaves @c resp alone if the path is not under prefix,
+  /// so that the caller may serve it in other ways.
+  bool serve(const HttpRequest& req, HttpResponse* resp);
+
+  /// As a HttpServer::HttpCallback, 404 for paths not under prefix.
+  void onRequest(const HttpRequest& req, HttpResponse* resp);
+
+  size_t numCachedFiles() const;
+  size_t cacheBytes() const;
+
+ private:
+  struct File;
+  typedef boost::shared_ptr<File> FilePtr;
+
+  enum Encoding { kIdentity, kGzip, kDeflate };
+
+  FilePtr getFile(const string& path, int* status);
+  FilePtr loadFile(const string& path, int* status) const;
+  void insert(const string& path, const FilePtr& file);
+  void evictLocked(const FilePtr& keep);
+  boost::shared_ptr<const string> variant(const FilePtr& file, Encoding encoding);
+
+  const string root_;
+  const string prefix_;
+  size_t maxCacheBytes_;
+  size_t maxCachedFiles_;
+  size_t maxInMemoryFileSize_;
+  double revalidateInterval_;
+  bool compression_;
+
+  mutable MutexLock mutex_;
+  std::map<string, FilePtr> files_;  // by path under root
+  size_t cacheBytes_;
+  int64_t useCount_;  // for LRU
+};
+
+}
+}
+
+#endif  // MUDUO_NET_HTTP_STATICFILEHANDLER_H
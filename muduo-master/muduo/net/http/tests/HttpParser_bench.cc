@@ -0,0 +1,142 @@
+#include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpScanner.h>
+#include <muduo/net/Buffer.h>
+
+#include <algorithm>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// what HttpContext did before, byte by byte, a map of headers
+class LegacyParser
+{
+ public:
+  bool parse(Buffer* buf)
+  {
+    const char* crlf = buf->findCRLF();
+    if (!crlf)
+      return false;
+    const char* space = std::find(buf->peek(), crlf, ' ');
+    method_.assign(buf->peek(), space);
+    const char* start = space + 1;
+    space = std::find(start, crlf, ' ');
+    const char* question = std::find(start, space, '?');
+    path_.assign(start, question);
+    query_.assign(question, space);
+    buf->retrieveUntil(crlf + 2);
+    while ((crlf = buf->findCRLF()) != NULL)
+    {
+      const char* colon = std::find(buf->peek(), crlf, ':');
+      if (colon == crlf)
+      {
+        buf->retrieveUntil(crlf + 2);
+        return true;
+      }
+      string field(buf->peek(), colon);
+      ++colon;
+      while (colon < crlf && isspace(*colon))
+        ++colon;
+      string value(colon, crlf);
+      while (!value.empty() && isspace(value[value.size()-1]))
+        value.resize(value.size()-1);
+      headers_[field] = value;
+      buf->retrieveUntil(crlf + 2);
+    }
+    return false;
+  }
+
+  void reset()
+  {
+    std::map<string, string> dummy;
+    headers_.swap(dummy);
+  }
+
+ private:
+  string method_;
+  string path_;
+  string query_;
+  std::map<string, string> headers_;
+};
+
+const char kRequest[] =
+  "GET /dashboard/api/v1/metrics?host=web-42&range=3600&step=15 HTTP/1.1\r\n"
+  "Host: monitor.example.com:8080\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 "
+  "(KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+  "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,"
+  "image/webp,*/*;q=0.8\r\n"
+  "Accept-Language: en-US,en;q=0.9\r\n"
+  "Accept-Encoding: gzip, deflate, br\r\n"
+  "Referer: http://monitor.example.com:8080/dashboard/overview\r\n"
+  "Cookie: session=3f6c8a4d9b2e4f10a7c5d8e9f0a1b2c3; theme=dark; tz=UTC\r\n"
+  "Connection: keep-alive\r\n"
+  "Cache-Control: max-age=0\r\n"
+  "Upgrade-Insecure-Requests: 1\r\n"
+  "\r\n";
+
+const int kPipeline = 16;
+
+template<typename Parser>
+double run(Parser* parser, int n)
+{
+  Buffer buf;
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < n; i += kPipeline)
+  {
+    for (int j = 0; j < kPipeline; ++j)
+    {
+      buf.append(kRequest, sizeof kRequest - 1);
+    }
+    for (int j = 0; j < kPipeline; ++j)
+    {
+      if (!parser->parse(&buf))
+      {
+        printf("parse error\n");
+        abort();
+      }
+      parser->reset();
+    }
+  }
+  return timeDifference(Timestamp::now(), start);
+}
+
+struct ContextParser
+{
+  bool parse(Buffer* buf)
+  {
+    return context.parseRequest(buf, Timestamp()) && context.gotAll()
+        && context.request().findHeader("Host").size() > 0;
+  }
+  void reset() { context.reset(); }
+  HttpContext context;
+};
+
+void report(const char* name, double seconds, int n)
+{
+  printf("%-16s %.3f s %8.0f ns/request %6.0f MiB/s\n", name, seconds,
+         seconds * 1e9 / n, n * (sizeof kRequest - 1) / seconds / 1024 / 1024);
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  printf("%d requests of %zd bytes\n", n, sizeof kRequest - 1);
+
+  LegacyParser legacy;
+  report("legacy", run(&legacy, n), n);
+
+  const char* names[] = { "scalar", "sse2", "avx2" };
+  const detail::HttpScanKind kinds[] = {
+    detail::kScanScalar, detail::kScanSse2, detail::kScanAvx2 };
+  for (int i = 0; i < 3; ++i)
+  {
+    if (detail::setHttpScanKind(kinds[i]))
+    {
+      ContextParser parser;
+      report(names[i], run(&parser, n), n);
+    }
+  }
+}
@@ -1,4 +1,5 @@
 #include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpScanner.h>
 #include <muduo/net/Buffer.h>
 
 //#define BOOST_TEST_MODULE BufferTest
@@ -77,3 +78,186 @@ BOOST_AUTO_TEST_CASE(testParseRequestEmptyHeaderValue)
   BOOST_CHECK_EQUAL(request.getHeader("User-Agent"), string(""));
   BOOST_CHECK_EQUAL(request.getHeader("Accept-Encoding"), string(""));
 }
+
+BOOST_AUTO_TEST_CASE(testParseRequestContentLength)
+{
+  string all("POST /upload HTTP/1.1\r\n"
+       "Content-Length: 11\r\n"
+       "\r\n"
+       "hello world");
+
+  for (size_t sz1 = 0; sz1 < all.size(); ++sz1)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(!context.gotAll());
+
+    input.append(all.c_str() + sz1, all.size() - sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().method(), HttpRequest::kPost);
+    BOOST_CHECK_EQUAL(context.request().body().as_string(), string("hello world"));
+    // left in the buffer, no copying
+    BOOST_CHECK_EQUAL(context.request().body().data(), input.peek());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestChunked)
+{
+  string all("POST /upload HTTP/1.1\r\n"
+       "Transfer-Encoding: chunked\r\n"
+       "\r\n"
+       "5\r\nhello\r\n"
+       "6;name=value\r\n world\r\n"
+       "0\r\n"
+       "Trailer: ignored\r\n"
+       "\r\n");
+
+  for (size_t sz1 = 0; sz1 < all.size(); ++sz1)
+  {
+    HttpContext context;
+    Buffer input;
+    input.append(all.c_str(), sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(!context.gotAll());
+
+    input.append(all.c_str() + sz1, all.size() - sz1);
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().body().as_string(), string("hello world"));
+    BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestPipelined)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("POST /a HTTP/1.1\r\n"
+       "Content-Length: 3\r\n"
+       "\r\n"
+       "abc"
+       "GET /b HTTP/1.0\r\n"
+       "connection: Keep-Alive\r\n"
+       "\r\n"
+       "GET /c HTTP/1.1\r\n"
+       "Connection: close\r\n"
+       "\r\n");
+
+  const char* paths[] = { "/a", "/b", "/c" };
+  const bool keepAlive[] = { true, true, false };
+  for (int i = 0; i < 3; ++i)
+  {
+    BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK(context.gotAll());
+    BOOST_CHECK_EQUAL(context.request().path(), string(paths[i]));
+    BOOST_CHECK_EQUAL(context.keepAlive(), keepAlive[i]);
+    BOOST_CHECK_EQUAL(context.numRequests(), i);
+    context.reset();
+  }
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(!context.gotAll());
+  BOOST_CHECK_EQUAL(input.readableBytes(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestErrors)
+{
+  const char* requests[] = {
+    "GET / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 1\r\n\r\n",
+    "GET / HTTP/1.1\r\nContent-Length: 1\r\nTransfer-Encoding: chunked\r\n\r\n",
+    "GET / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nab\r\n",
+    "POST / HTTP/1.1\r\nContent-Length: 1025\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n401\r\n",
+    "GET / HTTP/1.1\r\nHost: 01234567890123456789012345678901234567890123456789012345678901234567890123456789\r\n",
+  };
+  const int status[] = { 400, 400, 400, 400, 400, 400, 413, 413, 431 };
+  for (size_t i = 0; i < sizeof requests / sizeof requests[0]; ++i)
+  {
+    HttpContext context;
+    context.setMaxHeaderSize(80);
+    context.setMaxBodySize(1024);
+    Buffer input;
+    input.append(requests[i]);
+    BOOST_CHECK(!context.parseRequest(&input, Timestamp::now()));
+    BOOST_CHECK_EQUAL(context.errorStatus(), status[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testParseRequestHeaderIndex)
+{
+  HttpContext context;
+  Buffer input;
+  input.append("GET /search?q=muduo HTTP/1.1\r\n"
+       "Host: www.chenshuo.com\r\n"
+       "X-Dup: first\r\n"
+       "x-dup: second\r\n"
+       "Cookie:   a=b  \r\n"
+       "\r\n");
+
+  BOOST_CHECK(context.parseRequest(&input, Timestamp::now()));
+  BOOST_CHECK(context.gotAll());
+  const HttpRequest& request = context.request();
+  BOOST_CHECK_EQUAL(request.path(), string("/search"));
+  BOOST_CHECK_EQUAL(request.query(), string("?q=muduo"));
+  BOOST_CHECK_EQUAL(request.numHeaders(), 4);
+  BOOST_CHECK_EQUAL(request.headerName(1).as_string(), string("X-Dup"));
+  BOOST_CHECK_EQUAL(request.findHeader("HOST").as_string(), string("www.chenshuo.com"));
+  BOOST_CHECK_EQUAL(request.getHeader("X-DUP"), string("second"));
+  BOOST_CHECK_EQUAL(request.getHeader("Cookie"), string("a=b"));
+  BOOST_CHECK(request.findHeader("Accept").data() == NULL);
+  BOOST_CHECK_EQUAL(request.headers().size(), 4);
+  BOOST_CHECK_EQUAL(request.headers().find("Host")->second, string("www.chenshuo.com"));
+
+  HttpRequest copy(request);
+  context.reset();
+  BOOST_CHECK_EQUAL(copy.getHeader("host"), string("www.chenshuo.com"));
+}
+
+BOOST_AUTO_TEST_CASE(testScanKinds)
+{
+  using namespace muduo::net::detail;
+  const HttpScanKind saved = httpScanKind();
+  const HttpScanKind kinds[] = { kScanScalar, kScanSse2, kScanAvx2 };
+  string text;
+  for (int i = 0; i < 100; ++i)
+  {
+    text += static_cast<char>('a' + i % 26);
+  }
+  for (size_t k = 0; k < sizeof kinds / sizeof kinds[0]; ++k)
+  {
+    if (!setHttpScanKind(kinds[k]))
+    {
+      continue;
+    }
+    // every position of the delimiter, every length
+    for (size_t len = 0; len <= text.size(); ++len)
+    {
+      for (size_t pos = 0; pos <= len; ++pos)
+      {
+        string s(text, 0, len);
+        if (pos < len)
+        {
+          s[pos] = ':';
+        }
+        const char* begin = s.data();
+        BOOST_CHECK_EQUAL(findEither(begin, begin + len, ':', '\r') - begin, pos);
+        if (pos + 4 <= len)
+        {
+          s.replace(pos, 4, "\r\n\r\n");
+          begin = s.data();
+          BOOST_CHECK_EQUAL(findHeadersEnd(begin, begin + len) - begin, pos + 4);
+        }
+        else
+        {
+          BOOST_CHECK(findHeadersEnd(begin, begin + len) == NULL);
+        }
+      }
+    }
+  }
+  setHttpScanKind(saved);
+}
@@ -0,0 +1,88 @@
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+#include <muduo/base/Timestamp.h>
+
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// what HttpResponse did before, snprintf, a map of headers
+class LegacyResponse
+{
+ public:
+  explicit LegacyResponse(bool close)
+    : statusCode_(0), closeConnection_(close)
+  {
+  }
+
+  void setStatusCode(int code) { statusCode_ = code; }
+  void setStatusMessage(const string& message) { statusMessage_ = message; }
+  void setContentType(const string& contentType) { addHeader("Content-Type", contentType); }
+  void addHeader(const string& key, const string& value) { headers_[key] = value; }
+  void setBody(const string& body) { body_ = body; }
+
+  void appendToBuffer(Buffer* output) const
+  {
+    char buf[32];
+    snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
+    output->append(buf);
+    output->append(statusMessage_);
+    output->append("\r\n");
+    snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());
+    output->append(buf);
+    output->append("Connection: Keep-Alive\r\n");
+    for (std::map<string, string>::const_iterator it = headers_.begin();
+         it != headers_.end();
+         ++it)
+    {
+      output->append(it->first);
+      output->append(": ");
+      output->append(it->second);
+      output->append("\r\n");
+    }
+    output->append("\r\n");
+    output->append(body_);
+  }
+
+ private:
+  std::map<string, string> headers_;
+  int statusCode_;
+  string statusMessage_;
+  bool closeConnection_;
+  string body_;
+};
+
+// the /hello of HttpServer_test
+template<typename Response>
+double run(int n, Buffer* output)
+{
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    Response response(false);
+    response.setStatusCode(HttpResponse::k200Ok);
+    response.setStatusMessage("OK");
+    response.setContentType("text/plain");
+    response.addHeader("Server", "Muduo");
+    response.setBody("hello, world!\n");
+    response.appendToBuffer(output);
+    output->retrieveAll();
+  }
+  return timeDifference(Timestamp::now(), start);
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  Buffer output;
+  double legacy = run<LegacyResponse>(n, &output);
+  printf("legacy      %.3f s %6.0f ns/response\n", legacy, legacy * 1e9 / n);
+  double uncached = run<HttpResponse>(n, &output);
+  printf("no timer    %.3f s %6.0f ns/response\n", uncached, uncached * 1e9 / n);
+  HttpResponse::cacheDate();  // as HttpServer does every second
+  double cached = run<HttpResponse>(n, &output);
+  printf("HttpResponse %.3f s %6.0f ns/response, %.2fx\n", cached, cached * 1e9 / n, legacy / cached);
+}
@@ -0,0 +1,127 @@
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::Buffer;
+using muduo::net::HttpResponse;
+
+// without the Date header, which changes
+string toString(const HttpResponse& response)
+{
+  Buffer output;
+  response.appendToBuffer(&output);
+  string result(output.retrieveAllAsString());
+  size_t date = result.find("\r\nDate: ");
+  BOOST_REQUIRE(date != string::npos);
+  size_t end = result.find("\r\n", date + 2);
+  BOOST_CHECK_EQUAL(end - date, 37);
+  return result.erase(date + 2, end - date);
+}
+
+BOOST_AUTO_TEST_CASE(testResponse)
+{
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setStatusMessage("OK");
+  response.setContentType("text/plain");
+  response.addHeader("Server", "Muduo");
+  response.setBody("hello, world!\n");
+  BOOST_CHECK_EQUAL(toString(response),
+      string("HTTP/1.1 200 OK\r\n"
+             "Content-Length: 14\r\n"
+             "Connection: Keep-Alive\r\n"
+             "Content-Type: text/plain\r\n"
+             "Server: Muduo\r\n"
+             "\r\n"
+             "hello, world!\n"));
+
+  // cached by a timer of HttpServer, the same
+  HttpResponse::cacheDate();
+  BOOST_CHECK_EQUAL(toString(response).size(), 118);
+}
+
+BOOST_AUTO_TEST_CASE(testStatusLine)
+{
+  HttpResponse response(true);
+  response.setStatusCode(HttpResponse::k404NotFound);
+  BOOST_CHECK_EQUAL(toString(response),
+      string("HTTP/1.1 404 Not Found\r\n"
+             "Content-Length: 0\r\n"
+             "Connection: close\r\n"
+             "\r\n"));
+
+  response.setStatusMessage("Nothing Here");
+  BOOST_CHECK_EQUAL(toString(response).substr(0, 27), string("HTTP/1.1 404 Nothing Here\r\n"));
+
+  HttpResponse noContent(false);
+  noContent.setStatusCode(HttpResponse::k204NoContent);
+  BOOST_CHECK_EQUAL(toString(noContent),
+      string("HTTP/1.1 204 No Content\r\n"
+             "Connection: Keep-Alive\r\n"
+             "\r\n"));
+}
+
+BOOST_AUTO_TEST_CASE(testManyHeaders)
+{
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  string expected;
+  for (int i = 0; i < 20; ++i)
+  {
+    char key[32];
+    snprintf(key, sizeof key, "X-Header-%d", i);
+    string value(i, 'v');
+    response.addHeader(key, value);
+    expected += string(key) + ": " + value + "\r\n";
+  }
+  BOOST_CHECK_EQUAL(toString(response),
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Length: 0\r\n"
+      "Connection: Keep-Alive\r\n" + expected + "\r\n");
+}
+
+BOOST_AUTO_TEST_CASE(testBodyReference)
+{
+  boost::shared_ptr<const string> body(new string(10000, 'x'));
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k200Ok);
+  response.setBody(body);
+  BOOST_CHECK(response.hasBodyReference());
+  BOOST_CHECK_EQUAL(response.bodyLength(), 10000);
+
+  Buffer head;
+  response.appendHeadToBuffer(&head);
+  string s(head.retrieveAllAsString());
+  BOOST_CHECK(s.find("Content-Length: 10000\r\n") != string::npos);
+  BOOST_CHECK_EQUAL(s.substr(s.size() - 4), string("\r\n\r\n"));
+  BOOST_CHECK_EQUAL(toString(response).size(), s.size() - 37 + 10000);
+}
+
+BOOST_AUTO_TEST_CASE(testBodyFile)
+{
+  char name[] = "/tmp/httpresponse_unittest_XXXXXX";
+  int fd = ::mkstemp(name);
+  BOOST_REQUIRE(fd >= 0);
+  ::unlink(name);
+  BOOST_REQUIRE_EQUAL(::write(fd, "0123456789", 10), 10);
+
+  HttpResponse response(false);
+  response.setStatusCode(HttpResponse::k206PartialContent);
+  response.setBodyFile(fd, 2, 5);
+  string s(toString(response));
+  BOOST_CHECK_EQUAL(s.substr(0, 34), string("HTTP/1.1 206 Partial Content\r\nCont"));
+  BOOST_CHECK(s.find("Content-Length: 5\r\n") != string::npos);
+  BOOST_CHECK_EQUAL(s.substr(s.size() - 9), string("\r\n\r\n23456"));
+
+  response.setBody("inline");
+  BOOST_CHECK(!response.hasBodyReference());
+  ::close(fd);
+}
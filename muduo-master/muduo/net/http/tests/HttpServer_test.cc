@@ -61,19 +61,29 @@ void onRequest(const HttpRequest& req, HttpResponse* resp)
   }
 }
 
+// usage: httpserver_test [io threads] [worker threads]
 int main(int argc, char* argv[])
 {
   int numThreads = 0;
+  int numWorkers = 0;
   if (argc > 1)
   {
     benchmark = true;
     Logger::setLogLevel(Logger::WARN);
     numThreads = atoi(argv[1]);
+    numWorkers = argc > 2 ? atoi(argv[2]) : 0;
   }
   EventLoop loop;
   HttpServer server(&loop, InetAddress(8000), "dummy");
+  // stopped before the server is destroyed
+  ThreadPool workers("HttpWorker");
   server.setHttpCallback(onRequest);
   server.setThreadNum(numThreads);
+  if (numWorkers > 0)
+  {
+    workers.start(numWorkers);
+    server.setThreadPool(&workers);
+  }
   server.start();
   loop.loop();
 }
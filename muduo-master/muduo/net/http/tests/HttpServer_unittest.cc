@@ -0,0 +1,277 @@
+#include <muduo/net/http/HttpServer.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/InetAddress.h>
+
+#include <boost/bind.hpp>
+#include <boost/scoped_ptr.hpp>
+
+//#define BOOST_TEST_MODULE HttpServerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// asks the kernel for an unused port, so tests may run in parallel
+uint16_t freePort()
+{
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  ::memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrlen = sizeof addr;
+  BOOST_REQUIRE(::bind(sockfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) == 0);
+  BOOST_REQUIRE(::getsockname(sockfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) == 0);
+  ::close(sockfd);
+  return ntohs(addr.sin_port);
+}
+
+// "/sleep/<ms>" sleeps, "/block/<n>" waits for the gate, the body is the path
+class Handler
+{
+ public:
+  Handler()
+    : gate_(1),
+      blocked_(0)
+  {
+  }
+
+  void onRequest(const HttpRequest& req, HttpResponse* resp)
+  {
+    const string& path = req.path();
+    if (path.compare(0, 7, "/sleep/") == 0)
+    {
+      ::usleep(atoi(path.c_str() + 7) * 1000);
+    }
+    else if (path.compare(0, 7, "/block/") == 0)
+    {
+      __atomic_fetch_add(&blocked_, 1, __ATOMIC_RELAXED);
+      gate_.wait();
+    }
+    resp->setStatusCode(HttpResponse::k200Ok);
+    resp->setStatusMessage("OK");
+    resp->setBody(path);
+  }
+
+  void open() { gate_.countDown(); }
+  int blocked() const { return __atomic_load_n(&blocked_, __ATOMIC_RELAXED); }
+
+ private:
+  CountDownLatch gate_;
+  int blocked_; /* atomic */
+};
+
+// a HttpServer in its own loop thread, callbacks in a ThreadPool
+class Server
+{
+ public:
+  Server(int numWorkers, int maxInFlight)
+    : loop_(thread_.startLoop()),
+      port_(freePort()),
+      pool_("HttpWorker")
+  {
+    pool_.start(numWorkers);
+    CountDownLatch started(1);
+    loop_->runInLoop(boost::bind(&Server::start, this, maxInFlight, &started));
+    started.wait();
+  }
+
+  ~Server()
+  {
+    // the pool first, as HttpServer requires
+    handler_.open();
+    pool_.stop();
+    CountDownLatch stopped(1);
+    loop_->runInLoop(boost::bind(&Server::stop, this, &stopped));
+    stopped.wait();
+  }
+
+  // a blocking client, which gives up reading after 5 seconds
+  int connect()
+  {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr(port_, true);
+    BOOST_REQUIRE(::connect(sockfd, addr.getSockAddr(), sizeof(struct sockaddr_in)) == 0);
+    struct timeval tv = { 5, 0 };
+    ::setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    return sockfd;
+  }
+
+  Handler& handler() { return handler_; }
+
+ private:
+  void start(int maxInFlight, CountDownLatch* started)
+  {
+    server_.reset(new HttpServer(loop_, InetAddress(port_, true), "HttpServer"));
+    server_->setHttpCallback(boost::bind(&Handler::onRequest, &handler_, _1, _2));
+    server_->setThreadPool(&pool_, maxInFlight);
+    server_->start();
+    started->countDown();
+  }
+
+  void stop(CountDownLatch* stopped)
+  {
+    server_.reset();
+    stopped->countDown();
+  }
+
+  EventLoopThread thread_;
+  EventLoop* loop_;
+  const uint16_t port_;
+  Handler handler_;
+  boost::scoped_ptr<HttpServer> server_;
+  ThreadPool pool_;
+};
+
+void sendAll(int fd, const string& data)
+{
+  BOOST_REQUIRE(::write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+}
+
+string get(const string& path, const char* headers = "")
+{
+  return "GET " + path + " HTTP/1.1\r\nHost: test\r\n" + headers + "\r\n";
+}
+
+// bodies of @c n responses, fewer if the connection is closed or times out
+std::vector<string> readBodies(int fd, int n)
+{
+  std::vector<string> bodies;
+  string input;
+  char buf[4096];
+  while (static_cast<int>(bodies.size()) < n)
+  {
+    size_t headerEnd = input.find("\r\n\r\n");
+    size_t lengthAt = input.find("Content-Length: ");
+    if (headerEnd != string::npos && lengthAt < headerEnd)
+    {
+      size_t length = static_cast<size_t>(atoi(input.c_str() + lengthAt + 16));
+      if (input.size() >= headerEnd + 4 + length)
+      {
+        bodies.push_back(input.substr(headerEnd + 4, length));
+        input.erase(0, headerEnd + 4 + length);
+        continue;
+      }
+    }
+    ssize_t nr = ::read(fd, buf, sizeof buf);
+    if (nr <= 0)
+    {
+      break;
+    }
+    input.append(buf, nr);
+  }
+  return bodies;
+}
+
+// true if the peer closes the connection
+bool readEof(int fd)
+{
+  char buf[64];
+  return ::read(fd, buf, sizeof buf) == 0;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testPipelinedResponsesInOrder)
+{
+  Server server(4, 16);
+  int sockfd = server.connect();
+
+  // done in reverse order by the workers
+  sendAll(sockfd, get("/sleep/300") + get("/sleep/200") + get("/sleep/100") + get("/sleep/0"));
+  std::vector<string> bodies = readBodies(sockfd, 4);
+  BOOST_REQUIRE_EQUAL(bodies.size(), 4u);
+  BOOST_CHECK_EQUAL(bodies[0], "/sleep/300");
+  BOOST_CHECK_EQUAL(bodies[1], "/sleep/200");
+  BOOST_CHECK_EQUAL(bodies[2], "/sleep/100");
+  BOOST_CHECK_EQUAL(bodies[3], "/sleep/0");
+  ::close(sockfd);
+}
+
+BOOST_AUTO_TEST_CASE(testStopReadingWhenTooManyInFlight)
+{
+  const int kMaxInFlight = 2;
+  const int kRequests = 6;
+  Server server(4, kMaxInFlight);
+  int sockfd = server.connect();
+
+  string requests;
+  for (int i = 0; i < kRequests; ++i)
+  {
+    char path[32];
+    snprintf(path, sizeof path, "/block/%d", i);
+    requests += get(path);
+  }
+  sendAll(sockfd, requests);
+  // the rest waits in the input buffer, though workers are idle
+  ::usleep(300*1000);
+  BOOST_CHECK_EQUAL(server.handler().blocked(), kMaxInFlight);
+
+  server.handler().open();
+  std::vector<string> bodies = readBodies(sockfd, kRequests);
+  BOOST_REQUIRE_EQUAL(bodies.size(), static_cast<size_t>(kRequests));
+  for (int i = 0; i < kRequests; ++i)
+  {
+    char path[32];
+    snprintf(path, sizeof path, "/block/%d", i);
+    BOOST_CHECK_EQUAL(bodies[i], path);
+  }
+  BOOST_CHECK_EQUAL(server.handler().blocked(), kRequests);
+  ::close(sockfd);
+}
+
+BOOST_AUTO_TEST_CASE(testNoLimitOfInFlight)
+{
+  const int kRequests = 20;
+  Server server(2, 0);
+  int sockfd = server.connect();
+
+  string requests;
+  for (int i = 0; i < kRequests; ++i)
+  {
+    requests += get("/block/");
+  }
+  sendAll(sockfd, requests);
+  // all of them reach the pool
+  for (int i = 0; i < 100 && server.handler().blocked() < 2; ++i)
+  {
+    ::usleep(10*1000);
+  }
+  server.handler().open();
+  BOOST_CHECK_EQUAL(readBodies(sockfd, kRequests).size(), static_cast<size_t>(kRequests));
+  ::close(sockfd);
+}
+
+BOOST_AUTO_TEST_CASE(testCloseAfterInFlight)
+{
+  Server server(4, 16);
+  int sockfd = server.connect();
+
+  // answered before the connection is closed, the one after close is not
+  sendAll(sockfd, get("/sleep/200") + get("/sleep/0", "Connection: close\r\n")
+          + get("/ignored"));
+  std::vector<string> bodies = readBodies(sockfd, 3);
+  BOOST_REQUIRE_EQUAL(bodies.size(), 2u);
+  BOOST_CHECK_EQUAL(bodies[0], "/sleep/200");
+  BOOST_CHECK_EQUAL(bodies[1], "/sleep/0");
+  BOOST_CHECK(readEof(sockfd));
+  ::close(sockfd);
+}
@@ -0,0 +1,347 @@
+#include <muduo/net/http/StaticFileHandler.h>
+#include <muduo/net/http/HttpContext.h>
+#include <muduo/net/http/HttpRequest.h>
+#include <muduo/net/http/HttpResponse.h>
+#include <muduo/net/Buffer.h>
+
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+using muduo::string;
+using muduo::Timestamp;
+using muduo::net::Buffer;
+using muduo::net::HttpContext;
+using muduo::net::HttpResponse;
+using muduo::net::StaticFileHandler;
+
+namespace
+{
+
+string g_root;
+string g_html;  // index.html
+string g_big;   // big.txt
+
+bool writeFile(const string& name, const string& content)
+{
+  FILE* fp = ::fopen((g_root + name).c_str(), "w");
+  if (fp == NULL)
+  {
+    return false;
+  }
+  ::fwrite(content.data(), 1, content.size(), fp);
+  ::fclose(fp);
+  return true;
+}
+
+// a temporary directory of files
+struct Files
+{
+  Files()
+  {
+    char dir[] = "/tmp/staticfile_unittest_XXXXXX";
+    if (::mkdtemp(dir) == NULL)
+    {
+      perror("mkdtemp");
+      abort();
+    }
+    g_root = dir;
+    for (int i = 0; i < 100; ++i)
+    {
+      char line[32];
+      snprintf(line, sizeof line, "<p>line %03d</p>\n", i);
+      g_html += line;
+    }
+    for (int i = 0; i < 5000; ++i)
+    {
+      g_big.push_back(static_cast<char>('a' + i % 26));
+    }
+    // not BOOST_REQUIRE, which works only in test cases
+    if (!writeFile("/index.html", g_html)
+        || !writeFile("/big.txt", g_big)
+        || !writeFile("/a.bin", string(100, '\x01')))
+    {
+      perror("writeFile");
+      abort();
+    }
+    ::mkdir((g_root + "/dir").c_str(), 0755);
+  }
+
+  ~Files()
+  {
+    ::unlink((g_root + "/index.html").c_str());
+    ::unlink((g_root + "/big.txt").c_str());
+    ::unlink((g_root + "/a.bin").c_str());
+    ::rmdir((g_root + "/dir").c_str());
+    ::rmdir(g_root.c_str());
+  }
+};
+
+BOOST_GLOBAL_FIXTURE(Files);
+
+struct Response
+{
+  int status;
+  string head;  // without the Date
+  string body;
+
+  bool hasHeader(const string& header) const
+  {
+    return head.find("\r\n" + header + "\r\n") != string::npos;
+  }
+
+  string header(const string& field) const
+  {
+    size_t start = head.find("\r\n" + field + ": ");
+    if (start == string::npos)
+    {
+      return string();
+    }
+    start += field.size() + 4;
+    return head.substr(start, head.find("\r\n", start) - start);
+  }
+};
+
+Response get(StaticFileHandler* handler, const string& path, const string& headers = string(),
+             const char* method = "GET")
+{
+  HttpContext context;
+  Buffer input;
+  input.append(string(method) + " " + path + " HTTP/1.1\r\n" + headers + "\r\n");
+  BOOST_REQUIRE(context.parseRequest(&input, Timestamp::now()));
+  BOOST_REQUIRE(context.gotAll());
+
+  HttpResponse resp(false);
+  BOOST_CHECK(handler->serve(context.request(), &resp));
+  if (context.request().method() == muduo::net::HttpRequest::kHead)
+  {
+    resp.setHeadOnly(true);
+  }
+  Buffer output;
+  resp.appendToBuffer(&output);
+  string all(output.retrieveAllAsString());
+  Response result;
+  result.status = resp.statusCode();
+  size_t end = all.find("\r\n\r\n");
+  result.head = all.substr(0, end + 2);
+  result.body = all.substr(end + 4);
+  size_t date = result.head.find("\r\nDate: ");
+  result.head.erase(date, result.head.find("\r\n", date + 2) - date);
+  return result;
+}
+
+string inflate(const string& compressed, bool gzip)
+{
+  z_stream zs;
+  bzero(&zs, sizeof zs);
+  BOOST_REQUIRE_EQUAL(inflateInit2(&zs, gzip ? MAX_WBITS + 16 : MAX_WBITS), Z_OK);
+  string output(1 << 20, '\0');
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  zs.avail_in = static_cast<uInt>(compressed.size());
+  zs.next_out = reinterpret_cast<Bytef*>(&output[0]);
+  zs.avail_out = static_cast<uInt>(output.size());
+  BOOST_CHECK_EQUAL(inflate(&zs, Z_FINISH), Z_STREAM_END);
+  output.resize(zs.total_out);
+  inflateEnd(&zs);
+  return output;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testServe)
+{
+  StaticFileHandler handler(g_root);
+  Response r = get(&handler, "/index.html");
+  BOOST_CHECK_EQUAL(r.status, 200);
+  BOOST_CHECK_EQUAL(r.body, g_html);
+  BOOST_CHECK_EQUAL(r.header("Content-Type"), "text/html; charset=utf-8");
+  BOOST_CHECK(r.hasHeader("Accept-Ranges: bytes"));
+  BOOST_CHECK(r.hasHeader("Vary: Accept-Encoding"));
+  BOOST_CHECK(!r.header("ETag").empty());
+  BOOST_CHECK(!r.header("Last-Modified").empty());
+
+  BOOST_CHECK_EQUAL(get(&handler, "/").body, g_html);
+  BOOST_CHECK_EQUAL(get(&handler, "/a.bin").header("Content-Type"), "application/octet-stream");
+  BOOST_CHECK_EQUAL(handler.numCachedFiles(), 2);
+
+  r = get(&handler, "/index.html", "", "HEAD");
+  BOOST_CHECK_EQUAL(r.status, 200);
+  BOOST_CHECK_EQUAL(r.header("Content-Length"), "1600");
+  BOOST_CHECK(r.body.empty());
+}
+
+BOOST_AUTO_TEST_CASE(testErrors)
+{
+  StaticFileHandler handler(g_root);
+  BOOST_CHECK_EQUAL(get(&handler, "/missing.html").status, 404);
+  BOOST_CHECK_EQUAL(get(&handler, "/../etc/passwd").status, 404);
+  BOOST_CHECK_EQUAL(get(&handler, "/dir/%2e%2e/%2e%2e/etc/passwd").status, 404);
+  BOOST_CHECK_EQUAL(get(&handler, "/a%00.bin").status, 404);
+  BOOST_CHECK_EQUAL(get(&handler, "/a%2ebin").status, 200);
+
+  Response r = get(&handler, "/dir");
+  BOOST_CHECK_EQUAL(r.status, 301);
+  BOOST_CHECK_EQUAL(r.header("Location"), "/dir/");
+  BOOST_CHECK_EQUAL(get(&handler, "/dir/").status, 404);
+
+  r = get(&handler, "/index.html", "", "POST");
+  BOOST_CHECK_EQUAL(r.status, 405);
+  BOOST_CHECK_EQUAL(r.header("Allow"), "GET, HEAD");
+}
+
+BOOST_AUTO_TEST_CASE(testPrefix)
+{
+  StaticFileHandler handler(g_root, "/static");
+  BOOST_CHECK_EQUAL(get(&handler, "/static/index.html").body, g_html);
+  BOOST_CHECK_EQUAL(get(&handler, "/static/").body, g_html);
+
+  HttpContext context;
+  Buffer input;
+  input.append("GET /staticfoo HTTP/1.1\r\n\r\n");
+  BOOST_REQUIRE(context.parseRequest(&input, Timestamp::now()));
+  HttpResponse resp(false);
+  BOOST_CHECK(!handler.serve(context.request(), &resp));
+  handler.onRequest(context.request(), &resp);
+  BOOST_CHECK_EQUAL(resp.statusCode(), HttpResponse::k404NotFound);
+}
+
+BOOST_AUTO_TEST_CASE(testCompression)
+{
+  StaticFileHandler handler(g_root);
+  size_t before = handler.cacheBytes();
+  Response r = get(&handler, "/index.html", "Accept-Encoding: gzip, deflate\r\n");
+  BOOST_CHECK_EQUAL(r.status, 200);
+  BOOST_CHECK_EQUAL(r.header("Content-Encoding"), "gzip");
+  BOOST_CHECK(r.body.size() < g_html.size());
+  BOOST_CHECK_EQUAL(inflate(r.body, true), g_html);
+  BOOST_CHECK(r.header("ETag").find("-gzip\"") != string::npos);
+  BOOST_CHECK(handler.cacheBytes() > before);
+
+  // cached
+  size_t cached = handler.cacheBytes();
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Accept-Encoding: gzip\r\n").body, r.body);
+  BOOST_CHECK_EQUAL(handler.cacheBytes(), cached);
+
+  r = get(&handler, "/index.html", "Accept-Encoding: gzip;q=0, deflate\r\n");
+  BOOST_CHECK_EQUAL(r.header("Content-Encoding"), "deflate");
+  BOOST_CHECK_EQUAL(inflate(r.body, false), g_html);
+
+  r = get(&handler, "/index.html", "Accept-Encoding: br\r\n");
+  BOOST_CHECK(r.header("Content-Encoding").empty());
+  BOOST_CHECK_EQUAL(r.body, g_html);
+
+  // not text, not compressed, nor too large ones
+  r = get(&handler, "/a.bin", "Accept-Encoding: gzip\r\n");
+  BOOST_CHECK(r.header("Content-Encoding").empty());
+  BOOST_CHECK(!r.hasHeader("Vary: Accept-Encoding"));
+
+  handler.setMaxInMemoryFileSize(1024);
+  r = get(&handler, "/big.txt", "Accept-Encoding: gzip\r\n");
+  BOOST_CHECK(r.header("Content-Encoding").empty());
+  BOOST_CHECK_EQUAL(r.body, g_big);
+}
+
+BOOST_AUTO_TEST_CASE(testConditional)
+{
+  StaticFileHandler handler(g_root);
+  Response r = get(&handler, "/index.html");
+  string etag = r.header("ETag");
+  string lastModified = r.header("Last-Modified");
+
+  r = get(&handler, "/index.html", "If-None-Match: " + etag + "\r\n");
+  BOOST_CHECK_EQUAL(r.status, 304);
+  BOOST_CHECK(r.body.empty());
+  BOOST_CHECK_EQUAL(r.header("ETag"), etag);
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "If-None-Match: \"x\", W/" + etag + "\r\n").status, 304);
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "If-None-Match: \"x\"\r\n").status, 200);
+
+  // a gzip one matches too
+  string gzipTag = get(&handler, "/index.html", "Accept-Encoding: gzip\r\n").header("ETag");
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Accept-Encoding: gzip\r\nIf-None-Match: "
+                        + gzipTag + "\r\n").status, 304);
+
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "If-Modified-Since: " + lastModified + "\r\n").status, 304);
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html",
+                        "If-Modified-Since: Sat, 01 Jan 2000 00:00:00 GMT\r\n").status, 200);
+}
+
+BOOST_AUTO_TEST_CASE(testRange)
+{
+  StaticFileHandler handler(g_root);
+  Response r = get(&handler, "/index.html", "Range: bytes=10-19\r\nAccept-Encoding: gzip\r\n");
+  BOOST_CHECK_EQUAL(r.status, 206);
+  BOOST_CHECK_EQUAL(r.header("Content-Range"), "bytes 10-19/1600");
+  BOOST_CHECK_EQUAL(r.body, g_html.substr(10, 10));
+  BOOST_CHECK(r.header("Content-Encoding").empty());
+
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Range: bytes=1590-\r\n").body, g_html.substr(1590));
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Range: bytes=-5\r\n").body, g_html.substr(1595));
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Range: bytes=1590-5000\r\n").body, g_html.substr(1590));
+
+  r = get(&handler, "/index.html", "Range: bytes=2000-\r\n");
+  BOOST_CHECK_EQUAL(r.status, 416);
+  BOOST_CHECK_EQUAL(r.header("Content-Range"), "bytes */1600");
+
+  // ignored
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Range: bytes=1-2,5-6\r\n").status, 200);
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Range: lines=1-2\r\n").status, 200);
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Range: bytes=10-19\r\nIf-Range: \"old\"\r\n").status, 200);
+  string etag = get(&handler, "/index.html").header("ETag");
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Range: bytes=10-19\r\nIf-Range: "
+                        + etag + "\r\n").status, 206);
+
+  // by sendfile(2)
+  handler.setMaxInMemoryFileSize(1024);
+  r = get(&handler, "/big.txt", "Range: bytes=4990-\r\n");
+  BOOST_CHECK_EQUAL(r.status, 206);
+  BOOST_CHECK_EQUAL(r.body, g_big.substr(4990));
+}
+
+BOOST_AUTO_TEST_CASE(testCache)
+{
+  StaticFileHandler handler(g_root);
+  handler.setRevalidateInterval(0);
+  BOOST_CHECK_EQUAL(get(&handler, "/a.bin").body, string(100, '\x01'));
+  BOOST_REQUIRE(writeFile("/a.bin", string(50, '\x02')));
+  BOOST_CHECK_EQUAL(get(&handler, "/a.bin").body, string(50, '\x02'));
+  BOOST_CHECK_EQUAL(handler.cacheBytes(), 50);
+
+  handler.setMaxCachedFiles(2);
+  get(&handler, "/index.html");
+  get(&handler, "/big.txt");
+  BOOST_CHECK_EQUAL(handler.numCachedFiles(), 2);
+  BOOST_CHECK_EQUAL(handler.cacheBytes(), g_html.size() + g_big.size());
+
+  handler.setMaxCacheBytes(2000);
+  get(&handler, "/index.html");
+  BOOST_CHECK_EQUAL(handler.numCachedFiles(), 1);
+  BOOST_CHECK_EQUAL(handler.cacheBytes(), g_html.size());
+
+  ::unlink((g_root + "/index.html").c_str());
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html").status, 404);
+  BOOST_CHECK_EQUAL(handler.numCachedFiles(), 0);
+  BOOST_REQUIRE(writeFile("/index.html", g_html));
+  BOOST_REQUIRE(writeFile("/a.bin", string(100, '\x01')));
+}
+
+BOOST_AUTO_TEST_CASE(testCacheVariants)
+{
+  StaticFileHandler handler(g_root);
+  handler.setMaxCacheBytes(g_html.size() + g_big.size());
+  get(&handler, "/big.txt");
+  get(&handler, "/index.html");
+  BOOST_CHECK_EQUAL(handler.numCachedFiles(), 2);
+
+  // the compressed one counts too, the least recently used goes
+  BOOST_CHECK_EQUAL(get(&handler, "/index.html", "Accept-Encoding: gzip\r\n")
+                        .header("Content-Encoding"), "gzip");
+  BOOST_CHECK_EQUAL(handler.numCachedFiles(), 1);
+  BOOST_CHECK(handler.cacheBytes() > g_html.size());
+  BOOST_CHECK(handler.cacheBytes() < g_html.size() + g_big.size());
+}
@@ -25,6 +25,7 @@ namespace muduo
 namespace net
 {
 
+class LoopInspector;
 class ProcessInspector;
 class PerformanceInspector;
 class SystemInspector;
@@ -59,6 +60,7 @@ class Inspector : boost::noncopyable
   boost::scoped_ptr<ProcessInspector> processInspector_;
   boost::scoped_ptr<PerformanceInspector> performanceInspector_;
   boost::scoped_ptr<SystemInspector> systemInspector_;
+  boost::scoped_ptr<LoopInspector> loopInspector_;
   MutexLock mutex_;
   std::map<string, CommandList> modules_;
   std::map<string, HelpList> helps_;
@@ -0,0 +1,41 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+
+#include <muduo/net/inspect/LoopInspector.h>
+#include <muduo/net/BufferAllocator.h>
+#include <muduo/net/LoopStats.h>
+#include <muduo/net/Watchdog.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+void LoopInspector::registerCommands(Inspector* ins)
+{
+  ins->add("loop", "buffers", LoopInspector::buffers,
+           "print buffer pool statistics of each loop");
+  ins->add("loop", "stats", LoopInspector::stats,
+           "print latency and utilization of each loop, in microseconds");
+  ins->add("loop", "slow", LoopInspector::slow,
+           "print recent slow callbacks, see EventLoop::setSlowThreshold");
+}
+
+string LoopInspector::buffers(HttpRequest::Method, const Inspector::ArgList&)
+{
+  return SlabBufferAllocator::allStats();
+}
+
+string LoopInspector::stats(HttpRequest::Method, const Inspector::ArgList&)
+{
+  return LoopStats::allStats();
+}
+
+string LoopInspector::slow(HttpRequest::Method, const Inspector::ArgList&)
+{
+  return Watchdog::instance().reports();
+}
@@ -0,0 +1,36 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_INSPECT_LOOPINSPECTOR_H
+#define MUDUO_NET_INSPECT_LOOPINSPECTOR_H
+
+#include <muduo/net/inspect/Inspector.h>
+#include <boost/noncopyable.hpp>
+
+namespace muduo
+{
+namespace net
+{
+
+// Statistics of EventLoops in this process.
+class LoopInspector : boost::noncopyable
+{
+ public:
+  void registerCommands(Inspector* ins);
+
+  static string buffers(HttpRequest::Method, const Inspector::ArgList&);
+  static string stats(HttpRequest::Method, const Inspector::ArgList&);
+  static string slow(HttpRequest::Method, const Inspector::ArgList&);
+};
+
+}
+}
+
+#endif  // MUDUO_NET_INSPECT_LOOPINSPECTOR_H
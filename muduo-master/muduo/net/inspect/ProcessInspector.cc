@@ -101,6 +101,16 @@ ProcessInfo::CpuTime getCpuTime(StringPiece data)
   return t;
 }
 
+// last cpu the thread ran on, data starts from ppid
+int getProcessor(StringPiece data)
+{
+  for (int i = 0; i < 35; ++i)
+  {
+    data = next(data);
+  }
+  return data.empty() ? -1 : static_cast<int>(strtol(data.data(), NULL, 10));
+}
+
 int stringPrintf(string* out, const char* fmt, ...) __attribute__ ((format (printf, 2, 3)));
 
 int stringPrintf(string* out, const char* fmt, ...)
@@ -128,6 +138,8 @@ void ProcessInspector::registerCommands(Inspector* ins)
   ins->add("proc", "status", ProcessInspector::procStatus, "print /proc/self/status");
   // ins->add("proc", "opened_files", ProcessInspector::openedFiles, "count /proc/self/fd");
   ins->add("proc", "threads", ProcessInspector::threads, "list /proc/self/task");
+  ins->add("proc", "placement", ProcessInspector::placement,
+           "list cpu and NUMA node of threads");
 }
 
 string ProcessInspector::overview(HttpRequest::Method, const Inspector::ArgList&)
@@ -209,6 +221,36 @@ string ProcessInspector::openedFiles(HttpRequest::Method, const Inspector::ArgLi
   return buf;
 }
 
+string ProcessInspector::placement(HttpRequest::Method, const Inspector::ArgList&)
+{
+  std::vector<pid_t> threads = ProcessInfo::threads();
+  string result = "  TID NAME              CPU NODE AFFINITY\n";
+  result.reserve(threads.size() * 64);
+  string stat;
+  for (size_t i = 0; i < threads.size(); ++i)
+  {
+    char buf[256];
+    int tid = threads[i];
+    snprintf(buf, sizeof buf, "/proc/%d/task/%d/stat", ProcessInfo::pid(), tid);
+    if (FileUtil::readFile(buf, 65536, &stat) == 0)
+    {
+      StringPiece name = ProcessInfo::procname(stat);
+      const char* rp = name.end();
+      assert(*rp == ')');
+      const char* state = rp + 2;
+      *const_cast<char*>(rp) = '\0';  // don't do this at home
+      StringPiece data(stat);
+      data.remove_prefix(static_cast<int>(state - data.data() + 2));
+      int cpu = getProcessor(data);
+      snprintf(buf, sizeof buf, "%5d %-16s %4d %4d %s\n",
+               tid, name.data(), cpu, ProcessInfo::numaNodeOfCpu(cpu),
+               ProcessInfo::cpuAffinity(tid).c_str());
+      result += buf;
+    }
+  }
+  return result;
+}
+
 string ProcessInspector::threads(HttpRequest::Method, const Inspector::ArgList&)
 {
   std::vector<pid_t> threads = ProcessInfo::threads();
@@ -29,6 +29,7 @@ class ProcessInspector : boost::noncopyable
   static string procStatus(HttpRequest::Method, const Inspector::ArgList&);
   static string openedFiles(HttpRequest::Method, const Inspector::ArgList&);
   static string threads(HttpRequest::Method, const Inspector::ArgList&);
+  static string placement(HttpRequest::Method, const Inspector::ArgList&);
 
   static string username_;
 };
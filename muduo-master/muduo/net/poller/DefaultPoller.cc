@@ -9,6 +9,11 @@
 #include <muduo/net/Poller.h>
 #include <muduo/net/poller/PollPoller.h>
 #include <muduo/net/poller/EPollPoller.h>
+#ifndef NO_IO_URING
+#include <muduo/net/poller/UringPoller.h>
+#endif
+
+#include <muduo/base/Logging.h>
 
 #include <stdlib.h>
 
@@ -20,6 +25,17 @@ Poller* Poller::newDefaultPoller(EventLoop* loop)
   {
     return new PollPoller(loop);
   }
+  else if (::getenv("MUDUO_USE_URING"))
+  {
+#ifndef NO_IO_URING
+    if (UringPoller::available())
+    {
+      return new UringPoller(loop);
+    }
+#endif
+    LOG_WARN << "io_uring is not available, use epoll instead";
+    return new EPollPoller(loop);
+  }
   else
   {
     return new EPollPoller(loop);
@@ -36,6 +36,9 @@ namespace
 const int kNew = -1;
 const int kAdded = 1;
 const int kDeleted = 2;
+
+// interests of edge-triggered channels
+const uint32_t kEdgeTriggeredEvents = EPOLLIN | EPOLLPRI | EPOLLOUT | EPOLLET;
 }
 
 EPollPoller::EPollPoller(EventLoop* loop)
@@ -101,7 +104,17 @@ void EPollPoller::fillActiveChannels(int numEvents,
     assert(it != channels_.end());
     assert(it->second == channel);
 #endif
-    channel->set_revents(events_[i].events);
+    int revents = events_[i].events;
+    if (channel->isEdgeTriggered())
+    {
+      // all events are registered, drop those not interested in
+      revents &= channel->events() | EPOLLERR | EPOLLHUP;
+      if (revents == 0)
+      {
+        continue;
+      }
+    }
+    channel->set_revents(revents);
     activeChannels->push_back(channel);
   }
 }
@@ -143,6 +156,10 @@ void EPollPoller::updateChannel(Channel* channel)
       update(EPOLL_CTL_DEL, channel);
       channel->set_index(kDeleted);
     }
+    else if (channel->isEdgeTriggered())
+    {
+      // registered events never change
+    }
     else
     {
       update(EPOLL_CTL_MOD, channel);
@@ -175,7 +192,8 @@ void EPollPoller::update(int operation, Channel* channel)
 {
   struct epoll_event event;
   bzero(&event, sizeof event);
-  event.events = channel->events();
+  event.events = channel->isEdgeTriggered()
+                 ? kEdgeTriggeredEvents : implicit_cast<uint32_t>(channel->events());
   event.data.ptr = channel;
   int fd = channel->fd();
   LOG_TRACE << "epoll_ctl op = " << operationToString(operation)
@@ -0,0 +1,626 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+
+#include <muduo/net/poller/UringPoller.h>
+
+#include <muduo/base/Logging.h>
+#include <muduo/net/Channel.h>
+
+#include <algorithm>
+
+#include <assert.h>
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+const unsigned UringPoller::kQueueDepth;
+const int UringPoller::kNumRecvBuffers;
+const int UringPoller::kRecvBufferSize;
+const int UringPoller::kMaxIovecs;
+
+namespace
+{
+const int kNew = -1;
+const int kAdded = 1;
+const int kDeleted = 2;
+
+// group of the provided recv buffers
+const uint16_t kRecvBufferGroup = 1;
+
+int ioUringSetup(unsigned entries, struct io_uring_params* params)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int ringfd, unsigned toSubmit, unsigned minComplete,
+                 unsigned flags, const void* arg, size_t argSize)
+{
+  return static_cast<int>(::syscall(__NR_io_uring_enter, ringfd, toSubmit,
+                                    minComplete, flags, arg, argSize));
+}
+
+void* mmapRing(int ringfd, size_t size, off_t offset)
+{
+  void* ring = ::mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ringfd, offset);
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+  if (ring == MAP_FAILED)
+#pragma GCC diagnostic pop
+  {
+    LOG_SYSFATAL << "UringPoller mmap";
+  }
+  return ring;
+}
+
+// SINGLE_MMAP: 5.4, NODROP: 5.5, FAST_POLL: 5.7, EXT_ARG: 5.11
+const uint32_t kRequiredFeatures =
+    IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_FAST_POLL
+    | IORING_FEAT_EXT_ARG;
+}
+
+bool UringPoller::available()
+{
+  struct io_uring_params params;
+  bzero(&params, sizeof params);
+  int ringfd = ioUringSetup(1, &params);
+  if (ringfd < 0)
+  {
+    return false;
+  }
+  ::close(ringfd);
+  return (params.features & kRequiredFeatures) == kRequiredFeatures;
+}
+
+UringPoller::UringPoller(EventLoop* loop)
+  : Poller(loop),
+    ringfd_(-1),
+    ring_(NULL),
+    ringSize_(0),
+    sqes_(NULL),
+    sqesSize_(0),
+    round_(0),
+    recvBuffers_(kNumRecvBuffers * kRecvBufferSize)
+{
+  struct io_uring_params params;
+  bzero(&params, sizeof params);
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = 4 * kQueueDepth;
+  ringfd_ = ioUringSetup(kQueueDepth, &params);
+  if (ringfd_ < 0)
+  {
+    LOG_SYSFATAL << "UringPoller::UringPoller";
+  }
+  if ((params.features & kRequiredFeatures) != kRequiredFeatures)
+  {
+    LOG_FATAL << "UringPoller::UringPoller - io_uring is too old, features "
+              << params.features;
+  }
+
+  // one mmap for both rings
+  ringSize_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                       params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe));
+  ring_ = mmapRing(ringfd_, ringSize_, IORING_OFF_SQ_RING);
+  sqesSize_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes_ = static_cast<io_uring_sqe*>(mmapRing(ringfd_, sqesSize_, IORING_OFF_SQES));
+
+  char* ring = static_cast<char*>(ring_);
+  sqHead_ = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+  sqTail_ = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+  sqMask_ = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+  sqArray_ = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+  cqHead_ = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+  cqTail_ = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+  cqMask_ = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+
+  // submitted with the first poll()
+  provideRecvBuffers(0, kNumRecvBuffers);
+}
+
+UringPoller::~UringPoller()
+{
+  // cancels requests in flight
+  ::close(ringfd_);
+  ::munmap(sqes_, sqesSize_);
+  ::munmap(ring_, ringSize_);
+  for (size_t i = 0; i < allOps_.size(); ++i)
+  {
+    delete allOps_[i];
+  }
+}
+
+Timestamp UringPoller::poll(int timeoutMs, ChannelList* activeChannels)
+{
+  // gives back buffers the callbacks have consumed, in runs
+  if (!usedRecvBuffers_.empty())
+  {
+    std::sort(usedRecvBuffers_.begin(), usedRecvBuffers_.end());
+    size_t first = 0;
+    for (size_t i = 1; i <= usedRecvBuffers_.size(); ++i)
+    {
+      if (i == usedRecvBuffers_.size()
+          || usedRecvBuffers_[i] != usedRecvBuffers_[i-1] + 1)
+      {
+        provideRecvBuffers(usedRecvBuffers_[first], static_cast<int>(i - first));
+        first = i;
+      }
+    }
+    usedRecvBuffers_.clear();
+  }
+
+  // arms new interests, and re-arms requests completed in last iteration
+  for (size_t i = 0; i < dirtyFds_.size(); ++i)
+  {
+    InterestMap::iterator it = interests_.find(dirtyFds_[i]);
+    if (it != interests_.end() && it->second.dirty)
+    {
+      it->second.dirty = false;
+      arm(it->first, &it->second);
+    }
+  }
+  dirtyFds_.clear();
+
+  // don't wait if there are completions already
+  const bool ready = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+  int ret = enter(ready ? 0 : 1, timeoutMs);
+  int savedErrno = errno;
+  Timestamp now(Timestamp::now());
+  if (ret < 0 && savedErrno != EINTR && savedErrno != ETIME)
+  {
+    errno = savedErrno;
+    LOG_SYSERR << "UringPoller::poll()";
+  }
+  fillActiveChannels(activeChannels);
+  if (activeChannels->empty())
+  {
+    LOG_TRACE << "nothing happened";
+  }
+  else
+  {
+    LOG_TRACE << activeChannels->size() << " events happened";
+  }
+  return now;
+}
+
+void UringPoller::fillActiveChannels(ChannelList* activeChannels)
+{
+  ++round_;
+  const size_t first = activeChannels->size();
+  unsigned head = *cqHead_;
+  const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head)
+  {
+    const io_uring_cqe& cqe = cqes_[head & cqMask_];
+    if (cqe.user_data != 0)
+    {
+      complete(reinterpret_cast<Op*>(static_cast<uintptr_t>(cqe.user_data)),
+               cqe, activeChannels);
+    }
+    else if (cqe.res < 0 && cqe.res != -ENOENT && cqe.res != -EALREADY)
+    {
+      // a cancellation, a removal, or buffers given back
+      errno = -cqe.res;
+      LOG_SYSERR << "UringPoller::fillActiveChannels";
+    }
+  }
+  __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+  for (size_t i = first; i < activeChannels->size(); ++i)
+  {
+    Channel* channel = (*activeChannels)[i];
+    channel->set_revents(interests_[channel->fd()].revents);
+  }
+}
+
+void UringPoller::complete(Op* op, const io_uring_cqe& cqe, ChannelList* activeChannels)
+{
+  const int res = cqe.res;
+  const char* data = NULL;
+  if (cqe.flags & IORING_CQE_F_BUFFER)
+  {
+    const int bid = static_cast<int>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    data = &recvBuffers_[bid * kRecvBufferSize];
+    usedRecvBuffers_.push_back(bid);
+  }
+
+  Channel* channel = op->channel;
+  const int fd = op->fd;
+  if (channel == NULL)
+  {
+    // the channel is gone, or a poll was replaced
+    if (op->kind == kAcceptOp && res >= 0)
+    {
+      ::close(res);
+    }
+    freeOp(op);
+    return;
+  }
+
+  InterestMap::iterator it = interests_.find(fd);
+  assert(it != interests_.end());
+  assert(it->second.channel == channel);
+  Interest& interest = it->second;
+  int revents = 0;
+  switch (op->kind)
+  {
+    case kPollOp:
+      assert(interest.poll == op);
+      interest.poll = NULL;
+      if (res < 0)
+      {
+        errno = -res;
+        LOG_SYSERR << "UringPoller::complete poll fd = " << fd;
+      }
+      else
+      {
+        // interests may have changed since it was armed
+        revents = res & (channel->events() | POLLERR | POLLHUP | POLLNVAL | POLLRDHUP);
+        interest.recvFallback = false;
+      }
+      break;
+    case kRecvOp:
+      assert(interest.read == op);
+      interest.read = NULL;
+      if (res == -ENOBUFS)
+      {
+        LOG_DEBUG << "UringPoller - out of recv buffers, fd = " << fd;
+        interest.recvFallback = true;
+      }
+      else if (res != -ECANCELED)
+      {
+        // data received before a cancellation is delivered still
+        channel->setReadResult(res, data);
+        revents = POLLIN;
+      }
+      break;
+    case kAcceptOp:
+      assert(interest.read == op);
+      interest.read = NULL;
+      if (res != -ECANCELED)
+      {
+        channel->setReadResult(res, &op->addr);
+        revents = POLLIN;
+      }
+      break;
+    case kWriteOp:
+      assert(interest.write == op);
+      interest.write = NULL;
+      if (res != -ECANCELED)
+      {
+        channel->setWriteResult(res);
+        revents = POLLOUT;
+      }
+      break;
+  }
+  // not reused until next poll(), op->addr is valid in the callbacks
+  freeOp(op);
+  markDirty(fd, &interest);
+
+  if (revents != 0)
+  {
+    if (interest.round != round_)
+    {
+      interest.round = round_;
+      interest.revents = 0;
+      activeChannels->push_back(channel);
+    }
+    interest.revents |= revents;
+  }
+}
+
+void UringPoller::updateChannel(Channel* channel)
+{
+  Poller::assertInLoopThread();
+  const int index = channel->index();
+  const int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd
+    << " events = " << channel->events() << " index = " << index;
+  if (index == kNew || index == kDeleted)
+  {
+    if (index == kNew)
+    {
+      assert(channels_.find(fd) == channels_.end());
+      channels_[fd] = channel;
+      Interest interest = { channel, NULL, NULL, NULL, 0, 0, false, false };
+      interests_[fd] = interest;
+    }
+    else // index == kDeleted
+    {
+      assert(channels_.find(fd) != channels_.end());
+      assert(channels_[fd] == channel);
+    }
+    channel->set_index(kAdded);
+  }
+  else
+  {
+    assert(channels_.find(fd) != channels_.end());
+    assert(channels_[fd] == channel);
+    assert(index == kAdded);
+    if (channel->isNoneEvent())
+    {
+      channel->set_index(kDeleted);
+    }
+  }
+  // requests are changed in next poll(), together with others
+  markDirty(fd, &interests_[fd]);
+}
+
+void UringPoller::removeChannel(Channel* channel)
+{
+  Poller::assertInLoopThread();
+  int fd = channel->fd();
+  LOG_TRACE << "fd = " << fd;
+  assert(channels_.find(fd) != channels_.end());
+  assert(channels_[fd] == channel);
+  assert(channel->isNoneEvent());
+  int index = channel->index();
+  assert(index == kAdded || index == kDeleted);
+  (void)index;
+
+  InterestMap::iterator it = interests_.find(fd);
+  assert(it != interests_.end());
+  Interest& interest = it->second;
+  if (interest.poll)
+  {
+    submitPollRemove(&interest);
+  }
+  // the kernel may still use their memory, they are freed on completion
+  Op* ops[] = { interest.read, interest.write };
+  for (size_t i = 0; i < sizeof ops / sizeof ops[0]; ++i)
+  {
+    if (ops[i])
+    {
+      if (!ops[i]->cancelled)
+      {
+        submitCancel(ops[i]);
+      }
+      ops[i]->channel = NULL;
+    }
+  }
+  interests_.erase(it);
+  size_t n = channels_.erase(fd);
+  (void)n;
+  assert(n == 1);
+  channel->set_index(kNew);
+}
+
+void UringPoller::arm(int fd, Interest* interest)
+{
+  Channel* channel = interest->channel;
+  const int events = channel->events();
+  int pollEvents = 0;
+
+  if (events & (POLLIN | POLLPRI))
+  {
+    if (channel->readOp() == Channel::kNoReadOp || interest->recvFallback)
+    {
+      pollEvents |= events & (POLLIN | POLLPRI);
+    }
+    else if (!interest->read)
+    {
+      submitRead(fd, interest);
+    }
+  }
+  else if (interest->read && !interest->read->cancelled)
+  {
+    submitCancel(interest->read);
+  }
+
+  if (events & POLLOUT)
+  {
+    // nothing to gather, e.g. a file to sendfile(2), watches writability
+    if (!interest->write
+        && !(channel->gatherCallback() && submitWrite(fd, interest)))
+    {
+      pollEvents |= POLLOUT;
+    }
+  }
+  else if (interest->write && !interest->write->cancelled)
+  {
+    submitCancel(interest->write);
+  }
+
+  if (interest->poll && interest->poll->events != pollEvents)
+  {
+    submitPollRemove(interest);
+  }
+  if (pollEvents != 0 && !interest->poll)
+  {
+    submitPollAdd(fd, interest, pollEvents);
+  }
+}
+
+void UringPoller::markDirty(int fd, Interest* interest)
+{
+  if (!interest->dirty)
+  {
+    interest->dirty = true;
+    dirtyFds_.push_back(fd);
+  }
+}
+
+UringPoller::Op* UringPoller::newOp(OpKind kind, int fd, Interest* interest)
+{
+  Op* op = NULL;
+  if (freeOps_.empty())
+  {
+    op = new Op;
+    allOps_.push_back(op);
+  }
+  else
+  {
+    op = freeOps_.back();
+    freeOps_.pop_back();
+  }
+  op->kind = kind;
+  op->fd = fd;
+  op->channel = interest->channel;
+  op->events = 0;
+  op->cancelled = false;
+  return op;
+}
+
+void UringPoller::freeOp(Op* op)
+{
+  op->channel = NULL;
+  op->guard.reset();
+  freeOps_.push_back(op);
+}
+
+io_uring_sqe* UringPoller::getSqe()
+{
+  const unsigned tail = *sqTail_;
+  if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) > sqMask_)
+  {
+    // full, submits without waiting
+    if (enter(0, 0) < 0)
+    {
+      LOG_SYSFATAL << "UringPoller::getSqe";
+    }
+    assert(tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) <= sqMask_);
+  }
+  // the kernel doesn't look at it until io_uring_enter(2)
+  const unsigned index = tail & sqMask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  bzero(sqe, sizeof *sqe);
+  sqArray_[index] = index;
+  __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+  return sqe;
+}
+
+void UringPoller::submitPollAdd(int fd, Interest* interest, int events)
+{
+  Op* op = newOp(kPollOp, fd, interest);
+  op->events = events;
+  interest->poll = op;
+
+  io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = fd;
+  sqe->poll32_events = static_cast<uint32_t>(events);
+  sqe->user_data = reinterpret_cast<uintptr_t>(op);
+}
+
+void UringPoller::submitPollRemove(Interest* interest)
+{
+  Op* op = interest->poll;
+  assert(op != NULL);
+  interest->poll = NULL;
+  // whatever it reports is stale
+  op->channel = NULL;
+  op->cancelled = true;
+
+  io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = reinterpret_cast<uintptr_t>(op);
+}
+
+void UringPoller::submitRead(int fd, Interest* interest)
+{
+  const bool accept = interest->channel->readOp() == Channel::kAccept;
+  Op* op = newOp(accept ? kAcceptOp : kRecvOp, fd, interest);
+  interest->read = op;
+
+  io_uring_sqe* sqe = getSqe();
+  sqe->fd = fd;
+  sqe->user_data = reinterpret_cast<uintptr_t>(op);
+  if (accept)
+  {
+    op->addrlen = static_cast<socklen_t>(sizeof op->addr);
+    bzero(&op->addr, sizeof op->addr);
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->addr = reinterpret_cast<uintptr_t>(&op->addr);
+    sqe->addr2 = reinterpret_cast<uintptr_t>(&op->addrlen);
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+  }
+  else
+  {
+    // the kernel picks a buffer when data arrives
+    sqe->opcode = IORING_OP_RECV;
+    sqe->len = kRecvBufferSize;
+    sqe->flags = static_cast<uint8_t>(IOSQE_BUFFER_SELECT);
+    sqe->buf_group = kRecvBufferGroup;
+  }
+}
+
+bool UringPoller::submitWrite(int fd, Interest* interest)
+{
+  Op* op = newOp(kWriteOp, fd, interest);
+  const int count = interest->channel->gatherCallback()(op->vec, kMaxIovecs);
+  if (count <= 0)
+  {
+    freeOp(op);
+    return false;
+  }
+  // the owner of the data lives until the kernel is done with it
+  op->guard = interest->channel->lockTie();
+  interest->write = op;
+
+  io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_WRITEV;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uintptr_t>(op->vec);
+  sqe->len = static_cast<uint32_t>(count);
+  sqe->user_data = reinterpret_cast<uintptr_t>(op);
+  return true;
+}
+
+void UringPoller::submitCancel(Op* op)
+{
+  op->cancelled = true;
+  io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->fd = -1;
+  sqe->addr = reinterpret_cast<uintptr_t>(op);
+}
+
+void UringPoller::provideRecvBuffers(int bid, int count)
+{
+  io_uring_sqe* sqe = getSqe();
+  sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+  sqe->fd = count;
+  sqe->addr = reinterpret_cast<uintptr_t>(&recvBuffers_[bid * kRecvBufferSize]);
+  sqe->len = kRecvBufferSize;
+  sqe->off = static_cast<uint64_t>(bid);
+  sqe->buf_group = kRecvBufferGroup;
+}
+
+int UringPoller::enter(unsigned minComplete, int timeoutMs)
+{
+  const unsigned toSubmit = *sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+  if (toSubmit == 0 && minComplete == 0)
+  {
+    return 0;
+  }
+
+  struct __kernel_timespec ts;
+  struct io_uring_getevents_arg arg;
+  bzero(&arg, sizeof arg);
+  if (timeoutMs >= 0)
+  {
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000 * 1000;
+    arg.ts = reinterpret_cast<uintptr_t>(&ts);
+  }
+  unsigned flags = IORING_ENTER_EXT_ARG;
+  if (minComplete > 0)
+  {
+    flags |= IORING_ENTER_GETEVENTS;
+  }
+  return ioUringEnter(ringfd_, toSubmit, minComplete, flags, &arg, sizeof arg);
+}
@@ -0,0 +1,137 @@
+// Copyright 2010, Shuo Chen.  All rights reserved.
+// http://code.google.com/p/muduo/
+//
+// Use of this source code is governed by a BSD-style license
+// that can be found in the License file.
+
+// Author: Shuo Chen (chenshuo at chenshuo dot com)
+//
+// This is an internal header file, you should not include this.
+
+#ifndef MUDUO_NET_POLLER_URINGPOLLER_H
+#define MUDUO_NET_POLLER_URINGPOLLER_H
+
+#include <muduo/net/Poller.h>
+
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include <netinet/in.h>
+#include <sys/uio.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace muduo
+{
+namespace net
+{
+
+///
+/// IO Multiplexing with io_uring(7).
+///
+/// Readiness is watched with one-shot IORING_OP_POLL_ADD requests, which are
+/// re-armed after they fire, so it is level-triggered like poll(2).
+///
+/// Channels which ask for it with Channel::setReadOp() and
+/// Channel::setGatherCallback() get completion-based I/O instead,
+/// IORING_OP_RECV into a pool of buffers provided to the kernel,
+/// IORING_OP_ACCEPT and IORING_OP_WRITEV, which are re-armed the same way.
+/// A channel falls back to readiness for one read if the pool runs dry.
+///
+/// Requests made in one loop iteration are queued and submitted together
+/// with waiting for completions, in a single io_uring_enter(2).
+///
+class UringPoller : public Poller
+{
+ public:
+  UringPoller(EventLoop* loop);
+  virtual ~UringPoller();
+
+  virtual Timestamp poll(int timeoutMs, ChannelList* activeChannels);
+  virtual void updateChannel(Channel* channel);
+  virtual void removeChannel(Channel* channel);
+
+  /// Whether the kernel supports everything needed, Linux 5.11 or later.
+  static bool available();
+
+  static const int kNumRecvBuffers = 256;
+  static const int kRecvBufferSize = 16 * 1024;
+
+ private:
+  static const unsigned kQueueDepth = 1024;
+  static const int kMaxIovecs = 64;
+
+  enum OpKind { kPollOp, kRecvOp, kAcceptOp, kWriteOp };
+
+  // an in-flight request, its address is the user_data
+  struct Op
+  {
+    OpKind kind;
+    int fd;
+    Channel* channel;     // NULL once the channel is removed
+    int events;           // of kPollOp
+    bool cancelled;
+    boost::shared_ptr<void> guard;  // owner of the data of kWriteOp
+    struct iovec vec[kMaxIovecs];   // of kWriteOp
+    struct sockaddr_in6 addr;       // of kAcceptOp
+    socklen_t addrlen;
+  };
+
+  struct Interest
+  {
+    Channel* channel;
+    Op* poll;
+    Op* read;             // kRecvOp or kAcceptOp
+    Op* write;
+    int revents;          // of this round
+    int64_t round;        // when it was last active
+    bool dirty;           // waiting to be (re-)armed
+    bool recvFallback;    // buffers ran out, watches readability once
+  };
+  typedef std::map<int, Interest> InterestMap;
+
+  io_uring_sqe* getSqe();
+  Op* newOp(OpKind kind, int fd, Interest* interest);
+  void freeOp(Op* op);
+  void arm(int fd, Interest* interest);
+  void submitPollAdd(int fd, Interest* interest, int events);
+  void submitPollRemove(Interest* interest);
+  void submitRead(int fd, Interest* interest);
+  bool submitWrite(int fd, Interest* interest);
+  void submitCancel(Op* op);
+  void provideRecvBuffers(int bid, int count);
+  void markDirty(int fd, Interest* interest);
+  int enter(unsigned minComplete, int timeoutMs);
+  void fillActiveChannels(ChannelList* activeChannels);
+  void complete(Op* op, const io_uring_cqe& cqe, ChannelList* activeChannels);
+
+  int ringfd_;
+  // mmapped submission and completion rings
+  void* ring_;
+  size_t ringSize_;
+  io_uring_sqe* sqes_;
+  size_t sqesSize_;
+  unsigned* sqHead_;
+  unsigned* sqTail_;
+  unsigned sqMask_;
+  unsigned* sqArray_;
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned cqMask_;
+  io_uring_cqe* cqes_;
+
+  int64_t round_;
+  InterestMap interests_;
+  std::vector<int> dirtyFds_;
+  std::vector<Op*> freeOps_;
+  std::vector<Op*> allOps_;
+  std::vector<char> recvBuffers_;
+  std::vector<int> usedRecvBuffers_;  // given back in next poll()
+};
+
+}
+}
+#endif  // MUDUO_NET_POLLER_URINGPOLLER_H
@@ -1,3 +1,9 @@
+-- same check as CMake: the io_uring header new enough for UringPoller
+local function haveIoUring()
+    return os.execute("printf '#include <linux/io_uring.h>\\nint x = IORING_FEAT_EXT_ARG;\\n'"
+                      .. " | c++ -x c++ -fsyntax-only - 2>/dev/null") == 0
+end
+
 project "net"
     kind "StaticLib"
     language "C++"
@@ -8,6 +14,7 @@ project "net"
     headersdir('muduo/net')
     headers {
         'Buffer.h',
+        'BufferAllocator.h',
         'Callbacks.h',
         'Channel.h',
         'Endian.h',
@@ -24,12 +31,15 @@ project "net"
     files {
         'Acceptor.cc',
         'Buffer.cc',
+        'BufferAllocator.cc',
         'Channel.cc',
         'Connector.cc',
         'EventLoop.cc',
         'EventLoopThread.cc',
         'EventLoopThreadPool.cc',
         'InetAddress.cc',
+        'LoopStats.cc',
+        'OutputQueue.cc',
         'Poller.cc',
         'poller/DefaultPoller.cc',
         'poller/EPollPoller.cc',
@@ -41,5 +51,12 @@ project "net"
         'TcpServer.cc',
         'Timer.cc',
         'TimerQueue.cc',
+        'TimingWheel.cc',
+        'Watchdog.cc',
      }
 
+    if haveIoUring() then
+        files { 'poller/UringPoller.cc' }
+    else
+        defines { 'NO_IO_URING' }
+    end
@@ -5,8 +5,13 @@
 #define BOOST_TEST_DYN_LINK
 #include <boost/test/unit_test.hpp>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 using muduo::string;
 using muduo::net::Buffer;
+using muduo::net::BufferAllocatorPtr;
+using muduo::net::SlabBufferAllocator;
 
 BOOST_AUTO_TEST_CASE(testBufferAppendRetrieve)
 {
@@ -152,6 +157,105 @@ BOOST_AUTO_TEST_CASE(testBufferFindEOL)
   BOOST_CHECK_EQUAL(buf.findEOL(buf.peek()+90000), null);
 }
 
+BOOST_AUTO_TEST_CASE(testSlabBufferAllocator)
+{
+  SlabBufferAllocator slab("test");
+  size_t size = 1000;
+  char* block = slab.allocate(&size);
+  BOOST_CHECK_EQUAL(size, 1024);
+  slab.deallocate(block, size);
+  BOOST_CHECK_EQUAL(slab.stats().bytesCached, 1024);
+
+  size = 1024;
+  BOOST_CHECK_EQUAL(slab.allocate(&size), block);
+  BOOST_CHECK_EQUAL(slab.stats().hits, 1);
+  BOOST_CHECK_EQUAL(slab.stats().bytesInUse, 1024);
+  slab.deallocate(block, size);
+
+  size = 100000;
+  block = slab.allocate(&size);
+  BOOST_CHECK_EQUAL(size, 100000);
+  slab.deallocate(block, size);
+  BOOST_CHECK_EQUAL(slab.stats().bytesCached, 1024);
+  BOOST_CHECK_EQUAL(slab.stats().bytesInUse, 0);
+  BOOST_CHECK_EQUAL(slab.stats().allocations, 3);
+  BOOST_CHECK_EQUAL(slab.stats().deallocations, 3);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferAllocator)
+{
+  SlabBufferAllocator* slab = new SlabBufferAllocator("test");
+  BufferAllocatorPtr allocator(slab);
+  Buffer buf(allocator, 0);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), 0);
+  BOOST_CHECK_EQUAL(slab->stats().allocations, 0);
+
+  buf.append(string(200, 'x'));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 200);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), 1024);
+  // the whole block is usable
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 1024 - Buffer::kCheapPrepend - 200);
+
+  buf.append(string(2000, 'y'));
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 2200);
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), 4096);
+  BOOST_CHECK_EQUAL(buf.writableBytes(), 4096 - Buffer::kCheapPrepend - 2200);
+  BOOST_CHECK_EQUAL(buf.retrieveAsString(200), string(200, 'x'));
+
+  Buffer copy(buf);
+  BOOST_CHECK(copy.allocator() == allocator);
+  BOOST_CHECK_EQUAL(copy.retrieveAllAsString(), string(2000, 'y'));
+
+  buf.retrieveAll();
+  buf.release();
+  BOOST_CHECK_EQUAL(buf.internalCapacity(), 0);
+  BOOST_CHECK_EQUAL(slab->stats().bytesInUse, 4096);  // copy
+
+  buf.appendInt32(42);
+  BOOST_CHECK_EQUAL(buf.prependableBytes(), Buffer::kCheapPrepend);
+  BOOST_CHECK_EQUAL(buf.peekInt32(), 42);
+  BOOST_CHECK(slab->stats().hits > 0);
+
+  // prepend and initial size round up to the next class, none of it is wasted
+  Buffer rounded(allocator);
+  BOOST_CHECK_EQUAL(rounded.internalCapacity(), 2048);
+  BOOST_CHECK_EQUAL(rounded.writableBytes(), 2048 - Buffer::kCheapPrepend);
+
+  // a released buffer can be prepended to
+  buf.retrieveAll();
+  buf.release();
+  buf.prependInt32(7);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), sizeof(int32_t));
+  BOOST_CHECK_EQUAL(buf.readInt32(), 7);
+}
+
+BOOST_AUTO_TEST_CASE(testBufferReadFd)
+{
+  int fds[2];
+  BOOST_REQUIRE(::pipe2(fds, O_NONBLOCK) == 0);
+  const string data(60000, 'r');
+  BOOST_REQUIRE(::write(fds[1], data.data(), data.size()) == static_cast<ssize_t>(data.size()));
+
+  Buffer buf;
+  int savedErrno = 0;
+  bool drained = true;
+  BOOST_CHECK_EQUAL(buf.readFd(fds[0], &savedErrno, 1024, 10000, false, &drained), 10000);
+  BOOST_CHECK_EQUAL(buf.readableBytes(), 10000);
+  BOOST_CHECK(!drained);
+
+  // pre-sized, reads until EAGAIN
+  BOOST_CHECK_EQUAL(buf.readFd(fds[0], &savedErrno, 50000, 1000000, true, &drained), 50000);
+  BOOST_CHECK(drained);
+  BOOST_CHECK_EQUAL(buf.retrieveAllAsString(), data);
+  BOOST_CHECK_EQUAL(buf.readFd(fds[0], &savedErrno, 1024, 1000000, false), -1);
+  BOOST_CHECK_EQUAL(savedErrno, EAGAIN);
+
+  ::close(fds[1]);
+  BOOST_CHECK_EQUAL(buf.readFd(fds[0], &savedErrno, 1024, 1000000, false), 0);
+  ::close(fds[0]);
+}
+
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 void output(Buffer&& buf, const void* inner)
 {
@@ -65,6 +65,30 @@ int main()
     assert(nextLoop == model.getNextLoop());
   }
 
+  {
+    printf("Least connections:\n");
+    EventLoopThreadPool model(&loop, "least");
+    model.setThreadNum(3);
+    model.start(init);
+    model.setPlacementPolicy(EventLoopThreadPool::leastConnections);
+    std::vector<EventLoop*> loops = model.getAllLoops();
+    loops[0]->addConnections(2);
+    loops[1]->addConnections(1);
+    assert(model.getNextLoop() == loops[2]);
+    loops[2]->addConnections(3);
+    assert(model.getNextLoop() == loops[1]);
+    loops[0]->addConnections(1);
+    loops[1]->addConnections(2);
+    // ties go round-robin
+    assert(model.getNextLoop() == loops[2]);
+    assert(model.getNextLoop() == loops[0]);
+    assert(model.getNextLoop() == loops[1]);
+    for (size_t i = 0; i < loops.size(); ++i)
+    {
+      loops[i]->addConnections(-3);
+    }
+  }
+
   loop.loop();
 }
 
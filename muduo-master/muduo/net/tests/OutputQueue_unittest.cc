@@ -0,0 +1,280 @@
+#include <muduo/net/OutputQueue.h>
+#include <muduo/base/Thread.h>
+
+#include <boost/bind.hpp>
+
+//#define BOOST_TEST_MODULE OutputQueueTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using muduo::string;
+using muduo::net::BufferAllocatorPtr;
+using muduo::net::OutputQueue;
+using muduo::net::SlabBufferAllocator;
+
+namespace
+{
+string readAll(int fd, size_t len)
+{
+  string result;
+  char buf[8192];
+  while (result.size() < len)
+  {
+    ssize_t n = ::read(fd, buf, sizeof buf);
+    if (n <= 0)
+      break;
+    result.append(buf, n);
+  }
+  return result;
+}
+
+void appendChunks(OutputQueue* queue, size_t len)
+{
+  const string str(len, 'z');
+  queue->append(str.data(), str.size());
+}
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueAppendRetrieve)
+{
+  OutputQueue queue;
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(queue.numSegments(), 0);
+
+  const string str(200, 'x');
+  queue.append(str.data(), str.size());
+  BOOST_CHECK_EQUAL(queue.readableBytes(), str.size());
+  BOOST_CHECK_EQUAL(queue.numSegments(), 1);
+
+  queue.append(str.data(), str.size());
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 2*str.size());
+  BOOST_CHECK_EQUAL(queue.numSegments(), 1);
+
+  queue.retrieve(50);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 350);
+
+  queue.retrieve(350);
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(queue.numSegments(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueGrow)
+{
+  OutputQueue queue;
+  const string str(OutputQueue::kChunkSize * 2 + 100, 'y');
+  queue.append(str.data(), str.size());
+  BOOST_CHECK_EQUAL(queue.readableBytes(), str.size());
+  BOOST_CHECK_EQUAL(queue.numSegments(), 3);
+
+  queue.retrieve(OutputQueue::kChunkSize + 1);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), OutputQueue::kChunkSize + 99);
+  BOOST_CHECK_EQUAL(queue.numSegments(), 2);
+
+  queue.retrieveAll();
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(queue.numSegments(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueAppendFrom)
+{
+  OutputQueue from;
+  const string first(100, 'a');
+  const string second(OutputQueue::kChunkSize, 'b');
+  from.append(first.data(), first.size());
+  from.append(second.data(), second.size());
+  BOOST_CHECK_EQUAL(from.numSegments(), 2);
+
+  OutputQueue queue;
+  queue.append("head", 4);
+  // part of the first chunk is copied
+  queue.appendFrom(&from, 50);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 54);
+  BOOST_CHECK_EQUAL(queue.numSegments(), 1);
+  BOOST_CHECK_EQUAL(from.readableBytes(), first.size() + second.size() - 50);
+
+  // the rest of it is moved
+  queue.appendFrom(&from, first.size() - 50 + 10);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), first.size() + 14);
+  BOOST_CHECK_EQUAL(from.readableBytes(), second.size() - 10);
+  queue.appendFrom(&from, from.readableBytes());
+  BOOST_CHECK(from.empty());
+  BOOST_CHECK_EQUAL(from.numSegments(), 0);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 4 + first.size() + second.size());
+
+  int fds[2];
+  BOOST_REQUIRE(::pipe(fds) == 0);
+  int savedErrno = 0;
+  while (!queue.empty())
+  {
+    BOOST_REQUIRE(queue.writeFd(fds[1], &savedErrno) > 0);
+  }
+  BOOST_CHECK(readAll(fds[0], 4 + first.size() + second.size()) == "head" + first + second);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+// chunks filled by another thread go back to the pool both threads share
+BOOST_AUTO_TEST_CASE(testOutputQueueSharedAllocator)
+{
+  SlabBufferAllocator* slab = new SlabBufferAllocator("OutputQueueTest");
+  BufferAllocatorPtr allocator(slab);
+  OutputQueue staging(allocator);
+  OutputQueue queue(allocator);
+
+  const size_t len = OutputQueue::kChunkSize * 4;
+  muduo::Thread thread(boost::bind(appendChunks, &staging, len));
+  thread.start();
+  thread.join();
+  BOOST_CHECK_EQUAL(slab->stats().allocations, 4);
+  BOOST_CHECK_EQUAL(slab->stats().hits, 0);
+
+  queue.appendFrom(&staging, len);
+  queue.retrieveAll();
+  BOOST_CHECK_EQUAL(slab->stats().bytesInUse, 0);
+  BOOST_CHECK_EQUAL(slab->stats().bytesCached, static_cast<int64_t>(len));
+
+  muduo::Thread again(boost::bind(appendChunks, &staging, len));
+  again.start();
+  again.join();
+  BOOST_CHECK_EQUAL(slab->stats().hits, 4);
+  staging.retrieveAll();
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueAppendRef)
+{
+  OutputQueue queue;
+  boost::shared_ptr<const string> message(new string(1000, 'r'));
+  queue.append("head", 4);
+  queue.appendRef(message->data(), message->size(), message);
+  queue.append("tail", 4);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 1008);
+  BOOST_CHECK_EQUAL(queue.numSegments(), 3);
+  BOOST_CHECK_EQUAL(message.use_count(), 2);
+
+  queue.retrieve(500);
+  BOOST_CHECK_EQUAL(message.use_count(), 2);
+  queue.retrieve(504);
+  BOOST_CHECK_EQUAL(message.use_count(), 1);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueWriteFd)
+{
+  int fds[2];
+  BOOST_REQUIRE(::pipe(fds) == 0);
+
+  OutputQueue queue;
+  string expected;
+  for (int i = 0; i < 100; ++i)
+  {
+    string piece(100 + i, static_cast<char>('a' + i % 26));
+    expected += piece;
+    if (i % 2)
+    {
+      boost::shared_ptr<const string> ref(new string(piece));
+      queue.appendRef(ref->data(), ref->size(), ref);
+    }
+    else
+    {
+      queue.append(piece.data(), piece.size());
+    }
+  }
+  BOOST_CHECK_EQUAL(queue.readableBytes(), expected.size());
+
+  int savedErrno = 0;
+  ssize_t n = queue.writeFd(fds[1], &savedErrno);
+  BOOST_CHECK_EQUAL(n, static_cast<ssize_t>(expected.size()));
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(readAll(fds[0], expected.size()), expected);
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueFileAndPipe)
+{
+  char path[] = "/tmp/outputqueue_unittest.XXXXXX";
+  int filefd = ::mkstemp(path);
+  BOOST_REQUIRE(filefd >= 0);
+  ::unlink(path);
+  const string content(10000, 'f');
+  BOOST_REQUIRE(::write(filefd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+
+  int source[2];
+  int sink[2];
+  BOOST_REQUIRE(::pipe(source) == 0);
+  BOOST_REQUIRE(::pipe(sink) == 0);
+  BOOST_REQUIRE(::write(source[1], "pipe", 4) == 4);
+
+  OutputQueue queue;
+  queue.append("head", 4);
+  queue.appendFile(filefd, 100, 5000, boost::shared_ptr<const void>());
+  queue.appendPipe(source[0], 4, boost::shared_ptr<const void>());
+  queue.append("tail", 4);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 5012);
+  BOOST_CHECK_EQUAL(queue.numSegments(), 4);
+
+  string received;
+  int savedErrno = 0;
+  while (!queue.empty())
+  {
+    ssize_t n = queue.writeFd(sink[1], &savedErrno);
+    BOOST_REQUIRE(n > 0);
+    received += readAll(sink[0], n);
+  }
+  BOOST_CHECK_EQUAL(received, "head" + content.substr(100, 5000) + "pipe" + "tail");
+
+  // a file segment beyond EOF fails, the rest stays
+  queue.appendFile(filefd, 9000, 2000, boost::shared_ptr<const void>());
+  BOOST_CHECK_EQUAL(queue.writeFd(sink[1], &savedErrno), 1000);
+  BOOST_CHECK_EQUAL(queue.writeFd(sink[1], &savedErrno), -1);
+  BOOST_CHECK_EQUAL(savedErrno, EIO);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 1000u);
+
+  ::close(filefd);
+  ::close(source[0]);
+  ::close(source[1]);
+  ::close(sink[0]);
+  ::close(sink[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testOutputQueueWaitingPipe)
+{
+  int source[2];
+  int sink[2];
+  BOOST_REQUIRE(::pipe2(source, O_NONBLOCK) == 0);
+  BOOST_REQUIRE(::pipe(sink) == 0);
+
+  OutputQueue queue;
+  BOOST_CHECK_EQUAL(queue.waitingPipe(), -1);
+  queue.appendPipe(source[0], 8, boost::shared_ptr<const void>());
+
+  // the sink is writable, but the pipe is empty
+  int savedErrno = 0;
+  BOOST_CHECK_EQUAL(queue.writeFd(sink[1], &savedErrno), -1);
+  BOOST_CHECK_EQUAL(savedErrno, EAGAIN);
+  BOOST_CHECK_EQUAL(queue.waitingPipe(), source[0]);
+
+  BOOST_REQUIRE(::write(source[1], "half", 4) == 4);
+  BOOST_CHECK_EQUAL(queue.waitingPipe(), -1);
+  BOOST_CHECK_EQUAL(queue.writeFd(sink[1], &savedErrno), 4);
+  BOOST_CHECK_EQUAL(queue.readableBytes(), 4);
+  BOOST_CHECK_EQUAL(queue.waitingPipe(), source[0]);
+  BOOST_CHECK_EQUAL(readAll(sink[0], 4), "half");
+
+  BOOST_REQUIRE(::write(source[1], "done", 4) == 4);
+  BOOST_CHECK_EQUAL(queue.writeFd(sink[1], &savedErrno), 4);
+  BOOST_CHECK(queue.empty());
+  BOOST_CHECK_EQUAL(queue.waitingPipe(), -1);
+  BOOST_CHECK_EQUAL(readAll(sink[0], 4), "done");
+
+  ::close(source[0]);
+  ::close(source[1]);
+  ::close(sink[0]);
+  ::close(sink[1]);
+}
@@ -0,0 +1,465 @@
+#include <muduo/net/TcpConnection.h>
+
+#include <muduo/base/CountDownLatch.h>
+#include <muduo/base/Thread.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThread.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+
+//#define BOOST_TEST_MODULE TcpConnectionTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// asks the kernel for an unused port, builds of this test run in parallel
+uint16_t freePort()
+{
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  ::memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrlen = sizeof addr;
+  BOOST_REQUIRE(::bind(sockfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) == 0);
+  BOOST_REQUIRE(::getsockname(sockfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) == 0);
+  ::close(sockfd);
+  return ntohs(addr.sin_port);
+}
+
+// a server in its own loop thread, which keeps the last connection
+// and what it receives
+class Server
+{
+ public:
+  explicit Server(bool edgeTriggered = false)
+    : loop_(thread_.startLoop()),
+      port_(freePort()),
+      edgeTriggered_(edgeTriggered),
+      latch_(1)
+  {
+    CountDownLatch started(1);
+    loop_->runInLoop(boost::bind(&Server::start, this, &started));
+    started.wait();
+  }
+
+  ~Server()
+  {
+    CountDownLatch stopped(1);
+    loop_->runInLoop(boost::bind(&Server::stop, this, &stopped));
+    stopped.wait();
+  }
+
+  // connects a blocking client, which gives up reading after 10 seconds,
+  // returns its fd
+  int connect()
+  {
+    int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr(port_, true);
+    BOOST_REQUIRE(::connect(sockfd, addr.getSockAddr(), sizeof(struct sockaddr_in)) == 0);
+    struct timeval tv = { 10, 0 };
+    ::setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    latch_.wait();
+    return sockfd;
+  }
+
+  EventLoop* loop() const { return loop_; }
+  TcpConnectionPtr connection() const { return conn_; }
+
+  // waits up to 10 seconds for len bytes
+  string received(size_t len)
+  {
+    for (int i = 0; i < 1000 && receivedBytes() < len; ++i)
+    {
+      ::usleep(10*1000);
+    }
+    MutexLockGuard lock(mutex_);
+    return received_;
+  }
+
+ private:
+  void start(CountDownLatch* started)
+  {
+    server_.reset(new TcpServer(loop_, InetAddress(port_, true), "Server"));
+    server_->setConnectionCallback(boost::bind(&Server::onConnection, this, _1));
+    server_->setMessageCallback(boost::bind(&Server::onMessage, this, _1, _2));
+    server_->setEdgeTriggered(edgeTriggered_);
+    server_->start();
+    started->countDown();
+  }
+
+  void stop(CountDownLatch* stopped)
+  {
+    conn_.reset();
+    server_.reset();
+    stopped->countDown();
+  }
+
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn_ = conn;
+      latch_.countDown();
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf)
+  {
+    MutexLockGuard lock(mutex_);
+    received_ += buf->retrieveAllAsString();
+  }
+
+  size_t receivedBytes() const
+  {
+    MutexLockGuard lock(mutex_);
+    return received_.size();
+  }
+
+  EventLoopThread thread_;
+  EventLoop* loop_;
+  const uint16_t port_;
+  const bool edgeTriggered_;
+  CountDownLatch latch_;
+  mutable MutexLock mutex_;
+  string received_;  // guarded by mutex_
+  boost::scoped_ptr<TcpServer> server_;
+  TcpConnectionPtr conn_;  // written before latch_ counts down
+};
+
+string readAll(int fd, size_t len)
+{
+  string result;
+  char buf[8192];
+  while (result.size() < len)
+  {
+    ssize_t n = ::read(fd, buf, sizeof buf);
+    if (n <= 0)
+      break;
+    result.append(buf, n);
+  }
+  return result;
+}
+
+string makeMessage(char c, size_t len)
+{
+  string message;
+  for (size_t i = 0; i < len; ++i)
+  {
+    message += static_cast<char>(c + i % 10);
+  }
+  return message;
+}
+
+// sends one message with every overload, returns the bytes to expect
+string sendAll(const TcpConnectionPtr& conn)
+{
+  string expected;
+  const string small = makeMessage('a', 100);
+  // larger than a chunk of the output queue, and than the socket buffer
+  const string large = makeMessage('A', 1024*1024 + 7);
+  for (int i = 0; i < 2; ++i)
+  {
+    const string& message = i == 0 ? small : large;
+    conn->send(message.data(), static_cast<int>(message.size()));
+    conn->send(StringPiece(message));
+
+    Buffer buf;
+    buf.append(message);
+    conn->send(&buf);
+    BOOST_CHECK_EQUAL(buf.readableBytes(), 0);
+
+    std::vector<string> batch;
+    batch.push_back(message);
+    batch.push_back("batch");
+    conn->send(&batch);
+    BOOST_CHECK(batch.empty());
+
+    conn->send(boost::shared_ptr<const string>(new string(message)));
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+    conn->send(string(message));
+    conn->send("literal");
+    Buffer moved;
+    moved.append(message);
+    conn->send(std::move(moved));
+    conn->send(std::vector<string>(2, message));
+#endif
+
+    expected += message + message + message + message + "batch" + message;
+#ifdef __GXX_EXPERIMENTAL_CXX0X__
+    expected += message + "literal" + message + message + message;
+#endif
+  }
+  return expected;
+}
+
+void sendAllInLoop(const TcpConnectionPtr& conn, string* expected, CountDownLatch* latch)
+{
+  *expected = sendAll(conn);
+  latch->countDown();
+}
+
+// tags every message with the thread id and a sequence number
+void sendBuffers(const TcpConnectionPtr& conn, int id, int count, CountDownLatch* latch)
+{
+  latch->wait();
+  for (int i = 0; i < count; ++i)
+  {
+    char message[64];
+    snprintf(message, sizeof message, "%d:%05d;", id, i);
+    Buffer buf;
+    buf.append(message);
+    conn->send(&buf);
+  }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testSendInLoop)
+{
+  Server server;
+  int sockfd = server.connect();
+
+  string expected;
+  CountDownLatch latch(1);
+  server.loop()->runInLoop(
+      boost::bind(sendAllInLoop, server.connection(), &expected, &latch));
+  latch.wait();
+  BOOST_CHECK(readAll(sockfd, expected.size()) == expected);
+  ::close(sockfd);
+}
+
+BOOST_AUTO_TEST_CASE(testSendFromOtherThread)
+{
+  Server server;
+  int sockfd = server.connect();
+
+  string expected = sendAll(server.connection());
+  BOOST_CHECK(readAll(sockfd, expected.size()) == expected);
+  ::close(sockfd);
+}
+
+BOOST_AUTO_TEST_CASE(testSendBufferFromManyThreads)
+{
+  Server server;
+  int sockfd = server.connect();
+
+  const int kThreads = 4;
+  const int kMessages = 10000;
+  CountDownLatch latch(1);
+  boost::ptr_vector<Thread> threads;
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads.push_back(new Thread(
+          boost::bind(sendBuffers, server.connection(), i, kMessages, &latch)));
+    threads.back().start();
+  }
+  latch.countDown();
+
+  // each message is "id:seq;", 8 bytes, in order within one thread
+  const size_t total = kThreads * kMessages * 8;
+  string received = readAll(sockfd, total);
+  for (int i = 0; i < kThreads; ++i)
+  {
+    threads[i].join();
+  }
+  BOOST_REQUIRE_EQUAL(received.size(), total);
+  std::vector<int> next(kThreads);
+  for (size_t i = 0; i < received.size(); i += 8)
+  {
+    int id = -1, seq = -1;
+    BOOST_REQUIRE(sscanf(received.c_str() + i, "%d:%d;", &id, &seq) == 2);
+    BOOST_REQUIRE(id >= 0 && id < kThreads);
+    BOOST_REQUIRE_EQUAL(seq, next[id]++);
+  }
+  ::close(sockfd);
+}
+
+BOOST_AUTO_TEST_CASE(testEdgeTriggeredLargeWrite)
+{
+  Server server(true);
+  int sockfd = server.connect();
+
+  // larger than the socket send buffer, written until EAGAIN,
+  // and the rest after the next edge
+  string expected;
+  CountDownLatch latch(1);
+  server.loop()->runInLoop(
+      boost::bind(sendAllInLoop, server.connection(), &expected, &latch));
+  latch.wait();
+  BOOST_CHECK(readAll(sockfd, expected.size()) == expected);
+  BOOST_CHECK(server.connection()->connected());
+  ::close(sockfd);
+}
+
+BOOST_AUTO_TEST_CASE(testEdgeTriggeredLargeRead)
+{
+  Server server(true);
+  int sockfd = server.connect();
+
+  // several times the read budget, in one edge
+  const string message = makeMessage('r', 8 * TcpConnection::kDefaultReadBudget + 3);
+  size_t written = 0;
+  while (written < message.size())
+  {
+    ssize_t n = ::write(sockfd, message.data() + written, message.size() - written);
+    BOOST_REQUIRE(n > 0);
+    written += n;
+  }
+  BOOST_CHECK(server.received(message.size()) == message);
+  ::close(sockfd);
+}
+
+namespace
+{
+
+void sendFileInLoop(const TcpConnectionPtr& conn, int fd, size_t len, CountDownLatch* latch)
+{
+  conn->send("head");
+  conn->sendFile(fd, 0, len);
+  conn->send("tail");
+  latch->countDown();
+}
+
+void sendPipeInLoop(const TcpConnectionPtr& conn, int pipefd, size_t len, CountDownLatch* latch)
+{
+  conn->send("head");
+  conn->sendPipe(pipefd, len);
+  latch->countDown();
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testEdgeTriggeredSendFile)
+{
+  Server server(true);
+  int sockfd = server.connect();
+
+  char path[] = "/tmp/tcpconnection_unittest.XXXXXX";
+  int filefd = ::mkstemp(path);
+  BOOST_REQUIRE(filefd >= 0);
+  ::unlink(path);
+  // larger than the socket send buffer
+  const string content = makeMessage('0', 3*1024*1024);
+  BOOST_REQUIRE(::write(filefd, content.data(), content.size())
+                == static_cast<ssize_t>(content.size()));
+
+  CountDownLatch latch(1);
+  server.loop()->runInLoop(
+      boost::bind(sendFileInLoop, server.connection(), filefd, content.size(), &latch));
+  latch.wait();
+  const string expected = "head" + content + "tail";
+  BOOST_CHECK(readAll(sockfd, expected.size()) == expected);
+  ::close(sockfd);
+  ::close(filefd);
+}
+
+BOOST_AUTO_TEST_CASE(testEdgeTriggeredSendPipeLateWriter)
+{
+  Server server(true);
+  int sockfd = server.connect();
+
+  int fds[2];
+  BOOST_REQUIRE(::pipe2(fds, O_NONBLOCK) == 0);
+  CountDownLatch latch(1);
+  server.loop()->runInLoop(
+      boost::bind(sendPipeInLoop, server.connection(), fds[0], 8, &latch));
+  latch.wait();
+  BOOST_CHECK_EQUAL(readAll(sockfd, 4), "head");
+
+  // the pipe is empty, the connection watches it instead of the socket,
+  // a send() meanwhile is queued after the pipe
+  ::usleep(100*1000);
+  server.connection()->send("more");
+  ::usleep(100*1000);
+  BOOST_REQUIRE(::write(fds[1], "late", 4) == 4);
+  ::usleep(100*1000);
+  BOOST_REQUIRE(::write(fds[1], "data", 4) == 4);
+  BOOST_CHECK_EQUAL(readAll(sockfd, 12), "latedatamore");
+  ::close(sockfd);
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testSendFileBeyondEofCloses)
+{
+  for (int et = 0; et < 2; ++et)
+  {
+    Server server(et != 0);
+    int sockfd = server.connect();
+
+    char path[] = "/tmp/tcpconnection_unittest.XXXXXX";
+    int filefd = ::mkstemp(path);
+    BOOST_REQUIRE(filefd >= 0);
+    ::unlink(path);
+    const string content = makeMessage('0', 100);
+    BOOST_REQUIRE(::write(filefd, content.data(), content.size())
+                  == static_cast<ssize_t>(content.size()));
+
+    // the peer never gets the promised bytes, the connection is closed,
+    // "tail" is not sent
+    CountDownLatch latch(1);
+    server.loop()->runInLoop(
+        boost::bind(sendFileInLoop, server.connection(), filefd, 1000, &latch));
+    latch.wait();
+    BOOST_CHECK(readAll(sockfd, 4 + content.size()) == "head" + content);
+    for (int i = 0; i < 100 && server.connection()->connected(); ++i)
+    {
+      ::usleep(10*1000);
+    }
+    BOOST_CHECK(!server.connection()->connected());
+    ::close(sockfd);
+    ::close(filefd);
+  }
+}
+
+void inputCapacityInLoop(const TcpConnectionPtr& conn, size_t* capacity, CountDownLatch* latch)
+{
+  *capacity = conn->inputBuffer()->internalCapacity();
+  latch->countDown();
+}
+
+// a connection drained by small reads gives its input block back to the pool
+BOOST_AUTO_TEST_CASE(testIdleConnectionReleasesInputBuffer)
+{
+  for (int et = 0; et < 2; ++et)
+  {
+    Server server(et != 0);
+    int sockfd = server.connect();
+    const string message = makeMessage('a', 100);
+    for (int i = 0; i < 3; ++i)
+    {
+      BOOST_REQUIRE(::write(sockfd, message.data(), message.size())
+                    == static_cast<ssize_t>(message.size()));
+      BOOST_REQUIRE_EQUAL(server.received((i + 1) * message.size()).size(),
+                          (i + 1) * message.size());
+
+      size_t capacity = 1;
+      CountDownLatch latch(1);
+      server.loop()->runInLoop(
+          boost::bind(inputCapacityInLoop, server.connection(), &capacity, &latch));
+      latch.wait();
+      BOOST_CHECK_EQUAL(capacity, 0);
+    }
+    ::close(sockfd);
+  }
+}
@@ -0,0 +1,275 @@
+#include <muduo/net/TcpServer.h>
+
+#include <muduo/base/Mutex.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/EventLoopThreadPool.h>
+#include <muduo/net/InetAddress.h>
+
+#include <boost/bind.hpp>
+
+//#define BOOST_TEST_MODULE TcpServerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <sched.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// asks the kernel for an unused port, so tests may run in parallel
+uint16_t freePort()
+{
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  ::memset(&addr, 0, sizeof addr);
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrlen = sizeof addr;
+  BOOST_REQUIRE(::bind(sockfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) == 0);
+  BOOST_REQUIRE(::getsockname(sockfd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) == 0);
+  ::close(sockfd);
+  return ntohs(addr.sin_port);
+}
+
+// listening sockets of this process bound to port
+int countListeningSockets(uint16_t port)
+{
+  int count = 0;
+  DIR* dir = ::opendir("/proc/self/fd");
+  BOOST_REQUIRE(dir != NULL);
+  while (struct dirent* entry = ::readdir(dir))
+  {
+    int fd = atoi(entry->d_name);
+    int listening = 0;
+    socklen_t optlen = sizeof listening;
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof addr;
+    if (fd > 0
+        && ::getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &optlen) == 0
+        && listening
+        && ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addrlen) == 0
+        && addr.sin_family == AF_INET
+        && ntohs(addr.sin_port) == port)
+    {
+      ++count;
+    }
+  }
+  ::closedir(dir);
+  return count;
+}
+
+int connectTo(uint16_t port)
+{
+  int sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
+  InetAddress addr(port, true);
+  BOOST_REQUIRE(::connect(sockfd, addr.getSockAddr(), sizeof(struct sockaddr_in)) == 0);
+  return sockfd;
+}
+
+// counts connections of each loop, in the IO threads
+class Recorder
+{
+ public:
+  Recorder()
+    : connected_(0),
+      mismatched_(0)
+  {
+  }
+
+  void setLoops(const std::vector<EventLoop*>& loops)
+  {
+    MutexLockGuard lock(mutex_);
+    loops_ = loops;
+  }
+
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (!conn->connected())
+      return;
+    // name is "Server-ip:port#loop.id", the index of the acceptor's loop
+    int index = -1;
+    sscanf(conn->name().c_str() + conn->name().find('#'), "#%d.", &index);
+    MutexLockGuard lock(mutex_);
+    ++connected_;
+    ++perLoop_[conn->getLoop()];
+    if (index < 0 || index >= static_cast<int>(loops_.size())
+        || loops_[index] != conn->getLoop()
+        || !conn->getLoop()->isInLoopThread())
+    {
+      ++mismatched_;
+    }
+  }
+
+  void quitWhenConnected(EventLoop* loop, int total)
+  {
+    MutexLockGuard lock(mutex_);
+    if (connected_ == total)
+    {
+      loop->quit();
+    }
+  }
+
+  int connected() const
+  {
+    MutexLockGuard lock(mutex_);
+    return connected_;
+  }
+
+  int mismatched() const
+  {
+    MutexLockGuard lock(mutex_);
+    return mismatched_;
+  }
+
+  std::map<EventLoop*, int> perLoop() const
+  {
+    MutexLockGuard lock(mutex_);
+    return perLoop_;
+  }
+
+ private:
+  mutable MutexLock mutex_;
+  std::vector<EventLoop*> loops_;
+  int connected_;
+  int mismatched_;
+  std::map<EventLoop*, int> perLoop_;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(testReusePortPerLoop)
+{
+  const int kThreads = 4;
+  const int kClients = 200;
+  const uint16_t port = freePort();
+
+  EventLoop loop;
+  Recorder recorder;
+  std::vector<int> clients;
+  {
+    TcpServer server(&loop, InetAddress(port, true), "Server", TcpServer::kReusePortPerLoop);
+    server.setConnectionCallback(boost::bind(&Recorder::onConnection, &recorder, _1));
+    server.setThreadNum(kThreads);
+    server.start();
+    recorder.setLoops(server.threadPool()->getAllLoops());
+
+    // one listening socket per IO loop, none for the base loop
+    BOOST_CHECK_EQUAL(countListeningSockets(port), kThreads);
+
+    // the kernel completes handshakes before the loops accept
+    for (int i = 0; i < kClients; ++i)
+    {
+      clients.push_back(connectTo(port));
+    }
+    loop.runEvery(0.01, boost::bind(&Recorder::quitWhenConnected, &recorder, &loop, kClients));
+    loop.runAfter(10.0, boost::bind(&EventLoop::quit, &loop));
+    loop.loop();
+
+    BOOST_CHECK_EQUAL(recorder.connected(), kClients);
+    BOOST_CHECK_EQUAL(recorder.mismatched(), 0);
+    // every loop accepts some, the chance that one gets none is (3/4)^200
+    std::map<EventLoop*, int> perLoop = recorder.perLoop();
+    BOOST_CHECK_EQUAL(perLoop.size(), static_cast<size_t>(kThreads));
+    BOOST_CHECK(perLoop.find(&loop) == perLoop.end());
+  }
+  BOOST_CHECK_EQUAL(countListeningSockets(port), 0);
+
+  for (size_t i = 0; i < clients.size(); ++i)
+  {
+    ::close(clients[i]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testReusePortPerLoopWithoutThreads)
+{
+  const uint16_t port = freePort();
+
+  EventLoop loop;
+  Recorder recorder;
+  TcpServer server(&loop, InetAddress(port, true), "Server", TcpServer::kReusePortPerLoop);
+  server.setConnectionCallback(boost::bind(&Recorder::onConnection, &recorder, _1));
+  server.start();
+  recorder.setLoops(server.threadPool()->getAllLoops());
+
+  // the base loop accepts by itself
+  BOOST_CHECK_EQUAL(countListeningSockets(port), 1);
+  int sockfd = connectTo(port);
+  loop.runEvery(0.01, boost::bind(&Recorder::quitWhenConnected, &recorder, &loop, 1));
+  loop.runAfter(10.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  BOOST_CHECK_EQUAL(recorder.connected(), 1);
+  BOOST_CHECK_EQUAL(recorder.mismatched(), 0);
+  BOOST_CHECK_EQUAL(recorder.perLoop()[&loop], 1);
+  ::close(sockfd);
+}
+
+BOOST_AUTO_TEST_CASE(testCpuSteering)
+{
+  const int kThreads = 2;
+  const int kClientsPerCpu = 8;
+  const uint16_t port = freePort();
+
+  EventLoop loop;
+  Recorder recorder;
+  TcpServer server(&loop, InetAddress(port, true), "Server", TcpServer::kReusePortPerLoop);
+  server.setConnectionCallback(boost::bind(&Recorder::onConnection, &recorder, _1));
+  server.setThreadNum(kThreads);
+  server.setCpuSteering(true);
+  server.start();
+  std::vector<EventLoop*> loops = server.threadPool()->getAllLoops();
+  recorder.setLoops(loops);
+
+  // on loopback, the SYN is handled on the cpu of the connecting thread,
+  // so connections from cpu c go to loop (c % kThreads).
+  cpu_set_t saved;
+  BOOST_REQUIRE(::sched_getaffinity(0, sizeof saved, &saved) == 0);
+  std::vector<int> expected(kThreads);
+  std::vector<int> clients;
+  for (int cpu = 0; cpu < CPU_SETSIZE && clients.size() < 4 * kClientsPerCpu; ++cpu)
+  {
+    if (!CPU_ISSET(cpu, &saved))
+      continue;
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(cpu, &one);
+    BOOST_REQUIRE(::sched_setaffinity(0, sizeof one, &one) == 0);
+    for (int i = 0; i < kClientsPerCpu; ++i)
+    {
+      clients.push_back(connectTo(port));
+    }
+    expected[cpu % kThreads] += kClientsPerCpu;
+  }
+  BOOST_REQUIRE(::sched_setaffinity(0, sizeof saved, &saved) == 0);
+
+  const int total = static_cast<int>(clients.size());
+  loop.runEvery(0.01, boost::bind(&Recorder::quitWhenConnected, &recorder, &loop, total));
+  loop.runAfter(10.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  BOOST_CHECK_EQUAL(recorder.connected(), total);
+  BOOST_CHECK_EQUAL(recorder.mismatched(), 0);
+  std::map<EventLoop*, int> perLoop = recorder.perLoop();
+  for (int i = 0; i < kThreads; ++i)
+  {
+    BOOST_CHECK_EQUAL(perLoop[loops[i]], expected[i]);
+  }
+  for (size_t i = 0; i < clients.size(); ++i)
+  {
+    ::close(clients[i]);
+  }
+}
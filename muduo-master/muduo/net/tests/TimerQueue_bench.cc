@@ -0,0 +1,80 @@
+#include <muduo/net/EventLoop.h>
+#include <muduo/base/Timestamp.h>
+
+#include <boost/bind.hpp>
+
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+// the same timers in the default TimerQueue and in the timing wheel,
+// usage: timerqueue_bench [numTimers]
+
+int g_fired = 0;
+int g_total = 0;
+EventLoop* g_loop = NULL;
+
+void onTimer()
+{
+  if (++g_fired == g_total)
+  {
+    g_loop->quit();
+  }
+}
+
+void noop()
+{
+}
+
+void bench(const char* name, int n)
+{
+  EventLoop loop;
+  g_loop = &loop;
+  std::vector<TimerId> timers;
+  timers.reserve(n);
+
+  // connection idle timeouts, most of them are canceled before firing
+  Timestamp start(Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    timers.push_back(loop.runAfter(60.0 + (i % 1000) * 0.01, noop));
+  }
+  Timestamp inserted(Timestamp::now());
+  for (int i = 0; i < n; ++i)
+  {
+    loop.cancel(timers[i]);
+  }
+  Timestamp canceled(Timestamp::now());
+
+  // short timers all firing in 100ms
+  g_fired = 0;
+  g_total = n;
+  for (int i = 0; i < n; ++i)
+  {
+    loop.runAfter(0.001 + (i % 100) * 0.001, onTimer);
+  }
+  Timestamp fireStart(Timestamp::now());
+  loop.loop();
+  Timestamp fired(Timestamp::now());
+
+  printf("%-6s insert %6.1f ns  cancel %6.1f ns  fire all %.3f s\n", name,
+         timeDifference(inserted, start) * 1e9 / n,
+         timeDifference(canceled, inserted) * 1e9 / n,
+         timeDifference(fired, fireStart));
+}
+
+int main(int argc, char* argv[])
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000000;
+  printf("%d timers\n", n);
+
+  ::unsetenv("MUDUO_TIMING_WHEEL");
+  bench("set", n);
+
+  ::setenv("MUDUO_TIMING_WHEEL", "1", 1);
+  bench("wheel", n);
+}
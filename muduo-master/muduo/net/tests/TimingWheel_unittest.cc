@@ -0,0 +1,216 @@
+#include <muduo/net/TimingWheel.h>
+#include <muduo/net/Timer.h>
+
+//#define BOOST_TEST_MODULE TimingWheelTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using muduo::Timestamp;
+using muduo::net::Timer;
+using muduo::net::TimingWheel;
+
+namespace
+{
+void noop()
+{
+}
+
+const double kTick = 0.001;
+const Timestamp kStart(1000 * Timestamp::kMicroSecondsPerSecond);
+
+Timestamp at(int64_t microSeconds)
+{
+  return Timestamp(kStart.microSecondsSinceEpoch() + microSeconds);
+}
+
+Timer* newTimer(int64_t microSeconds)
+{
+  return new Timer(noop, at(microSeconds), 0.0);
+}
+
+// advances tick by tick, until timer fires
+int64_t firesAt(TimingWheel* wheel, Timer* timer, int64_t limit)
+{
+  std::vector<Timer*> expired;
+  for (int64_t tick = 1; tick * 1000 <= limit; ++tick)
+  {
+    wheel->advance(at(tick * 1000), &expired);
+    if (!expired.empty())
+    {
+      BOOST_CHECK_EQUAL(expired.size(), 1u);
+      BOOST_CHECK(expired[0] == timer);
+      delete timer;
+      return tick * 1000;
+    }
+  }
+  return -1;
+}
+}
+
+BOOST_AUTO_TEST_CASE(testTimingWheelInsertAdvance)
+{
+  TimingWheel wheel(kTick, kStart);
+  BOOST_CHECK(wheel.empty());
+  BOOST_CHECK(!wheel.nextExpiration().valid());
+
+  Timer* t1 = newTimer(10500);
+  Timestamp when = wheel.insert(t1, at(0));
+  BOOST_CHECK_EQUAL(when.microSecondsSinceEpoch(),
+                    at(11000).microSecondsSinceEpoch());
+  BOOST_CHECK_EQUAL(wheel.nextExpiration().microSecondsSinceEpoch(),
+                    when.microSecondsSinceEpoch());
+  BOOST_CHECK_EQUAL(wheel.size(), 1u);
+
+  std::vector<Timer*> expired;
+  wheel.advance(at(10900), &expired);
+  BOOST_CHECK(expired.empty());
+  wheel.advance(at(11000), &expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+  BOOST_CHECK(expired[0] == t1);
+  BOOST_CHECK(wheel.empty());
+  delete t1;
+
+  // already expired timers fire in the next tick
+  Timer* t2 = newTimer(0);
+  when = wheel.insert(t2, at(11000));
+  BOOST_CHECK_EQUAL(when.microSecondsSinceEpoch(),
+                    at(12000).microSecondsSinceEpoch());
+  expired.clear();
+  wheel.advance(at(1000000), &expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+  delete t2;
+}
+
+BOOST_AUTO_TEST_CASE(testTimingWheelRemove)
+{
+  TimingWheel wheel(kTick, kStart);
+  Timer* t1 = newTimer(5000);
+  Timer* t2 = newTimer(5000);
+  Timer* t3 = newTimer(100000000);
+  wheel.insert(t1, at(0));
+  wheel.insert(t2, at(0));
+  wheel.insert(t3, at(0));
+  BOOST_CHECK_EQUAL(wheel.size(), 3u);
+
+  BOOST_CHECK(!wheel.remove(t1, t1->sequence() + 1));
+  BOOST_CHECK(wheel.remove(t1, t1->sequence()));
+  BOOST_CHECK(!wheel.remove(t1, t1->sequence()));
+  delete t1;
+  BOOST_CHECK(wheel.remove(t3, t3->sequence()));
+  delete t3;
+  BOOST_CHECK_EQUAL(wheel.size(), 1u);
+
+  std::vector<Timer*> expired;
+  wheel.advance(at(10000), &expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+  BOOST_CHECK(expired[0] == t2);
+  delete t2;
+}
+
+// a retired timer is reused, a stale sequence can't remove it
+BOOST_AUTO_TEST_CASE(testTimingWheelRetire)
+{
+  TimingWheel wheel(kTick, kStart);
+  BOOST_CHECK(wheel.recycle() == NULL);
+
+  Timer* t1 = newTimer(5000);
+  const int64_t seq1 = t1->sequence();
+  wheel.insert(t1, at(0));
+  std::vector<Timer*> expired;
+  wheel.advance(at(10000), &expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+  wheel.retire(t1);
+  BOOST_CHECK(!wheel.remove(t1, seq1));
+
+  Timer* t2 = wheel.recycle();
+  BOOST_CHECK(t2 == t1);
+  BOOST_CHECK(wheel.recycle() == NULL);
+  t2->reuse(noop, at(20000), 0.0);
+  BOOST_CHECK(t2->sequence() != seq1);
+  wheel.insert(t2, at(10000));
+  BOOST_CHECK(!wheel.remove(t1, seq1));
+  BOOST_CHECK_EQUAL(wheel.size(), 1u);
+  BOOST_CHECK(wheel.remove(t2, t2->sequence()));
+  BOOST_CHECK(wheel.empty());
+  // freed by wheel
+  wheel.retire(t2);
+}
+
+BOOST_AUTO_TEST_CASE(testTimingWheelCascade)
+{
+  const int64_t delays[] = { 63000, 64000, 65000, 127500, 1000000,
+                             4095000, 4096000, 4097000, 300000000 };
+  for (size_t i = 0; i < sizeof delays / sizeof delays[0]; ++i)
+  {
+    TimingWheel wheel(kTick, kStart);
+    Timer* timer = newTimer(delays[i]);
+    wheel.insert(timer, at(0));
+    int64_t fired = firesAt(&wheel, timer, delays[i] + 1000000);
+    // rounds up to the end of tick
+    BOOST_CHECK_EQUAL(fired, (delays[i] + 999) / 1000 * 1000);
+    BOOST_CHECK(wheel.empty());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(testTimingWheelNextExpiration)
+{
+  TimingWheel wheel(kTick, kStart);
+  Timer* far = newTimer(10000000);
+  wheel.insert(far, at(0));
+  // wakes up for cascading only
+  BOOST_CHECK_EQUAL(wheel.nextExpiration().microSecondsSinceEpoch(),
+                    at(64000).microSecondsSinceEpoch());
+
+  Timer* near = newTimer(3000);
+  wheel.insert(near, at(0));
+  BOOST_CHECK_EQUAL(wheel.nextExpiration().microSecondsSinceEpoch(),
+                    at(3000).microSecondsSinceEpoch());
+
+  std::vector<Timer*> expired;
+  wheel.advance(at(9999500), &expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+  BOOST_CHECK(expired[0] == near);
+  delete near;
+  expired.clear();
+  // far is deleted by wheel
+}
+
+BOOST_AUTO_TEST_CASE(testTimingWheelInsertAfterIdle)
+{
+  TimingWheel wheel(kTick, kStart);
+  Timer* t1 = newTimer(1000);
+  wheel.insert(t1, at(0));
+  std::vector<Timer*> expired;
+  wheel.advance(at(1000), &expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+  delete t1;
+  expired.clear();
+
+  // an hour later, the empty wheel catches up, nothing to walk through
+  const int64_t hour = static_cast<int64_t>(3600) * Timestamp::kMicroSecondsPerSecond;
+  Timer* t2 = newTimer(hour + 5000);
+  Timestamp when = wheel.insert(t2, at(hour + 200));
+  BOOST_CHECK_EQUAL(when.microSecondsSinceEpoch(),
+                    at(hour + 5000).microSecondsSinceEpoch());
+  BOOST_CHECK_EQUAL(wheel.nextExpiration().microSecondsSinceEpoch(),
+                    at(hour + 5000).microSecondsSinceEpoch());
+
+  wheel.advance(at(hour + 4000), &expired);
+  BOOST_CHECK(expired.empty());
+  wheel.advance(at(hour + 5000), &expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+  BOOST_CHECK(expired[0] == t2);
+  delete t2;
+  expired.clear();
+
+  // a timer in the past fires in the next tick
+  Timer* t3 = newTimer(hour);
+  when = wheel.insert(t3, at(hour + 7500));
+  BOOST_CHECK_EQUAL(when.microSecondsSinceEpoch(),
+                    at(hour + 8000).microSecondsSinceEpoch());
+  wheel.advance(at(hour + 8000), &expired);
+  BOOST_REQUIRE_EQUAL(expired.size(), 1u);
+  BOOST_CHECK(expired[0] == t3);
+  delete t3;
+}
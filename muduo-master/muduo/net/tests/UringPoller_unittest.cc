@@ -0,0 +1,227 @@
+#include <muduo/net/poller/UringPoller.h>
+
+#include <muduo/net/Channel.h>
+#include <muduo/net/EventLoop.h>
+#include <muduo/net/InetAddress.h>
+#include <muduo/net/TcpClient.h>
+#include <muduo/net/TcpServer.h>
+
+#include <boost/bind.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+
+//#define BOOST_TEST_MODULE UringPollerTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// EventLoop picks UringPoller with MUDUO_USE_URING
+bool useUring()
+{
+  if (!UringPoller::available())
+  {
+    printf("io_uring is not available, skipped\n");
+    return false;
+  }
+  ::setenv("MUDUO_USE_URING", "1", 1);
+  return true;
+}
+
+void onPipeReadable(EventLoop* loop, int fd, string* received)
+{
+  char buf[64];
+  ssize_t n = ::read(fd, buf, sizeof buf);
+  if (n > 0)
+  {
+    received->append(buf, n);
+  }
+  if (received->size() >= 6)
+  {
+    loop->quit();
+  }
+}
+
+// echoes everything, counts connections
+class EchoServer
+{
+ public:
+  EchoServer(EventLoop* loop, const InetAddress& listenAddr)
+    : server_(loop, listenAddr, "EchoServer"),
+      connections_(0),
+      disconnections_(0)
+  {
+    server_.setConnectionCallback(
+        boost::bind(&EchoServer::onConnection, this, _1));
+    server_.setMessageCallback(
+        boost::bind(&EchoServer::onMessage, this, _1, _2, _3));
+    server_.start();
+  }
+
+  int connections() const { return connections_; }
+  int disconnections() const { return disconnections_; }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+      ++connections_;
+    else
+      ++disconnections_;
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    conn->send(buf);
+  }
+
+  TcpServer server_;
+  int connections_;
+  int disconnections_;
+};
+
+// sends message once connected, quits the loop after n clients got it back
+class EchoClient
+{
+ public:
+  EchoClient(EventLoop* loop, const InetAddress& serverAddr,
+             const string& message, int* done, int total)
+    : loop_(loop),
+      client_(loop, serverAddr, "EchoClient"),
+      message_(message),
+      done_(done),
+      total_(total)
+  {
+    client_.setConnectionCallback(
+        boost::bind(&EchoClient::onConnection, this, _1));
+    client_.setMessageCallback(
+        boost::bind(&EchoClient::onMessage, this, _1, _2, _3));
+    client_.connect();
+  }
+
+  const string& received() const { return received_; }
+
+ private:
+  void onConnection(const TcpConnectionPtr& conn)
+  {
+    if (conn->connected())
+    {
+      conn->send(message_);
+    }
+  }
+
+  void onMessage(const TcpConnectionPtr& conn, Buffer* buf, Timestamp)
+  {
+    received_ += buf->retrieveAllAsString();
+    if (received_.size() == message_.size())
+    {
+      conn->shutdown();
+      if (++*done_ == total_)
+      {
+        loop_->runAfter(0.1, boost::bind(&EventLoop::quit, loop_));
+      }
+    }
+  }
+
+  EventLoop* loop_;
+  TcpClient client_;
+  const string message_;
+  string received_;
+  int* done_;
+  const int total_;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(testUringPollerReadiness)
+{
+  if (!useUring())
+    return;
+
+  EventLoop loop;
+  int fds[2];
+  BOOST_REQUIRE(::pipe(fds) == 0);
+  string received;
+  Channel channel(&loop, fds[0]);
+  channel.setReadCallback(boost::bind(onPipeReadable, &loop, fds[0], &received));
+  channel.enableReading();
+
+  // wakes up by eventfd, and a timerfd
+  loop.runInLoop(boost::bind(::write, fds[1], "abc", 3));
+  loop.runAfter(0.05, boost::bind(::write, fds[1], "def", 3));
+  loop.runAfter(5.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+  BOOST_CHECK_EQUAL(received, "abcdef");
+
+  channel.disableAll();
+  channel.remove();
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+
+BOOST_AUTO_TEST_CASE(testUringPollerCompletionEcho)
+{
+  if (!useUring())
+    return;
+
+  EventLoop loop;
+  EchoServer server(&loop, InetAddress(32101, true));
+
+  // many more bytes than a recv buffer and the socket buffers,
+  // so reads and writes complete partially
+  string message;
+  for (int i = 0; message.size() < 4*1024*1024; ++i)
+  {
+    message += static_cast<char>('A' + i % 26);
+  }
+  int done = 0;
+  EchoClient client(&loop, InetAddress(32101, true), message, &done, 1);
+  loop.runAfter(10.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  BOOST_CHECK_EQUAL(done, 1);
+  BOOST_CHECK(client.received() == message);
+  BOOST_CHECK_EQUAL(server.connections(), 1);
+  BOOST_CHECK_EQUAL(server.disconnections(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(testUringPollerManyConnections)
+{
+  if (!useUring())
+    return;
+
+  EventLoop loop;
+  EchoServer server(&loop, InetAddress(32102, true));
+
+  // more connections than recv buffers
+  const int kClients = UringPoller::kNumRecvBuffers + 44;
+  int done = 0;
+  boost::ptr_vector<EchoClient> clients;
+  for (int i = 0; i < kClients; ++i)
+  {
+    char message[64];
+    snprintf(message, sizeof message, "hello from client %d", i);
+    clients.push_back(new EchoClient(&loop, InetAddress(32102, true),
+                                     string(UringPoller::kRecvBufferSize, 'x') + message,
+                                     &done, kClients));
+  }
+  loop.runAfter(10.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  BOOST_CHECK_EQUAL(done, kClients);
+  BOOST_CHECK_EQUAL(server.connections(), kClients);
+  for (int i = 0; i < kClients; ++i)
+  {
+    char message[64];
+    snprintf(message, sizeof message, "hello from client %d", i);
+    BOOST_CHECK(clients[i].received() == string(UringPoller::kRecvBufferSize, 'x') + message);
+  }
+}
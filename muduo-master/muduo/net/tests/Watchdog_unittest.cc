@@ -0,0 +1,67 @@
+#include <muduo/net/Watchdog.h>
+
+#include <muduo/net/EventLoop.h>
+
+#include <boost/bind.hpp>
+
+//#define BOOST_TEST_MODULE WatchdogTest
+#define BOOST_TEST_MAIN
+#define BOOST_TEST_DYN_LINK
+#include <boost/test/unit_test.hpp>
+
+using namespace muduo;
+using namespace muduo::net;
+
+namespace
+{
+
+// busy, the capture signal would cut a sleep short
+void spin(double seconds)
+{
+  Timestamp end(addTime(Timestamp::now(), seconds));
+  while (Timestamp::now() < end)
+  {
+  }
+}
+
+bool contains(const string& str, const char* substr)
+{
+  return str.find(substr) != string::npos;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(testSlowFunctor)
+{
+  EventLoop loop;
+  loop.setSlowThreshold(0.05);
+  loop.queueInLoop(boost::bind(spin, 0.3));
+  loop.runAfter(0.5, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  string reports = Watchdog::instance().reports();
+  // caught while running, with its stack, and when finished.
+  // doPendingFunctors() is inlined in release builds, loop() is not.
+  BOOST_CHECK(contains(reports, "pending functor running for"));
+  BOOST_CHECK(contains(reports, "EventLoop4loop"));
+  BOOST_CHECK(contains(reports, "pending functor took"));
+}
+
+BOOST_AUTO_TEST_CASE(testSlowIteration)
+{
+  EventLoop loop;
+  loop.setSlowThreshold(0.2);
+  // none of them is slow, the iteration is. Each one is far below the
+  // threshold, a busy machine may stretch it, which is then reported
+  // for itself, not for the iteration.
+  for (int i = 0; i < 600; ++i)
+  {
+    loop.queueInLoop(boost::bind(spin, 0.001));
+  }
+  loop.runAfter(1.0, boost::bind(&EventLoop::quit, &loop));
+  loop.loop();
+
+  string reports = Watchdog::instance().reports();
+  BOOST_CHECK(contains(reports, "iteration running for"));
+  BOOST_CHECK(contains(reports, "iteration took"));
+}
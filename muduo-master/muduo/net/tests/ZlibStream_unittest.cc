@@ -89,3 +89,32 @@ BOOST_AUTO_TEST_CASE(testZlibOutputStream5)
   printf("total %zd\n", output.readableBytes());
   BOOST_CHECK_EQUAL(stream.zlibErrorCode(), Z_STREAM_END);
 }
+
+BOOST_AUTO_TEST_CASE(testZlibOutputStreamGzip)
+{
+  muduo::net::Buffer output;
+  muduo::string input(100, 'x');
+  {
+    muduo::net::ZlibOutputStream stream(&output, true);
+    BOOST_CHECK(stream.write(input));
+  }
+  // gzip magic, and uncompressed size at the end
+  BOOST_CHECK_EQUAL(static_cast<unsigned char>(output.peek()[0]), 0x1f);
+  BOOST_CHECK_EQUAL(static_cast<unsigned char>(output.peek()[1]), 0x8b);
+  BOOST_CHECK_EQUAL(static_cast<unsigned char>(output.peek()[output.readableBytes() - 4]), 100);
+
+  muduo::string decompressed(200, '\0');
+  uLongf len = decompressed.size();
+  z_stream zs;
+  bzero(&zs, sizeof zs);
+  BOOST_CHECK_EQUAL(inflateInit2(&zs, MAX_WBITS + 16), Z_OK);
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(output.peek()));
+  zs.avail_in = static_cast<uInt>(output.readableBytes());
+  zs.next_out = reinterpret_cast<Bytef*>(&decompressed[0]);
+  zs.avail_out = static_cast<uInt>(len);
+  BOOST_CHECK_EQUAL(inflate(&zs, Z_FINISH), Z_STREAM_END);
+  BOOST_CHECK_EQUAL(zs.total_out, 100);
+  inflateEnd(&zs);
+  decompressed.resize(100);
+  BOOST_CHECK_EQUAL(decompressed, input);
+}